@@ -141,28 +141,28 @@ syntax keyword vifmOption contained aproposprg autochpos caseoptions cdpath cd
 		\ followlinks fusehome gdefault grepprg histcursor history hi hlsearch hls
 		\ iec ignorecase ic iooptions incsearch is laststatus lines locateprg ls
 		\ lsoptions lsview mediaprg milleroptions millerview mintimeoutlen number nu
-		\ numberwidth nuw previewprg quickview relativenumber rnu rulerformat ruf
-		\ runexec scrollbind scb scrolloff so sort sortgroups sortorder sortnumbers
-		\ shell sh shellflagcmd shcf shortmess shm showtabline stal sizefmt slowfs
-		\ smartcase scs statusline stl suggestoptions syncregs syscalls tabscope
-		\ tabstop timefmt timeoutlen title tm trash trashdir ts tuioptions to
-		\ undolevels ul vicmd viewcolumns vifminfo vimhelp vixcmd wildmenu wmnu
-		\ wildstyle wordchars wrap wrapscan ws
+		\ numberwidth nuw pollslowfs previewprg quickview relativenumber rnu
+		\ rulerformat ruf runexec scrollbind scb scrolloff so sort sortgroups
+		\ sortorder sortnumbers shell sh shellflagcmd shcf shortmess shm showtabline
+		\ stal sizefmt slowfs smartcase scs statusline stl suggestoptions syncregs
+		\ syscalls tabscope tabstop timefmt timeoutlen title tm trash trashdir ts
+		\ tuioptions to undolevels ul vicmd viewcolumns vifminfo vimhelp vixcmd
+		\ wildmenu wmnu wildstyle wordchars wrap wrapscan ws
 
 " Disabled boolean options
 syntax keyword vifmOption contained noautochpos nocf nochaselinks nodotfiles
 		\ nofastrun nofollowlinks nohlsearch nohls noiec noignorecase noic
 		\ noincsearch nois nolaststatus nols nolsview nomillerview nonumber nonu
-		\ noquickview norelativenumber nornu noscrollbind noscb norunexec
-		\ nosmartcase noscs nosortnumbers nosyscalls notitle notrash novimhelp
-		\ nowildmenu nowmnu nowrap nowrapscan nows
+		\ nopollslowfs noquickview norelativenumber nornu noscrollbind noscb
+		\ norunexec nosmartcase noscs nosortnumbers nosyscalls notitle notrash
+		\ novimhelp nowildmenu nowmnu nowrap nowrapscan nows
 
 " Inverted boolean options
 syntax keyword vifmOption contained invautochpos invcf invchaselinks invdotfiles
 		\ invfastrun invfollowlinks invhlsearch invhls inviec invignorecase invic
 		\ invincsearch invis invlaststatus invls invlsview invmillerview invnumber
-		\ invnu invquickview invrelativenumber invrnu invscrollbind invscb
-		\ invrunexec invsmartcase invscs invsortnumbers invsyscalls invtitle
+		\ invnu invpollslowfs invquickview invrelativenumber invrnu invscrollbind
+		\ invscb invrunexec invsmartcase invscs invsortnumbers invsyscalls invtitle
 		\ invtrash invvimhelp invwildmenu invwmnu invwrap invwrapscan invws
 
 " Expressions
@@ -49,6 +49,7 @@ static void process_general_args(args_t *args);
 static void show_help_msg(const char wrong_arg[]);
 static void show_version_msg(void);
 static void process_non_general_args(args_t *args);
+static void eval_remote_exprs(const args_t *args);
 static void quit_on_arg_parsing(int code);
 
 /* Command line arguments definition for getopt_long(). */
@@ -115,7 +116,8 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 				done = 1;
 				break;
 			case 'R': /* --remote-expr <expr> */
-				args->remote_expr = optarg;
+				args->nremote_exprs = add_to_string_array(&args->remote_exprs,
+						args->nremote_exprs, 1, optarg);
 				break;
 
 			case 'h': /* -h, --help */
@@ -187,7 +189,7 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 		}
 	}
 
-	if(args->remote_cmds != NULL || args->remote_expr != NULL)
+	if(args->remote_cmds != NULL || args->nremote_exprs != 0)
 	{
 		args->target_name = args->server_name;
 		args->server_name = NULL;
@@ -415,7 +417,8 @@ show_help_msg(const char wrong_arg[])
 	puts("  vifm --remote");
 	puts("    passes all arguments that left in command line to vifm server.\n");
 	puts("  vifm --remote-expr <expr>");
-	puts("    passes expression to vifm server and prints result.\n");
+	puts("    passes expression to vifm server and prints result, can be");
+	puts("    repeated to evaluate several expressions at once.\n");
 #endif
 	puts("  vifm -c <command> | +<command>");
 	puts("    run <command> on startup.\n");
@@ -449,7 +452,7 @@ show_version_msg(void)
 static void
 process_non_general_args(args_t *args)
 {
-	if(args->remote_cmds != NULL && args->remote_expr != NULL)
+	if(args->remote_cmds != NULL && args->nremote_exprs != 0)
 	{
 		fprintf(stderr, "%s\n", "--remote and --remote-expr can't be combined.");
 		quit_on_arg_parsing(EXIT_FAILURE);
@@ -467,17 +470,9 @@ process_non_general_args(args_t *args)
 		return;
 	}
 
-	if(args->remote_expr != NULL)
+	if(args->nremote_exprs != 0)
 	{
-		char *const result = ipc_eval(curr_stats.ipc, args->target_name,
-				args->remote_expr);
-		if(result == NULL)
-		{
-			fprintf(stderr, "%s\n", "Evaluating expression remotely failed.");
-			quit_on_arg_parsing(EXIT_FAILURE);
-		}
-		fprintf(stdout, "%s\n", result);
-		quit_on_arg_parsing(EXIT_SUCCESS);
+		eval_remote_exprs(args);
 		return;
 	}
 
@@ -507,6 +502,39 @@ process_non_general_args(args_t *args)
 	}
 }
 
+/* Evaluates all remote expressions at once and prints their results one per
+ * line (empty line for an expression that failed). */
+static void
+eval_remote_exprs(const args_t *args)
+{
+	size_t i;
+	int failed;
+
+	char **const results = reallocarray(NULL, args->nremote_exprs,
+			sizeof(*results));
+	if(results == NULL)
+	{
+		fprintf(stderr, "%s\n", "Not enough memory.");
+		quit_on_arg_parsing(EXIT_FAILURE);
+		return;
+	}
+
+	failed = ipc_eval_many(curr_stats.ipc, args->target_name, args->remote_exprs,
+			args->nremote_exprs, results);
+	if(failed)
+	{
+		fprintf(stderr, "%s\n", "Evaluating expression remotely failed.");
+	}
+
+	for(i = 0U; i < args->nremote_exprs; ++i)
+	{
+		fprintf(stdout, "%s\n", (results[i] == NULL ? "" : results[i]));
+	}
+
+	free_string_array(results, args->nremote_exprs);
+	quit_on_arg_parsing(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 /* Quits during argument parsing when it's allowed (e.g. not for remote
  * commands). */
 static void
@@ -527,6 +555,10 @@ args_free(args_t *args)
 		args->cmds = NULL;
 		args->ncmds = 0;
 
+		free_string_array(args->remote_exprs, args->nremote_exprs);
+		args->remote_exprs = NULL;
+		args->nremote_exprs = 0;
+
 		update_string(&args->startup_log_path, NULL);
 	}
 }
@@ -44,7 +44,8 @@ typedef struct
 	const char *server_name; /* Name of this server. */
 	const char *target_name; /* Name of target server. */
 	char **remote_cmds;      /* Arguments to pass to server instance. */
-	char *remote_expr;       /* Expression to evaluate remotely. */
+	char **remote_exprs;     /* Expressions to evaluate remotely. */
+	size_t nremote_exprs;    /* Number of remote expressions. */
 
 	char lwin_path[PATH_MAX + 1]; /* Chosen path of the left pane. */
 	char rwin_path[PATH_MAX + 1]; /* Chosen path of the right pane. */
@@ -23,25 +23,24 @@
 #include <windows.h>
 #endif
 
-#include <fcntl.h> /* open() */
-#include <sys/stat.h> /* O_RDONLY */
-#include <sys/types.h> /* pid_t ssize_t */
+#include <fcntl.h> /* FD_CLOEXEC F_* O_NONBLOCK fcntl() open() */
+#include <sys/stat.h> /* O_RDONLY stat */
+#include <sys/types.h> /* dev_t pid_t ssize_t */
 #ifndef _WIN32
-#include <sys/select.h> /* FD_* select */
-#include <sys/time.h> /* timeval */
 #include <sys/wait.h> /* WEXITSTATUS() WIFEXITED() waitpid() */
 #endif
 #include <signal.h> /* kill() */
-#include <unistd.h> /* execve() fork() select() */
+#include <unistd.h> /* execve() fork() pipe() read() write() */
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL wchar_t */
-#include <stdint.h> /* uintptr_t */
+#include <stdint.h> /* uint64_t uintptr_t */
 #include <stdlib.h> /* EXIT_FAILURE _Exit() free() malloc() */
-#include <string.h> /* memcpy() */
+#include <string.h> /* memcpy() strdup() */
 
 #include "cfg/config.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
@@ -50,7 +49,10 @@
 #include "utils/env.h"
 #include "utils/fs.h"
 #include "utils/log.h"
+#include "utils/macros.h"
 #include "utils/path.h"
+#include "utils/perf.h"
+#include "utils/poller.h"
 #include "utils/str.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
@@ -71,15 +73,26 @@
  *
  * Operations are displayed on designated job bar.
  *
+ * Tasks and operations are executed by a bounded pool of worker threads
+ * ('bgthreads' option).  Queued tasks are picked before queued operations and
+ * operations can't occupy all of the workers, so that quick interactive tasks
+ * aren't stuck behind long operations.  Number of operations that perform I/O
+ * on the same device at the same time is limited as well, the device is
+ * determined by a worker thread because stat() can block on slow mounts.
+ *
  * On non-Windows systems background thread reads data from error streams of
  * external applications, which are then displayed by main thread.  This thread
- * maintains its own list of jobs (via err_next field), which is added to by
- * building a temporary list with new_err_jobs pointing to its head.  Every job
- * that has associated external process has the following life cycle:
+ * waits on a poller (epoll on Linux) for error streams and a wake up pipe, new
+ * jobs are passed to it through a temporary list with new_err_jobs pointing to
+ * its head.  Every job that has associated external process has the following
+ * life cycle:
  *  1. Created by main thread and passed to error thread through new_err_jobs.
  *  2. Either gets marked by signal handler or its stream reaches EOF.
  *  3. Its in_use flag is reset.
  *  4. Main thread frees corresponding entry.
+ *
+ * Main thread is notified about changes in jobs via a pipe (see
+ * bg_notification_fd()).
  */
 
 /* Turns pointer (P) to field (F) of a structure (S) to address of that
@@ -100,13 +113,27 @@
 #define NO_JOB_ID INVALID_HANDLE_VALUE
 #endif
 
-/* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
-typedef struct
+/* Maximum number of operations that can perform I/O on the same device
+ * simultaneously. */
+#define MAX_TASKS_PER_DEVICE 2
+
+/* Structure with passed to worker threads so they can perform correct
+ * initialization/cleanup. */
+typedef struct background_task_args
 {
 	bg_task_func func; /* Function to execute in a background thread. */
 	void *args;        /* Argument to pass. */
 	bg_job_t *job;     /* Job identifier that corresponds to the task. */
+
+	/* Copy of job type, because job can be freed before the task is. */
+	int important; /* Whether this is an operation rather than a task. */
+	char *io_dir;  /* Directory whose device is yet to be determined or NULL. */
+	int resolving; /* Whether device is being determined at the moment. */
+	int has_dev;   /* Whether dev field is set. */
+	dev_t dev;     /* Device on which the operation performs I/O. */
+
+	/* Next task in the queue or in the list of running tasks. */
+	struct background_task_args *next;
 }
 background_task_args;
 
@@ -114,16 +141,25 @@ static void job_check(bg_job_t *job);
 static void job_free(bg_job_t *job);
 #ifndef _WIN32
 static void * error_thread(void *p);
-static int update_error_jobs(bg_job_t **jobs, fd_set *set);
-static void free_drained_jobs(bg_job_t **jobs);
-static void import_error_jobs(bg_job_t **jobs);
-static int make_ready_list(bg_job_t **jobs, fd_set *set);
+static void import_error_jobs(poller_t *poller);
+static int make_pipe(int fds[2]);
+static void drain_fd(int fd);
 static void report_error_msg(const char title[], const char text[]);
 static void append_error_msg(bg_job_t *job, const char err_msg[]);
 #endif
 static bg_job_t * add_background_job(pid_t pid, const char cmd[],
 		uintptr_t data, BgJobType type);
-static void * background_task_bootstrap(void *arg);
+static void enqueue_task(background_task_args *task);
+static int count_queued_tasks(void);
+static void remove_task(background_task_args **list,
+		background_task_args *task);
+static void * worker_thread(void *arg);
+static background_task_args * pick_task(void);
+static void resolve_device(background_task_args *task);
+static int device_is_busy(const background_task_args *task);
+static void free_task(background_task_args *task);
+static void run_task(background_task_args *task);
+static void notify_main_thread(void);
 static void set_current_job(bg_job_t *job);
 static void make_current_job_key(void);
 static int bg_op_cancel(bg_op_t *bg_op);
@@ -135,19 +171,50 @@ bg_job_t *bg_jobs = NULL;
 static bg_job_t *new_err_jobs;
 /* Mutex to protect new_err_jobs. */
 static pthread_mutex_t new_err_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
-/* Conditional variable to signal availability of new jobs in new_err_jobs. */
-static pthread_cond_t new_err_jobs_cond = PTHREAD_COND_INITIALIZER;
+/* Pipe used to wake up error thread when new_err_jobs isn't empty. */
+static int wake_pipe[2] = { -1, -1 };
+/* Pipe used to notify main thread about changes in state of jobs. */
+static int notify_pipe[2] = { -1, -1 };
 #endif
 
 /* Thread local storage for bg_job_t associated with active thread. */
 static pthread_key_t current_job;
 
+/* Mutex to protect state of the pool of worker threads. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Conditional variable to signal idle workers about changes in the pool. */
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+/* Tasks waiting for a worker, interactive tasks precede operations. */
+static background_task_args *queued_tasks;
+/* Tasks that are being executed by workers. */
+static background_task_args *running_tasks;
+/* Number of worker threads that exist. */
+static int nworkers;
+/* Number of worker threads that wait for a task. */
+static int nidle;
+/* Maximum number of worker threads. */
+static int max_workers = 1;
+
 void
 bg_init(void)
 {
 #ifndef _WIN32
 	pthread_t id;
-	const int err = pthread_create(&id, NULL, &error_thread, NULL);
+	int err;
+	poller_t *poller;
+
+	err = make_pipe(notify_pipe);
+	assert(err == 0);
+
+	poller = poller_create();
+	assert(poller != NULL);
+
+	err = make_pipe(wake_pipe);
+	assert(err == 0);
+	err = poller_add(poller, wake_pipe[0], NULL);
+	assert(err == 0);
+
+	err = pthread_create(&id, NULL, &error_thread, poller);
 	assert(err == 0);
 	(void)err;
 #endif
@@ -156,6 +223,16 @@ bg_init(void)
 	set_current_job(NULL);
 }
 
+int
+bg_notification_fd(void)
+{
+#ifndef _WIN32
+	return notify_pipe[0];
+#else
+	return -1;
+#endif
+}
+
 void
 bg_process_finished_cb(pid_t pid, int exit_code)
 {
@@ -175,6 +252,9 @@ bg_process_finished_cb(pid_t pid, int exit_code)
 		}
 		job = job->next;
 	}
+
+	/* This is called from a signal handler, but writing to a pipe is safe. */
+	notify_main_thread();
 }
 
 void
@@ -184,6 +264,11 @@ bg_check(void)
 	bg_job_t *prev;
 	bg_job_t *p;
 
+#ifndef _WIN32
+	/* Notifications are handled by this invocation. */
+	drain_fd(notify_pipe[0]);
+#endif
+
 	/* Quit if there is no jobs or list is unavailable (e.g. used by another
 	 * invocation of this function). */
 	if(head == NULL)
@@ -395,132 +480,71 @@ bg_and_wait_for_errors(char cmd[], const struct cancellation_t *cancellation)
 static void *
 error_thread(void *p)
 {
-	bg_job_t *jobs = NULL;
+	enum { MAX_READY = 64 };
+
+	poller_t *const poller = p;
 
 	(void)pthread_detach(pthread_self());
 	block_all_thread_signals();
 
 	while(1)
 	{
-		fd_set active, ready;
-		const int max_fd = update_error_jobs(&jobs, &active);
-		struct timeval timeout = { .tv_sec = 0, .tv_usec = 250*1000 }, ts = timeout;
+		void *ready[MAX_READY];
+		int i;
 
-		while(select(max_fd + 1, memcpy(&ready, &active, sizeof(active)), NULL,
-					NULL, &ts) > 0)
+		const int nready = poller_wait(poller, -1, ready, ARRAY_LEN(ready));
+		if(nready < 0)
 		{
-			int need_update_list = (jobs == NULL);
+			LOG_SERROR_MSG(errno, "Waiting for error streams failed");
+			continue;
+		}
 
-			bg_job_t **job = &jobs;
-			while(*job != NULL)
-			{
-				bg_job_t *const j = *job;
-				char err_msg[ERR_MSG_LEN];
-				ssize_t nread;
-
-				if(!FD_ISSET(j->fd, &ready))
-				{
-					goto next_job;
-				}
-
-				nread = read(j->fd, err_msg, sizeof(err_msg) - 1U);
-				if(nread < 0)
-				{
-					need_update_list = 1;
-					j->drained = 1;
-					goto next_job;
-				}
-
-				if(nread == 0)
-				{
-					/* Reached EOF, exclude corresponding file descriptor from the set,
-					 * cut the job out of our list and allow its deletion. */
-					FD_CLR(j->fd, &active);
-					*job = j->err_next;
-					pthread_spin_lock(&j->status_lock);
-					j->in_use = 0;
-					pthread_spin_unlock(&j->status_lock);
-					continue;
-				}
-
-				err_msg[nread] = '\0';
-				append_error_msg(j, err_msg);
-
-			next_job:
-				job = &j->err_next;
-			}
+		for(i = 0; i < nready; ++i)
+		{
+			bg_job_t *const j = ready[i];
+			char err_msg[ERR_MSG_LEN];
+			ssize_t nread;
 
-			if(!need_update_list)
-			{
-				pthread_mutex_lock(&new_err_jobs_lock);
-				need_update_list = (new_err_jobs != NULL);
-				pthread_mutex_unlock(&new_err_jobs_lock);
-			}
-			if(need_update_list)
+			if(j == NULL)
 			{
-				break;
+				/* Wake up request. */
+				drain_fd(wake_pipe[0]);
+				import_error_jobs(poller);
+				continue;
 			}
 
-			ts = timeout;
-		}
-	}
-	return NULL;
-}
-
-/* Updates *jobs by removing finished tasks and adding new ones.  Initializes
- * *set set.  Returns max file descriptor number of the set. */
-static int
-update_error_jobs(bg_job_t **jobs, fd_set *set)
-{
-	free_drained_jobs(jobs);
-	import_error_jobs(jobs);
-	return make_ready_list(jobs, set);
-}
-
-/* Updates *jobs by removing finished tasks. */
-static void
-free_drained_jobs(bg_job_t **jobs)
-{
-	bg_job_t **job = jobs;
-	while(*job != NULL)
-	{
-		bg_job_t *const j = *job;
-
-		if(j->drained)
-		{
-			pthread_spin_lock(&j->status_lock);
-			/* If finished, reset in_use mark and drop it from the list. */
-			if(!j->running)
+			nread = read(j->fd, err_msg, sizeof(err_msg) - 1U);
+			if(nread <= 0)
 			{
+				/* Reached EOF or failed to read, exclude corresponding file descriptor
+				 * from the set and allow deletion of the job. */
+				poller_remove(poller, j->fd);
+				pthread_spin_lock(&j->status_lock);
 				j->in_use = 0;
-				*job = j->err_next;
 				pthread_spin_unlock(&j->status_lock);
+				notify_main_thread();
 				continue;
 			}
-			pthread_spin_unlock(&j->status_lock);
-		}
 
-		job = &j->err_next;
+			err_msg[nread] = '\0';
+			append_error_msg(j, err_msg);
+			notify_main_thread();
+		}
 	}
+	return NULL;
 }
 
-/* Updates *jobs by adding new tasks. */
+/* Starts waiting for error streams of newly started jobs. */
 static void
-import_error_jobs(bg_job_t **jobs)
+import_error_jobs(poller_t *poller)
 {
 	bg_job_t *new_jobs;
 
-	/* Add new tasks to internal list, wait if there are no jobs. */
 	pthread_mutex_lock(&new_err_jobs_lock);
-	while(*jobs == NULL && new_err_jobs == NULL)
-	{
-		pthread_cond_wait(&new_err_jobs_cond, &new_err_jobs_lock);
-	}
 	new_jobs = new_err_jobs;
 	new_err_jobs = NULL;
 	pthread_mutex_unlock(&new_err_jobs_lock);
 
-	/* Prepend new jobs to the list. */
 	while(new_jobs != NULL)
 	{
 		bg_job_t *const new_job = new_jobs;
@@ -529,38 +553,47 @@ import_error_jobs(bg_job_t **jobs)
 		assert(new_job->type == BJT_COMMAND &&
 				"Only external commands should be here.");
 
-		/* Mark a this job as an interesting one to avoid it being killed until we
-		 * have a chance to read error stream. */
-		new_job->drained = 0;
-
-		new_job->err_next = *jobs;
-		*jobs = new_job;
+		if(poller_add(poller, new_job->fd, new_job) != 0)
+		{
+			/* Can't read the stream, so don't hold the job. */
+			pthread_spin_lock(&new_job->status_lock);
+			new_job->in_use = 0;
+			pthread_spin_unlock(&new_job->status_lock);
+		}
 	}
 }
 
-/* Initializes *set set.  Returns max file descriptor number of the set. */
+/* Creates non-blocking pipe whose descriptors aren't inherited by child
+ * processes.  Returns zero on success, otherwise non-zero is returned. */
 static int
-make_ready_list(bg_job_t **jobs, fd_set *set)
+make_pipe(int fds[2])
 {
-	int max_fd = 0;
-	bg_job_t **job = jobs;
-
-	FD_ZERO(set);
+	int i;
 
-	while(*job != NULL)
+	if(pipe(fds) != 0)
 	{
-		bg_job_t *const j = *job;
-
-		FD_SET(j->fd, set);
-		if(j->fd > max_fd)
-		{
-			max_fd = j->fd;
-		}
+		fds[0] = -1;
+		fds[1] = -1;
+		return 1;
+	}
 
-		job = &j->err_next;
+	for(i = 0; i < 2; ++i)
+	{
+		(void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		(void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
 	}
+	return 0;
+}
 
-	return max_fd;
+/* Reads everything that's available from a non-blocking descriptor. */
+static void
+drain_fd(int fd)
+{
+	char buf[64];
+	while(fd != -1 && read(fd, buf, sizeof(buf)) > 0)
+	{
+		/* Do nothing. */
+	}
 }
 
 /* Either displays error message to the user for foreground operations or saves
@@ -903,7 +936,7 @@ bg_run_external(const char cmd[], int skip_errors, ShellRequester by)
 
 int
 bg_execute(const char descr[], const char op_descr[], int total, int important,
-		bg_task_func task_func, void *args)
+		const char io_dir[], bg_task_func task_func, void *args)
 {
 	pthread_t id;
 	int ret;
@@ -916,12 +949,19 @@ bg_execute(const char descr[], const char op_descr[], int total, int important,
 
 	task_args->func = task_func;
 	task_args->args = args;
+	task_args->important = important;
+	/* Failing to copy the path only lifts the limit for this operation. */
+	task_args->io_dir = (important && io_dir != NULL) ? strdup(io_dir) : NULL;
+	task_args->resolving = 0;
+	task_args->has_dev = 0;
+	task_args->dev = 0;
+	task_args->next = NULL;
 	task_args->job = add_background_job(WRONG_PID, descr, (uintptr_t)NO_JOB_ID,
 			important ? BJT_OPERATION : BJT_TASK);
 
 	if(task_args->job == NULL)
 	{
-		free(task_args);
+		free_task(task_args);
 		return 1;
 	}
 
@@ -934,21 +974,94 @@ bg_execute(const char descr[], const char op_descr[], int total, int important,
 	}
 
 	ret = 0;
-	if(pthread_create(&id, NULL, &background_task_bootstrap, task_args) != 0)
+
+	pthread_mutex_lock(&pool_lock);
+
+	max_workers = MAX(1, cfg.bg_threads);
+	enqueue_task(task_args);
+
+	/* Start new worker only if existing ones are busy. */
+	if(nworkers < max_workers && count_queued_tasks() > nidle)
 	{
+		if(pthread_create(&id, NULL, &worker_thread, NULL) == 0)
+		{
+			++nworkers;
+		}
+	}
+
+	if(nworkers == 0)
+	{
+		remove_task(&queued_tasks, task_args);
+
 		/* Mark job as finished with error. */
 		pthread_spin_lock(&task_args->job->status_lock);
 		task_args->job->running = 0;
 		task_args->job->exit_code = 1;
 		pthread_spin_unlock(&task_args->job->status_lock);
 
-		free(task_args);
+		free_task(task_args);
 		ret = 1;
 	}
+	else
+	{
+		/* Wake up all workers, because some of them might need to quit after
+		 * the limit was lowered. */
+		pthread_cond_broadcast(&pool_cond);
+	}
+
+	pthread_mutex_unlock(&pool_lock);
 
 	return ret;
 }
 
+/* Adds task to the queue according to its priority.  Should be called with
+ * pool_lock held. */
+static void
+enqueue_task(background_task_args *task)
+{
+	background_task_args **link = &queued_tasks;
+
+	/* Operations go to the end of the queue, while tasks are inserted before the
+	 * first operation. */
+	while(*link != NULL && (task->important || !(*link)->important))
+	{
+		link = &(*link)->next;
+	}
+
+	task->next = *link;
+	*link = task;
+}
+
+/* Counts tasks waiting in the queue.  Should be called with pool_lock held.
+ * Returns the number. */
+static int
+count_queued_tasks(void)
+{
+	int count = 0;
+	const background_task_args *task;
+	for(task = queued_tasks; task != NULL; task = task->next)
+	{
+		++count;
+	}
+	return count;
+}
+
+/* Removes task from the list.  Should be called with pool_lock held. */
+static void
+remove_task(background_task_args **list, background_task_args *task)
+{
+	while(*list != NULL && *list != task)
+	{
+		list = &(*list)->next;
+	}
+
+	if(*list != NULL)
+	{
+		*list = task->next;
+		task->next = NULL;
+	}
+}
+
 /* Creates structure that describes background job and registers it in the list
  * of jobs. */
 static bg_job_t *
@@ -985,7 +1098,11 @@ add_background_job(pid_t pid, const char cmd[], uintptr_t data, BgJobType type)
 		new->err_next = new_err_jobs;
 		new_err_jobs = new;
 		pthread_mutex_unlock(&new_err_jobs_lock);
-		pthread_cond_signal(&new_err_jobs_cond);
+
+		if(wake_pipe[1] != -1)
+		{
+			(void)write(wake_pipe[1], "", 1);
+		}
 	}
 #else
 	new->hprocess = (HANDLE)data;
@@ -1005,31 +1122,188 @@ add_background_job(pid_t pid, const char cmd[], uintptr_t data, BgJobType type)
 	return new;
 }
 
-/* pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
+/* pthreads entry point for a worker thread.  Executes queued tasks until
+ * number of workers exceeds the limit.  Returns result for this thread. */
 static void *
-background_task_bootstrap(void *arg)
+worker_thread(void *arg)
 {
-	background_task_args *const task_args = arg;
-
 	(void)pthread_detach(pthread_self());
 	block_all_thread_signals();
-	set_current_job(task_args->job);
 
-	task_args->func(&task_args->job->bg_op, task_args->args);
+	pthread_mutex_lock(&pool_lock);
+	while(nworkers <= max_workers)
+	{
+		background_task_args *const task = pick_task();
+		if(task == NULL)
+		{
+			++nidle;
+			pthread_cond_wait(&pool_cond, &pool_lock);
+			--nidle;
+			continue;
+		}
 
-	/* Mark task as finished normally. */
-	pthread_spin_lock(&task_args->job->status_lock);
-	task_args->job->running = 0;
-	task_args->job->exit_code = 0;
-	pthread_spin_unlock(&task_args->job->status_lock);
+		if(task->resolving)
+		{
+			/* The task is still in the queue, try again once its device is known. */
+			resolve_device(task);
+			continue;
+		}
+
+		pthread_mutex_unlock(&pool_lock);
+		run_task(task);
+		pthread_mutex_lock(&pool_lock);
+
+		remove_task(&running_tasks, task);
+		free_task(task);
 
-	free(task_args);
+		/* Finished task might have been blocking others. */
+		pthread_cond_broadcast(&pool_cond);
+	}
+	--nworkers;
+	pthread_mutex_unlock(&pool_lock);
 
 	return NULL;
 }
 
+/* Picks first queued task that can be started right away and moves it to the
+ * list of running tasks.  An operation whose device isn't known yet is returned
+ * with its resolving flag set and is left in the queue.  Should be called with
+ * pool_lock held.  Returns the task or NULL. */
+static background_task_args *
+pick_task(void)
+{
+	background_task_args **link;
+	const background_task_args *task;
+	int nops = 0;
+
+	for(task = running_tasks; task != NULL; task = task->next)
+	{
+		nops += task->important;
+	}
+	/* Determining device can block as well as running an operation. */
+	for(task = queued_tasks; task != NULL; task = task->next)
+	{
+		nops += task->resolving;
+	}
+
+	for(link = &queued_tasks; *link != NULL; link = &(*link)->next)
+	{
+		background_task_args *const candidate = *link;
+
+		/* Keep one worker available for tasks. */
+		if(candidate->important && max_workers > 1 && nops >= max_workers - 1)
+		{
+			continue;
+		}
+
+		if(candidate->resolving)
+		{
+			continue;
+		}
+
+		if(candidate->io_dir != NULL)
+		{
+			candidate->resolving = 1;
+			return candidate;
+		}
+
+		if(device_is_busy(candidate))
+		{
+			continue;
+		}
+
+		*link = candidate->next;
+		candidate->next = running_tasks;
+		running_tasks = candidate;
+		return candidate;
+	}
+
+	return NULL;
+}
+
+/* Determines device of the queued operation.  Should be called with pool_lock
+ * held, which is released for the duration of the check. */
+static void
+resolve_device(background_task_args *task)
+{
+	char *const io_dir = task->io_dir;
+	struct stat s;
+	int has_dev;
+
+	pthread_mutex_unlock(&pool_lock);
+	has_dev = (os_stat(io_dir, &s) == 0);
+	pthread_mutex_lock(&pool_lock);
+
+	task->has_dev = has_dev;
+	task->dev = has_dev ? s.st_dev : 0;
+	task->io_dir = NULL;
+	task->resolving = 0;
+	free(io_dir);
+}
+
+/* Checks whether limit on number of operations running on the same device as
+ * the task is reached.  Should be called with pool_lock held.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+device_is_busy(const background_task_args *task)
+{
+	const background_task_args *running;
+	int on_dev = 0;
+
+	if(!task->has_dev)
+	{
+		return 0;
+	}
+
+	for(running = running_tasks; running != NULL; running = running->next)
+	{
+		on_dev += (running->has_dev && running->dev == task->dev);
+	}
+	return (on_dev >= MAX_TASKS_PER_DEVICE);
+}
+
+/* Frees task structure. */
+static void
+free_task(background_task_args *task)
+{
+	free(task->io_dir);
+	free(task);
+}
+
+/* Executes the task in the current thread and marks its job as finished. */
+static void
+run_task(background_task_args *task)
+{
+	uint64_t start;
+
+	set_current_job(task->job);
+
+	start = perf_begin();
+	task->func(&task->job->bg_op, task->args);
+	perf_end(PK_BG_TASK, start, 0U);
+
+	/* Mark task as finished normally. */
+	pthread_spin_lock(&task->job->status_lock);
+	task->job->running = 0;
+	task->job->exit_code = 0;
+	pthread_spin_unlock(&task->job->status_lock);
+
+	set_current_job(NULL);
+	notify_main_thread();
+}
+
+/* Wakes up main thread if it waits for changes in state of jobs. */
+static void
+notify_main_thread(void)
+{
+#ifndef _WIN32
+	if(notify_pipe[1] != -1)
+	{
+		(void)write(notify_pipe[1], "", 1);
+	}
+#endif
+}
+
 /* Stores pointer to the job in a thread-local storage. */
 static void
 set_current_job(bg_job_t *job)
@@ -1164,6 +1438,7 @@ void
 bg_op_changed(bg_op_t *bg_op)
 {
 	ui_stat_job_bar_changed(bg_op);
+	notify_main_thread();
 }
 
 void
@@ -95,7 +95,6 @@ typedef struct bg_job_t
 	struct bg_job_t *next;     /* Link to the next element in bg_jobs list. */
 
 	/* Used by error thread for BJT_COMMAND jobs. */
-	int drained;               /* Whether error stream of no interest anymore. */
 	struct bg_job_t *err_next; /* Link to the next element in error read list. */
 }
 bg_job_t;
@@ -135,10 +134,17 @@ void bg_process_finished_cb(pid_t pid, int exit_code);
  * needed. */
 void bg_check(void);
 
-/* Starts new background task, which is run in a separate thread.  Returns zero
- * on success, otherwise non-zero is returned. */
+/* Retrieves file descriptor that becomes readable when state of jobs changes
+ * (bg_check() resets it).  Returns the descriptor or -1 if it's not
+ * available. */
+int bg_notification_fd(void);
+
+/* Starts new background task, which is run by one of worker threads.  io_dir
+ * specifies directory on whose device an important task (operation) performs
+ * I/O, it's ignored for other tasks and can be NULL.  Returns zero on success,
+ * otherwise non-zero is returned. */
 int bg_execute(const char descr[], const char op_descr[], int total,
-		int important, bg_task_func task_func, void *args);
+		int important, const char io_dir[], bg_task_func task_func, void *args);
 
 /* Checks whether there are any internal jobs (not external applications tracked
  * by vifm) running in background. */
@@ -27,6 +27,7 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
+#include "utils/trie.h"
 
 /* Single bookmark representation. */
 typedef struct
@@ -41,12 +42,19 @@ static int validate_tags(const char tags[]);
 static int change_bmark(const char path[], const char tags[], time_t timestamp,
 		int *ret);
 static int add_bmark(const char path[], const char tags[], time_t timestamp);
+static bmark_t * find_bmark(const char canonic_path[]);
+static trie_t * get_paths_index(void);
+static int index_bmark(trie_t *trie, size_t i);
+static void drop_paths_index(void);
 static void make_canonic(const char path[], char buf[], size_t buf_size);
 
 /* Array of the bookmarks. */
 static bmark_t *bmarks;
 /* Current number of bookmarks. */
 static size_t bmark_count;
+/* Maps paths of bookmarks to their positions in the array.  Built on first use
+ * and dropped when paths change. */
+static trie_t *paths_index;
 
 int
 bmarks_set(const char path[], const char tags[])
@@ -94,25 +102,23 @@ bmarks_remove(const char path[])
 static int
 change_bmark(const char path[], const char tags[], time_t timestamp, int *ret)
 {
-	size_t i;
+	bmark_t *bmark;
 	char canonic_path[strlen(path) + 16U];
 	make_canonic(path, canonic_path, sizeof(canonic_path));
 
 	/* Try to update tags of an existing bookmark. */
-	for(i = 0U; i < bmark_count; ++i)
+	bmark = find_bmark(canonic_path);
+	if(bmark == NULL)
 	{
-		if(stroscmp(canonic_path, bmarks[i].path) == 0)
-		{
-			*ret = replace_string(&bmarks[i].tags, tags);
-			if(*ret == 0)
-			{
-				bmarks[i].timestamp = timestamp;
-			}
-			return 0;
-		}
+		return 1;
 	}
 
-	return 1;
+	*ret = replace_string(&bmark->tags, tags);
+	if(*ret == 0)
+	{
+		bmark->timestamp = timestamp;
+	}
+	return 0;
 }
 
 /* Adds new bookmark.  Returns zero on success and non-zero otherwise. */
@@ -143,9 +149,90 @@ add_bmark(const char path[], const char tags[], time_t timestamp)
 	}
 
 	++bmark_count;
+
+	if(paths_index != NULL && index_bmark(paths_index, bmark_count - 1U) != 0)
+	{
+		drop_paths_index();
+	}
 	return 0;
 }
 
+/* Looks up bookmark by its path.  Returns pointer to the bookmark or NULL. */
+static bmark_t *
+find_bmark(const char canonic_path[])
+{
+	size_t i;
+	char *key;
+	void *data;
+
+	trie_t *const trie = get_paths_index();
+	if(trie != NULL && (key = stroskey(canonic_path)) != NULL)
+	{
+		const int found = (trie_get(trie, key, &data) == 0);
+		free(key);
+		return found ? &bmarks[(size_t)data] : NULL;
+	}
+
+	for(i = 0U; i < bmark_count; ++i)
+	{
+		if(stroscmp(canonic_path, bmarks[i].path) == 0)
+		{
+			return &bmarks[i];
+		}
+	}
+	return NULL;
+}
+
+/* Retrieves index of bookmarks building it if necessary.  Returns the index or
+ * NULL on error. */
+static trie_t *
+get_paths_index(void)
+{
+	size_t i;
+
+	if(paths_index != NULL)
+	{
+		return paths_index;
+	}
+
+	paths_index = trie_create();
+	/* Going backwards makes first of bookmarks with equal paths win. */
+	for(i = bmark_count; i-- > 0U && paths_index != NULL; )
+	{
+		if(index_bmark(paths_index, i) != 0)
+		{
+			drop_paths_index();
+		}
+	}
+	return paths_index;
+}
+
+/* Adds i-th bookmark to the index.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+index_bmark(trie_t *trie, size_t i)
+{
+	int error;
+
+	char *const key = stroskey(bmarks[i].path);
+	if(key == NULL)
+	{
+		return 1;
+	}
+
+	error = (trie_set(trie, key, (void *)i) < 0);
+	free(key);
+	return error;
+}
+
+/* Frees index of bookmarks, so that it's rebuilt on next use. */
+static void
+drop_paths_index(void)
+{
+	trie_free(paths_index);
+	paths_index = NULL;
+}
+
 void
 bmarks_list(bmarks_find_cb cb, void *arg)
 {
@@ -208,24 +295,18 @@ bmarks_clear(void)
 
 	bmarks = NULL;
 	bmark_count = 0U;
+	drop_paths_index();
 }
 
 int
 bmark_is_older(const char path[], time_t than)
 {
-	size_t i;
+	const bmark_t *bmark;
 	char canonic_path[strlen(path) + 16U];
 	make_canonic(path, canonic_path, sizeof(canonic_path));
 
-	for(i = 0U; i < bmark_count; ++i)
-	{
-		if(stroscmp(canonic_path, bmarks[i].path) == 0)
-		{
-			return bmarks[i].timestamp < than;
-		}
-	}
-
-	return 1;
+	bmark = find_bmark(canonic_path);
+	return (bmark == NULL || bmark->timestamp < than);
 }
 
 void
@@ -252,19 +333,17 @@ bmarks_complete(int n, char *tags[], const char str[])
 void
 bmarks_file_moved(const char src[], const char dst[])
 {
-	size_t i;
+	bmark_t *bmark;
 	char canonic_src[strlen(src) + 16U], canonic_dst[strlen(dst) + 16U];
 	make_canonic(src, canonic_src, sizeof(canonic_src));
 	make_canonic(dst, canonic_dst, sizeof(canonic_dst));
 
 	/* Renames bookmark. */
-	for(i = 0U; i < bmark_count; ++i)
+	bmark = find_bmark(canonic_src);
+	if(bmark != NULL)
 	{
-		if(stroscmp(canonic_src, bmarks[i].path) == 0)
-		{
-			(void)replace_string(&bmarks[i].path, canonic_dst);
-			break;
-		}
+		(void)replace_string(&bmark->path, canonic_dst);
+		drop_paths_index();
 	}
 }
 
@@ -22,11 +22,13 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcmp() strdup() strpbrk() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() strcmp() strdup() strlen() strpbrk() */
+#include <time.h> /* time() time_t */
 
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
 #include "engine/functions.h"
 #include "engine/text_buffer.h"
 #include "engine/var.h"
@@ -41,20 +43,66 @@
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
-#include "utils/trie.h"
 #include "utils/utils.h"
+#ifndef _WIN32
+#include "utils/utils_nix.h"
+#endif
 #include "filelist.h"
 #include "macros.h"
+#include "status.h"
 #include "types.h"
 
+/* Maximum number of files tracked by extcached(). */
+#define EXTCACHE_SIZE 128
+
+/* Maximum number of commands that are evaluated asynchronously. */
+#define ASYNC_CMDS_MAX 16
+
+/* Minimal number of seconds between two asynchronous runs of the same
+ * command by system(). */
+#define ASYNC_REFRESH_PERIOD 2
+
+/* Number of milliseconds after which asynchronously run command is
+ * interrupted. */
+#define ASYNC_TIMEOUT 10000
+
 /* A single entry of cache of external commands. */
 typedef struct
 {
-	fsddata_t *caches; /* A set of named caches. */
-	filemon_t mon;     /* File monitor. */
+	char *path;                   /* Canonical path to a file or NULL for
+	                                 unused entry. */
+	fsddata_t *caches;            /* A set of named caches of
+	                                 extcached_value_t. */
+	filemon_t mon;                /* File monitor. */
+	unsigned long long last_used; /* Use counter at the moment of last use. */
 }
 extcache_t;
 
+/* Value of a named cache of extcached(). */
+typedef struct
+{
+	unsigned long long pending; /* Number of asynchronous run of the command
+	                               whose result should replace the output or
+	                               zero. */
+	char output[];              /* Output of the command. */
+}
+extcached_value_t;
+
+/* State of asynchronous evaluation of a command.  Runs of each command are
+ * numbered starting with one, at most one run is active at a time.  Requests
+ * for a new run while one is active are coalesced into a single rerun. */
+typedef struct
+{
+	char *cmd;                    /* The command or NULL for unused entry. */
+	char *output;                 /* Output of the last run or NULL. */
+	unsigned long long started;   /* Number of the last started run. */
+	unsigned long long finished;  /* Number of the last finished run. */
+	int rerun;                    /* Whether another run was requested. */
+	time_t finished_at;           /* When the last run has finished. */
+	unsigned long long last_used; /* Use counter at the moment of last use. */
+}
+async_cmd_t;
+
 static var_t chooseopt_builtin(const call_info_t *call_info);
 static var_t executable_builtin(const call_info_t *call_info);
 static var_t expand_builtin(const call_info_t *call_info);
@@ -72,6 +120,18 @@ static var_t system_builtin(const call_info_t *call_info);
 static var_t tabpagenr_builtin(const call_info_t *call_info);
 static var_t term_builtin(const call_info_t *call_info);
 static var_t execute_cmd(var_t cmd_arg, int interactive, int preserve_stdin);
+static void strip_trailing_newlines(char str[], size_t *len);
+static int parse_async_arg(const call_info_t *call_info, int pos, int *async);
+static extcache_t * get_extcache(const char path[]);
+static void set_extcached_value(fsddata_t *caches, const char name[],
+		unsigned long long pending, const char output[]);
+static char * get_extcached_result(const char cmd[],
+		extcached_value_t *value);
+static unsigned long long request_extcached_run(const char cmd[]);
+static char * get_async_output(const char cmd[]);
+static async_cmd_t * find_async_cmd(const char cmd[], int create);
+static unsigned long long schedule_async_run(async_cmd_t *entry);
+static void * async_cmd_thread(void *arg);
 
 /* Function descriptions. */
 static const function_t functions[] = {
@@ -79,14 +139,14 @@ static const function_t functions[] = {
 	{ "chooseopt",   "query choose options",       {1,1}, &chooseopt_builtin },
 	{ "executable",  "check for executable file",  {1,1}, &executable_builtin },
 	{ "expand",      "expand macros in a string",  {1,1}, &expand_builtin },
-	{ "extcached",   "caches result of a command", {3,3}, &extcached_builtin },
+	{ "extcached",   "caches result of a command", {3,4}, &extcached_builtin },
 	{ "filetype",    "retrieve type of a file",    {1,2}, &filetype_builtin },
 	{ "fnameescape", "escapes string for a :cmd",  {1,1}, &fnameescape_builtin },
 	{ "getpanetype", "retrieve type of file list", {0,0}, &getpanetype_builtin},
 	{ "has",         "check for specific ability", {1,1}, &has_builtin },
 	{ "layoutis",    "query current layout",       {1,1}, &layoutis_builtin },
 	{ "paneisat",    "query pane location",        {1,1}, &paneisat_builtin },
-	{ "system",      "execute external command",   {1,1}, &system_builtin },
+	{ "system",      "execute external command",   {1,2}, &system_builtin },
 	{ "tabpagenr",   "number of current/last tab", {0,1}, &tabpagenr_builtin },
 	{ "term",        "run interactive command",    {1,1}, &term_builtin },
 };
@@ -94,6 +154,17 @@ static const function_t functions[] = {
 /* Kind of monitor used by the extcached(). */
 static FileMonType extcached_mon_type = FMT_CHANGED;
 
+/* Cache of the extcached() and its use counter. */
+static extcache_t extcache[EXTCACHE_SIZE];
+static unsigned long long extcache_uses;
+
+/* Commands evaluated asynchronously, their use counter and a flag that
+ * indicates that some output has changed.  Protected by async_lock. */
+static async_cmd_t async_cmds[ASYNC_CMDS_MAX];
+static unsigned long long async_cmds_uses;
+static int async_changed;
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void
 init_builtin_functions(void)
 {
@@ -106,6 +177,38 @@ init_builtin_functions(void)
 	}
 }
 
+void
+process_async_builtins(void)
+{
+	int changed;
+
+	pthread_mutex_lock(&async_lock);
+	changed = async_changed;
+	async_changed = 0;
+	pthread_mutex_unlock(&async_lock);
+
+	if(changed)
+	{
+		stats_redraw_later();
+	}
+}
+
+int
+async_builtins_running(void)
+{
+	int running = 0;
+	int i;
+
+	pthread_mutex_lock(&async_lock);
+	for(i = 0; i < ASYNC_CMDS_MAX && !running; ++i)
+	{
+		running = (async_cmds[i].started != async_cmds[i].finished);
+	}
+	pthread_mutex_unlock(&async_lock);
+
+	return running;
+}
+
 /* Retrieves values of options related to file choosing as a string.  On unknown
  * arguments empty string is returned. */
 static var_t
@@ -183,14 +286,15 @@ expand_builtin(const call_info_t *call_info)
 }
 
 /* Returns cached value of an external command.  Cache validity is bound to a
- * file. */
+ * file.  In asynchronous mode the command is run in background while the last
+ * known value (or an empty string) is returned. */
 static var_t
 extcached_builtin(const call_info_t *call_info)
 {
-	static trie_t *cache;
-	if(cache == NULL)
+	int async;
+	if(parse_async_arg(call_info, 3, &async) != 0)
 	{
-		cache = trie_create();
+		return var_error();
 	}
 
 	char *cache_name = var_to_str(call_info->argv[0]);
@@ -202,77 +306,233 @@ extcached_builtin(const call_info_t *call_info)
 	char *path = var_to_str(call_info->argv[1]);
 	if(path == NULL)
 	{
+		free(cache_name);
+		return var_error();
+	}
+
+	char *cmd = var_to_str(call_info->argv[2]);
+	if(cmd == NULL)
+	{
+		free(cache_name);
+		free(path);
 		return var_error();
 	}
 
 	char canonic[PATH_MAX + 1];
 	to_canonic_path(path, flist_get_dir(curr_view), canonic, sizeof(canonic));
-	replace_string(&path, canonic);
+	free(path);
 
-	extcache_t *cached = NULL;
-	void *data;
-	if(trie_get(cache, path, &data) == 0)
+	extcache_t *const cached = get_extcache(canonic);
+	if(cached == NULL)
 	{
-		cached = data;
+		free(cache_name);
+		free(cmd);
+		return var_error();
 	}
 
+	/* Output from before the file has changed, returned while the command is
+	 * run asynchronously. */
+	char *stale = NULL;
+
 	filemon_t current_mon = {};
-	if(filemon_from_file(path, extcached_mon_type, &current_mon) == 0 &&
-			cached != NULL)
+	if(filemon_from_file(canonic, extcached_mon_type, &current_mon) == 0 &&
+			cached->caches != NULL)
 	{
+		void *data;
+		const int found = (fsddata_get(cached->caches, cache_name, &data) == 0);
+		extcached_value_t *const value = data;
+
 		if(filemon_equal(&current_mon, &cached->mon))
 		{
-			void *cached_output;
-			if(fsddata_get(cached->caches, cache_name, &cached_output) == 0)
+			char *output = NULL;
+
+			if(found && value->pending == 0U)
+			{
+				output = strdup(value->output);
+			}
+			else if(found)
 			{
+				output = get_extcached_result(cmd, value);
+				if(output != NULL)
+				{
+					set_extcached_value(cached->caches, cache_name, 0U, output);
+				}
+				else if(async)
+				{
+					/* Keep waiting for the result of the current run. */
+					output = strdup(value->output);
+				}
+			}
+
+			if(output != NULL)
+			{
+				var_t result = var_from_str(output);
+				free(output);
 				free(cache_name);
-				free(path);
-				return var_from_str(cached_output);
+				free(cmd);
+				return result;
 			}
 		}
 		else
 		{
+			if(async && found)
+			{
+				stale = strdup(value->output);
+			}
 			fsddata_free(cached->caches);
 			cached->caches = NULL;
 		}
 	}
 
-	if(cached == NULL)
+	if(cached->caches == NULL)
 	{
-		cached = malloc(sizeof(*cached));
-		if(cached == NULL)
+		cached->caches = fsddata_create(0, 0);
+	}
+
+	filemon_assign(&cached->mon, &current_mon);
+
+	if(async)
+	{
+		const unsigned long long pending = request_extcached_run(cmd);
+		if(pending != 0U)
 		{
+			const char *const output = (stale == NULL ? "" : stale);
+			set_extcached_value(cached->caches, cache_name, pending, output);
+			var_t result = var_from_str(output);
+			free(stale);
 			free(cache_name);
-			free(path);
-			return var_error();
+			free(cmd);
+			return result;
 		}
+	}
+
+	free(stale);
+	free(cmd);
+
+	var_t output = execute_cmd(call_info->argv[2], call_info->interactive, 0);
+	char *const output_str = var_to_str(output);
+	if(output_str != NULL)
+	{
+		set_extcached_value(cached->caches, cache_name, 0U, output_str);
+		free(output_str);
+	}
+	free(cache_name);
+
+	return output;
+}
 
-		cached->caches = NULL;
+/* Finds cache entry of extcached() for the path creating it if necessary,
+ * which can evict least recently used entry.  Returns the entry or NULL on
+ * error. */
+static extcache_t *
+get_extcache(const char path[])
+{
+	extcache_t *lru = &extcache[0];
+	int i;
 
-		if(trie_set(cache, path, cached) < 0)
+	for(i = 0; i < EXTCACHE_SIZE; ++i)
+	{
+		extcache_t *const entry = &extcache[i];
+		if(entry->path != NULL && strcmp(entry->path, path) == 0)
 		{
-			free(cached);
-			free(cache_name);
-			free(path);
-			return var_error();
+			entry->last_used = ++extcache_uses;
+			return entry;
+		}
+
+		if(entry->last_used < lru->last_used)
+		{
+			lru = entry;
 		}
 	}
 
-	if(cached->caches == NULL)
+	char *const path_copy = strdup(path);
+	if(path_copy == NULL)
 	{
-		cached->caches = fsddata_create(0, 0);
+		return NULL;
 	}
 
-	filemon_assign(&cached->mon, &current_mon);
-	free(path);
+	free(lru->path);
+	fsddata_free(lru->caches);
 
-	var_t output = execute_cmd(call_info->argv[2], call_info->interactive, 0);
-	(void)fsddata_set(cached->caches, cache_name, var_to_str(output));
-	free(cache_name);
+	lru->path = path_copy;
+	lru->caches = NULL;
+	lru->last_used = ++extcache_uses;
+	return lru;
+}
+
+/* Sets value of a named cache of extcached(). */
+static void
+set_extcached_value(fsddata_t *caches, const char name[],
+		unsigned long long pending, const char output[])
+{
+	const size_t len = strlen(output);
+	extcached_value_t *const value = malloc(sizeof(*value) + len + 1U);
+	if(value == NULL)
+	{
+		return;
+	}
+
+	value->pending = pending;
+	memcpy(value->output, output, len + 1U);
+
+	if(fsddata_set(caches, name, value) != 0)
+	{
+		free(value);
+	}
+}
+
+/* Retrieves result of asynchronous run of the command that is awaited by the
+ * value.  Schedules a new run if there is no suitable one, in which case
+ * pending run of the value is updated.  Returns newly allocated string or NULL
+ * if the result isn't available yet. */
+static char *
+get_extcached_result(const char cmd[], extcached_value_t *value)
+{
+	char *output = NULL;
+
+	pthread_mutex_lock(&async_lock);
+
+	async_cmd_t *const entry = find_async_cmd(cmd, 1);
+	if(entry != NULL)
+	{
+		if(entry->finished >= value->pending && entry->output != NULL)
+		{
+			output = strdup(entry->output);
+		}
+		else if(entry->started == entry->finished)
+		{
+			/* Entry was evicted or run has failed. */
+			const unsigned long long pending = schedule_async_run(entry);
+			if(pending != 0U)
+			{
+				value->pending = pending;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&async_lock);
 
 	return output;
 }
 
+/* Requests asynchronous run of the command that starts after this call.
+ * Returns number of the run or zero on failure. */
+static unsigned long long
+request_extcached_run(const char cmd[])
+{
+	unsigned long long run = 0U;
+
+	pthread_mutex_lock(&async_lock);
+	async_cmd_t *const entry = find_async_cmd(cmd, 1);
+	if(entry != NULL)
+	{
+		run = schedule_async_run(entry);
+	}
+	pthread_mutex_unlock(&async_lock);
+
+	return run;
+}
+
 /* Modifies kind of monitor used by the extcached(). */
 TSTATIC void
 set_extcached_monitor_type(FileMonType type)
@@ -489,10 +749,32 @@ paneisat_builtin(const call_info_t *call_info)
 
 /* Runs the command in a shell and returns its output (joined standard output
  * and standard error streams).  All trailing newline characters are stripped to
- * allow easy appending to command output.  Returns the output. */
+ * allow easy appending to command output.  In asynchronous mode the command is
+ * run in background while the last known output (or an empty string) is
+ * returned.  Returns the output. */
 static var_t
 system_builtin(const call_info_t *call_info)
 {
+	int async;
+	if(parse_async_arg(call_info, 1, &async) != 0)
+	{
+		return var_error();
+	}
+
+	if(async)
+	{
+		char *const cmd = var_to_str(call_info->argv[0]);
+		char *const output = (cmd == NULL ? NULL : get_async_output(cmd));
+		free(cmd);
+
+		if(output != NULL)
+		{
+			var_t result = var_from_str(output);
+			free(output);
+			return result;
+		}
+	}
+
 	return execute_cmd(call_info->argv[0], call_info->interactive, 0);
 }
 
@@ -574,17 +856,212 @@ execute_cmd(var_t cmd_arg, int interactive, int preserve_stdin)
 		return var_from_str("");
 	}
 
-	/* Remove trailing new line characters. */
-	while(cmd_out_len != 0U && result_str[cmd_out_len - 1] == '\n')
-	{
-		result_str[cmd_out_len - 1] = '\0';
-		--cmd_out_len;
-	}
+	strip_trailing_newlines(result_str, &cmd_out_len);
 
 	result = var_from_str(result_str);
 	free(result_str);
 	return result;
 }
 
+/* Removes trailing new line characters from the string of length *len. */
+static void
+strip_trailing_newlines(char str[], size_t *len)
+{
+	while(*len != 0U && str[*len - 1] == '\n')
+	{
+		str[*len - 1] = '\0';
+		--*len;
+	}
+}
+
+/* Parses optional argument at position pos, which requests asynchronous
+ * evaluation.  Returns zero and sets *async on success, otherwise non-zero is
+ * returned. */
+static int
+parse_async_arg(const call_info_t *call_info, int pos, int *async)
+{
+	*async = 0;
+	if(call_info->argc <= pos)
+	{
+		return 0;
+	}
+
+	char *const mode = var_to_str(call_info->argv[pos]);
+	if(mode == NULL)
+	{
+		return 1;
+	}
+
+	if(strcmp(mode, "async") != 0)
+	{
+		vle_tb_append_linef(vle_err, "Invalid argument (expected \"async\"): %s",
+				mode);
+		free(mode);
+		return 1;
+	}
+
+	free(mode);
+	*async = 1;
+	return 0;
+}
+
+/* Retrieves last known output of asynchronously run command scheduling its
+ * update if it's outdated.  Returns newly allocated string or NULL if command
+ * can't be run asynchronously. */
+static char *
+get_async_output(const char cmd[])
+{
+	char *output = NULL;
+
+	pthread_mutex_lock(&async_lock);
+
+	async_cmd_t *const entry = find_async_cmd(cmd, 1);
+	if(entry != NULL)
+	{
+		if(entry->started == entry->finished &&
+				(entry->output == NULL ||
+				 time(NULL) - entry->finished_at >= ASYNC_REFRESH_PERIOD))
+		{
+			(void)schedule_async_run(entry);
+		}
+
+		if(entry->output != NULL || entry->started != entry->finished)
+		{
+			output = strdup(entry->output == NULL ? "" : entry->output);
+		}
+	}
+
+	pthread_mutex_unlock(&async_lock);
+
+	return output;
+}
+
+/* Finds state of asynchronously run command creating it if requested, which
+ * can evict state of least recently used command that's not running.  Must be
+ * called with async_lock held.  Returns the state or NULL. */
+static async_cmd_t *
+find_async_cmd(const char cmd[], int create)
+{
+	async_cmd_t *lru = NULL;
+	int i;
+
+	for(i = 0; i < ASYNC_CMDS_MAX; ++i)
+	{
+		async_cmd_t *const entry = &async_cmds[i];
+		if(entry->cmd != NULL && strcmp(entry->cmd, cmd) == 0)
+		{
+			entry->last_used = ++async_cmds_uses;
+			return entry;
+		}
+
+		if(entry->started == entry->finished &&
+				(lru == NULL || entry->last_used < lru->last_used))
+		{
+			lru = entry;
+		}
+	}
+
+	if(!create || lru == NULL)
+	{
+		return NULL;
+	}
+
+	char *const cmd_copy = strdup(cmd);
+	if(cmd_copy == NULL)
+	{
+		return NULL;
+	}
+
+	free(lru->cmd);
+	free(lru->output);
+
+	const async_cmd_t empty = { .cmd = cmd_copy, .last_used = ++async_cmds_uses };
+	*lru = empty;
+	return lru;
+}
+
+/* Makes sure that the command will be run after this call.  Must be called
+ * with async_lock held.  Returns number of the run or zero on failure. */
+static unsigned long long
+schedule_async_run(async_cmd_t *entry)
+{
+#ifndef _WIN32
+	pthread_t id;
+
+	if(entry->started != entry->finished)
+	{
+		entry->rerun = 1;
+		return entry->started + 1U;
+	}
+
+	++entry->started;
+	if(pthread_create(&id, NULL, &async_cmd_thread, entry) != 0)
+	{
+		--entry->started;
+		return 0U;
+	}
+	return entry->started;
+#else
+	/* Standard streams are redirected to run commands, which isn't possible to do
+	 * in background. */
+	return 0U;
+#endif
+}
+
+/* Entry point of a thread that runs a command asynchronously until there are
+ * no more requests for its runs.  Returns NULL. */
+static void *
+async_cmd_thread(void *arg)
+{
+#ifndef _WIN32
+	async_cmd_t *const entry = arg;
+
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	pthread_mutex_lock(&async_lock);
+	while(entry->started != entry->finished)
+	{
+		/* Entries aren't evicted while they run, so this is stable. */
+		const char *const cmd = entry->cmd;
+		const unsigned long long run = entry->started;
+		size_t len;
+		char *output;
+
+		pthread_mutex_unlock(&async_lock);
+
+		output = read_cmd_output_timed(cmd, ASYNC_TIMEOUT, &len);
+		if(output != NULL)
+		{
+			strip_trailing_newlines(output, &len);
+		}
+
+		pthread_mutex_lock(&async_lock);
+
+		if(output != NULL)
+		{
+			if(entry->output == NULL || strcmp(entry->output, output) != 0)
+			{
+				async_changed = 1;
+			}
+			free(entry->output);
+			entry->output = output;
+		}
+
+		entry->finished = run;
+		entry->finished_at = time(NULL);
+
+		if(entry->rerun)
+		{
+			entry->rerun = 0;
+			++entry->started;
+		}
+	}
+	pthread_mutex_unlock(&async_lock);
+#endif
+
+	return NULL;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
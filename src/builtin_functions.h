@@ -24,6 +24,14 @@
 /* Initializes builtin functions. */
 void init_builtin_functions(void);
 
+/* Checks whether output of any of asynchronously evaluated commands has changed
+ * and schedules redraw if so.  Should be called periodically. */
+void process_async_builtins(void);
+
+/* Checks whether there are commands being evaluated asynchronously.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int async_builtins_running(void);
+
 #ifdef TEST
 #include "utils/filemon.h"
 #endif
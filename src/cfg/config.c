@@ -169,6 +169,7 @@ cfg_init(void)
 	cfg.short_term_mux_titles = 0;
 
 	cfg.slow_fs_list = strdup("");
+	cfg.poll_slow_fs = 0;
 
 	cfg.cd_path = strdup(env_get_def("CDPATH", DEFAULT_CD_PATH));
 	replace_char(cfg.cd_path, ':', ',');
@@ -184,6 +185,8 @@ cfg_init(void)
 
 	cfg.chase_links = 0;
 
+	cfg.bg_threads = 4;
+
 	cfg.timeout_len = 1000;
 	cfg.min_timeout_len = 150;
 
@@ -254,6 +254,8 @@ typedef struct config_t
 
 	/* Comma-separated list of file system types which are slow to respond. */
 	char *slow_fs_list;
+	/* Whether changes on slow file systems are detected by polling. */
+	int poll_slow_fs;
 
 	/* Coma separated list of places to look for relative path to directories. */
 	char *cd_path;
@@ -283,6 +285,8 @@ typedef struct config_t
 	 * link expanded). */
 	int chase_links;
 
+	int bg_threads; /* Maximum number of threads running background tasks. */
+
 	int timeout_len;     /* Maximum period on waiting for the input. */
 	int min_timeout_len; /* Minimum period on waiting for the input. */
 
@@ -70,9 +70,7 @@ static void get_history(view_t *view, int reread, const char dir[],
 		const char file[], int rel_pos);
 static void set_manual_filter(view_t *view, const char value[]);
 static void set_view_property(view_t *view, char type, const char value[]);
-static int copy_file(const char src[], const char dst[]);
-static int copy_file_internal(FILE *src, FILE *dst);
-static void update_info_file(const char filename[], int merge);
+static int update_info_file(const char src[], const char dst[], int merge);
 static void process_hist_entry(view_t *view, const char dir[],
 		const char file[], int pos, char ***lh, int *nlh, int **lhp, size_t *nlhp);
 static char * convert_old_trash_path(const char trash_path[]);
@@ -498,85 +496,39 @@ write_info_file(void)
 {
 	char info_file[PATH_MAX + 16];
 	char tmp_file[PATH_MAX + 16];
+	filemon_t current_vifminfo_mon;
+	int vifminfo_changed;
 
 	(void)snprintf(info_file, sizeof(info_file), "%s/vifminfo", cfg.config_dir);
 	(void)snprintf(tmp_file, sizeof(tmp_file), "%s_%u", info_file, get_pid());
 
-	if(os_access(info_file, R_OK) != 0 || copy_file(info_file, tmp_file) == 0)
-	{
-		filemon_t current_vifminfo_mon;
-		int vifminfo_changed;
-
-		vifminfo_changed =
-			filemon_from_file(info_file, FMT_MODIFIED, &current_vifminfo_mon) != 0 ||
-			!filemon_equal(&vifminfo_mon, &current_vifminfo_mon);
-
-		update_info_file(tmp_file, vifminfo_changed);
-		(void)filemon_from_file(tmp_file, FMT_MODIFIED, &vifminfo_mon);
-
-		if(rename_file(tmp_file, info_file) != 0)
-		{
-			LOG_ERROR_MSG("Can't replace vifminfo file with its temporary copy");
-			(void)remove(tmp_file);
-		}
-	}
-}
+	vifminfo_changed =
+		filemon_from_file(info_file, FMT_MODIFIED, &current_vifminfo_mon) != 0 ||
+		!filemon_equal(&vifminfo_mon, &current_vifminfo_mon);
 
-/* Copies the src file to the dst location.  Returns zero on success. */
-static int
-copy_file(const char src[], const char dst[])
-{
-	FILE *const src_fp = os_fopen(src, "rb");
-	FILE *const dst_fp = os_fopen(dst, "wb");
-	int result;
-
-	result = copy_file_internal(src_fp, dst_fp);
-
-	if(dst_fp != NULL)
+	/* Merging reads the original file directly instead of its copy, the result
+	 * is written to a temporary file which then atomically replaces the
+	 * original. */
+	if(update_info_file(info_file, tmp_file, vifminfo_changed) != 0)
 	{
-		(void)fclose(dst_fp);
-	}
-	if(src_fp != NULL)
-	{
-		(void)fclose(src_fp);
-	}
-
-	if(result != 0)
-	{
-		(void)remove(dst);
+		(void)remove(tmp_file);
+		return;
 	}
 
-	return result;
-}
+	(void)filemon_from_file(tmp_file, FMT_MODIFIED, &vifminfo_mon);
 
-/* Internal sub-function of the copy_file() function.  Returns zero on
- * success. */
-static int
-copy_file_internal(FILE *src, FILE *dst)
-{
-	char buffer[4*1024];
-	size_t nread;
-
-	if(src == NULL || dst == NULL)
+	if(rename_file(tmp_file, info_file) != 0)
 	{
-		return 1;
-	}
-
-	while((nread = fread(&buffer[0], 1, sizeof(buffer), src)))
-	{
-		if(fwrite(&buffer[0], 1, nread, dst) != nread)
-		{
-			break;
-		}
+		LOG_ERROR_MSG("Can't replace vifminfo file with its temporary copy");
+		(void)remove(tmp_file);
 	}
-
-	return nread > 0;
 }
 
-/* Reads contents of the filename file as an info file and updates it with the
- * state of current instance. */
-static void
-update_info_file(const char filename[], int merge)
+/* Reads contents of the src file as an info file if merging is requested and
+ * writes it updated with the state of current instance into the dst file.
+ * Returns zero if dst file was written, otherwise non-zero is returned. */
+static int
+update_info_file(const char src[], const char dst[], int merge)
 {
 	/* TODO: refactor this function update_info_file() */
 
@@ -594,16 +546,17 @@ update_info_file(const char filename[], int merge)
 	char **dir_stack = NULL;
 	int ndir_stack = 0;
 	char *non_conflicting_marks;
+	int error = 1;
 
 	if(cfg.vifm_info == 0)
-		return;
+		return 1;
 
 	cmds_list = vle_cmds_list_udcs();
 	ncmds_list = count_strings(cmds_list);
 
 	non_conflicting_marks = strdup(valid_marks);
 
-	if(merge && (fp = os_fopen(filename, "r")) != NULL)
+	if(merge && (fp = os_fopen(src, "r")) != NULL)
 	{
 		size_t nlhp = 0UL, nrhp = 0UL, nbt = 0UL, nbmt = 0UL;
 		char *line = NULL, *line2 = NULL, *line3 = NULL, *line4 = NULL;
@@ -808,7 +761,7 @@ update_info_file(const char filename[], int merge)
 		fclose(fp);
 	}
 
-	if((fp = os_fopen(filename, "w")) != NULL)
+	if((fp = os_fopen(dst, "w")) != NULL)
 	{
 		fprintf(fp, "# You can edit this file by hand, but it's recommended not to "
 				"do that.\n");
@@ -901,7 +854,7 @@ update_info_file(const char filename[], int merge)
 			fprintf(fp, "c%s\n", cfg.cs.name);
 		}
 
-		fclose(fp);
+		error = (fclose(fp) != 0);
 	}
 
 	free_string_array(ft, nft);
@@ -925,6 +878,8 @@ update_info_file(const char filename[], int merge)
 	free_string_array(bmarks, nbmarks);
 	free_string_array(dir_stack, ndir_stack);
 	free(non_conflicting_marks);
+
+	return error;
 }
 
 /* Handles single directory history entry, possibly skipping merging it in. */
@@ -973,6 +928,7 @@ write_options(FILE *fp)
 	fputs("\n# Options:\n", fp);
 	fprintf(fp, "=aproposprg=%s\n", escape_spaces(cfg.apropos_prg));
 	fprintf(fp, "=%sautochpos\n", cfg.auto_ch_pos ? "" : "no");
+	fprintf(fp, "=bgthreads=%d\n", cfg.bg_threads);
 	fprintf(fp, "=cdpath=%s\n", cfg.cd_path);
 	fprintf(fp, "=%schaselinks\n", cfg.chase_links ? "" : "no");
 	fprintf(fp, "=columns=%d\n", cfg.columns);
@@ -1002,6 +958,9 @@ write_options(FILE *fp)
 	fprintf(fp, "=locateprg=%s\n", escape_spaces(cfg.locate_prg));
 	fprintf(fp, "=mediaprg=%s\n", escape_spaces(cfg.media_prg));
 	fprintf(fp, "=mintimeoutlen=%d\n", cfg.min_timeout_len);
+#ifndef _WIN32
+	fprintf(fp, "=%spollslowfs\n", cfg.poll_slow_fs ? "" : "no");
+#endif
 	fprintf(fp, "=%squickview\n", curr_stats.preview.on ? "" : "no");
 	fprintf(fp, "=rulerformat=%s\n", escape_spaces(cfg.ruler_format));
 	fprintf(fp, "=%srunexec\n", cfg.auto_execute ? "" : "no");
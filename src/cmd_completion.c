@@ -38,8 +38,8 @@
 #include <stddef.h> /* NULL size_t */
 #include <stdlib.h> /* free() */
 #include <stdio.h> /* snprintf() */
-#include <string.h> /* memcpy() strdup() strlen() strncasecmp() strncmp()
-                       strrchr() */
+#include <string.h> /* memcpy() strchr() strdup() strlen() strncasecmp()
+                       strncmp() strrchr() */
 
 #include "cfg/config.h"
 #include "compat/dtype.h"
@@ -92,6 +92,8 @@ static void complete_winrun(const char str[]);
 static void complete_from_string_list(const char str[], const char *items[][2],
 		size_t item_count, int ignore_case);
 static void complete_command_name(const char beginning[]);
+static void complete_indexed_names(const char dir[], char *names[],
+		size_t count, int skip_dot_files);
 static int filename_completion_in_dir(const char path[], const char str[],
 		CompletionType type);
 static void filename_completion_internal(DIR *dir, const char dir_path[],
@@ -874,11 +876,20 @@ complete_command_name(const char beginning[])
 	char ** paths;
 	size_t paths_count;
 	char *const cwd = save_cwd();
+	const int indexable = (strchr(beginning, '/') == NULL && beginning[0] != '~');
 
 	paths = get_paths(&paths_count);
 	for(i = 0U; i < paths_count; ++i)
 	{
-		if(vifm_chdir(paths[i]) == 0)
+		size_t count;
+		char **const names = indexable
+		                   ? get_path_dir_names(i, beginning, &count)
+		                   : NULL;
+		if(names != NULL)
+		{
+			complete_indexed_names(paths[i], names, count, beginning[0] == '\0');
+		}
+		else if(vifm_chdir(paths[i]) == 0)
 		{
 			filename_completion(beginning, CT_EXECONLY, 1);
 		}
@@ -888,6 +899,32 @@ complete_command_name(const char beginning[])
 	restore_cwd(cwd);
 }
 
+/* Adds executables among names of files in the directory to the list of
+ * completions. */
+static void
+complete_indexed_names(const char dir[], char *names[], size_t count,
+		int skip_dot_files)
+{
+	size_t i;
+	for(i = 0U; i < count; ++i)
+	{
+		char full_path[PATH_MAX + 1];
+
+		if(skip_dot_files && names[i][0] == '.')
+		{
+			continue;
+		}
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", dir, names[i]);
+		if(executable_exists(full_path))
+		{
+			vle_compl_add_path_match(names[i]);
+		}
+	}
+
+	vle_compl_finish_group();
+}
+
 /* Does filename completion outside current working directory.  Returns
  * completion start offset. */
 static int
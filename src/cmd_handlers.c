@@ -28,6 +28,7 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
 #include <errno.h>
+#include <limits.h> /* INT_MAX */
 #include <signal.h>
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* pclose() popen() snprintf() */
@@ -77,6 +78,7 @@
 #include "utils/matcher.h"
 #include "utils/matchers.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -239,6 +241,7 @@ static int map_or_remap(const cmd_info_t *cmd_info, int no_remap);
 static int normal_cmd(const cmd_info_t *cmd_info);
 static int nunmap_cmd(const cmd_info_t *cmd_info);
 static int only_cmd(const cmd_info_t *cmd_info);
+static int perf_cmd(const cmd_info_t *cmd_info);
 static int popd_cmd(const cmd_info_t *cmd_info);
 static int pushd_cmd(const cmd_info_t *cmd_info);
 static int put_cmd(const cmd_info_t *cmd_info);
@@ -666,6 +669,10 @@ const cmd_add_t cmds_list[] = {
 	  .descr = "switch to single-view mode",
 	  .flags = HAS_COMMENT,
 	  .handler = &only_cmd,        .min_args = 0,   .max_args = 0, },
+	{ .name = "perf",              .abbr = NULL,    .id = -1,
+	  .descr = "control recording of performance statistics",
+	  .flags = HAS_QUOTED_ARGS | HAS_COMMENT | HAS_ENVVARS,
+	  .handler = &perf_cmd,        .min_args = 0,   .max_args = 2, },
 	{ .name = "popd",              .abbr = NULL,    .id = -1,
 	  .descr = "pop top of directory stack",
 	  .flags = HAS_COMMENT,
@@ -826,7 +833,7 @@ const cmd_add_t cmds_list[] = {
 	{ .name = "tree",              .abbr = NULL,    .id = -1,
 	  .descr = "display filesystem as a tree",
 	  .flags = HAS_EMARK | HAS_COMMENT,
-	  .handler = &tree_cmd,        .min_args = 0,   .max_args = 0, },
+	  .handler = &tree_cmd,        .min_args = 0,   .max_args = 1, },
 	{ .name = "undolist",          .abbr = "undol", .id = -1,
 	  .descr = "display list of operations",
 	  .flags = HAS_EMARK | HAS_COMMENT,
@@ -3522,6 +3529,67 @@ only_cmd(const cmd_info_t *cmd_info)
 	return 0;
 }
 
+/* Controls recording of performance statistics or displays them. */
+static int
+perf_cmd(const cmd_info_t *cmd_info)
+{
+	const char *action;
+
+	if(cmd_info->argc == 0)
+	{
+		return show_perf_menu(curr_view) != 0;
+	}
+
+	action = cmd_info->argv[0];
+
+	if(strcmp(action, "export") == 0)
+	{
+		char path[PATH_MAX + 1];
+		char *expanded;
+
+		if(cmd_info->argc != 2)
+		{
+			return CMDS_ERR_TOO_FEW_ARGS;
+		}
+
+		expanded = expand_tilde(cmd_info->argv[1]);
+		to_canonic_path(expanded, flist_get_dir(curr_view), path, sizeof(path));
+		free(expanded);
+
+		if(perf_export_trace(path) != 0)
+		{
+			ui_sb_errf("Failed to write trace to: %s", path);
+			return 1;
+		}
+		ui_sb_msgf("Trace written to: %s", path);
+		return 1;
+	}
+
+	if(cmd_info->argc != 1)
+	{
+		return CMDS_ERR_TRAILING_CHARS;
+	}
+
+	if(strcmp(action, "on") == 0)
+	{
+		perf_enable(1);
+	}
+	else if(strcmp(action, "off") == 0)
+	{
+		perf_enable(0);
+	}
+	else if(strcmp(action, "reset") == 0)
+	{
+		perf_reset();
+	}
+	else
+	{
+		ui_sb_errf("Unknown action: %s", action);
+		return CMDS_ERR_CUSTOM;
+	}
+	return 0;
+}
+
 static int
 popd_cmd(const cmd_info_t *cmd_info)
 {
@@ -4350,16 +4418,27 @@ trashes_cmd(const cmd_info_t *cmd_info)
 static int
 tree_cmd(const cmd_info_t *cmd_info)
 {
+	int depth = INT_MAX;
 	int in_tree = flist_custom_active(curr_view)
 	           && cv_tree(curr_view->custom.type);
 
+	if(cmd_info->argc != 0)
+	{
+		const char *arg = cmd_info->argv[0];
+		if(!skip_prefix(&arg, "depth=") || !read_int(arg, &depth) || depth <= 0)
+		{
+			ui_sb_errf("Invalid argument: %s", cmd_info->argv[0]);
+			return CMDS_ERR_CUSTOM;
+		}
+	}
+
 	if(cmd_info->emark && in_tree)
 	{
 		cd_updir(curr_view, 1);
 	}
 	else
 	{
-		(void)flist_load_tree(curr_view, flist_get_dir(curr_view));
+		(void)flist_load_tree(curr_view, flist_get_dir(curr_view), depth);
 	}
 	return 0;
 }
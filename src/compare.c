@@ -42,6 +42,7 @@
 #include "utils/trie.h"
 #include "utils/utils.h"
 #include "filelist.h"
+#include "flist_pos.h"
 #include "fops_cpmv.h"
 #include "fops_misc.h"
 #include "running.h"
@@ -922,6 +923,7 @@ compare_move(view_t *from, view_t *to)
 		remove_last_path_component(canonical);
 		replace_string(&other->name, curr->name);
 		replace_string(&other->origin, canonical);
+		fpos_invalidate_index(to);
 	}
 	else
 	{
@@ -21,8 +21,8 @@
 #include <regex.h> /* regex_t regcomp() regexec() regfree() */
 
 #include <stddef.h> /* size_t */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcasecmp() strchr() strdup() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcasecmp() strchr() strdup() strlen() strpbrk() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/reallocarray.h"
@@ -31,6 +31,18 @@
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
+#include "../utils/trie.h"
+#include "../utils/utils.h"
+
+/* Kinds of patterns, which define how autocommands are looked up. */
+typedef enum
+{
+	PK_NAME,   /* Literal name of a file. */
+	PK_PATH,   /* Literal path. */
+	PK_PREFIX, /* Literal path followed by slash and double asterisk. */
+	PK_OTHER,  /* Anything else, needs to be matched against a regex. */
+}
+PatternKind;
 
 /* Describes single registered autocommand. */
 typedef struct
@@ -41,12 +53,51 @@ typedef struct
 	char *action;              /* Action to perform via handler. */
 	vle_aucmd_handler handler; /* Handler to invoke on event firing. */
 	int negated;               /* Whether pattern is negated. */
+	PatternKind kind;          /* Kind of the pattern. */
+	char *key;                 /* Lower case pattern without trailing asterisks
+	                              for kinds other than PK_OTHER. */
+	unsigned long long id;     /* Unique identifier that grows with each
+	                              registration. */
 }
 aucmd_info_t;
 
+/* List of positions of autocommands in ascending order. */
+typedef struct
+{
+	int *items; /* The positions. */
+	int count;  /* Number of items. */
+}
+pos_list_t;
+
+/* Index of autocommands of a single event. */
+typedef struct
+{
+	trie_t *names;     /* Keys of PK_NAME patterns mapped to pos_list_t. */
+	trie_t *paths;     /* Keys of PK_PATH patterns mapped to pos_list_t. */
+	trie_t *prefixes;  /* Keys of PK_PREFIX patterns mapped to pos_list_t. */
+	pos_list_t others; /* Autocommands of PK_OTHER kind. */
+	pos_list_t all;    /* All autocommands of the event. */
+}
+event_index_t;
+
 static int add_aucmd(const char event[], const char pattern[], int negated,
 		const char action[], vle_aucmd_handler handler);
+static PatternKind classify_pattern(const char pattern[], int negated,
+		char **key);
 static int is_pattern_match(const aucmd_info_t *autocmd, const char path[]);
+static int find_matches(const event_index_t *index, const char path[],
+		pos_list_t *matches);
+static void add_bucket(trie_t *trie, const char key[], pos_list_t *matches);
+static int pos_sorter(const void *first, const void *second);
+static event_index_t * get_event_index(const char event[]);
+static int build_index(void);
+static event_index_t * make_event_index(void);
+static int index_autocmd(event_index_t *index, int pos);
+static int add_to_bucket(trie_t *trie, const char key[], int pos);
+static int add_pos(pos_list_t *list, int pos);
+static void free_event_index(void *ptr);
+static void free_pos_list(void *ptr);
+static void invalidate_index(void);
 static void free_autocmd_data(aucmd_info_t *autocmd);
 static char ** get_patterns(const char patterns[], int *len);
 
@@ -55,6 +106,15 @@ static aucmd_info_t *autocmds;
 /* Declarations to enable use of DA_* on autocmds. */
 static DA_INSTANCE(autocmds);
 
+/* Identifier of the last registered autocommand. */
+static unsigned long long last_aucmd_id;
+
+/* Maps lower case names of events to event_index_t.  Built on demand and
+ * dropped on any change of the list of autocommands, which increments
+ * generation. */
+static trie_t *event_indexes;
+static unsigned int generation;
+
 /* Pattern expansion hook. */
 static vle_aucmd_expand_hook expand_hook = &strdup;
 
@@ -136,6 +196,8 @@ add_aucmd(const char event[], const char pattern[], int negated,
 	autocmd->negated = negated;
 	autocmd->action = strdup(action);
 	autocmd->handler = handler;
+	autocmd->kind = classify_pattern(pattern, negated, &autocmd->key);
+	autocmd->id = ++last_aucmd_id;
 	if(autocmd->event == NULL || autocmd->pattern == NULL ||
 			autocmd->action == NULL)
 	{
@@ -144,15 +206,53 @@ add_aucmd(const char event[], const char pattern[], int negated,
 	}
 
 	DA_COMMIT(autocmds);
-	/* TODO: sort by event name (case insensitive) and then by pattern? */
+	invalidate_index();
 	return 0;
 }
 
+/* Determines kind of the pattern and computes its key for lookups.  Returns
+ * the kind. */
+static PatternKind
+classify_pattern(const char pattern[], int negated, char **key)
+{
+	char lower[PATH_MAX + 1];
+	size_t len;
+
+	*key = NULL;
+
+	/* Negated patterns match almost everything, so there is no point in
+	 * indexing them. */
+	if(negated || str_to_lower(pattern, lower, sizeof(lower)) != 0)
+	{
+		return PK_OTHER;
+	}
+
+	len = strlen(lower);
+	if(len > 3U && ends_with(lower, "/**"))
+	{
+		/* Keep the slash, the pattern doesn't match the directory itself. */
+		lower[len - 2U] = '\0';
+		if(strpbrk(lower, "*?[\\") != NULL || (*key = strdup(lower)) == NULL)
+		{
+			return PK_OTHER;
+		}
+		return PK_PREFIX;
+	}
+
+	if(strpbrk(lower, "*?[\\") != NULL || (*key = strdup(lower)) == NULL)
+	{
+		return PK_OTHER;
+	}
+	return (strchr(lower, '/') == NULL ? PK_NAME : PK_PATH);
+}
+
 void
 vle_aucmd_execute(const char event[], const char path[], void *arg)
 {
-	size_t i;
 	char canonic_path[PATH_MAX + 1];
+	unsigned long long last_id = 0U;
+	const unsigned long long max_id = last_aucmd_id;
+	int done = 0;
 
 	canonicalize_path(path, canonic_path, sizeof(canonic_path));
 	if(!is_root_dir(canonic_path))
@@ -160,14 +260,308 @@ vle_aucmd_execute(const char event[], const char path[], void *arg)
 		chosp(canonic_path);
 	}
 
+	/* Handlers can change the list of autocommands, in which case matches are
+	 * looked up anew and only autocommands registered after the last invoked one
+	 * are considered.  Autocommands added by handlers aren't invoked, otherwise
+	 * a handler that re-registers itself would run indefinitely. */
+	while(!done)
+	{
+		int i;
+		pos_list_t matches = {};
+		const unsigned int gen = generation;
+
+		const event_index_t *const index = get_event_index(event);
+		if(index == NULL || find_matches(index, canonic_path, &matches) != 0)
+		{
+			free(matches.items);
+			break;
+		}
+
+		done = 1;
+		for(i = 0; i < matches.count; ++i)
+		{
+			const aucmd_info_t *const autocmd = &autocmds[matches.items[i]];
+			if(autocmd->id <= last_id || autocmd->id > max_id)
+			{
+				continue;
+			}
+
+			last_id = autocmd->id;
+			autocmd->handler(autocmd->action, arg);
+
+			if(generation != gen)
+			{
+				done = 0;
+				break;
+			}
+		}
+
+		free(matches.items);
+	}
+}
+
+/* Collects positions of autocommands of the event whose patterns match the
+ * path in the order of their registration.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+find_matches(const event_index_t *index, const char path[],
+		pos_list_t *matches)
+{
+	int i;
+	char lower[PATH_MAX + 1];
+
+	if(str_to_lower(path, lower, sizeof(lower)) != 0)
+	{
+		/* Can't use the index, check every autocommand. */
+		for(i = 0; i < index->all.count; ++i)
+		{
+			const int pos = index->all.items[i];
+			if(is_pattern_match(&autocmds[pos], path) && add_pos(matches, pos) != 0)
+			{
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	add_bucket(index->names, get_last_path_component(lower), matches);
+	add_bucket(index->paths, lower, matches);
+
+	/* Look up every parent directory, prefix keys end with a slash. */
+	char *p = lower;
+	while((p = strchr(p, '/')) != NULL)
+	{
+		const char c = *++p;
+		*p = '\0';
+		add_bucket(index->prefixes, lower, matches);
+		*p = c;
+	}
+
+	for(i = 0; i < index->others.count; ++i)
+	{
+		const int pos = index->others.items[i];
+		if(is_pattern_match(&autocmds[pos], path) && add_pos(matches, pos) != 0)
+		{
+			return 1;
+		}
+	}
+
+	safe_qsort(matches->items, matches->count, sizeof(*matches->items),
+			&pos_sorter);
+	return 0;
+}
+
+/* Appends positions stored in the trie for the key to the list. */
+static void
+add_bucket(trie_t *trie, const char key[], pos_list_t *matches)
+{
+	void *data;
+	if(trie_get(trie, key, &data) == 0)
+	{
+		const pos_list_t *const bucket = data;
+		int i;
+		for(i = 0; i < bucket->count; ++i)
+		{
+			(void)add_pos(matches, bucket->items[i]);
+		}
+	}
+}
+
+/* qsort() comparer that sorts positions in ascending order.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+pos_sorter(const void *first, const void *second)
+{
+	const int a = *(const int *)first;
+	const int b = *(const int *)second;
+	return (a > b) - (a < b);
+}
+
+/* Retrieves index of autocommands of the event building it if needed.  Returns
+ * the index or NULL if there are no autocommands for the event. */
+static event_index_t *
+get_event_index(const char event[])
+{
+	char lower[64];
+	void *data;
+
+	if(event_indexes == NULL && build_index() != 0)
+	{
+		return NULL;
+	}
+
+	if(str_to_lower(event, lower, sizeof(lower)) != 0 ||
+			trie_get(event_indexes, lower, &data) != 0)
+	{
+		return NULL;
+	}
+	return data;
+}
+
+/* Builds index of all autocommands.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+build_index(void)
+{
+	size_t i;
+
+	event_indexes = trie_create();
+	if(event_indexes == NULL)
+	{
+		return 1;
+	}
+
 	for(i = 0U; i < DA_SIZE(autocmds); ++i)
 	{
-		if(strcasecmp(event, autocmds[i].event) == 0 &&
-				is_pattern_match(&autocmds[i], canonic_path))
+		char lower[64];
+		void *data;
+		event_index_t *index;
+
+		if(str_to_lower(autocmds[i].event, lower, sizeof(lower)) != 0)
+		{
+			/* Such events can't be looked up, see get_event_index(). */
+			continue;
+		}
+
+		if(trie_get(event_indexes, lower, &data) == 0)
 		{
-			autocmds[i].handler(autocmds[i].action, arg);
+			index = data;
+		}
+		else
+		{
+			index = make_event_index();
+			if(index == NULL || trie_set(event_indexes, lower, index) < 0)
+			{
+				free_event_index(index);
+				invalidate_index();
+				return 1;
+			}
+		}
+
+		if(index_autocmd(index, i) != 0)
+		{
+			invalidate_index();
+			return 1;
 		}
 	}
+
+	return 0;
+}
+
+/* Allocates empty index of an event.  Returns the index or NULL on error. */
+static event_index_t *
+make_event_index(void)
+{
+	event_index_t *const index = calloc(1, sizeof(*index));
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	index->names = trie_create();
+	index->paths = trie_create();
+	index->prefixes = trie_create();
+	if(index->names == NULL || index->paths == NULL || index->prefixes == NULL)
+	{
+		free_event_index(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+/* Adds autocommand at specified position to the index.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+index_autocmd(event_index_t *index, int pos)
+{
+	const aucmd_info_t *const autocmd = &autocmds[pos];
+
+	if(add_pos(&index->all, pos) != 0)
+	{
+		return 1;
+	}
+
+	switch(autocmd->kind)
+	{
+		case PK_NAME:   return add_to_bucket(index->names, autocmd->key, pos);
+		case PK_PATH:   return add_to_bucket(index->paths, autocmd->key, pos);
+		case PK_PREFIX: return add_to_bucket(index->prefixes, autocmd->key, pos);
+		case PK_OTHER:  return add_pos(&index->others, pos);
+	}
+	return 1;
+}
+
+/* Appends position to a list stored in the trie for the key.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+add_to_bucket(trie_t *trie, const char key[], int pos)
+{
+	void *data;
+	if(trie_get(trie, key, &data) != 0)
+	{
+		data = calloc(1, sizeof(pos_list_t));
+		if(data == NULL || trie_set(trie, key, data) < 0)
+		{
+			free(data);
+			return 1;
+		}
+	}
+	return add_pos(data, pos);
+}
+
+/* Appends position to the list.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+add_pos(pos_list_t *list, int pos)
+{
+	int *const items = reallocarray(list->items, list->count + 1,
+			sizeof(*items));
+	if(items == NULL)
+	{
+		return 1;
+	}
+
+	list->items = items;
+	list->items[list->count++] = pos;
+	return 0;
+}
+
+/* Frees index of an event.  ptr can be NULL. */
+static void
+free_event_index(void *ptr)
+{
+	event_index_t *const index = ptr;
+	if(index != NULL)
+	{
+		trie_free_with_data(index->names, &free_pos_list);
+		trie_free_with_data(index->paths, &free_pos_list);
+		trie_free_with_data(index->prefixes, &free_pos_list);
+		free(index->others.items);
+		free(index->all.items);
+		free(index);
+	}
+}
+
+/* Frees list of positions allocated on heap.  ptr can be NULL. */
+static void
+free_pos_list(void *ptr)
+{
+	pos_list_t *const list = ptr;
+	if(list != NULL)
+	{
+		free(list->items);
+		free(list);
+	}
+}
+
+/* Drops index of autocommands, so it's rebuilt on next use. */
+static void
+invalidate_index(void)
+{
+	trie_free_with_data(event_indexes, &free_event_index);
+	event_indexes = NULL;
+	++generation;
 }
 
 /* Checks whether path matches pattern in the autocommand.  Returns non-zero if
@@ -214,6 +608,7 @@ vle_aucmd_remove(const char event[], const char patterns[])
 
 		free_autocmd_data(&autocmds[i]);
 		DA_REMOVE(autocmds, &autocmds[i]);
+		invalidate_index();
 	}
 
 	free_string_array(pats, len);
@@ -226,6 +621,7 @@ free_autocmd_data(aucmd_info_t *autocmd)
 	free(autocmd->event);
 	free(autocmd->pattern);
 	free(autocmd->action);
+	free(autocmd->key);
 	regfree(&autocmd->regex);
 }
 
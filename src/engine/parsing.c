@@ -16,25 +16,35 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
-/* The parsing and evaluation are mostly separated.  Currently parsing evaluates
- * values without side-effects, but this can be changed later.
+/* The parsing and evaluation are separated.  Parsing doesn't evaluate anything
+ * that can change between evaluations (like values of variables or options).
  *
  * Output of parsing phase is an expression tree, which is made of nodes of type
  * expr_t.  After parsing they either contain literals or specification of how
- * their value should be evaluated.  Expression value is evaluated at most once.
+ * their value should be evaluated.  Evaluation doesn't modify the tree, so it
+ * can be evaluated multiple times.
  *
- * There are two types of evaluation-time operations (part of Ops enumeration):
+ * There are three types of evaluation-time operations (part of Ops
+ * enumeration):
  *  1. With specific evaluation order requirements.
  *  2. With evaluation of all arguments before the node.
+ *  3. Without arguments, which query current state.
  *
  * First type corresponds to logical AND and OR operations, which evaluate their
  * arguments lazily from left to right.
  *
  * Second type is for the rest of builtins and user-provided functions.
  *
+ * Third type is for environment variables, builtin variables and options.
+ *
  * parse_or_expr() is a root-level parser of expressions and it basically
- * performs parsing phase.  parse_or_expr() evaluates expression, which is the
- * second phase.
+ * performs parsing phase.  eval_expr() evaluates expression, which is the
+ * second phase.  Operators applied to literals are evaluated right after
+ * parsing by fold_expr().
+ *
+ * Trees of completely parsed expressions are cached by text of the expression,
+ * because the same expressions get evaluated over and over again (e.g., those
+ * in 'statusline' on every cursor movement).
  *
  * If parsing stops before the end of an expression, partial result is stored in
  * global variables to be queried by client code (this way expressions can
@@ -61,6 +71,9 @@
 #define VAR_NAME_LENGTH_MAX 1024
 #define CMD_LINE_LENGTH_MAX 4096
 
+/* Number of slots in cache of parsed expressions. */
+#define EXPR_CACHE_SIZE 64
+
 /* Maximum number of characters in option's name. */
 static const size_t OPTION_NAME_MAX = 64;
 
@@ -97,10 +110,14 @@ TOKENS_TYPE;
 /* Types of evaluation operations. */
 typedef enum
 {
-	OP_NONE, /* The node has already been evaluated or is a literal. */
-	OP_OR,   /* Logical OR. */
-	OP_AND,  /* Logical AND. */
-	OP_CALL, /* Builtin operator implemented as a function or builtin function. */
+	OP_NONE,       /* The node is a literal. */
+	OP_OR,         /* Logical OR. */
+	OP_AND,        /* Logical AND. */
+	OP_CALL,       /* Builtin operator implemented as a function or builtin
+	                  function. */
+	OP_ENVVAR,     /* Value of an environment variable. */
+	OP_BUILTINVAR, /* Value of a builtin variable. */
+	OP_OPTION,     /* Value of an option (name can have "l:" or "g:" prefix). */
 }
 Ops;
 
@@ -111,18 +128,27 @@ typedef struct
 }
 eval_context_t;
 
-/* Defines expression and how to evaluate its value.  Value is stored here after
- * evaluation. */
+/* Defines expression and how to evaluate its value. */
 typedef struct expr_t
 {
-	var_t value;        /* Value of a literal or result of evaluation. */
+	var_t value;        /* Value of a literal. */
 	Ops op_type;        /* Type of operation. */
-	char *func;         /* Function (builtin or user) name for OP_CALL. */
+	char *name;         /* Function (builtin or user) name for OP_CALL or name
+	                       of a variable or an option. */
 	int nops;           /* Number of operands. */
 	struct expr_t *ops; /* Operands. */
 }
 expr_t;
 
+/* Entry of cache of parsed expressions. */
+typedef struct
+{
+	char *text;        /* Text of the expression or NULL for unused slot. */
+	expr_t expr;       /* Parsed and simplified expression. */
+	int prev_token_ws; /* Whether the token before the end was whitespace. */
+}
+cached_expr_t;
+
 /* Metadata container for static buffer. */
 typedef struct
 {
@@ -132,15 +158,23 @@ typedef struct
 }
 sbuffer;
 
-static int eval_expr(eval_context_t *ctx, expr_t *expr);
-static int eval_or_op(eval_context_t *ctx, int nops, expr_t ops[],
+static int take_cached_expr(const char text[], expr_t *expr);
+static void put_cached_expr(const char text[], expr_t *expr);
+static cached_expr_t * get_cache_slot(const char text[]);
+static int eval_expr(eval_context_t *ctx, const expr_t *expr, var_t *result);
+static int eval_or_op(eval_context_t *ctx, int nops, const expr_t ops[],
 		var_t *result);
-static int eval_and_op(eval_context_t *ctx, int nops, expr_t ops[],
+static int eval_and_op(eval_context_t *ctx, int nops, const expr_t ops[],
 		var_t *result);
 static int eval_call_op(eval_context_t *ctx, const char name[], int nops,
-		expr_t ops[], var_t *result);
+		const expr_t ops[], var_t *result);
 static int compare_variables(TOKENS_TYPE operation, var_t lhs, var_t rhs);
-static var_t eval_concat(eval_context_t *ctx, int nops, expr_t ops[]);
+static var_t eval_concat(int nops, const var_t args[]);
+static int eval_envvar(const char name[], var_t *result);
+static int eval_builtinvar(const char name[], var_t *result);
+static int eval_opt(const char name[], var_t *result);
+static void fold_expr(expr_t *expr);
+static int is_operator(const expr_t *expr);
 static int add_expr_op(expr_t *expr, const expr_t *arg);
 static void free_expr(const expr_t *expr);
 static expr_t parse_or_expr(const char **in);
@@ -156,9 +190,9 @@ static var_t parse_singly_quoted_string(const char **in);
 static int parse_singly_quoted_char(const char **in, sbuffer *sbuf);
 static var_t parse_doubly_quoted_string(const char **in);
 static int parse_doubly_quoted_char(const char **in, sbuffer *sbuf);
-static var_t eval_envvar(const char **in);
-static var_t eval_builtinvar(const char **in);
-static var_t eval_opt(const char **in);
+static expr_t parse_envvar(const char **in);
+static expr_t parse_builtinvar(const char **in);
+static expr_t parse_opt(const char **in);
 static expr_t parse_logical_not(const char **in);
 static int parse_sequence(const char **in, const char first[],
 		const char other[], size_t buf_len, char buf[]);
@@ -186,6 +220,9 @@ static var_t res_val;
 /* Empty expression to be returned on errors. */
 static expr_t null_expr;
 
+/* Cache of parsed expressions. */
+static cached_expr_t expr_cache[EXPR_CACHE_SIZE];
+
 /* Public interface --------------------------------------------------------- */
 
 void
@@ -213,6 +250,8 @@ ParsingErrors
 parse(const char input[], int interactive, var_t *result)
 {
 	expr_t expr_root;
+	int cacheable;
+	var_t value;
 
 	assert(initialized && "Parser must be initialized before use.");
 
@@ -220,8 +259,24 @@ parse(const char input[], int interactive, var_t *result)
 	last_token.type = BEGIN;
 
 	last_position = input;
-	get_next(&last_position);
-	expr_root = parse_or_expr(&last_position);
+
+	cacheable = take_cached_expr(input, &expr_root);
+	if(cacheable)
+	{
+		last_position += strlen(last_position);
+		last_token.type = END;
+	}
+	else
+	{
+		get_next(&last_position);
+		expr_root = parse_or_expr(&last_position);
+
+		cacheable = (last_error == PE_NO_ERROR && last_token.type == END);
+		if(cacheable)
+		{
+			fold_expr(&expr_root);
+		}
+	}
 	last_parsed_char = last_position;
 
 	var_free(res_val);
@@ -242,9 +297,9 @@ parse(const char input[], int interactive, var_t *result)
 				/* This is a comment, just ignore it. */
 				last_position += strlen(last_position);
 			}
-			else if(eval_expr(&ctx, &expr_root) == 0)
+			else if(eval_expr(&ctx, &expr_root, &value) == 0)
 			{
-				res_val = var_clone(expr_root.value);
+				res_val = value;
 				last_error = PE_INVALID_EXPRESSION;
 			}
 		}
@@ -252,10 +307,10 @@ parse(const char input[], int interactive, var_t *result)
 
 	if(last_error == PE_NO_ERROR)
 	{
-		if(eval_expr(&ctx, &expr_root) == 0)
+		if(eval_expr(&ctx, &expr_root, &value) == 0)
 		{
-			res_val = var_clone(expr_root.value);
-			*result = var_clone(expr_root.value);
+			res_val = var_clone(value);
+			*result = value;
 		}
 	}
 
@@ -264,7 +319,14 @@ parse(const char input[], int interactive, var_t *result)
 		last_position = skip_whitespace(input);
 	}
 
-	free_expr(&expr_root);
+	if(cacheable)
+	{
+		put_cached_expr(input, &expr_root);
+	}
+	else
+	{
+		free_expr(&expr_root);
+	}
 	return last_error;
 }
 
@@ -282,43 +344,101 @@ is_prev_token_whitespace(void)
 	return prev_token.type == WHITESPACE;
 }
 
+/* Expression caching ------------------------------------------------------- */
+
+/* Retrieves parsed expression from the cache.  The expression is removed from
+ * the cache for the time of its evaluation, which makes nested parsing safe.
+ * Returns non-zero if the expression was found, otherwise zero is returned. */
+static int
+take_cached_expr(const char text[], expr_t *expr)
+{
+	cached_expr_t *const slot = get_cache_slot(text);
+	if(slot->text == NULL || strcmp(slot->text, text) != 0)
+	{
+		return 0;
+	}
+
+	*expr = slot->expr;
+	prev_token.type = (slot->prev_token_ws ? WHITESPACE : SYM);
+
+	free(slot->text);
+	slot->text = NULL;
+	slot->expr = null_expr;
+	return 1;
+}
+
+/* Puts parsed expression into the cache, which takes ownership of it. */
+static void
+put_cached_expr(const char text[], expr_t *expr)
+{
+	cached_expr_t *const slot = get_cache_slot(text);
+	char *const text_copy = strdup(text);
+	if(text_copy == NULL)
+	{
+		free_expr(expr);
+		return;
+	}
+
+	free(slot->text);
+	free_expr(&slot->expr);
+
+	slot->text = text_copy;
+	slot->expr = *expr;
+	slot->prev_token_ws = (prev_token.type == WHITESPACE);
+}
+
+/* Finds slot of the cache that corresponds to the text.  Returns the slot,
+ * which can be occupied by a different expression. */
+static cached_expr_t *
+get_cache_slot(const char text[])
+{
+	/* djb2 hash by Dan Bernstein. */
+	unsigned int hash = 5381U;
+	while(*text != '\0')
+	{
+		hash = hash*33U + (unsigned char)*text++;
+	}
+	return &expr_cache[hash%EXPR_CACHE_SIZE];
+}
+
 /* Expression evaluation ---------------------------------------------------- */
 
-/* Evaluates values of an expression.  Returns zero on success, which means that
- * expr->value is now correct, otherwise non-zero is returned. */
+/* Evaluates value of an expression.  Returns zero on success, which means that
+ * *result holds a value that should be freed by the caller, otherwise non-zero
+ * is returned and *result isn't changed. */
 static int
-eval_expr(eval_context_t *ctx, expr_t *expr)
+eval_expr(eval_context_t *ctx, const expr_t *expr, var_t *result)
 {
-	int result = 1;
 	switch(expr->op_type)
 	{
 		case OP_NONE:
-			/* Do nothing, value is already available. */
+			*result = var_clone(expr->value);
 			return 0;
 		case OP_OR:
-			result = eval_or_op(ctx, expr->nops, expr->ops, &expr->value);
-			break;
+			return eval_or_op(ctx, expr->nops, expr->ops, result);
 		case OP_AND:
-			result = eval_and_op(ctx, expr->nops, expr->ops, &expr->value);
-			break;
+			return eval_and_op(ctx, expr->nops, expr->ops, result);
 		case OP_CALL:
-			assert(expr->func != NULL && "Function must have a name.");
-			result = eval_call_op(ctx, expr->func, expr->nops, expr->ops,
-					&expr->value);
-			break;
-	}
-	if(result == 0)
-	{
-		expr->op_type = OP_NONE;
+			assert(expr->name != NULL && "Function must have a name.");
+			return eval_call_op(ctx, expr->name, expr->nops, expr->ops, result);
+		case OP_ENVVAR:
+			return eval_envvar(expr->name, result);
+		case OP_BUILTINVAR:
+			return eval_builtinvar(expr->name, result);
+		case OP_OPTION:
+			return eval_opt(expr->name, result);
 	}
-	return result;
+
+	assert(0 && "Unhandled type of operation.");
+	return 1;
 }
 
 /* Evaluates logical OR operation.  All operands are evaluated lazily from left
  * to right.  Returns zero on success, otherwise non-zero is returned. */
 static int
-eval_or_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
+eval_or_op(eval_context_t *ctx, int nops, const expr_t ops[], var_t *result)
 {
+	var_t value;
 	int val;
 	int i;
 
@@ -328,28 +448,30 @@ eval_or_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
 		return 0;
 	}
 
-	if(eval_expr(ctx, &ops[0]) != 0)
+	if(eval_expr(ctx, &ops[0], &value) != 0)
 	{
 		return 1;
 	}
 
 	if(nops == 1)
 	{
-		*result = var_clone(ops[0].value);
+		*result = value;
 		return 0;
 	}
 
 	/* Conversion to integer so that strings are converted into numbers instead of
 	 * checked to be empty. */
-	val = var_to_int(ops[0].value);
+	val = var_to_int(value);
+	var_free(value);
 
 	for(i = 1; i < nops && !val; ++i)
 	{
-		if(eval_expr(ctx, &ops[i]) != 0)
+		if(eval_expr(ctx, &ops[i], &value) != 0)
 		{
 			return 1;
 		}
-		val |= var_to_int(ops[i].value);
+		val |= var_to_int(value);
+		var_free(value);
 	}
 
 	*result = var_from_bool(val);
@@ -359,8 +481,9 @@ eval_or_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
 /* Evaluates logical AND operation.  All operands are evaluated lazily from left
  * to right.  Returns zero on success, otherwise non-zero is returned. */
 static int
-eval_and_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
+eval_and_op(eval_context_t *ctx, int nops, const expr_t ops[], var_t *result)
 {
+	var_t value;
 	int val;
 	int i;
 
@@ -370,28 +493,30 @@ eval_and_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
 		return 0;
 	}
 
-	if(eval_expr(ctx, &ops[0]) != 0)
+	if(eval_expr(ctx, &ops[0], &value) != 0)
 	{
 		return 1;
 	}
 
 	if(nops == 1)
 	{
-		*result = var_clone(ops[0].value);
+		*result = value;
 		return 0;
 	}
 
 	/* Conversion to integer so that strings are converted into numbers instead of
 	 * checked to be empty. */
-	val = var_to_int(ops[0].value);
+	val = var_to_int(value);
+	var_free(value);
 
 	for(i = 1; i < nops && val; ++i)
 	{
-		if(eval_expr(ctx, &ops[i]) != 0)
+		if(eval_expr(ctx, &ops[i], &value) != 0)
 		{
 			return 1;
 		}
-		val &= var_to_int(ops[i].value);
+		val &= var_to_int(value);
+		var_free(value);
 	}
 
 	*result = var_from_bool(val);
@@ -401,95 +526,110 @@ eval_and_op(eval_context_t *ctx, int nops, expr_t ops[], var_t *result)
 /* Evaluates invocation operation.  All operands are evaluated beforehand.
  * Returns zero on success, otherwise non-zero is returned. */
 static int
-eval_call_op(eval_context_t *ctx, const char name[], int nops, expr_t ops[],
-		var_t *result)
+eval_call_op(eval_context_t *ctx, const char name[], int nops,
+		const expr_t ops[], var_t *result)
 {
 	int i;
+	const var_t *args;
+	call_info_t call_info;
+	var_t value = var_false();
+
+	function_call_info_init(&call_info, ctx->interactive);
 
 	for(i = 0; i < nops; ++i)
 	{
-		if(eval_expr(ctx, &ops[i]) != 0)
+		var_t arg;
+		if(eval_expr(ctx, &ops[i], &arg) != 0)
 		{
+			function_call_info_free(&call_info);
+			return 1;
+		}
+
+		function_call_info_add_arg(&call_info, arg);
+		if(call_info.argc != i + 1)
+		{
+			var_free(arg);
+			function_call_info_free(&call_info);
+			last_error = PE_INTERNAL;
 			return 1;
 		}
 	}
 
+	args = call_info.argv;
+
 	if(strcmp(name, "==") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(EQ, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(EQ, args[0], args[1]));
 	}
 	else if(strcmp(name, "!=") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(NE, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(NE, args[0], args[1]));
 	}
 	else if(strcmp(name, "<") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(LT, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(LT, args[0], args[1]));
 	}
 	else if(strcmp(name, "<=") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(LE, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(LE, args[0], args[1]));
 	}
 	else if(strcmp(name, ">") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(GT, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(GT, args[0], args[1]));
 	}
 	else if(strcmp(name, ">=") == 0)
 	{
 		assert(nops == 2 && "Must be two arguments.");
-		*result = var_from_bool(compare_variables(GE, ops[0].value, ops[1].value));
+		value = var_from_bool(compare_variables(GE, args[0], args[1]));
 	}
 	else if(strcmp(name, ".") == 0)
 	{
-		*result = eval_concat(ctx, nops, ops);
+		value = eval_concat(nops, args);
 	}
 	else if(strcmp(name, "!") == 0)
 	{
 		assert(nops == 1 && "Must be single argument.");
-		*result = var_from_bool(!var_to_int(ops[0].value));
+		value = var_from_bool(!var_to_int(args[0]));
 	}
 	else if(strcmp(name, "-") == 0 || strcmp(name, "+") == 0)
 	{
 		if(nops == 1)
 		{
-			const int val = var_to_int(ops[0].value);
-			*result = var_from_int(name[0] == '-' ? -val : val);
+			const int val = var_to_int(args[0]);
+			value = var_from_int(name[0] == '-' ? -val : val);
 		}
 		else
 		{
 			assert(nops == 2 && "Must be two arguments.");
-			const int a = var_to_int(ops[0].value);
-			const int b = var_to_int(ops[1].value);
-			*result = var_from_int(name[0] == '-' ? a - b : a + b);
+			const int a = var_to_int(args[0]);
+			const int b = var_to_int(args[1]);
+			value = var_from_int(name[0] == '-' ? a - b : a + b);
 		}
 	}
 	else
 	{
-		int i;
-		call_info_t call_info;
-		function_call_info_init(&call_info, ctx->interactive);
-
-		for(i = 0; i < nops; ++i)
-		{
-			function_call_info_add_arg(&call_info, var_clone(ops[i].value));
-		}
-
-		*result = function_call(name, &call_info);
-		if(result->type == VTYPE_ERROR)
+		value = function_call(name, &call_info);
+		if(value.type == VTYPE_ERROR)
 		{
 			last_error = PE_INVALID_EXPRESSION;
-			var_free(*result);
-			*result = var_false();
 		}
-		function_call_info_free(&call_info);
 	}
 
-	return (last_error != PE_NO_ERROR);
+	function_call_info_free(&call_info);
+
+	if(last_error != PE_NO_ERROR)
+	{
+		var_free(value);
+		return 1;
+	}
+
+	*result = value;
+	return 0;
 }
 
 /* Compares lhs and rhs variables by comparison operator specified by a token.
@@ -535,10 +675,10 @@ compare_variables(TOKENS_TYPE operation, var_t lhs, var_t rhs)
 	}
 }
 
-/* Evaluates concatenation of expressions.  Returns resultant value or variable
- * of type VTYPE_ERROR. */
+/* Evaluates concatenation of values.  Returns resultant value or variable of
+ * type VTYPE_ERROR. */
 static var_t
-eval_concat(eval_context_t *ctx, int nops, expr_t ops[])
+eval_concat(int nops, const var_t args[])
 {
 	char res[CMD_LINE_LENGTH_MAX + 1];
 	size_t res_len = 0U;
@@ -548,14 +688,14 @@ eval_concat(eval_context_t *ctx, int nops, expr_t ops[])
 
 	if(nops == 1)
 	{
-		return var_clone(ops[0].value);
+		return var_clone(args[0]);
 	}
 
 	res[0] = '\0';
 
 	for(i = 0; i < nops; ++i)
 	{
-		char *const str_val = var_to_str(ops[i].value);
+		char *const str_val = var_to_str(args[i]);
 		if(str_val == NULL)
 		{
 			last_error = PE_INTERNAL;
@@ -570,6 +710,144 @@ eval_concat(eval_context_t *ctx, int nops, expr_t ops[])
 	return (last_error == PE_NO_ERROR ? var_from_str(res) : var_error());
 }
 
+/* Evaluates value of an environment variable.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+eval_envvar(const char name[], var_t *result)
+{
+	*result = var_from_str(getenv_fu(name));
+	return 0;
+}
+
+/* Evaluates value of a builtin variable.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+eval_builtinvar(const char name[], var_t *result)
+{
+	const var_t value = getvar(name);
+	if(value.type == VTYPE_ERROR)
+	{
+		last_error = PE_INVALID_EXPRESSION;
+		return 1;
+	}
+
+	*result = var_clone(value);
+	return 0;
+}
+
+/* Evaluates value of an option.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+eval_opt(const char name[], var_t *result)
+{
+	OPT_SCOPE scope = OPT_ANY;
+	const opt_t *option;
+
+	if((name[0] == 'l' || name[0] == 'g') && name[1] == ':')
+	{
+		scope = (name[0] == 'l') ? OPT_LOCAL : OPT_GLOBAL;
+		name += 2;
+	}
+
+	option = find_option(name, scope);
+	if(option == NULL)
+	{
+		last_error = PE_INVALID_EXPRESSION;
+		return 1;
+	}
+
+	switch(option->type)
+	{
+		case OPT_STR:
+		case OPT_STRLIST:
+		case OPT_CHARSET:
+			*result = var_from_str(option->val.str_val);
+			return 0;
+
+		case OPT_BOOL:
+			*result = var_from_bool(option->val.bool_val);
+			return 0;
+
+		case OPT_INT:
+			*result = var_from_int(option->val.int_val);
+			return 0;
+
+		case OPT_ENUM:
+		case OPT_SET:
+			*result = var_from_str(get_value(option));
+			return 0;
+	}
+
+	assert(0 && "Unexpected option type");
+	last_error = PE_INTERNAL;
+	return 1;
+}
+
+/* Simplifies parsed expression by dropping nodes that don't affect the result
+ * and by evaluating operators whose operands are literals. */
+static void
+fold_expr(expr_t *expr)
+{
+	int i;
+	int all_literals = 1;
+	var_t value;
+	const ParsingErrors error = last_error;
+	eval_context_t ctx = { .interactive = 0 };
+
+	for(i = 0; i < expr->nops; ++i)
+	{
+		fold_expr(&expr->ops[i]);
+		all_literals &= (expr->ops[i].op_type == OP_NONE);
+	}
+
+	/* Logical operations and concatenation of a single operand result in the
+	 * operand. */
+	if(expr->nops == 1 && (expr->op_type == OP_OR || expr->op_type == OP_AND ||
+				(expr->op_type == OP_CALL && strcmp(expr->name, ".") == 0)))
+	{
+		const expr_t op = expr->ops[0];
+		free(expr->ops);
+		free(expr->name);
+		var_free(expr->value);
+		*expr = op;
+		return;
+	}
+
+	if(!all_literals || !is_operator(expr))
+	{
+		return;
+	}
+
+	if(eval_expr(&ctx, expr, &value) != 0)
+	{
+		last_error = error;
+		return;
+	}
+
+	free_expr(expr);
+	*expr = null_expr;
+	expr->value = value;
+}
+
+/* Checks whether expression is an operator, which doesn't have side-effects.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_operator(const expr_t *expr)
+{
+	switch(expr->op_type)
+	{
+		case OP_OR:
+		case OP_AND:
+			return 1;
+		case OP_CALL:
+			/* Names of functions start with a letter. */
+			return !isalpha((unsigned char)expr->name[0]);
+
+		default:
+			return 0;
+	}
+}
+
 /* Appends operand to an expression.  Returns zero on success, otherwise
  * non-zero is returned and the *op is freed. */
 static int
@@ -593,7 +871,7 @@ free_expr(const expr_t *expr)
 {
 	int i;
 
-	free(expr->func);
+	free(expr->name);
 	var_free(expr->value);
 
 	for(i = 0; i < expr->nops; ++i)
@@ -698,9 +976,9 @@ parse_comp_expr(const char **in)
 		return lhs;
 	}
 
-	result.func = strdup(last_token.str);
+	result.name = strdup(last_token.str);
 
-	if(add_expr_op(&result, &lhs) != 0 || result.func == NULL)
+	if(add_expr_op(&result, &lhs) != 0 || result.name == NULL)
 	{
 		free_expr(&result);
 		last_error = PE_INTERNAL;
@@ -748,8 +1026,8 @@ parse_factor(const char **in)
 		expr_t intermediate = { .op_type = OP_CALL };
 		expr_t next;
 
-		intermediate.func = strdup(last_token.str);
-		if(add_expr_op(&intermediate, &result) != 0 || intermediate.func == NULL)
+		intermediate.name = strdup(last_token.str);
+		if(add_expr_op(&intermediate, &result) != 0 || intermediate.name == NULL)
 		{
 			last_error = PE_INTERNAL;
 			free_expr(&intermediate);
@@ -790,8 +1068,8 @@ parse_concat_expr(const char **in)
 {
 	expr_t result = { .op_type = OP_CALL };
 
-	result.func = strdup(".");
-	if(result.func == NULL)
+	result.name = strdup(".");
+	if(result.name == NULL)
 	{
 		last_error = PE_INTERNAL;
 	}
@@ -861,11 +1139,11 @@ parse_term(const char **in)
 			break;
 		case DOLLAR:
 			get_next(in);
-			result.value = eval_envvar(in);
+			result = parse_envvar(in);
 			break;
 		case AMPERSAND:
 			get_next(in);
-			result.value = eval_opt(in);
+			result = parse_opt(in);
 			break;
 		case EMARK:
 			get_next(in);
@@ -893,7 +1171,7 @@ parse_term(const char **in)
 			{
 				if(**in == ':')
 				{
-					result.value = eval_builtinvar(in);
+					result = parse_builtinvar(in);
 				}
 				else
 				{
@@ -930,8 +1208,8 @@ parse_signed_number(const char **in)
 		return null_expr;
 	}
 
-	result.func = strdup((sign == 1) ? "+" : "-");
-	if(add_expr_op(&result, &op) != 0 || result.func == NULL)
+	result.name = strdup((sign == 1) ? "+" : "-");
+	if(add_expr_op(&result, &op) != 0 || result.name == NULL)
 	{
 		free_expr(&result);
 		last_error = PE_INTERNAL;
@@ -1102,32 +1380,41 @@ parse_doubly_quoted_char(const char **in, sbuffer *sbuf)
 }
 
 /* envvar ::= '$' envvarname */
-static var_t
-eval_envvar(const char **in)
+static expr_t
+parse_envvar(const char **in)
 {
+	expr_t result = { .op_type = OP_ENVVAR };
 	char name[VAR_NAME_LENGTH_MAX + 1];
+
 	if(!parse_sequence(in, ENV_VAR_NAME_FIRST_CHAR, ENV_VAR_NAME_CHARS,
 		sizeof(name), name))
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
+	}
+
+	result.name = strdup(name);
+	if(result.name == NULL)
+	{
+		last_error = PE_INTERNAL;
+		return null_expr;
 	}
 
-	return var_from_str(getenv_fu(name));
+	return result;
 }
 
 /* builtinvar ::= 'v:' varname */
-static var_t
-eval_builtinvar(const char **in)
+static expr_t
+parse_builtinvar(const char **in)
 {
-	var_t var_value;
+	expr_t result = { .op_type = OP_BUILTINVAR };
 	char name[VAR_NAME_LENGTH_MAX + 1];
 	strcpy(name, "v:");
 
 	if(last_token.c != 'v' || **in != ':')
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
 	}
 
 	get_next(in);
@@ -1138,70 +1425,65 @@ eval_builtinvar(const char **in)
 				sizeof(name) - 2U, &name[2]))
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
 	}
 
-	var_value = getvar(name);
-	if(var_value.type == VTYPE_ERROR)
+	if(getvar(name).type == VTYPE_ERROR)
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
 	}
 
-	return var_clone(var_value);
+	result.name = strdup(name);
+	if(result.name == NULL)
+	{
+		last_error = PE_INTERNAL;
+		return null_expr;
+	}
+
+	return result;
 }
 
-/* envvar ::= '&' [ 'l:' | 'g:' ] optname */
-static var_t
-eval_opt(const char **in)
+/* opt ::= '&' [ 'l:' | 'g:' ] optname */
+static expr_t
+parse_opt(const char **in)
 {
+	expr_t result = { .op_type = OP_OPTION };
 	OPT_SCOPE scope = OPT_ANY;
-	const opt_t *option;
-
-	char name[OPTION_NAME_MAX + 1];
+	char name[2 + OPTION_NAME_MAX + 1];
+	size_t prefix_len = 0U;
 
 	if((last_token.c == 'l' || last_token.c == 'g') && **in == ':')
 	{
 		scope = (last_token.c == 'l') ? OPT_LOCAL : OPT_GLOBAL;
+		name[prefix_len++] = last_token.c;
+		name[prefix_len++] = ':';
 		get_next(in);
 		get_next(in);
 	}
 
-	if(!parse_sequence(in, OPT_NAME_FIRST_CHAR, OPT_NAME_CHARS, sizeof(name),
-		name))
+	if(!parse_sequence(in, OPT_NAME_FIRST_CHAR, OPT_NAME_CHARS,
+				OPTION_NAME_MAX + 1, &name[prefix_len]))
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
 	}
 
-	option = find_option(name, scope);
-	if(option == NULL)
+	/* Validate the name here to report errors as early as possible. */
+	if(find_option(&name[prefix_len], scope) == NULL)
 	{
 		last_error = PE_INVALID_EXPRESSION;
-		return var_false();
+		return null_expr;
 	}
 
-	switch(option->type)
+	result.name = strdup(name);
+	if(result.name == NULL)
 	{
-		case OPT_STR:
-		case OPT_STRLIST:
-		case OPT_CHARSET:
-			return var_from_str(option->val.str_val);
-
-		case OPT_BOOL:
-			return var_from_bool(option->val.bool_val);
-
-		case OPT_INT:
-			return var_from_int(option->val.int_val);
-
-		case OPT_ENUM:
-		case OPT_SET:
-			return var_from_str(get_value(option));
-
-		default:
-			assert(0 && "Unexpected option type");
-			return var_false();
+		last_error = PE_INTERNAL;
+		return null_expr;
 	}
+
+	return result;
 }
 
 /* logical_not ::= '!' term */
@@ -1226,8 +1508,8 @@ parse_logical_not(const char **in)
 		return null_expr;
 	}
 
-	result.func = strdup("!");
-	if(result.func == NULL)
+	result.name = strdup("!");
+	if(result.name == NULL)
 	{
 		last_error = PE_INTERNAL;
 		free_expr(&result);
@@ -1295,7 +1577,7 @@ parse_funccall(const char **in)
 		return null_expr;
 	}
 
-	result.func = name;
+	result.name = name;
 
 	get_next(in);
 	skip_whitespace_tokens(in);
@@ -20,13 +20,17 @@
 #include "event_loop.h"
 
 #include <curses.h>
-#include <unistd.h>
+#ifndef _WIN32
+#include <poll.h> /* poll() pollfd POLLIN */
+#endif
+#include <unistd.h> /* STDIN_FILENO */
 
 #include <assert.h> /* assert() */
 #include <signal.h> /* signal() */
 #include <stddef.h> /* NULL size_t wchar_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* memmove() strncpy() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
 #include <wchar.h> /* wint_t wcslen() wcscmp() */
 
 #include "cfg/config.h"
@@ -38,6 +42,7 @@
 #include "modes/modes.h"
 #include "modes/wk.h"
 #include "ui/fileview.h"
+#include "ui/listing_cache.h"
 #include "ui/quickview.h"
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
@@ -49,6 +54,7 @@
 #include "utils/utils.h"
 #include "background.h"
 #include "bracket_notation.h"
+#include "builtin_functions.h"
 #include "filelist.h"
 #include "ipc.h"
 #include "registers.h"
@@ -57,6 +63,13 @@
 
 static int ensure_term_is_ready(void);
 static int get_char_async_loop(WINDOW *win, wint_t *c, int timeout);
+static void perform_async_tasks(void);
+static int read_char(WINDOW *win, wint_t *c, int timeout);
+#ifndef _WIN32
+static int wait_for_events(int timeout);
+static int add_view_fds(const view_t *view, struct pollfd fds[], int *nfds);
+static void add_fd(struct pollfd fds[], int *nfds, int fd);
+#endif
 static void process_scheduled_updates(void);
 TSTATIC int process_scheduled_updates_of_view(view_t *view);
 static void update_hardware_cursor(void);
@@ -122,9 +135,16 @@ event_loop(const int *quit)
 		 * waiting for the next key after timeout. */
 		do
 		{
-			const int actual_timeout = wait_for_suggestion
-			                         ? MIN(timeout, cfg.sug.delay)
-			                         : timeout;
+			/* Timeout matters only when there is a key sequence that can be
+			 * completed by it, otherwise wait for input indefinitely. */
+			const int key_timeout = (input_buf_pos == 0 || last_result == KEYS_WAIT)
+			                      ? -1
+			                      : timeout;
+			const int actual_timeout = !wait_for_suggestion
+			                         ? key_timeout
+			                         : key_timeout < 0
+			                         ? cfg.sug.delay
+			                         : MIN(key_timeout, cfg.sug.delay);
 
 			if(!ensure_term_is_ready())
 			{
@@ -132,10 +152,6 @@ event_loop(const int *quit)
 				continue;
 			}
 
-			modes_periodic();
-
-			bg_check();
-
 			got_input = (get_char_async_loop(status_bar, &c, actual_timeout) != ERR);
 
 			/* If suggestion delay timed out, reset it and wait the rest of the
@@ -143,7 +159,10 @@ event_loop(const int *quit)
 			if(!got_input && wait_for_suggestion)
 			{
 				wait_for_suggestion = 0;
-				timeout -= actual_timeout;
+				if(key_timeout >= 0)
+				{
+					timeout -= actual_timeout;
+				}
 				display_suggestion_box(input_buf);
 				continue;
 			}
@@ -331,74 +350,216 @@ ensure_term_is_ready(void)
  * performing the following tasks while waiting for input:
  *  - checks for new IPC messages;
  *  - checks whether contents of displayed directories changed;
+ *  - picks up directories listed in background;
+ *  - checks state of background jobs;
+ *  - checks for updates of asynchronously evaluated expressions;
+ *  - draws previews of files produced in background;
  *  - redraws UI if requested.
+ * The timeout is in milliseconds, negative value means waiting indefinitely.
  * Returns KEY_CODE_YES for functional keys (preprocesses *c in this case), OK
  * for wide character and ERR otherwise (e.g. after timeout). */
 static int
 get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 {
-	const int IPC_F = ipc_enabled() ? 10 : 1;
-
 	do
 	{
-		int i;
+		int result;
+		int waited;
+
+		perform_async_tasks();
+
+#ifndef _WIN32
+		/* Curses might have buffered input, so query it before waiting. */
+		result = read_char(win, c, 0);
+		if(result != ERR)
+		{
+			return result;
+		}
 
-		int delay_slice = DIV_ROUND_UP(MIN(cfg.min_timeout_len, timeout), IPC_F);
+		waited = wait_for_events(timeout);
+#else
+		/* Without a way to wait for events, check for them periodically. */
+		waited = (timeout < 0 ? cfg.min_timeout_len
+		                      : MIN(timeout, cfg.min_timeout_len));
+		waited = DIV_ROUND_UP(waited, ipc_enabled() ? 10 : 1);
 #ifdef __PDCURSES__
 		/* pdcurses performs delays in 50 ms intervals (1/20 of a second). */
-		delay_slice = MAX(50, delay_slice);
+		waited = MAX(50, waited);
 #endif
 
-		if(should_check_views_for_changes())
+		result = read_char(win, c, waited);
+		if(result != ERR)
 		{
-			check_view_for_changes(curr_view);
-			check_view_for_changes(other_view);
+			return result;
 		}
+#endif
 
-		process_scheduled_updates();
-
-		for(i = 0; i < IPC_F && timeout > 0; ++i)
+		if(timeout > 0)
 		{
-			int result;
+			timeout = MAX(0, timeout - waited);
+		}
+	}
+	while(timeout != 0);
 
-			ipc_check(curr_stats.ipc);
-			wtimeout(win, delay_slice);
-			timeout -= delay_slice;
+	return ERR;
+}
 
-			if(suggestions_are_visible)
-			{
-				/* Redraw suggestion box as it might have been hidden due to other
-				 * redraws. */
-				display_suggestion_box(curr_input_buf);
-			}
+/* Performs tasks that don't depend on input and are needed to keep state of
+ * the application up to date. */
+static void
+perform_async_tasks(void)
+{
+	if(should_check_views_for_changes())
+	{
+		/* Directories listed in background are picked up by the checks. */
+		(void)lcache_check_updates();
+		check_view_for_changes(curr_view);
+		check_view_for_changes(other_view);
+	}
 
-			/* Update cursor before waiting for input.  Modes set cursor correctly
-			 * within corresponding windows, but we need to call refresh on one of
-			 * them to make it active. */
-			update_hardware_cursor();
+	modes_periodic();
 
-			result = compat_wget_wch(win, c);
-			if(result != ERR)
-			{
-				if(result == KEY_CODE_YES)
-				{
-					*c = K(*c);
-				}
-				else if(*c == L'\0')
-				{
-					*c = WC_C_SPACE;
-				}
-				return result;
-			}
+	bg_check();
+
+	ipc_check(curr_stats.ipc);
+
+	process_async_builtins();
+
+	qv_process_async();
+
+	process_scheduled_updates();
+
+	if(suggestions_are_visible)
+	{
+		/* Redraw suggestion box as it might have been hidden due to other
+		 * redraws. */
+		display_suggestion_box(curr_input_buf);
+	}
+
+	/* Update cursor before waiting for input.  Modes set cursor correctly within
+	 * corresponding windows, but we need to call refresh on one of them to make
+	 * it active. */
+	update_hardware_cursor();
+}
+
+/* Reads single character waiting for at most timeout milliseconds.  Returns
+ * KEY_CODE_YES for functional keys (preprocesses *c in this case), OK for wide
+ * character and ERR otherwise. */
+static int
+read_char(WINDOW *win, wint_t *c, int timeout)
+{
+	int result;
 
-			process_scheduled_updates();
+	wtimeout(win, timeout);
+	result = compat_wget_wch(win, c);
+	if(result == KEY_CODE_YES)
+	{
+		*c = K(*c);
+	}
+	else if(result != ERR && *c == L'\0')
+	{
+		*c = WC_C_SPACE;
+	}
+	return result;
+}
+
+#ifndef _WIN32
+
+/* Blocks until there is input or some other event to process or timeout (in
+ * milliseconds, negative means infinity) expires.  Waiting is limited by
+ * 'mintimeoutlen' if some of the changes can only be detected by polling.
+ * Returns number of milliseconds spent waiting. */
+static int
+wait_for_events(int timeout)
+{
+	/* Input, jobs, previews, listings, IPC and up to three watchers per view. */
+	struct pollfd fds[4 + IPC_MAX_FDS + 2*3];
+	int nfds = 0;
+	int need_polling = modes_need_periodic() || async_builtins_running();
+	const int qv_fd = qv_async_fd();
+	struct timespec start, end;
+
+	add_fd(fds, &nfds, STDIN_FILENO);
+	add_fd(fds, &nfds, bg_notification_fd());
+	add_fd(fds, &nfds, qv_fd);
+	need_polling |= (qv_fd == -1 && qv_async_pending());
+
+	if(curr_stats.ipc != NULL)
+	{
+		int i;
+		int ipc_fds[IPC_MAX_FDS];
+		const int nipc_fds = ipc_get_fds(curr_stats.ipc, ipc_fds);
+		need_polling |= (nipc_fds < 0);
+		for(i = 0; i < nipc_fds; ++i)
+		{
+			add_fd(fds, &nfds, ipc_fds[i]);
 		}
 	}
-	while(timeout > 0);
 
-	return ERR;
+	if(should_check_views_for_changes())
+	{
+		const int lcache_fd = lcache_get_fd();
+		add_fd(fds, &nfds, lcache_fd);
+		need_polling |= (lcache_fd == -1 && lcache_is_busy());
+
+		need_polling |= add_view_fds(curr_view, fds, &nfds);
+		need_polling |= add_view_fds(other_view, fds, &nfds);
+	}
+
+	if(need_polling)
+	{
+		timeout = (timeout < 0 ? cfg.min_timeout_len
+		                       : MIN(timeout, cfg.min_timeout_len));
+	}
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	/* Errors (like EINTR on signals) are handled by the caller as spurious wake
+	 * ups. */
+	(void)poll(fds, nfds, timeout);
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return DIV_ROUND_UP((end.tv_sec - start.tv_sec)*1000000000LL +
+			(end.tv_nsec - start.tv_nsec), 1000000);
 }
 
+/* Adds descriptors that signal changes of the view to the set.  Returns
+ * non-zero if the view needs to be checked for changes periodically, otherwise
+ * zero is returned. */
+static int
+add_view_fds(const view_t *view, struct pollfd fds[], int *nfds)
+{
+	int i;
+	int watch_fds[2];
+	int nwatch_fds;
+
+	if(!window_shows_dirlist(view))
+	{
+		return 0;
+	}
+
+	nwatch_fds = flist_get_watch_fds(view, watch_fds);
+	for(i = 0; i < nwatch_fds; ++i)
+	{
+		add_fd(fds, nfds, watch_fds[i]);
+	}
+	return (nwatch_fds < 0);
+}
+
+/* Adds descriptor to the set of descriptors to wait on unless it's -1. */
+static void
+add_fd(struct pollfd fds[], int *nfds, int fd)
+{
+	if(fd != -1)
+	{
+		fds[*nfds].fd = fd;
+		fds[*nfds].events = POLLIN;
+		fds[*nfds].revents = 0;
+		++*nfds;
+	}
+}
+
+#endif
+
 /* Updates TUI or its elements if something is scheduled. */
 static void
 process_scheduled_updates(void)
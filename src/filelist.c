@@ -43,6 +43,7 @@
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "engine/autocmds.h"
 #include "engine/mode.h"
 #include "int/fuse.h"
@@ -52,10 +53,14 @@
 #include "ui/cancellation.h"
 #include "ui/column_view.h"
 #include "ui/fileview.h"
+#include "ui/listing_cache.h"
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/tabs.h"
 #include "ui/ui.h"
+#include "utils/change_poller.h"
+#include "utils/dir_cache.h"
+#include "utils/dir_lister.h"
 #include "utils/dynarray.h"
 #include "utils/env.h"
 #include "utils/fs.h"
@@ -65,6 +70,7 @@
 #include "utils/macros.h"
 #include "utils/matcher.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -85,15 +91,49 @@
 #include "status.h"
 #include "types.h"
 
+/* Number of threads that list directories while building tree-view. */
+#define TREE_LISTING_THREADS 4
+
+/* Maximum number of directories of a tree that are watched for changes to
+ * reuse their listings on reload.  Keeps usage of inotify watches, which are
+ * limited per user, in check. */
+#define TREE_CACHE_WATCHES 1024
+
+/* What to do with a file while building a tree. */
+typedef enum
+{
+	TA_SKIP,     /* Ignore file completely. */
+	TA_HIDE,     /* Count file as filtered out. */
+	TA_TRAVERSE, /* Same as TA_HIDE, but also add children of the directory. */
+	TA_ADD,      /* Add file as is. */
+	TA_FOLD,     /* Add directory as folded one. */
+	TA_ENTER,    /* Add directory along with its children. */
+}
+TreeAction;
+
+/* Parameters of tree building that don't change during traversal. */
+typedef struct
+{
+	view_t *view;           /* View whose custom list is being filled. */
+	trie_t *excluded_paths; /* Paths which should be skipped. */
+	trie_t *folded_paths;   /* Directories with explicit state of folding. */
+	dir_lister_t *lister;   /* Lists directories in background. */
+	dir_cache_t *cache;     /* Listings of directories from previous builds. */
+}
+tree_builder_t;
+
 static void init_flist(view_t *view);
 static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
 static int navigate_to_file_in_custom_view(view_t *view, const char dir[],
 		const char file[]);
 static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
+static int entry_has_path(const dir_entry_t *entry, const char path[]);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const struct dirent *d);
+static int fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d);
 static int data_is_dir_entry(const struct dirent *d, const char path[]);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
@@ -120,6 +160,9 @@ static void zap_compare_view(view_t *view, view_t *other, zap_filter filter,
 		void *arg);
 static int find_separator(view_t *view, int idx);
 static void update_dir_watcher(view_t *view);
+static int is_polled(const view_t *view);
+static void reset_dir_poller(view_t *view);
+static void check_polled_view(view_t *view);
 static int custom_list_is_incomplete(const view_t *view);
 static int is_dead_or_filtered(view_t *view, const dir_entry_t *entry,
 		void *arg);
@@ -143,6 +186,8 @@ static int correct_pos(view_t *view, int pos, int dist, int closest);
 static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
+static dir_entry_t * add_listed_entry(view_t *view, dir_entry_t **list,
+		int *list_size, const char path[], const struct stat *s);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
@@ -150,6 +195,8 @@ static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 static entries_t list_sibling_dirs(view_t *view);
 static entries_t flist_list_in(view_t *view, const char path[], int only_dirs,
 		int can_include_parent);
+static entries_t entries_from_listing(view_t *view, const char path[],
+		const dir_listing_t *listing, int only_dirs, int can_include_parent);
 static dir_entry_t * pick_sibling(view_t *view, entries_t parent_dirs,
 		int offset, int wrap, int *wrapped);
 static int iter_entries(view_t *view, dir_entry_t **entry,
@@ -157,17 +204,29 @@ static int iter_entries(view_t *view, dir_entry_t **entry,
 static void clear_marking(view_t *view);
 static int set_position_by_path(view_t *view, const char path[]);
 static int flist_load_tree_internal(view_t *view, const char path[],
-		int reload);
+		int reload, int depth);
 static int make_tree(view_t *view, const char path[], int reload,
-		trie_t *excluded_paths);
+		trie_t *excluded_paths, trie_t *folded_paths, int depth);
 static void tree_from_cv(view_t *view);
 static int complete_tree(const char name[], int valid, const void *parent_data,
 		void *data, void *arg);
 static void reset_entry_list(view_t *view, dir_entry_t **entries, int *count);
 static void drop_tops(view_t *view, dir_entry_t *entries, int *nentries,
 		int extra);
-static int add_files_recursively(view_t *view, const char path[],
-		trie_t *excluded_paths, int parent_pos, int no_direct_parent);
+static int build_tree(view_t *view, const char path[],
+		trie_t *excluded_paths, trie_t *folded_paths, int depth);
+static int add_files_recursively(tree_builder_t *tb, const char path[],
+		const dir_listing_t *listing, int depth, int parent_pos,
+		int no_direct_parent);
+static const dir_listing_t * get_tree_listing(tree_builder_t *tb,
+		const char path[], const dir_listing_t *cached, dir_lister_req_t *req);
+static TreeAction pick_tree_action(tree_builder_t *tb, const char full_path[],
+		const char name[], const struct stat *s, int depth);
+static const struct stat * get_listed_stat(const dir_listing_t *listing,
+		int i);
+static dir_entry_t * add_tree_entry(view_t *view, const char path[],
+		const struct stat *s);
+static int is_folded(trie_t *folded_paths, const char path[], int depth);
 static int file_is_visible(view_t *view, const char name[], int is_dir,
 		const void *data, int apply_local_filter);
 static int add_directory_leaf(view_t *view, const char path[], int parent_pos);
@@ -223,6 +282,7 @@ init_flist(view_t *view)
 	view->dir_entry[0].type = FT_DIR;
 	view->dir_entry[0].hi_num = -1;
 	view->dir_entry[0].name_dec_num = -1;
+	view->dir_entry[0].name_width = 0;
 	view->dir_entry[0].origin = &view->curr_dir[0];
 	view->list_rows = 1;
 }
@@ -242,6 +302,7 @@ flist_free_view(view_t *view)
 	dynarray_free(view->dir_entry);
 	view->dir_entry = NULL;
 	view->list_rows = 0;
+	fpos_invalidate_index(view);
 
 	for(i = 0; i < view->custom.entry_count; ++i)
 	{
@@ -255,9 +316,13 @@ flist_free_view(view_t *view)
 	update_string(&view->custom.orig_dir, NULL);
 	update_string(&view->custom.title, NULL);
 	trie_free(view->custom.excluded_paths);
+	trie_free(view->custom.folded_paths);
 	trie_free(view->custom.paths_cache);
+	dir_cache_free(view->custom.tree_cache);
 	view->custom.excluded_paths = NULL;
+	view->custom.folded_paths = NULL;
 	view->custom.paths_cache = NULL;
+	view->custom.tree_cache = NULL;
 
 	for(i = 0; i < view->local_filter.entry_count; ++i)
 	{
@@ -289,6 +354,8 @@ flist_free_view(view_t *view)
 
 	fswatch_free(view->watch);
 	view->watch = NULL;
+	change_poller_free(view->poller);
+	view->poller = NULL;
 
 	flist_free_cache(view, &view->left_column);
 	flist_free_cache(view, &view->right_column);
@@ -692,6 +759,10 @@ change_directory(view_t *view, const char directory[])
 	/* Perform additional actions on leaving custom view. */
 	if(was_in_custom_view)
 	{
+		/* Stop tracking changes of directories of the tree. */
+		dir_cache_free(view->custom.tree_cache);
+		view->custom.tree_cache = NULL;
+
 		if(ui_view_unsorted(view))
 		{
 			enable_view_sorting(view);
@@ -895,7 +966,17 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->type = get_type_from_mode(s.st_mode);
+	return fill_dir_entry_by_stat(entry, path, &s, d);
+}
+
+/* Fills fields of the entry from lstat() information of the file specified by
+ * its path.  d is optional source of file type.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d)
+{
+	entry->type = get_type_from_mode(s->st_mode);
 	if(entry->type == FT_UNK)
 	{
 		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d, path);
@@ -906,27 +987,27 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->size = (uintmax_t)s.st_size;
-	entry->uid = s.st_uid;
-	entry->gid = s.st_gid;
-	entry->mode = s.st_mode;
-	entry->inode = s.st_ino;
-	entry->mtime = s.st_mtime;
-	entry->atime = s.st_atime;
-	entry->ctime = s.st_ctime;
-	entry->nlinks = s.st_nlink;
+	entry->size = (uintmax_t)s->st_size;
+	entry->uid = s->st_uid;
+	entry->gid = s->st_gid;
+	entry->mode = s->st_mode;
+	entry->inode = s->st_ino;
+	entry->mtime = s->st_mtime;
+	entry->atime = s->st_atime;
+	entry->ctime = s->st_ctime;
+	entry->nlinks = s->st_nlink;
 
 	if(entry->type == FT_LINK)
 	{
-		struct stat s;
+		struct stat target;
 
 		const SymLinkType symlink_type = get_symlink_type(path);
 		entry->dir_link = (symlink_type != SLT_UNKNOWN);
 
 		/* Query mode of symbolic link target. */
-		if(symlink_type != SLT_SLOW && os_stat(entry->name, &s) == 0)
+		if(symlink_type != SLT_SLOW && os_stat(entry->name, &target) == 0)
 		{
-			entry->mode = s.st_mode;
+			entry->mode = target.st_mode;
 		}
 	}
 
@@ -1084,6 +1165,8 @@ flist_custom_finish_internal(view_t *view, CVType type, int reload,
 	free_dir_entries(view, &view->dir_entry, &view->list_rows);
 	view->dir_entry = view->custom.entries;
 	view->list_rows = view->custom.entry_count;
+	fpos_invalidate_index(view);
+	reset_dir_poller(view);
 	view->custom.entries = NULL;
 	view->custom.entry_count = 0;
 	view->dir_entry = dynarray_shrink(view->dir_entry);
@@ -1380,6 +1463,7 @@ flist_custom_clone(view_t *to, const view_t *from, int as_tree)
 	free_dir_entries(to, &to->dir_entry, &to->list_rows);
 	to->dir_entry = dst;
 	to->list_rows = j;
+	fpos_invalidate_index(to);
 
 	to->filtered = 0;
 
@@ -1404,6 +1488,7 @@ flist_custom_uncompress_tree(view_t *view)
 
 	view->dir_entry = NULL;
 	view->list_rows = 0;
+	fpos_invalidate_index(view);
 
 	for(i = 0U; i < nentries; ++i)
 	{
@@ -1492,18 +1577,26 @@ entry_from_path(view_t *view, dir_entry_t *entries, int count,
 			sizeof(canonic_path));
 
 	fname = get_last_path_component(canonic_path);
-	for(i = 0; i < count; ++i)
-	{
-		char full_path[PATH_MAX + 1];
-		dir_entry_t *const entry = &entries[i];
 
-		if(stroscmp(entry->name, fname) != 0)
+	if(entries == view->dir_entry && count == view->list_rows)
+	{
+		/* Use index of the view to visit only entries with matching name. */
+		i = -1;
+		while((i = fpos_find_next_by_name(view, fname, i)) >= 0)
 		{
-			continue;
+			if(entry_has_path(&entries[i], canonic_path))
+			{
+				return &entries[i];
+			}
 		}
+		return NULL;
+	}
 
-		get_full_path_of(entry, sizeof(full_path), full_path);
-		if(stroscmp(full_path, canonic_path) == 0)
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *const entry = &entries[i];
+		if(stroscmp(entry->name, fname) == 0 &&
+				entry_has_path(entry, canonic_path))
 		{
 			return entry;
 		}
@@ -1512,6 +1605,16 @@ entry_from_path(view_t *view, dir_entry_t *entries, int count,
 	return NULL;
 }
 
+/* Checks whether full path of the entry matches the path.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+entry_has_path(const dir_entry_t *entry, const char path[])
+{
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+	return (stroscmp(full_path, path) == 0);
+}
+
 uint64_t
 fentry_get_nitems(const view_t *view, const dir_entry_t *entry)
 {
@@ -1640,13 +1743,18 @@ populate_dir_list_internal(view_t *view, int reload)
 
 	view->filtered = 0;
 
+	/* Poller is started on the next check to examine files that will be loaded
+	 * now. */
+	reset_dir_poller(view);
+
 	/* List reload usually implies that something related to file list has
-	 * changed, like an option.  Reset cached lists to make sure they are up to
-	 * date with main column. */
+	 * changed, like an option.  Make cached lists be rebuilt to make sure they
+	 * are up to date with main column.  Listings of directories they are built
+	 * from stay valid until directories change. */
 	if(reload)
 	{
-		flist_free_cache(view, &view->left_column);
-		flist_free_cache(view, &view->right_column);
+		view->left_column.id = 0;
+		view->right_column.id = 0;
 	}
 
 	if(flist_custom_active(view))
@@ -1778,7 +1886,8 @@ populate_custom_view(view_t *view, int reload)
 		int prev_list_rows, result;
 
 		start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
-		result = flist_load_tree_internal(view, flist_get_dir(view), 1);
+		result = flist_load_tree_internal(view, flist_get_dir(view), 1,
+				view->custom.tree_depth);
 
 		if(view->dir_entry == NULL)
 		{
@@ -1908,6 +2017,7 @@ zap_compare_view(view_t *view, view_t *other, zap_filter filter, void *arg)
 	}
 
 	view->list_rows = j;
+	fpos_invalidate_index(view);
 }
 
 /* Finds separator among the group of equivalent files of the view specified by
@@ -2180,10 +2290,16 @@ update_dir_list(view_t *view, int reload)
 {
 	dir_entry_t *prev_dir_entries;
 	int prev_list_rows;
+	uint64_t read_start;
+	int error;
 
 	start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
 
-	if(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0)
+	read_start = perf_begin();
+	error = enum_dir_content(view->curr_dir, &add_file_entry_to_view, view);
+	perf_end(PK_DIR_READ, read_start, view->list_rows);
+
+	if(error != 0)
 	{
 		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", view->curr_dir);
 		free_dir_entries(view, &prev_dir_entries, &prev_list_rows);
@@ -2226,6 +2342,7 @@ start_dir_list_change(view_t *view, dir_entry_t **entries, int *len, int reload)
 
 	view->matches = 0;
 	view->selected_files = 0;
+	fpos_invalidate_index(view);
 }
 
 /* Finishes file list update, possibly merging information from old entries into
@@ -2309,12 +2426,16 @@ resort_dir_list(int msg, view_t *view)
 static void
 sort_dir_list(int msg, view_t *view)
 {
+	uint64_t start;
+
 	if(msg && view->list_rows > 2048 && !vle_mode_is(CMDLINE_MODE))
 	{
 		ui_sb_quick_msgf("%s", "Sorting directory...");
 	}
 
+	start = perf_begin();
 	sort_view(view);
+	perf_end(PK_DIR_SORT, start, view->list_rows);
 
 	if(msg && !vle_mode_is(CMDLINE_MODE))
 	{
@@ -2454,6 +2575,7 @@ merge_entries(dir_entry_t *new, const dir_entry_t *prev)
 	{
 		new->hi_num = prev->hi_num;
 		new->name_dec_num = prev->name_dec_num;
+		new->name_width = prev->name_width;
 	}
 }
 
@@ -2552,8 +2674,10 @@ init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 
 	entry->type = FT_UNK;
 	entry->dir_link = 0;
+	entry->folded = 0;
 	entry->hi_num = -1;
 	entry->name_dec_num = -1;
+	entry->name_width = 0;
 
 	entry->child_count = 0;
 	entry->child_pos = 0;
@@ -2590,6 +2714,8 @@ replace_dir_entries(view_t *view, dir_entry_t **entries, int *count,
 
 		entry->name = strdup(entry->name);
 		entry->origin = strdup(entry->origin);
+		/* Width of name in a custom view depends on its root. */
+		entry->name_width = 0;
 
 		if(entry->name == NULL || entry->origin == NULL)
 		{
@@ -2649,6 +2775,17 @@ dir_entry_t *
 entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 		const char path[])
 {
+	return add_listed_entry(view, list, list_size, path, NULL);
+}
+
+/* Adds file at the path to the list.  Uses lstat() information when it's
+ * available (s can be NULL).  Returns added entry or NULL on error. */
+static dir_entry_t *
+add_listed_entry(view_t *view, dir_entry_t **list, int *list_size,
+		const char path[], const struct stat *s)
+{
+	int failed;
+
 	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
 	if(dir_entry == NULL)
 	{
@@ -2660,7 +2797,18 @@ entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 	dir_entry->origin = strdup(path);
 	remove_last_path_component(dir_entry->origin);
 
-	if(fill_dir_entry_by_path(dir_entry, path) != 0)
+#ifndef _WIN32
+	if(s != NULL)
+	{
+		failed = fill_dir_entry_by_stat(dir_entry, path, s, NULL);
+	}
+	else
+#endif
+	{
+		failed = fill_dir_entry_by_path(dir_entry, path);
+	}
+
+	if(failed)
 	{
 		fentry_free(view, dir_entry);
 		return NULL;
@@ -2691,9 +2839,19 @@ check_if_filelist_has_changed(view_t *view)
 	int failed, changed;
 	const char *const curr_dir = flist_get_dir(view);
 
-	if(view->on_slow_fs ||
-			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
-			is_unc_root(curr_dir))
+	if(is_unc_root(curr_dir))
+	{
+		return;
+	}
+
+	if(is_polled(view))
+	{
+		check_polled_view(view);
+		return;
+	}
+
+	/* Slow file systems are polled only when it's allowed. */
+	if(view->on_slow_fs)
 	{
 		return;
 	}
@@ -2708,7 +2866,9 @@ check_if_filelist_has_changed(view_t *view)
 	}
 	else
 	{
+		const uint64_t start = perf_begin();
 		changed = fswatch_changed(view->watch, &failed);
+		perf_end(PK_FSWATCH, start, 0U);
 	}
 
 	/* Check if we still have permission to visit this directory. */
@@ -2751,6 +2911,155 @@ check_if_filelist_has_changed(view_t *view)
 	}
 }
 
+int
+flist_get_watch_fds(const view_t *view, int fds[2])
+{
+	int nfds = 0;
+
+	/* Keep these checks in sync with check_if_filelist_has_changed(). */
+
+	if(is_unc_root(flist_get_dir(view)))
+	{
+		return 0;
+	}
+
+	if(is_polled(view))
+	{
+		if(view->poller == NULL)
+		{
+			return -1;
+		}
+
+		fds[0] = change_poller_get_fd(view->poller);
+		return (fds[0] == -1 ? -1 : 1);
+	}
+
+	if(view->on_slow_fs)
+	{
+		return 0;
+	}
+
+	/* Trees are checked by examining modification times of directories. */
+	if(view->watch == NULL ||
+			(flist_custom_active(view) && view->custom.type == CV_TREE))
+	{
+		return -1;
+	}
+
+	fds[nfds] = fswatch_get_fd(view->watch);
+	if(fds[nfds++] == -1)
+	{
+		return -1;
+	}
+
+	if(flist_custom_active(view))
+	{
+		return nfds;
+	}
+
+	/* Directories of columns might be being listed and not be watched yet,
+	 * their listings will bring notifications of their own. */
+	if(view->left_column.dir != NULL || view->right_column.dir != NULL)
+	{
+		fds[nfds] = lcache_get_watch_fd();
+		nfds += (fds[nfds] != -1);
+	}
+
+	return nfds;
+}
+
+/* Checks whether changes of the view are detected by polling timestamps in
+ * background instead of watching for them.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+is_polled(const view_t *view)
+{
+	return (view->on_slow_fs && cfg.poll_slow_fs)
+	    || (flist_custom_active(view) && !cv_tree(view->custom.type));
+}
+
+/* Makes poller of the view forget current set of paths, new set is passed to it
+ * on the next check. */
+static void
+reset_dir_poller(view_t *view)
+{
+	/* The poller is kept to not start a new thread on every reload, while the old
+	 * one might still be blocked on a slow file system. */
+	if(view->poller != NULL)
+	{
+		(void)change_poller_set_paths(view->poller, NULL, 0, NULL);
+		view->poller_outdated = 1;
+	}
+}
+
+/* Updates paths of the poller of the view or schedules a reload if it detected
+ * a change. */
+static void
+check_polled_view(view_t *view)
+{
+	/* Polling starts often and backs off while nothing changes. */
+	enum { MIN_INTERVAL = 1000, MAX_INTERVAL = 30000 };
+
+	char **paths;
+	int npaths = 0;
+	int i;
+
+	if(view->poller == NULL)
+	{
+		/* Number of pollers is limited, so this might fail until some other view
+		 * frees its poller. */
+		view->poller = change_poller_create(MIN_INTERVAL, MAX_INTERVAL);
+		if(view->poller == NULL)
+		{
+			return;
+		}
+		view->poller_outdated = 1;
+	}
+
+	if(!view->poller_outdated)
+	{
+		if(change_poller_changed(view->poller))
+		{
+			ui_view_schedule_reload(view);
+		}
+		return;
+	}
+
+	if(!flist_custom_active(view))
+	{
+		char *path = (char *)flist_get_dir(view);
+		view->poller_outdated =
+			(change_poller_set_paths(view->poller, &path, 1, NULL) != 0);
+		return;
+	}
+
+	/* Entries of custom views are usually grouped by their location, so dropping
+	 * adjacent duplicates here leaves little work for the poller. */
+	paths = reallocarray(NULL, view->list_rows, sizeof(*paths));
+	if(paths == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		char *const origin = view->dir_entry[i].origin;
+		if(is_parent_dir(view->dir_entry[i].name))
+		{
+			continue;
+		}
+		if(npaths == 0 || strcmp(paths[npaths - 1], origin) != 0)
+		{
+			paths[npaths++] = origin;
+		}
+	}
+
+	/* Locations on slow file systems are examined only when it's allowed. */
+	view->poller_outdated = (change_poller_set_paths(view->poller, paths, npaths,
+				cfg.poll_slow_fs ? NULL : cfg.slow_fs_list) != 0);
+	free(paths);
+}
+
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
  * Returns non-zero if so, otherwise zero is returned. */
 static int
@@ -2760,7 +3069,7 @@ tree_has_changed(const dir_entry_t *entries, size_t nchildren)
 	while(pos < nchildren)
 	{
 		const dir_entry_t *const entry = &entries[pos];
-		if(entry->type == FT_DIR && !is_parent_dir(entry->name))
+		if(entry->type == FT_DIR && !entry->folded && !is_parent_dir(entry->name))
 		{
 			char full_path[PATH_MAX + 1];
 			struct stat s;
@@ -2785,40 +3094,36 @@ tree_has_changed(const dir_entry_t *entries, size_t nchildren)
 int
 flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 {
-	int update = 0;
-	int error;
+	unsigned long long id;
+	const dir_listing_t *listing;
 
 	if(path == NULL)
 	{
 		return 0;
 	}
 
-	if(cache->watch == NULL || stroscmp(cache->dir, path) != 0)
+	/* Previous list of the same directory is kept until its newer listing is
+	 * available. */
+	listing = lcache_get(path, &id);
+	if(cache->dir != NULL && stroscmp(cache->dir, path) == 0 &&
+			(listing == NULL || id == cache->id))
 	{
-		fswatch_free(cache->watch);
-
-		cache->watch = fswatch_create(path);
-		if(cache->watch == NULL)
-		{
-			/* Reset the cache on failure to create a watcher to do not accidentally
-			 * provide incorrect data. */
-			flist_free_cache(view, cache);
-			return 0;
-		}
-
-		replace_string(&cache->dir, path);
-
-		update = 1;
+		return 0;
 	}
 
-	if(update || fswatch_changed(cache->watch, &error) || error)
+	free_dir_entries(view, &cache->entries.entries, &cache->entries.nentries);
+	replace_string(&cache->dir, path);
+	cache->id = id;
+
+	if(listing == NULL)
 	{
-		free_dir_entries(view, &cache->entries.entries, &cache->entries.nentries);
-		cache->entries = flist_list_in(view, path, 0, 1);
+		/* Directory is being listed in background. */
+		cache->entries.nentries = -1;
 		return 1;
 	}
 
-	return 0;
+	cache->entries = entries_from_listing(view, path, listing, 0, 1);
+	return 1;
 }
 
 void
@@ -2826,8 +3131,7 @@ flist_free_cache(view_t *view, cached_entries_t *cache)
 {
 	free_dir_entries(view, &cache->entries.entries, &cache->entries.nentries);
 	update_string(&cache->dir, NULL);
-	fswatch_free(cache->watch);
-	cache->watch = NULL;
+	cache->id = 0;
 }
 
 void
@@ -3146,31 +3450,45 @@ list_sibling_dirs(view_t *view)
 static entries_t
 flist_list_in(view_t *view, const char path[], int only_dirs,
 		int can_include_parent)
+{
+	dir_listing_t listing = { .stats = NULL };
+	listing.names = list_all_files(path, &listing.count);
+
+	const entries_t siblings = entries_from_listing(view, path, &listing,
+			only_dirs, can_include_parent);
+	dir_listing_free(&listing);
+	return siblings;
+}
+
+/* Makes list of files of specified directory out of its listing.  Returns the
+ * list, which is of length -1 on error. */
+static entries_t
+entries_from_listing(view_t *view, const char path[],
+		const dir_listing_t *listing, int only_dirs, int can_include_parent)
 {
 	entries_t siblings = {};
-	int len, i;
-	char **list;
+	int i;
 
-	list = list_all_files(path, &len);
-	if(len < 0)
+	if(listing->count < 0)
 	{
 		siblings.nentries = -1;
 		return siblings;
 	}
 
-	for(i = 0; i < len; ++i)
+	for(i = 0; i < listing->count; ++i)
 	{
 		dir_entry_t *entry;
 		int is_dir;
+		const char *const name = listing->names[i];
 
-		if(view->hide_dot && list[i][0] == '.')
+		if(view->hide_dot && name[0] == '.')
 		{
 			continue;
 		}
 
-		char *full_path = format_str("%s/%s", path, list[i]);
-		entry = entry_list_add(view, &siblings.entries, &siblings.nentries,
-				full_path);
+		char *full_path = format_str("%s/%s", path, name);
+		entry = add_listed_entry(view, &siblings.entries, &siblings.nentries,
+				full_path, get_listed_stat(listing, i));
 		free(full_path);
 
 		if(entry == NULL)
@@ -3180,13 +3498,12 @@ flist_list_in(view_t *view, const char path[], int only_dirs,
 
 		is_dir = fentry_is_dir(entry);
 		if((only_dirs && !is_dir) ||
-				!filters_file_is_visible(view, path, list[i], is_dir, 0))
+				!filters_file_is_visible(view, path, name, is_dir, 0))
 		{
 			fentry_free(view, entry);
 			--siblings.nentries;
 		}
 	}
-	free_string_array(list, len);
 
 	if(can_include_parent && cfg_parent_dir_is_visible(is_root_dir(path)))
 	{
@@ -3578,6 +3895,8 @@ fentry_rename(view_t *view, dir_entry_t *entry, const char to[])
 	 * the caches. */
 	entry->hi_num = -1;
 	entry->name_dec_num = -1;
+	entry->name_width = 0;
+	fpos_invalidate_index(view);
 
 	/* Update origins of entries which include the one we're renaming. */
 	if(flist_custom_active(view) && fentry_is_dir(entry))
@@ -3629,12 +3948,12 @@ fentry_is_dir(const dir_entry_t *entry)
 }
 
 int
-flist_load_tree(view_t *view, const char path[])
+flist_load_tree(view_t *view, const char path[], int depth)
 {
 	char full_path[PATH_MAX + 1];
 	get_current_full_path(view, sizeof(full_path), full_path);
 
-	if(flist_load_tree_internal(view, path, 0) != 0)
+	if(flist_load_tree_internal(view, path, 0, depth) != 0)
 	{
 		return 1;
 	}
@@ -3674,7 +3993,8 @@ flist_clone_tree(view_t *to, const view_t *from)
 	}
 	else
 	{
-		if(make_tree(to, flist_get_dir(from), 0, from->custom.excluded_paths) != 0)
+		if(make_tree(to, flist_get_dir(from), 0, from->custom.excluded_paths,
+					from->custom.folded_paths, from->custom.tree_depth) != 0)
 		{
 			return 1;
 		}
@@ -3682,17 +4002,48 @@ flist_clone_tree(view_t *to, const view_t *from)
 
 	trie_free(to->custom.excluded_paths);
 	to->custom.excluded_paths = trie_clone(from->custom.excluded_paths);
+	trie_free(to->custom.folded_paths);
+	to->custom.folded_paths = trie_clone(from->custom.folded_paths);
+	to->custom.tree_depth = from->custom.tree_depth;
+	return 0;
+}
+
+int
+flist_toggle_fold(view_t *view)
+{
+	char full_path[PATH_MAX + 1];
+	dir_entry_t *const entry = get_current_entry(view);
+
+	if(!flist_custom_active(view) || view->custom.type != CV_TREE ||
+			entry->type != FT_DIR || !fentry_is_valid(entry))
+	{
+		return 1;
+	}
+
+	get_full_path_of(entry, sizeof(full_path), full_path);
+	if(trie_set(view->custom.folded_paths, full_path,
+				entry->folded ? NULL : (void *)1) < 0)
+	{
+		return 1;
+	}
+
+	/* The whole tree is rebuilt instead of splicing children of the directory
+	 * into the list, because sorting, filtering and links to parents have to be
+	 * redone for the list anyway. */
+	load_saving_pos(view);
 	return 0;
 }
 
 /* Implements tree view (re)loading.  Returns zero on success, otherwise
  * non-zero is returned. */
 static int
-flist_load_tree_internal(view_t *view, const char path[], int reload)
+flist_load_tree_internal(view_t *view, const char path[], int reload,
+		int depth)
 {
 	trie_t *excluded_paths = reload ? view->custom.excluded_paths : NULL;
+	trie_t *folded_paths = reload ? view->custom.folded_paths : NULL;
 
-	if(make_tree(view, path, reload, excluded_paths) != 0)
+	if(make_tree(view, path, reload, excluded_paths, folded_paths, depth) != 0)
 	{
 		return 1;
 	}
@@ -3701,14 +4052,20 @@ flist_load_tree_internal(view_t *view, const char path[], int reload)
 	{
 		trie_free(view->custom.excluded_paths);
 		view->custom.excluded_paths = trie_create();
+		trie_free(view->custom.folded_paths);
+		view->custom.folded_paths = trie_create();
+		view->custom.tree_depth = depth;
 	}
 	return 0;
 }
 
-/* (Re)loads tree at path into the view using specified list of excluded files.
- * Returns zero on success, otherwise non-zero is returned. */
+/* (Re)loads tree at path into the view using specified list of excluded files
+ * and folding state of directories.  Directories deeper than depth are folded
+ * unless unfolded explicitly.  Returns zero on success, otherwise non-zero is
+ * returned. */
 static int
-make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths)
+make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
+		trie_t *folded_paths, int depth)
 {
 	char canonic_path[PATH_MAX + 1];
 	int nfiltered;
@@ -3730,7 +4087,7 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths)
 	}
 	else
 	{
-		nfiltered = add_files_recursively(view, path, excluded_paths, -1, 0);
+		nfiltered = build_tree(view, path, excluded_paths, folded_paths, depth);
 		type = CV_TREE;
 	}
 	ui_cancellation_disable();
@@ -3775,6 +4132,7 @@ tree_from_cv(view_t *view)
 
 	view->dir_entry = NULL;
 	view->list_rows = 0;
+	fpos_invalidate_index(view);
 
 	for(i = 0U; i < nentries; ++i)
 	{
@@ -3922,47 +4280,136 @@ drop_tops(view_t *view, dir_entry_t *entries, int *nentries, int extra)
 	}
 }
 
-/* Adds custom view entries corresponding to file system tree.  parent_pos is
- * expected to be negative for the outermost invocation.  Returns number of
- * filtered out files on success or partial success and negative value on
- * serious error. */
+/* Builds tree rooted at the path by listing directories in parallel.  Returns
+ * number of filtered out files on success or partial success and negative
+ * value on serious error. */
 static int
-add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
-		int parent_pos, int no_direct_parent)
+build_tree(view_t *view, const char path[], trie_t *excluded_paths,
+		trie_t *folded_paths, int depth)
+{
+	int nfiltered;
+	const dir_listing_t *cached;
+	dir_lister_req_t *req = NULL;
+	tree_builder_t tb = {
+		.view = view,
+		.excluded_paths = excluded_paths,
+		.folded_paths = folded_paths,
+	};
+
+	if(view->custom.tree_cache == NULL)
+	{
+		view->custom.tree_cache = dir_cache_create(TREE_CACHE_WATCHES);
+		if(view->custom.tree_cache == NULL)
+		{
+			return -1;
+		}
+	}
+
+	tb.lister = dir_lister_create(TREE_LISTING_THREADS);
+	if(tb.lister == NULL)
+	{
+		return -1;
+	}
+
+	tb.cache = view->custom.tree_cache;
+	dir_cache_start_pass(tb.cache);
+
+	cached = dir_cache_get(tb.cache, path);
+	if(cached == NULL)
+	{
+		req = dir_lister_queue(tb.lister, path);
+	}
+	nfiltered = add_files_recursively(&tb, path,
+			get_tree_listing(&tb, path, cached, req), depth, -1, 0);
+	dir_lister_release(tb.lister, req);
+
+	dir_lister_free(tb.lister);
+	dir_cache_finish_pass(tb.cache);
+	return nfiltered;
+}
+
+/* Adds custom view entries corresponding to file system tree.  listing is
+ * contents of the path and can be NULL on error.  Directories are entered only
+ * if they aren't folded, which by default happens for those that are deeper
+ * than depth levels.  parent_pos is expected to be negative for the outermost
+ * invocation.  Returns number of filtered out files on success or partial
+ * success and negative value on serious error. */
+static int
+add_files_recursively(tree_builder_t *tb, const char path[],
+		const dir_listing_t *listing, int depth, int parent_pos,
+		int no_direct_parent)
 {
 	int i;
+	view_t *const view = tb->view;
 	const int prev_count = view->custom.entry_count;
 	int nfiltered = 0;
+	int error = 0;
+	TreeAction *actions;
+	dir_lister_req_t **reqs;
+	const dir_listing_t **cached;
 
-	int len;
-	char **lst = list_all_files(path, &len);
-	if(len < 0)
+	if(listing == NULL || listing->count < 0)
 	{
 		return -1;
 	}
 
-	for(i = 0; i < len && !ui_cancellation_requested(); ++i)
+	actions = reallocarray(NULL, listing->count, sizeof(*actions));
+	reqs = calloc(listing->count, sizeof(*reqs));
+	cached = calloc(listing->count, sizeof(*cached));
+	if(listing->count != 0 &&
+			(actions == NULL || reqs == NULL || cached == NULL))
 	{
-		int dir;
-		void *dummy;
-		dir_entry_t *entry;
-		char *const full_path = format_str("%s/%s", path, lst[i]);
+		free(actions);
+		free(reqs);
+		free(cached);
+		return -1;
+	}
+
+	for(i = 0; i < listing->count; ++i)
+	{
+		char *const full_path = format_str("%s/%s", path, listing->names[i]);
+		actions[i] = pick_tree_action(tb, full_path, listing->names[i],
+				get_listed_stat(listing, i), depth);
+		free(full_path);
+	}
 
-		if(trie_get(excluded_paths, full_path, &dummy) == 0)
+	/* Requests are served in LIFO order, so queue them backwards for directories
+	 * to be listed in the order in which they are going to be visited.  Only
+	 * directories that changed since the last build need to be listed. */
+	for(i = listing->count - 1; i >= 0; --i)
+	{
+		if(actions[i] == TA_ENTER || actions[i] == TA_TRAVERSE)
 		{
+			char *const full_path = format_str("%s/%s", path, listing->names[i]);
+			cached[i] = dir_cache_get(tb->cache, full_path);
+			if(cached[i] == NULL)
+			{
+				reqs[i] = dir_lister_queue(tb->lister, full_path);
+			}
 			free(full_path);
+		}
+	}
+
+	for(i = 0; i < listing->count && !ui_cancellation_requested(); ++i)
+	{
+		dir_entry_t *entry;
+		char *full_path;
+
+		if(actions[i] == TA_SKIP)
+		{
 			continue;
 		}
 
-		dir = is_dir(full_path);
-		if(!file_is_visible(view, lst[i], dir, NULL, 1))
+		full_path = format_str("%s/%s", path, listing->names[i]);
+
+		if(actions[i] == TA_HIDE || actions[i] == TA_TRAVERSE)
 		{
 			/* Traverse directory (but not symlink to it) even if we're skipping it,
 			 * because we might need files that are inside of it. */
-			if(dir && !is_symlink(full_path) &&
-					file_is_visible(view, lst[i], dir, NULL, 0))
+			if(actions[i] == TA_TRAVERSE)
 			{
-				nfiltered += add_files_recursively(view, full_path, excluded_paths,
+				nfiltered += add_files_recursively(tb, full_path,
+						get_tree_listing(tb, full_path, cached[i], reqs[i]), depth,
 						parent_pos, 1);
 			}
 
@@ -3971,12 +4418,15 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			continue;
 		}
 
-		entry = flist_custom_add(view, full_path);
+		/* Information about directories is always queried anew, because listing
+		 * of the parent might come from cache and not reflect changes in them. */
+		entry = add_tree_entry(view, full_path,
+				actions[i] == TA_ADD ? get_listed_stat(listing, i) : NULL);
 		if(entry == NULL)
 		{
 			free(full_path);
-			free_string_array(lst, len);
-			return -1;
+			error = 1;
+			break;
 		}
 
 		if(parent_pos >= 0)
@@ -3984,13 +4434,16 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			entry->child_pos = (view->custom.entry_count - 1) - parent_pos;
 		}
 
-		/* Not using dir variable here, because it is set for symlinks to
-		 * directories as well. */
-		if(entry->type == FT_DIR)
+		if(actions[i] == TA_FOLD)
+		{
+			entry->folded = 1;
+		}
+		else if(actions[i] == TA_ENTER)
 		{
 			const int idx = view->custom.entry_count - 1;
-			const int filtered = add_files_recursively(view, full_path,
-					excluded_paths, idx, 0);
+			const int filtered = add_files_recursively(tb, full_path,
+					get_tree_listing(tb, full_path, cached[i], reqs[i]), depth - 1, idx,
+					0);
 			/* Keep going in case of error and load partial list. */
 			if(filtered >= 0)
 			{
@@ -4002,12 +4455,27 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			}
 		}
 
+		dir_lister_release(tb->lister, reqs[i]);
+		reqs[i] = NULL;
+
 		free(full_path);
 
 		show_progress("Building tree...", 1000);
 	}
 
-	free_string_array(lst, len);
+	/* Drop requests that weren't used because of an error or cancellation. */
+	for(i = 0; i < listing->count; ++i)
+	{
+		dir_lister_release(tb->lister, reqs[i]);
+	}
+	free(cached);
+	free(reqs);
+	free(actions);
+
+	if(error)
+	{
+		return -1;
+	}
 
 	/* The prev_count != 0 check is to make sure that we won't create leaf instead
 	 * of the whole tree (this is handled in flist_custom_finish()). */
@@ -4025,6 +4493,141 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 	return nfiltered;
 }
 
+/* Retrieves listing of a directory of a tree either from cache or from the
+ * request (req can be NULL on error) storing it in the cache.  Returns the
+ * listing or NULL on error. */
+static const dir_listing_t *
+get_tree_listing(tree_builder_t *tb, const char path[],
+		const dir_listing_t *cached, dir_lister_req_t *req)
+{
+	dir_listing_t listing;
+
+	if(cached != NULL)
+	{
+		return cached;
+	}
+
+	if(req == NULL)
+	{
+		return NULL;
+	}
+
+	dir_lister_take(tb->lister, req, &listing);
+	return dir_cache_put(tb->cache, path, &listing);
+}
+
+/* Decides how file of a directory being added to a tree should be processed.
+ * s is lstat() information about the file and can be NULL.  Returns the
+ * action. */
+static TreeAction
+pick_tree_action(tree_builder_t *tb, const char full_path[], const char name[],
+		const struct stat *s, int depth)
+{
+	void *dummy;
+	int dir, real_dir;
+
+	if(trie_get(tb->excluded_paths, full_path, &dummy) == 0)
+	{
+		return TA_SKIP;
+	}
+
+	dir = (s != NULL) ? S_ISDIR(s->st_mode) : is_dir(full_path);
+	real_dir = (s != NULL) ? dir : (dir && !is_symlink(full_path));
+
+	if(!file_is_visible(tb->view, name, dir, NULL, 1))
+	{
+		return (real_dir && file_is_visible(tb->view, name, dir, NULL, 0))
+		     ? TA_TRAVERSE
+		     : TA_HIDE;
+	}
+
+	if(!real_dir)
+	{
+		return TA_ADD;
+	}
+
+	return is_folded(tb->folded_paths, full_path, depth) ? TA_FOLD : TA_ENTER;
+}
+
+/* Retrieves lstat() information about i-th file of the listing if it's
+ * available and sufficient to fill in an entry without querying file system.
+ * Returns the information or NULL. */
+static const struct stat *
+get_listed_stat(const dir_listing_t *listing, int i)
+{
+#ifndef _WIN32
+	/* Symbolic links need more processing, so ignore them. */
+	if(listing->stats != NULL && listing->stats[i].st_mode != 0 &&
+			!S_ISLNK(listing->stats[i].st_mode))
+	{
+		return &listing->stats[i];
+	}
+#endif
+	return NULL;
+}
+
+/* Adds file at the path to the tree that's being built.  Uses lstat()
+ * information when it's available (s can be NULL).  Returns added entry or NULL
+ * on error. */
+static dir_entry_t *
+add_tree_entry(view_t *view, const char path[], const struct stat *s)
+{
+#ifndef _WIN32
+	char canonic_path[PATH_MAX + 1];
+	dir_entry_t *entry;
+
+	if(s == NULL)
+	{
+		return flist_custom_add(view, path);
+	}
+
+	to_canonic_path(path, flist_get_dir(view), canonic_path,
+			sizeof(canonic_path));
+
+	/* Don't add duplicates. */
+	if(trie_put(view->custom.paths_cache, canonic_path) != 0)
+	{
+		return NULL;
+	}
+
+	entry = alloc_dir_entry(&view->custom.entries, view->custom.entry_count);
+	if(entry == NULL)
+	{
+		return NULL;
+	}
+
+	init_dir_entry(view, entry, get_last_path_component(canonic_path));
+
+	entry->origin = strdup(canonic_path);
+	remove_last_path_component(entry->origin);
+
+	if(fill_dir_entry_by_stat(entry, canonic_path, s, NULL) != 0)
+	{
+		fentry_free(view, entry);
+		return NULL;
+	}
+
+	++view->custom.entry_count;
+	return entry;
+#else
+	return flist_custom_add(view, path);
+#endif
+}
+
+/* Checks whether directory at the path should be folded when it's depth levels
+ * away from the bottom of the tree.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+is_folded(trie_t *folded_paths, const char path[], int depth)
+{
+	void *data;
+	if(trie_get(folded_paths, path, &data) == 0)
+	{
+		return (data != NULL);
+	}
+	return (depth <= 1);
+}
+
 /* Checks whether file is visible according to dot and filename filters.  is_dir
  * is used when data is NULL, otherwise data_is_dir_entry() called (this is an
  * optimization).  Returns non-zero if so, otherwise zero is returned. */
@@ -175,6 +175,11 @@ dir_entry_t * get_current_entry(const view_t *view);
 /* Checks whether content in the current directory of the view changed and
  * reloads the view if so. */
 void check_if_filelist_has_changed(view_t *view);
+/* Collects up to two descriptors (current directory and miller columns) that
+ * become readable when contents of the view might have changed.  Returns number
+ * of collected descriptors or -1 if changes can be detected only by calling
+ * check_if_filelist_has_changed() periodically. */
+int flist_get_watch_fds(const view_t *view, int fds[2]);
 /* Checks whether cd'ing into path is possible. Shows cd errors to a user.
  * Returns non-zero if it's possible, zero otherwise. */
 int cd_is_possible(const char path[]);
@@ -288,14 +293,21 @@ int fentry_is_valid(const dir_entry_t *entry);
  * directories).  Returns non-zero if so, otherwise zero is returned. */
 int fentry_is_dir(const dir_entry_t *entry);
 /* Loads directory tree specified by its path into the view.  Considers various
- * filters.  Returns zero on success, otherwise non-zero is returned. */
-int flist_load_tree(view_t *view, const char path[]);
+ * filters.  Directories nested deeper than depth levels are loaded folded, use
+ * INT_MAX to load the whole tree.  Returns zero on success, otherwise non-zero
+ * is returned. */
+int flist_load_tree(view_t *view, const char path[], int depth);
 /* Makes to contain tree with the same root as from including copying list of
- * excluded files.  Returns zero on success, otherwise non-zero is returned. */
+ * excluded files and folding state.  Returns zero on success, otherwise
+ * non-zero is returned. */
 int flist_clone_tree(view_t *to, const view_t *from);
-/* Updates specified cache of the view.  If the path is NULL, then nothing is
- * done.  Returns non-zero if cached file list has changed, otherwise zero is
- * returned. */
+/* Folds or unfolds directory under cursor of a tree-view loading its children
+ * on unfolding.  Returns zero on success, otherwise non-zero is returned. */
+int flist_toggle_fold(view_t *view);
+/* Updates specified cache of the view from listing of the path, which is made
+ * in background (the list is of length -1 until then).  If the path is NULL,
+ * then nothing is done.  Returns non-zero if cached file list has changed,
+ * otherwise zero is returned. */
 int flist_update_cache(view_t *view, cached_entries_t *cache,
 		const char path[]);
 /* Frees the cache. */
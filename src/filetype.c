@@ -104,6 +104,40 @@ ft_get_viewer(const char file[])
 	return find_existing_cmd(&fileviewers, file);
 }
 
+const char *
+ft_get_viewer_no_mime(const char file[], int *mime)
+{
+	int i;
+
+	*mime = 0;
+	for(i = 0; i < fileviewers.count; ++i)
+	{
+		int needs_mime;
+		assoc_record_t prog;
+		assoc_t *const assoc = &fileviewers.list[i];
+
+		if(!matchers_match_no_mime(assoc->matchers, file, &needs_mime))
+		{
+			continue;
+		}
+
+		prog = find_existing_cmd_record(&assoc->records);
+		if(is_assoc_record_empty(&prog))
+		{
+			continue;
+		}
+
+		if(needs_mime)
+		{
+			*mime = 1;
+			return NULL;
+		}
+		return prog.command;
+	}
+
+	return NULL;
+}
+
 /* Finds first existing command which pattern matches given file.  Returns the
  * command (it's lifetime is managed by this unit) or NULL on failure. */
 static const char *
@@ -119,6 +119,12 @@ void ft_set_programs(struct matchers_t *matchers, const char programs[],
  * otherwise returns pointer to string stored internally. */
 const char * ft_get_viewer(const char file[]);
 
+/* Gets viewer for file without detecting its mime type.  *mime is set to
+ * non-zero when mime type is needed to pick the viewer.  Returns NULL if no
+ * suitable viewer available or if it can't be picked, otherwise returns pointer
+ * to string stored internally. */
+const char * ft_get_viewer_no_mime(const char file[], int *mime);
+
 /* Gets list of programs associated with specified file name.  Returns the list.
  * Caller should free the result by calling ft_assoc_records_free() on it. */
 assoc_records_t ft_get_all_viewers(const char file[]);
@@ -20,6 +20,7 @@
 #include "filtering.h"
 
 #include <assert.h> /* assert() */
+#include <stdint.h> /* uint64_t */
 #include <string.h> /* strdup() */
 
 #include "cfg/config.h"
@@ -28,6 +29,7 @@
 #include "utils/dynarray.h"
 #include "utils/matcher.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/utils.h"
@@ -365,12 +367,15 @@ filters_drop_temporaries(view_t *view, dir_entry_t entries[])
 	dynarray_free(view->dir_entry);
 	view->dir_entry = entries;
 	view->list_rows = list_size;
+	fpos_invalidate_index(view);
 }
 
 int
 local_filter_set(view_t *view, const char filter[])
 {
 	int result;
+	int all_filtered;
+	uint64_t start;
 	const int current_file_pos = view->local_filter.in_progress
 	                           ? get_unfiltered_pos(view, view->list_pos)
 	                           : load_unfiltered_list(view);
@@ -383,7 +388,11 @@ local_filter_set(view_t *view, const char filter[])
 	result = (filter_change(&view->local_filter.filter, filter,
 			!regexp_should_ignore_case(filter)) ? -1 : 0);
 
-	if(update_filtering_lists(view, 1, 0) != 0 && result == 0)
+	start = perf_begin();
+	all_filtered = update_filtering_lists(view, 1, 0);
+	perf_end(PK_DIR_FILTER, start, view->local_filter.unfiltered_count);
+
+	if(all_filtered && result == 0)
 	{
 		result = 1;
 	}
@@ -453,6 +462,7 @@ load_unfiltered_list(view_t *view)
 	view->local_filter.unfiltered_count = view->list_rows;
 	view->local_filter.prefiltered_count = view->filtered;
 	view->dir_entry = NULL;
+	fpos_invalidate_index(view);
 
 	return current_file_pos;
 }
@@ -479,7 +489,7 @@ list_is_incomplete(view_t *view)
 	for(i = 0; i < view->list_rows; ++i)
 	{
 		dir_entry_t *const entry = &view->dir_entry[i];
-		if(entry->type == FT_DIR && entry->child_count == 0 &&
+		if(entry->type == FT_DIR && entry->child_count == 0 && !entry->folded &&
 				!is_parent_dir(entry->name))
 		{
 			return 1;
@@ -595,6 +605,7 @@ update_filtering_lists(view_t *view, int add, int clear)
 	if(add)
 	{
 		view->list_rows = list_size;
+		fpos_invalidate_index(view);
 		view->filtered = view->local_filter.prefiltered_count
 		               + view->local_filter.unfiltered_count - list_size;
 		ensure_filtered_list_not_empty(view, parent_entry);
@@ -666,6 +677,7 @@ ensure_filtered_list_not_empty(view_t *view, dir_entry_t *parent_entry)
 		size_t list_size = 0U;
 		(void)add_dir_entry(&view->dir_entry, &list_size, parent_entry);
 		view->list_rows = list_size;
+		fpos_invalidate_index(view);
 	}
 }
 
@@ -802,6 +814,7 @@ local_filter_cancel(view_t *view)
 	dynarray_free(view->dir_entry);
 	view->dir_entry = NULL;
 	view->list_rows = 0;
+	fpos_invalidate_index(view);
 
 	update_filtering_lists(view, 1, 1);
 	local_filter_finish(view);
@@ -20,12 +20,14 @@
 #include "flist_pos.h"
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* abs() */
-#include <string.h> /* strcmp() */
+#include <stdlib.h> /* abs() free() */
+#include <string.h> /* memset() strcmp() */
 #include <wctype.h> /* towupper() */
 
 #include "cfg/config.h"
+#include "compat/reallocarray.h"
 #include "ui/fileview.h"
 #include "ui/ui.h"
 #include "utils/fs.h"
@@ -50,6 +52,12 @@ static int is_mismatched_entry(const dir_entry_t *entry);
 static int find_next(const view_t *view, entry_predicate pred);
 static int find_prev(const view_t *view, entry_predicate pred);
 static int file_can_be_displayed(const char directory[], const char filename[]);
+static int find_by_name(const view_t *view, const char name[], const char dir[],
+		int pos);
+static void build_name_index(view_t *view);
+static unsigned int hash_name(const char name[]);
+static int entry_has_name(const dir_entry_t *entry, const char name[],
+		const char dir[]);
 
 int
 fpos_find_by_name(const view_t *view, const char name[])
@@ -60,22 +68,147 @@ fpos_find_by_name(const view_t *view, const char name[])
 int
 fpos_find_entry(const view_t *view, const char name[], const char dir[])
 {
-	int i;
-	for(i = 0; i < view->list_rows; ++i)
+	return find_by_name(view, name, dir, -1);
+}
+
+int
+fpos_find_next_by_name(const view_t *view, const char name[], int pos)
+{
+	return find_by_name(view, name, NULL, pos);
+}
+
+void
+fpos_invalidate_index(view_t *view)
+{
+	free(view->name_index);
+	view->name_index = NULL;
+	view->name_index_size = 0;
+	view->name_index_entries = NULL;
+	view->name_index_rows = 0;
+}
+
+void
+fpos_index_reordered(view_t *view)
+{
+	/* Keep the table for reuse, mismatch of entries forces refilling it. */
+	view->name_index_entries = NULL;
+}
+
+/* Finds the first entry after the pos position by its name and optionally by
+ * its directory.  Returns index of the entry or -1. */
+static int
+find_by_name(const view_t *view, const char name[], const char dir[], int pos)
+{
+	/* The index is a cache that doesn't affect state of the view. */
+	view_t *const v = (view_t *)view;
+	unsigned int mask;
+	unsigned int i;
+
+	if(view->name_index == NULL || view->name_index_entries != view->dir_entry ||
+			view->name_index_rows != view->list_rows)
 	{
-		if(dir != NULL && stroscmp(view->dir_entry[i].origin, dir) != 0)
+		build_name_index(v);
+	}
+
+	if(view->name_index == NULL)
+	{
+		/* Fallback for the case of memory allocation failure. */
+		for(i = pos + 1; (int)i < view->list_rows; ++i)
 		{
-			continue;
+			if(entry_has_name(&view->dir_entry[i], name, dir))
+			{
+				return i;
+			}
 		}
+		return -1;
+	}
 
-		if(stroscmp(view->dir_entry[i].name, name) == 0)
+	/* Equal names share probe sequence where they are stored in the order of
+	 * increasing positions. */
+	mask = view->name_index_size - 1;
+	for(i = hash_name(name) & mask; view->name_index[i] != -1; i = (i + 1) & mask)
+	{
+		const int entry_pos = view->name_index[i];
+		if(entry_pos > pos &&
+				entry_has_name(&view->dir_entry[entry_pos], name, dir))
 		{
-			return i;
+			return entry_pos;
 		}
 	}
 	return -1;
 }
 
+/* Fills hash table that maps names of entries to their positions.  Leaves the
+ * index empty on memory allocation error. */
+static void
+build_name_index(view_t *view)
+{
+	int i;
+	int size = 16;
+
+	/* Keep load factor below one half for short probe sequences. */
+	while(size < view->list_rows*2)
+	{
+		size *= 2;
+	}
+
+	/* Reordering of entries doesn't change their number, so the table can be
+	 * reused as is. */
+	if(view->name_index == NULL || view->name_index_size != size)
+	{
+		fpos_invalidate_index(view);
+
+		view->name_index = reallocarray(NULL, size, sizeof(*view->name_index));
+		if(view->name_index == NULL)
+		{
+			return;
+		}
+	}
+
+	memset(view->name_index, 0xff, size*sizeof(*view->name_index));
+	view->name_index_size = size;
+	view->name_index_entries = view->dir_entry;
+	view->name_index_rows = view->list_rows;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		unsigned int slot = hash_name(view->dir_entry[i].name) & (size - 1);
+		while(view->name_index[slot] != -1)
+		{
+			slot = (slot + 1) & (size - 1);
+		}
+		view->name_index[slot] = i;
+	}
+}
+
+/* Computes hash of a file name that is consistent with stroscmp().  Returns the
+ * hash. */
+static unsigned int
+hash_name(const char name[])
+{
+	/* FNV-1a. */
+	unsigned int hash = 2166136261U;
+	while(*name != '\0')
+	{
+#ifndef _WIN32
+		hash ^= (unsigned char)*name++;
+#else
+		hash ^= (unsigned char)tolower((unsigned char)*name++);
+#endif
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/* Checks whether entry has specified name and directory (if it's not NULL).
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+entry_has_name(const dir_entry_t *entry, const char name[], const char dir[])
+{
+	return stroscmp(entry->name, name) == 0
+	    && (dir == NULL || stroscmp(entry->origin, dir) == 0);
+}
+
 int
 fpos_scroll_down(view_t *view, int lines_count)
 {
@@ -43,6 +43,21 @@ int fpos_find_by_name(const struct view_t *view, const char name[]);
 int fpos_find_entry(const struct view_t *view, const char name[],
 		const char dir[]);
 
+/* Finds index of the first file with the name that follows the pos position
+ * (-1 to search from the start).  Returns file entry index or -1 if file wasn't
+ * found. */
+int fpos_find_next_by_name(const struct view_t *view, const char name[],
+		int pos);
+
+/* Drops index of entries by names, which must be done whenever entries of the
+ * view are replaced, reordered or renamed. */
+void fpos_invalidate_index(struct view_t *view);
+
+/* Marks index of entries by names as outdated after entries of the view were
+ * reordered in place.  Memory of the index is kept and the index is refilled on
+ * the next lookup. */
+void fpos_index_reordered(struct view_t *view);
+
 /* Tries to move cursor down by given number of lines.  Returns non-zero if
  * position was updated. */
 int fpos_scroll_down(struct view_t *view, int lines_count);
@@ -156,50 +156,24 @@ void
 flist_sel_restore(view_t *view, reg_t *reg)
 {
 	int i;
-	trie_t *const selection_trie = trie_create();
+	char **const paths = (reg == NULL ? view->saved_selection : reg->files);
+	const int npaths = (reg == NULL ? view->nsaved_selection : reg->nfiles);
 
 	flist_sel_drop(view);
 
-	if(reg == NULL)
+	/* Look up each path instead of visiting every entry of the view, because
+	 * number of selected files is usually much smaller. */
+	for(i = 0; i < npaths; ++i)
 	{
-		int i;
-		for(i = 0; i < view->nsaved_selection; ++i)
-		{
-			(void)trie_put(selection_trie, view->saved_selection[i]);
-		}
-	}
-	else
-	{
-		int i;
-		for(i = 0; i < reg->nfiles; ++i)
-		{
-			(void)trie_put(selection_trie, reg->files[i]);
-		}
-	}
-
-	for(i = 0; i < view->list_rows; ++i)
-	{
-		char full_path[PATH_MAX + 1];
-		void *ignored_data;
-		dir_entry_t *const entry = &view->dir_entry[i];
-
-		get_full_path_of(entry, sizeof(full_path), full_path);
-		if(trie_get(selection_trie, full_path, &ignored_data) == 0)
+		dir_entry_t *const entry = entry_from_path(view, view->dir_entry,
+				view->list_rows, paths[i]);
+		if(entry != NULL && !entry->selected)
 		{
 			entry->selected = 1;
 			++view->selected_files;
-
-			/* Assuming that selection is usually contiguous it makes sense to quit
-			 * when we found all elements to optimize this operation. */
-			if(view->selected_files == view->nsaved_selection)
-			{
-				break;
-			}
 		}
 	}
 
-	trie_free(selection_trie);
-
 	redraw_current_view();
 }
 
@@ -373,8 +373,8 @@ fops_delete_bg(view_t *view, int use_trash)
 	args->ops = fops_get_bg_ops(use_trash ? OP_REMOVE : OP_REMOVESL,
 			use_trash ? "deleting" : "Deleting", args->path);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &delete_files_in_bg,
-				args) != 0)
+	if(bg_execute(task_desc, "...", args->sel_list_len, 1, args->path,
+				&delete_files_in_bg, args) != 0)
 	{
 		fops_free_bg_args(args);
 
@@ -1125,7 +1125,7 @@ start_dir_size_calc(const char path[], int force)
 
 	snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", path);
 
-	if(bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
+	if(bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, NULL, &dir_size_bg,
 				args) != 0)
 	{
 		free(args->path);
@@ -29,12 +29,14 @@
 #endif
 
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* free() */
 #include <stdio.h> /* popen() */
 #include <string.h> /* strdup() */
 
 #include "../utils/fs.h"
 #include "../utils/path.h"
+#include "../utils/perf.h"
 #include "../utils/str.h"
 #include "../filetype.h"
 #include "../status.h"
@@ -63,6 +65,9 @@ get_mimetype(const char file[], int resolve_symlinks)
 	static char mimetype[128];
 
 	char target[PATH_MAX + 1];
+	const char *result = mimetype;
+	const uint64_t start = perf_begin();
+
 	if(resolve_symlinks)
 	{
 		char *const symlink_base = strdup(file);
@@ -86,12 +91,13 @@ get_mimetype(const char file[], int resolve_symlinks)
 		{
 			if(get_file_mimetype(file, mimetype, sizeof(mimetype)) == -1)
 			{
-				return NULL;
+				result = NULL;
 			}
 		}
 	}
 
-	return mimetype;
+	perf_end(PK_MIME, start, 0U);
+	return result;
 }
 
 static int
@@ -19,8 +19,8 @@
 #include "path_env.h"
 
 #include <stdio.h> /* snprintf() sprintf() */
-#include <stdlib.h> /* malloc() free() */
-#include <string.h> /* strchr() strlen() */
+#include <stdlib.h> /* calloc() malloc() free() */
+#include <string.h> /* strchr() strcmp() strlen() strncmp() */
 
 #include "../cfg/config.h"
 #include "../compat/dtype.h"
@@ -33,16 +33,44 @@
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
+#include "../utils/utils.h"
+#include "../utils/watch_set.h"
+
+/* Index of names of files in a directory from PATH. */
+typedef struct
+{
+	int watch;       /* Identifier of watch of the directory or -1. */
+	int watch_lost;  /* Whether the watch doesn't work anymore. */
+	char **names;    /* Sorted list of file names. */
+	int count;       /* Number of elements in names. */
+	int valid;       /* Whether names are up to date. */
+	int unavailable; /* Whether directory can't be indexed. */
+}
+dir_index_t;
 
 static int path_env_was_changed(int force);
 static void append_scripts_dirs(void);
 static void add_dirs_to_path(const char *path);
 static void add_to_path(const char *path);
 static void split_path_list(void);
+static void reset_indexes(void);
+static dir_index_t * get_index(size_t idx);
+#ifndef _WIN32
+static void on_dir_changed(int id, int gone, void *arg);
+#endif
+static int build_index(dir_index_t *index, const char path[]);
+static int name_sorter(const void *first, const void *second);
+static int lower_bound(char *names[], int count, const char name[]);
 
 static char **paths;
 static int paths_count;
 
+/* Indexes of directories of PATH, which is parallel to paths. */
+static dir_index_t *indexes;
+
+/* Watches of directories of PATH, created on first use. */
+static watch_set_t *watches;
+
 static char *clean_path;
 static char *real_path;
 
@@ -161,6 +189,8 @@ split_path_list(void)
 
 	path = env_get_def("PATH", "");
 
+	reset_indexes();
+
 	if(paths != NULL)
 		free_string_array(paths, paths_count);
 
@@ -235,6 +265,217 @@ split_path_list(void)
 	}
 	while(q[0] != '\0');
 	paths_count = i;
+
+	indexes = calloc(paths_count, sizeof(*indexes));
+	if(indexes != NULL)
+	{
+		for(i = 0; i < paths_count; ++i)
+		{
+			indexes[i].watch = -1;
+		}
+	}
+}
+
+/* Frees indexes of directories of PATH. */
+static void
+reset_indexes(void)
+{
+	int i;
+
+	if(indexes == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < paths_count; ++i)
+	{
+		if(indexes[i].watch != -1)
+		{
+			watch_set_remove(watches, indexes[i].watch);
+		}
+		free_string_array(indexes[i].names, indexes[i].count);
+	}
+
+	free(indexes);
+	indexes = NULL;
+}
+
+int
+path_dir_may_contain(size_t idx, const char name[])
+{
+	const dir_index_t *const index = get_index(idx);
+	if(index == NULL)
+	{
+		return 1;
+	}
+
+	const int pos = lower_bound(index->names, index->count, name);
+	return (pos < index->count && strcmp(index->names[pos], name) == 0);
+}
+
+char **
+get_path_dir_names(size_t idx, const char prefix[], size_t *count)
+{
+	const dir_index_t *const index = get_index(idx);
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	const size_t prefix_len = strlen(prefix);
+	const int first = lower_bound(index->names, index->count, prefix);
+	int last = first;
+	while(last < index->count &&
+			strncmp(index->names[last], prefix, prefix_len) == 0)
+	{
+		++last;
+	}
+
+	*count = last - first;
+	return index->names + first;
+}
+
+/* Retrieves up to date index of idx-th directory of PATH building it if
+ * necessary.  Returns the index or NULL if it's not available. */
+static dir_index_t *
+get_index(size_t idx)
+{
+#ifndef _WIN32
+	if(indexes == NULL || idx >= (size_t)paths_count)
+	{
+		return NULL;
+	}
+
+	dir_index_t *const index = &indexes[idx];
+	if(index->unavailable)
+	{
+		return NULL;
+	}
+
+	if(watches == NULL)
+	{
+		watches = watch_set_create(0);
+		if(watches == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	watch_set_check(watches, &on_dir_changed, NULL);
+
+	/* Watch is added anew to continue tracking changes. */
+	if(index->watch_lost)
+	{
+		watch_set_remove(watches, index->watch);
+		index->watch = -1;
+		index->watch_lost = 0;
+	}
+
+	if(index->watch == -1)
+	{
+		/* Relative paths depend on current directory, so they can't be indexed.
+		 * Watch is added before reading the directory to not miss changes made in
+		 * between. */
+		index->watch = is_path_absolute(paths[idx])
+		             ? watch_set_add(watches, paths[idx])
+		             : -1;
+		if(index->watch == -1)
+		{
+			index->unavailable = 1;
+			return NULL;
+		}
+		index->valid = 0;
+	}
+
+	if(!index->valid && build_index(index, paths[idx]) != 0)
+	{
+		return NULL;
+	}
+
+	return index;
+#else
+	/* Executables are looked up with different extensions, which makes exact
+	 * matching of names unusable. */
+	return NULL;
+#endif
+}
+
+#ifndef _WIN32
+/* Invalidates indexes of a directory that has changed. */
+static void
+on_dir_changed(int id, int gone, void *arg)
+{
+	int i;
+	for(i = 0; i < paths_count; ++i)
+	{
+		if(indexes[i].watch == id)
+		{
+			indexes[i].valid = 0;
+			indexes[i].watch_lost |= gone;
+		}
+	}
+}
+#endif
+
+/* Reads list of files of the directory into the index.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+build_index(dir_index_t *index, const char path[])
+{
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	free_string_array(index->names, index->count);
+	index->names = NULL;
+	index->count = 0;
+
+	struct dirent *dentry;
+	while((dentry = os_readdir(dir)) != NULL)
+	{
+		if(!is_builtin_dir(dentry->d_name))
+		{
+			index->count = add_to_string_array(&index->names, index->count, 1,
+					dentry->d_name);
+		}
+	}
+	os_closedir(dir);
+
+	safe_qsort(index->names, index->count, sizeof(*index->names), &name_sorter);
+	index->valid = 1;
+	return 0;
+}
+
+/* Wraps strcmp() for use with qsort(). */
+static int
+name_sorter(const void *first, const void *second)
+{
+	const char *const *const a = first;
+	const char *const *const b = second;
+	return strcmp(*a, *b);
+}
+
+/* Finds position of the first element of sorted array that isn't less than the
+ * name.  Returns the position, which is count if there is no such element. */
+static int
+lower_bound(char *names[], int count, const char name[])
+{
+	int l = 0, r = count;
+	while(l < r)
+	{
+		const int m = l + (r - l)/2;
+		if(strcmp(names[m], name) < 0)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			r = m;
+		}
+	}
+	return l;
 }
 
 void
@@ -29,6 +29,18 @@ void update_path_env(int force);
  * the count argument. */
 char ** get_paths(size_t *count);
 
+/* Checks whether directory at position idx in the list returned by get_paths()
+ * might contain a file named name.  Names are looked up in an index of the
+ * directory, which is updated when directory changes.  Returns zero if there is
+ * definitely no such file, otherwise non-zero is returned. */
+int path_dir_may_contain(size_t idx, const char name[]);
+
+/* Lists names of files that start with the prefix in directory at position idx
+ * in the list returned by get_paths().  *count is set to number of names.
+ * Returns sorted list of names, which shouldn't be freed by the caller and is
+ * valid until next call to this unit, or NULL if directory isn't indexed. */
+char ** get_path_dir_names(size_t idx, const char prefix[], size_t *count);
+
 /* Sets PATH to its value that was set by user or another program. Use
  * load_real_path_env() function to revert this effect. */
 void load_clean_path_env(void);
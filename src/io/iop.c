@@ -34,6 +34,7 @@
 #include <assert.h> /* assert() */
 #include <errno.h> /* EEXIST ENOENT EISDIR errno */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
                       fsetpos() fwrite() snprintf() */
 #include <stdlib.h> /* free() */
@@ -45,6 +46,7 @@
 #include "../utils/log.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
+#include "../utils/perf.h"
 #include "../utils/str.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
@@ -277,7 +279,17 @@ iop_rmdir_internal(io_args_t *args)
 int
 iop_cp(io_args_t *args)
 {
-	return retry_wrapper(&iop_cp_internal, args);
+	const uint64_t start = perf_begin();
+	const int result = retry_wrapper(&iop_cp_internal, args);
+
+	/* Size is queried only when it's going to be recorded. */
+	if(start != 0U)
+	{
+		perf_end(PK_COPY, start,
+				result == 0 ? get_file_size(args->arg2.dst) : 0U);
+	}
+
+	return result;
 }
 
 /* Implementation of iop_cp(). */
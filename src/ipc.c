@@ -27,10 +27,17 @@
 #endif
 
 #ifndef WIN32_PIPE_READ
-# include <sys/types.h>
-# include <sys/select.h> /* FD_* select() */
+# include <sys/socket.h> /* AF_UNIX MSG_NOSIGNAL SOCK_STREAM accept() bind()
+                            connect() getsockopt() listen() recv() send()
+                            socket() socklen_t */
+# include <sys/types.h> /* gid_t pid_t uid_t */
+# include <sys/un.h> /* sockaddr_un */
+# include <poll.h> /* POLLIN POLLOUT poll() pollfd */
+# include <signal.h> /* kill() */
+# ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+# endif
 #else
-# define O_NONBLOCK 0
 # define REQUIRED_WINVER 0x0600 /* To get PIPE_REJECT_REMOTE_CLIENTS. */
 # include "utils/windefs.h"
 # include <windows.h>
@@ -42,16 +49,21 @@
 # endif
 #endif
 
-#include <sys/stat.h> /* mkfifo() stat() */
-#include <dirent.h> /* DIR closedir() opendir() readdir() */
-#include <fcntl.h>
-#include <unistd.h> /* close() open() select() unlink() usleep() */
+#include <sys/stat.h> /* S_ISDIR S_ISREG S_ISSOCK chmod() fstat() lstat()
+                          mkdir() stat */
+#include <fcntl.h> /* FD_CLOEXEC F_* O_* fcntl() flock open() */
+#include <unistd.h> /* close() ftruncate() getpid() getuid() lseek() read()
+                       unlink() usleep() write() */
 
-#include <errno.h> /* EACCES EEXIST EDQUOT ENOSPC ENXIO errno */
+#include <errno.h> /* EACCES EADDRINUSE EAGAIN EEXIST EINTR EPERM EWOULDBLOCK
+                      errno */
+#include <limits.h> /* UINT_MAX */
 #include <stddef.h> /* NULL size_t ssize_t */
-#include <stdio.h> /* FILE fclose() fdopen() fread() fwrite() */
-#include <stdlib.h> /* free() malloc() snprintf() */
-#include <string.h> /* strcmp() strcpy() strlen() */
+#include <stdint.h> /* uint32_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() realloc() strtol() strtoul() */
+#include <string.h> /* memcpy() memmove() memset() strcmp() strcpy() strlen()
+                       strncmp() */
 
 #include "utils/fs.h"
 #include "utils/log.h"
@@ -68,8 +80,9 @@
  *
  *     "version:{...}" -\
  *     "from:{name}"   --\
- *     "body:{type}"   ---\
- *                         some sort of a header that ends on `body:`
+ *     "id:{number}"   ---\
+ *     "body:{type}"   ----\
+ *                          some sort of a header that ends on `body:`
  *     "string #1"     -\
  *     "string #2"     --\
  *     {...}           ---\
@@ -83,6 +96,9 @@
  *
  * {name} is a name of another instance.
  *
+ * {number} is an optional non-zero identifier of a request, which is repeated
+ * in a reply to it.
+ *
  * {type} can be:
  *  - "args" to pass list of arguments, in which case body is prepended with CWD
  *    unconditionally;
@@ -93,18 +109,59 @@
  *
  * On version mismatch or unknown field name, packet is discarded which is
  * logged.
+ *
+ * On the wire each packet is prepended with its size as a 32-bit number in
+ * native byte order.
+ *
+ * On *nix instances listen on Unix domain sockets and replies are sent back
+ * over the same connection.  Connections can be kept open to send any number
+ * of packets, which are processed in the order they were sent.  Running
+ * instances are recorded in a per-user registry file, which is locked while
+ * it's being read or updated.  Each line of the registry is "{pid} {name}".
+ * Sockets and the registry reside in a directory that is accessible only by
+ * its owner, connections from processes of other users are rejected.
+ *
+ * On Windows each packet is sent over a new connection to a named pipe of the
+ * target instance and replies are sent to a named pipe of the sender.
  */
 
 /* Prefix for names of all pipes to distinguish them from other pipes. */
 #define PREFIX "vifm-ipc-"
 
 #ifndef WIN32_PIPE_READ
-typedef FILE *read_pipe_t;
-#define NULL_READ_PIPE NULL
+
+/* Prefix of name of the directory with sockets and the registry. */
+#define DIR_PREFIX "vifm-"
+
+/* Prefix of name of the registry of running instances. */
+#define REGISTRY_PREFIX "vifm-servers-"
+
+/* Maximum number of clients that are served at the same time. */
+#define MAX_CLIENTS (IPC_MAX_FDS - 1)
+
+/* Maximum size of a packet in bytes. */
+#define MAX_PKG_SIZE (16U*1024U*1024U)
+
+/* Maximum time in milliseconds to wait on another instance. */
+#define IO_TIMEOUT 1000
+
+/* Time in milliseconds between attempts to lock the registry. */
+#define LOCK_RETRY_INTERVAL 10
+
+/* Connection with another instance. */
+typedef struct
+{
+	int fd;     /* Socket or -1. */
+	char *buf;  /* Received data that wasn't processed yet. */
+	size_t len; /* Amount of data in the buffer. */
+	size_t cap; /* Size of the buffer. */
+}
+conn_t;
+
 #else
+
 typedef HANDLE read_pipe_t;
 #define NULL_READ_PIPE INVALID_HANDLE_VALUE
-#endif
 
 /* Holds list information for add_to_list(). */
 typedef struct
@@ -116,6 +173,8 @@ typedef struct
 }
 list_data_t;
 
+#endif
+
 /* Storage of data of an instance. */
 struct ipc_t
 {
@@ -127,33 +186,94 @@ struct ipc_t
 	int locked;
 	/* Path to the pipe used by this instance. */
 	char pipe_path[PATH_MAX + 1];
+#ifndef WIN32_PIPE_READ
+	/* Listening socket. */
+	int listen_fd;
+	/* Connections of other instances to this one. */
+	conn_t clients[MAX_CLIENTS];
+	/* Number of elements in the clients array. */
+	int nclients;
+	/* Connection to another instance made by this one. */
+	conn_t peer;
+	/* Name of the instance to which peer is connected or NULL. */
+	char *peer_name;
+	/* Identifier of the next request. */
+	unsigned int next_id;
+#else
 	/* Opened file of the pipe. */
 	read_pipe_t pipe_file;
 	/* Holds result of expression evaluation or NULL on evaluation error. */
 	char *eval_result;
+#endif
 };
 
+/* Parsed packet. */
+typedef struct
+{
+	const char *type; /* Type of the body. */
+	const char *from; /* Name of the sender. */
+	unsigned int id;  /* Identifier of a request or zero. */
+	char **array;     /* Strings of the body. */
+	int len;          /* Number of elements in the array. */
+}
+pkg_t;
+
+#ifndef WIN32_PIPE_READ
+static int create_socket(const char name[], char path_buf[], size_t len);
+static int try_use_socket(const char path[], const char name[],
+		const char registry[], int *fatal);
+static int make_address(const char path[], struct sockaddr_un *addr);
+static void accept_clients(ipc_t *ipc);
+static int serve_client(ipc_t *ipc, conn_t *conn);
+static int send_reply(ipc_t *ipc, conn_t *conn, unsigned int id,
+		const char type[], char *data[]);
+static int eval_many(ipc_t *ipc, const char whom[], char *exprs[], int n,
+		char *results[]);
+static int collect_replies(ipc_t *ipc, unsigned int first_id, int n,
+		char *results[]);
+static int send_to_peer(ipc_t *ipc, const char whom[], const char data[],
+		size_t len);
+static int connect_to_peer(ipc_t *ipc, const char whom[]);
+static int append_pkg(char **buf, size_t *len, const char pkg[],
+		size_t pkg_len);
+static char * take_pkg(conn_t *conn, size_t *pos, int *len, int *error);
+static int conn_receive(conn_t *conn);
+static int conn_write(conn_t *conn, const char data[], size_t len);
+static void conn_close(conn_t *conn);
+static void make_nonblocking(int fd);
+static int peer_is_trusted(int fd);
+static int prepare_ipc_dir(void);
+static int registry_open(int exclusive);
+static void registry_close(int fd);
+static char * registry_read(int fd);
+static int registry_has(const char registry[], const char name[]);
+static void registry_update(int fd, const char registry[], const char name[],
+		int add);
+static const char * next_record(const char **pos, pid_t *pid, size_t *len);
+static int process_is_alive(pid_t pid);
+#else
 static read_pipe_t create_pipe(const char name[], char path_buf[], size_t len);
 static char * receive_pkg(ipc_t *ipc, int *len);
 static read_pipe_t try_use_pipe(const char path[], int *fatal);
-static void handle_pkg(ipc_t *ipc, const char pkg[], const char *end);
+static char * eval_one(ipc_t *ipc, const char whom[], const char expr[]);
+static int send_pkg(const char whom[], const char what[], size_t len);
+static int add_to_list(const char name[], const void *data, void *param);
+#endif
+static int parse_pkg(char pkg[], const char *end, pkg_t *parsed);
+static void handle_pkg(ipc_t *ipc, void *conn, char pkg[], const char *end);
 static void handle_args(ipc_t *ipc, char ***array, int len);
-static void handle_expr(ipc_t *ipc, const char from[], char *array[], int len);
-static void handle_eval_result(ipc_t *ipc, char *array[], int len);
+static void handle_expr(ipc_t *ipc, void *conn, const pkg_t *pkg);
 static int format_and_send(ipc_t *ipc, const char whom[], char *data[],
 		const char type[]);
-static int send_pkg(const char whom[], const char what[], size_t len);
+static size_t format_pkg(ipc_t *ipc, const char type[], unsigned int id,
+		char *data[], char pkg[], size_t size);
 static char * get_the_only_target(const ipc_t *ipc);
 static char ** list_servers(const ipc_t *ipc, int *len);
-static int add_to_list(const char name[], const void *data, void *param);
 static const char * get_ipc_dir(void);
 static int sorter(const void *first, const void *second);
-#ifndef WIN32_PIPE_READ
-static int pipe_is_in_use(const char path[]);
-#endif
 
 /* Current version string. */
-static const char IPC_VERSION[] = "version:1";
+static const char IPC_VERSION[] = "version:2";
 /* Request to process remote arguments. */
 static const char ARGS_TYPE[] = "args";
 /* Request to process remote expression. */
@@ -172,7 +292,7 @@ ipc_enabled(void)
 ipc_t *
 ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 {
-	ipc_t *const ipc = malloc(sizeof(*ipc));
+	ipc_t *const ipc = calloc(1, sizeof(*ipc));
 	if(ipc == NULL)
 	{
 		return NULL;
@@ -187,12 +307,24 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 		name = "vifm";
 	}
 
+#ifndef WIN32_PIPE_READ
+	ipc->listen_fd = create_socket(name, ipc->pipe_path, sizeof(ipc->pipe_path));
+	if(ipc->listen_fd == -1)
+	{
+		free(ipc);
+		return NULL;
+	}
+
+	ipc->peer.fd = -1;
+	ipc->next_id = 1U;
+#else
 	ipc->pipe_file = create_pipe(name, ipc->pipe_path, sizeof(ipc->pipe_path));
 	if(ipc->pipe_file == NULL_READ_PIPE)
 	{
 		free(ipc);
 		return NULL;
 	}
+#endif
 
 	return ipc;
 }
@@ -206,8 +338,28 @@ ipc_free(ipc_t *ipc)
 	}
 
 #ifndef WIN32_PIPE_READ
-	fclose(ipc->pipe_file);
-	unlink(ipc->pipe_path);
+	{
+		int i;
+		int registry;
+		char *contents;
+
+		for(i = 0; i < ipc->nclients; ++i)
+		{
+			conn_close(&ipc->clients[i]);
+		}
+		conn_close(&ipc->peer);
+		free(ipc->peer_name);
+		close(ipc->listen_fd);
+
+		/* Removal is done under the lock to not remove socket of an instance that
+		 * is being started. */
+		registry = registry_open(1);
+		contents = registry_read(registry);
+		unlink(ipc->pipe_path);
+		registry_update(registry, contents, ipc_get_name(ipc), 0);
+		free(contents);
+		registry_close(registry);
+	}
 #else
 	CloseHandle(ipc->pipe_file);
 #endif
@@ -223,377 +375,1356 @@ ipc_get_name(const ipc_t *ipc)
 int
 ipc_check(ipc_t *ipc)
 {
-	int len;
-	char *pkg;
-
 	if(ipc->locked)
 	{
 		return 0;
 	}
 
-	pkg = receive_pkg(ipc, &len);
-	if(pkg != NULL)
+#ifndef WIN32_PIPE_READ
 	{
-		handle_pkg(ipc, pkg, pkg + len);
-		free(pkg);
-		return 1;
+		int i;
+		int handled = 0;
+
+		accept_clients(ipc);
+
+		i = 0;
+		while(i < ipc->nclients)
+		{
+			conn_t *const conn = &ipc->clients[i];
+
+			/* Whatever was received before the client disconnected still needs to be
+			 * processed. */
+			const int closed = conn_receive(conn);
+			handled |= serve_client(ipc, conn);
+
+			if(closed || conn->fd == -1)
+			{
+				conn_close(conn);
+				*conn = ipc->clients[--ipc->nclients];
+				continue;
+			}
+			++i;
+		}
+
+		return handled;
 	}
-	return 0;
+#else
+	{
+		int len;
+		char *const pkg = receive_pkg(ipc, &len);
+		if(pkg != NULL)
+		{
+			handle_pkg(ipc, NULL, pkg, pkg + len);
+			free(pkg);
+			return 1;
+		}
+		return 0;
+	}
+#endif
 }
 
-/* Receives message addressed to this instance.  Returns NULL if there was no
- * message or on failure to read it, otherwise newly allocated string is
- * returned. */
-static char *
-receive_pkg(ipc_t *ipc, int *len)
+int
+ipc_get_fds(const ipc_t *ipc, int fds[IPC_MAX_FDS])
 {
 #ifndef WIN32_PIPE_READ
-	uint32_t size;
-	char *pkg;
-	char *p;
+	int i;
+	int nfds = 0;
 
-	fd_set ready;
-	int max_fd;
-	struct timeval ts = { .tv_sec = 0, .tv_usec = 10000 };
+	/* Locked instance doesn't read messages, so there is no point in waiting
+	 * for them. */
+	if(ipc->locked)
+	{
+		return -1;
+	}
 
-	/* At least on OS X pipe might get into EOF state, so reset it.  This will
-	 * also reset any errors, which is fine with us. */
-	clearerr(ipc->pipe_file);
+	/* New connections wait in the queue until some client disconnects. */
+	if(ipc->nclients < MAX_CLIENTS)
+	{
+		fds[nfds++] = ipc->listen_fd;
+	}
 
-	if(fread(&size, sizeof(size), 1U, ipc->pipe_file) != 1U ||
-			size >= 4294967294U)
+	for(i = 0; i < ipc->nclients; ++i)
 	{
-		return NULL;
+		fds[nfds++] = ipc->clients[i].fd;
 	}
+	return nfds;
+#else
+	return -1;
+#endif
+}
 
-	pkg = malloc(size + 1U);
-	if(pkg == NULL)
+#ifndef WIN32_PIPE_READ
+
+/* Creates listening socket picking unused name.  Returns the socket or -1 on
+ * error. */
+static int
+create_socket(const char name[], char path_buf[], size_t len)
+{
+	unsigned int id = 0U;
+	int fd;
+	int fatal;
+	int registry;
+	char *contents;
+
+	if(prepare_ipc_dir() != 0)
 	{
-		LOG_ERROR_MSG("Failed to allocate memory: %lu", (unsigned long)(size + 1));
-		return NULL;
+		return -1;
 	}
 
-	max_fd = fileno(ipc->pipe_file);
-	FD_ZERO(&ready);
-	FD_SET(max_fd, &ready);
+	registry = registry_open(1);
+	contents = registry_read(registry);
 
-	p = pkg;
-	while(size != 0U && select(max_fd + 1, &ready, NULL, NULL, &ts) > 0)
+	/* Try to use name as is at first. */
+	snprintf(path_buf, len, "%s/" PREFIX "%s", get_ipc_dir(), name);
+	fd = try_use_socket(path_buf, name, contents, &fatal);
+	while(fd == -1 && !fatal)
 	{
-		const size_t nread = fread(p, 1U, size, ipc->pipe_file);
-		size -= nread;
-		p += nread;
+		char full_name[NAME_MAX + 1];
 
-		if(nread == 0U)
+		if(++id == 0U)
 		{
 			break;
 		}
 
-		ts.tv_sec = 0;
-		ts.tv_usec = 10000;
+		snprintf(full_name, sizeof(full_name), "%s%u", name, id);
+		snprintf(path_buf, len, "%s/" PREFIX "%s", get_ipc_dir(), full_name);
+		fd = try_use_socket(path_buf, full_name, contents, &fatal);
 	}
 
-	if(size != 0U)
+	if(fd != -1)
 	{
-		free(pkg);
-		LOG_ERROR_MSG("Failed to read whole packet, left: %lu",
-				(unsigned long)size);
-		return NULL;
+		registry_update(registry, contents,
+				get_last_path_component(path_buf) + (sizeof(PREFIX) - 1U), 1);
 	}
 
-	/* Make sure we have a trailing zero. */
-	*p = '\0';
-	*len = p - pkg;
+	free(contents);
+	registry_close(registry);
+	return fd;
+}
 
-	return pkg;
-#else
-	uint32_t size;
-	char *pkg;
-	char *p;
-	DWORD nread;
+/* Either creates a socket or reuses path of previously abandoned one.  Returns
+ * -1 on failure (with *fatal set to non-zero if further tries don't make any
+ * sense) or listening socket otherwise. */
+static int
+try_use_socket(const char path[], const char name[], const char registry[],
+		int *fatal)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
 
-	if(ReadFile(ipc->pipe_file, &size, sizeof(size), &nread, NULL) == FALSE ||
-			size >= 4294967294U)
+	*fatal = 1;
+
+	if(make_address(path, &addr) != 0)
 	{
-		return NULL;
+		return -1;
 	}
 
-	pkg = malloc(size + 1U);
-	if(pkg == NULL)
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
 	{
-		return NULL;
+		LOG_SERROR_MSG(errno, "Failed to create a socket");
+		return -1;
 	}
 
-	p = pkg;
-	while(size != 0U)
+	if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
 	{
-		/* TODO: maybe use OVERLAPPED I/O on Windows instead, it's just so
-		 *       inconvenient... */
-		usleep(10000);
-
-		if(ReadFile(ipc->pipe_file, p, size, &nread, NULL) == FALSE || nread == 0U)
+		/* Socket that isn't registered was left by an instance that has crashed.
+		 * Any other kind of file (like a FIFO of older version) isn't touched. */
+		if(errno != EADDRINUSE || lstat(path, &st) != 0 || !S_ISSOCK(st.st_mode) ||
+				registry == NULL || registry_has(registry, name) ||
+				unlink(path) != 0 ||
+				bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
 		{
-			break;
+			*fatal = (errno != EADDRINUSE && errno != EEXIST);
+			close(fd);
+			return -1;
 		}
-
-		size -= nread;
-		p += nread;
 	}
 
-	/* Weird requirement for named pipes, need to break and set connection every
-	 * time. */
-	DisconnectNamedPipe(ipc->pipe_file);
-	ConnectNamedPipe(ipc->pipe_file, NULL);
+	*fatal = 0;
 
-	if(size != 0U)
+	if(chmod(path, 0600) != 0 || listen(fd, MAX_CLIENTS) != 0)
 	{
-		free(pkg);
-		return NULL;
+		LOG_SERROR_MSG(errno, "Failed to set up a socket");
+		close(fd);
+		(void)unlink(path);
+		return -1;
 	}
 
-	/* Make sure we have a trailing zero. */
-	*p = '\0';
-	*len = p - pkg;
-
-	return pkg;
-#endif
+	make_nonblocking(fd);
+	return fd;
 }
 
-/* Tries to open a pipe for communication.  Returns NULL_READ_PIPE on error or
- * opened file descriptor otherwise. */
-static read_pipe_t
-create_pipe(const char name[], char path_buf[], size_t len)
+/* Fills socket address structure.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+make_address(const char path[], struct sockaddr_un *addr)
 {
-	unsigned int id = 0U;
-	read_pipe_t rp;
-	int fatal;
+	if(strlen(path) >= sizeof(addr->sun_path))
+	{
+		LOG_ERROR_MSG("Path of a socket is too long: %s", path);
+		return 1;
+	}
 
-	/* Try to use name as is at first. */
-	snprintf(path_buf, len, "%s/" PREFIX "%s", get_ipc_dir(), name);
-	rp = try_use_pipe(path_buf, &fatal);
-	while(rp == NULL_READ_PIPE && !fatal)
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+/* Accepts pending connections while there is space for them. */
+static void
+accept_clients(ipc_t *ipc)
+{
+	while(ipc->nclients < MAX_CLIENTS)
 	{
-		snprintf(path_buf, len, "%s/" PREFIX "%s%u", get_ipc_dir(), name, ++id);
+		conn_t *conn;
 
-		if(id == 0)
+		const int fd = accept(ipc->listen_fd, NULL, NULL);
+		if(fd == -1)
 		{
-			return NULL_READ_PIPE;
+			break;
 		}
 
-		rp = try_use_pipe(path_buf, &fatal);
-	}
+		if(!peer_is_trusted(fd))
+		{
+			LOG_ERROR_MSG("Rejected connection from a process of another user");
+			close(fd);
+			continue;
+		}
 
-	return rp;
+		make_nonblocking(fd);
+
+		conn = &ipc->clients[ipc->nclients++];
+		memset(conn, 0, sizeof(*conn));
+		conn->fd = fd;
+	}
 }
 
-/* Either creates a pipe or reused previously abandoned one.  Returns
- * NULL_READ_PIPE on failure (with *fatal set to non-zero if further tries don't
- * make any sense) or valid file descriptor otherwise. */
-static read_pipe_t
-try_use_pipe(const char path[], int *fatal)
+/* Handles all complete packets received from a client.  Returns non-zero if
+ * there were any, otherwise zero is returned. */
+static int
+serve_client(ipc_t *ipc, conn_t *conn)
 {
-#ifndef WIN32_PIPE_READ
-	FILE *f;
-	int fd;
-
-	*fatal = 0;
+	int handled = 0;
+	size_t pos = 0U;
 
-	/* Try to create a pipe. */
-	if(mkfifo(path, 0600) == 0)
+	while(conn->fd != -1)
 	{
-		/* Open if created. */
-		const int fd = open(path, O_RDONLY | O_NONBLOCK);
-		if(fd == -1)
+		int len, error;
+		char *const pkg = take_pkg(conn, &pos, &len, &error);
+		if(pkg == NULL)
 		{
-			if(errno == EACCES)
+			if(error)
 			{
-				/* If we created a file that we can't open, remove it and assume that
-				 * something is fundamentally wrong with the system setup. */
-				(void)unlink(path);
-				*fatal = 1;
+				conn_close(conn);
 			}
-			return NULL_READ_PIPE;
+			break;
 		}
-		return fdopen(fd, "r");
+
+		handle_pkg(ipc, conn, pkg, pkg + len);
+		free(pkg);
+		handled = 1;
 	}
 
-	/* Fail fast if the error is not related to existence of the file or pipe
-	 * exists and is in use. */
-	if(errno != EEXIST || pipe_is_in_use(path))
+	if(conn->buf != NULL)
 	{
-		/* No retries if file-system is unable to create more files. */
-		*fatal = (errno == EDQUOT || errno == ENOSPC);
-		return NULL_READ_PIPE;
+		memmove(conn->buf, conn->buf + pos, conn->len - pos);
+		conn->len -= pos;
 	}
+	return handled;
+}
 
-	/* Use this file if we're the only one willing to read from it. */
-	fd = open(path, O_RDONLY | O_NONBLOCK);
+/* Sends reply to a request over connection it came from.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+send_reply(ipc_t *ipc, conn_t *conn, unsigned int id, const char type[],
+		char *data[])
+{
+	char pkg[8192];
+	char *buf = NULL;
+	size_t buf_len = 0U;
+	int error;
 
-	if(fd == -1)
+	const size_t len = format_pkg(ipc, type, id, data, pkg, sizeof(pkg));
+	if(len == 0U || append_pkg(&buf, &buf_len, pkg, len) != 0)
 	{
-		return NULL_READ_PIPE;
+		free(buf);
+		return 1;
 	}
 
-	f = fdopen(fd, "r");
-	if(f == NULL_READ_PIPE)
+	error = conn_write(conn, buf, buf_len);
+	free(buf);
+
+	if(error)
 	{
-		close(fd);
+		conn_close(conn);
 	}
-	return f;
-#else
-	*fatal = 0;
-	return CreateNamedPipeA(path,
-			PIPE_ACCESS_INBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE,
-			PIPE_TYPE_BYTE | PIPE_NOWAIT | PIPE_REJECT_REMOTE_CLIENTS,
-			PIPE_UNLIMITED_INSTANCES, 4096, 4096, 10, NULL);
-#endif
+	return error;
 }
 
-/* Parses pkg into array of strings and invokes callback. */
-static void
-handle_pkg(ipc_t *ipc, const char pkg[], const char *end)
+/* Sends all expressions at once and then waits for all replies.  Returns zero
+ * if all requests were answered, otherwise non-zero is returned. */
+static int
+eval_many(ipc_t *ipc, const char whom[], char *exprs[], int n,
+		char *results[])
 {
-	char **array = NULL;
+	int i;
+	int error;
+	char *buf = NULL;
 	size_t len = 0U;
-	int in_body = 0;
-	const char *type = NULL;
-	const char *from = NULL;
+	unsigned int first_id;
 
-	while(pkg != end)
+	/* Skip zero on overflow, because it means absence of an identifier. */
+	if(ipc->next_id > UINT_MAX - n)
 	{
-		if(in_body)
-		{
-			len = add_to_string_array(&array, len, 1, pkg);
-		}
-		else if(starts_with_lit(pkg, "version:"))
-		{
-			if(strcmp(pkg, IPC_VERSION) != 0)
-			{
-				break;
-			}
-		}
-		else if(starts_with_lit(pkg, "from:"))
-		{
-			from = after_first(pkg, ':');
-		}
-		else if(starts_with_lit(pkg, "body:"))
-		{
-			type = after_first(pkg, ':');
-			in_body = 1;
-		}
-		else
-		{
-			break;
-		}
-		pkg += strlen(pkg) + 1;
+		ipc->next_id = 1U;
 	}
+	first_id = ipc->next_id;
+	ipc->next_id += n;
 
-	if(pkg != end)
+	for(i = 0; i < n; ++i)
 	{
-		LOG_ERROR_MSG("Discarded remote package due to field: `%s`", pkg);
+		char pkg[8192];
+		char *data[] = { exprs[i], NULL };
+		const size_t pkg_len = format_pkg(ipc, EVAL_TYPE, first_id + i, data, pkg,
+				sizeof(pkg));
+		if(pkg_len == 0U || append_pkg(&buf, &len, pkg, pkg_len) != 0)
+		{
+			free(buf);
+			return 1;
+		}
 	}
-	else if(from == NULL)
+
+	error = send_to_peer(ipc, whom, buf, len);
+	free(buf);
+
+	if(error)
 	{
-		LOG_ERROR_MSG("Discarded remote package due to missing from field");
+		LOG_ERROR_MSG("Failed to send expressions");
+		return 1;
 	}
-	else if(type == NULL)
-	{
+
+	return collect_replies(ipc, first_id, n, results);
+}
+
+/* Receives replies to requests with identifiers in the range
+ * [first_id; first_id + n).  Replies to other requests (e.g., to those that
+ * have timed out before) are ignored.  Returns zero if all requests were
+ * answered, otherwise non-zero is returned. */
+static int
+collect_replies(ipc_t *ipc, unsigned int first_id, int n, char *results[])
+{
+	int nanswered = 0;
+	char *const answered = calloc(n, 1);
+	if(answered == NULL)
+	{
+		return 1;
+	}
+
+	while(nanswered < n && ipc->peer.fd != -1)
+	{
+		struct pollfd pfd = { .fd = ipc->peer.fd, .events = POLLIN };
+		size_t pos = 0U;
+		int closed;
+
+		if(poll(&pfd, 1, IO_TIMEOUT) <= 0)
+		{
+			LOG_ERROR_MSG("Timed out on waiting for --remote-expr response");
+			break;
+		}
+
+		closed = conn_receive(&ipc->peer);
+
+		while(1)
+		{
+			int len, error;
+			pkg_t parsed;
+			int idx;
+
+			char *const pkg = take_pkg(&ipc->peer, &pos, &len, &error);
+			if(pkg == NULL)
+			{
+				closed |= error;
+				break;
+			}
+
+			if(parse_pkg(pkg, pkg + len, &parsed) == 0)
+			{
+				idx = parsed.id - first_id;
+				if(parsed.id >= first_id && idx < n && !answered[idx])
+				{
+					if(strcmp(parsed.type, EVAL_RESULT_TYPE) == 0 && parsed.len == 1)
+					{
+						results[idx] = parsed.array[0];
+						parsed.array[0] = NULL;
+					}
+					answered[idx] = 1;
+					++nanswered;
+				}
+				free_string_array(parsed.array, parsed.len);
+			}
+			free(pkg);
+		}
+
+		if(ipc->peer.buf != NULL)
+		{
+			memmove(ipc->peer.buf, ipc->peer.buf + pos, ipc->peer.len - pos);
+			ipc->peer.len -= pos;
+		}
+
+		if(closed)
+		{
+			conn_close(&ipc->peer);
+		}
+	}
+
+	free(answered);
+	return (nanswered != n);
+}
+
+/* Sends data to another instance over a connection to it, which is kept open.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+send_to_peer(ipc_t *ipc, const char whom[], const char data[], size_t len)
+{
+	const int reused = (ipc->peer.fd != -1 && ipc->peer_name != NULL &&
+			strcmp(ipc->peer_name, whom) == 0);
+
+	if(connect_to_peer(ipc, whom) != 0)
+	{
+		return 1;
+	}
+
+	if(conn_write(&ipc->peer, data, len) == 0)
+	{
+		return 0;
+	}
+
+	conn_close(&ipc->peer);
+
+	/* The instance might have been restarted since the connection was made. */
+	if(reused && connect_to_peer(ipc, whom) == 0 &&
+			conn_write(&ipc->peer, data, len) == 0)
+	{
+		return 0;
+	}
+
+	LOG_ERROR_MSG("Failed to write into a socket");
+	conn_close(&ipc->peer);
+	return 1;
+}
+
+/* Makes sure that there is a connection to the specified instance.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+connect_to_peer(ipc_t *ipc, const char whom[])
+{
+	char path[PATH_MAX + 1];
+	struct sockaddr_un addr;
+	int fd;
+
+	if(ipc->peer.fd != -1 && ipc->peer_name != NULL &&
+			strcmp(ipc->peer_name, whom) == 0)
+	{
+		return 0;
+	}
+
+	conn_close(&ipc->peer);
+
+	if(prepare_ipc_dir() != 0)
+	{
+		return 1;
+	}
+
+	snprintf(path, sizeof(path), "%s/" PREFIX "%s", get_ipc_dir(), whom);
+	if(make_address(path, &addr) != 0)
+	{
+		return 1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
+	{
+		LOG_SERROR_MSG(errno, "Failed to create a socket");
+		return 1;
+	}
+
+	if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to connect to %s", path);
+		close(fd);
+		return 1;
+	}
+
+	if(!peer_is_trusted(fd))
+	{
+		LOG_ERROR_MSG("Socket is served by a process of another user: %s", path);
+		close(fd);
+		return 1;
+	}
+
+	make_nonblocking(fd);
+
+	if(replace_string(&ipc->peer_name, whom) != 0)
+	{
+		close(fd);
+		return 1;
+	}
+
+	ipc->peer.fd = fd;
+	return 0;
+}
+
+/* Appends packet prepended with its size to the buffer.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+append_pkg(char **buf, size_t *len, const char pkg[], size_t pkg_len)
+{
+	const uint32_t size = pkg_len;
+	char *const new_buf = realloc(*buf, *len + sizeof(size) + pkg_len);
+	if(new_buf == NULL)
+	{
+		return 1;
+	}
+
+	memcpy(new_buf + *len, &size, sizeof(size));
+	memcpy(new_buf + *len + sizeof(size), pkg, pkg_len);
+	*buf = new_buf;
+	*len += sizeof(size) + pkg_len;
+	return 0;
+}
+
+/* Extracts next complete packet from the buffer of the connection starting at
+ * *pos, which is advanced past it.  Sets *error on malformed input.  Returns
+ * newly allocated packet with a trailing zero or NULL if there isn't one. */
+static char *
+take_pkg(conn_t *conn, size_t *pos, int *len, int *error)
+{
+	uint32_t size;
+	char *pkg;
+
+	*error = 0;
+
+	if(conn->len - *pos < sizeof(size))
+	{
+		return NULL;
+	}
+
+	memcpy(&size, conn->buf + *pos, sizeof(size));
+	if(size > MAX_PKG_SIZE)
+	{
+		LOG_ERROR_MSG("Packet is too big: %lu", (unsigned long)size);
+		*error = 1;
+		return NULL;
+	}
+
+	if(conn->len - *pos - sizeof(size) < size)
+	{
+		return NULL;
+	}
+
+	pkg = malloc(size + 1U);
+	if(pkg == NULL)
+	{
+		LOG_ERROR_MSG("Failed to allocate memory: %lu", (unsigned long)(size + 1));
+		*error = 1;
+		return NULL;
+	}
+
+	memcpy(pkg, conn->buf + *pos + sizeof(size), size);
+	/* Make sure we have a trailing zero. */
+	pkg[size] = '\0';
+
+	*pos += sizeof(size) + size;
+	*len = size;
+	return pkg;
+}
+
+/* Reads everything that's available on the connection.  Returns non-zero if
+ * the connection was closed or failed, otherwise zero is returned. */
+static int
+conn_receive(conn_t *conn)
+{
+	while(conn->fd != -1)
+	{
+		ssize_t nread;
+
+		if(conn->cap - conn->len < 4096U)
+		{
+			const size_t cap = conn->cap*2U + 4096U;
+			char *const buf = realloc(conn->buf, cap);
+			if(buf == NULL)
+			{
+				return 1;
+			}
+			conn->buf = buf;
+			conn->cap = cap;
+		}
+
+		nread = recv(conn->fd, conn->buf + conn->len, conn->cap - conn->len, 0);
+		if(nread > 0)
+		{
+			conn->len += nread;
+			continue;
+		}
+
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		return (nread == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+	}
+	return 1;
+}
+
+/* Writes all data into a connection waiting for it to accept the data if
+ * needed.  Returns zero on success, otherwise non-zero is returned. */
+static int
+conn_write(conn_t *conn, const char data[], size_t len)
+{
+	while(len != 0U)
+	{
+		struct pollfd pfd = { .fd = conn->fd, .events = POLLOUT };
+
+		const ssize_t nwritten = send(conn->fd, data, len, MSG_NOSIGNAL);
+		if(nwritten > 0)
+		{
+			data += nwritten;
+			len -= nwritten;
+			continue;
+		}
+
+		if(nwritten < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(nwritten == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) ||
+				poll(&pfd, 1, IO_TIMEOUT) <= 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Closes connection and frees its buffer. */
+static void
+conn_close(conn_t *conn)
+{
+	if(conn->fd != -1)
+	{
+		close(conn->fd);
+		conn->fd = -1;
+	}
+
+	free(conn->buf);
+	conn->buf = NULL;
+	conn->len = 0U;
+	conn->cap = 0U;
+}
+
+/* Makes descriptor non-blocking and not inheritable by child processes. */
+static void
+make_nonblocking(int fd)
+{
+	(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+/* Checks whether the other end of a connection belongs to the current user.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+peer_is_trusted(int fd)
+{
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__)
+	uid_t uid;
+	gid_t gid;
+	return (getpeereid(fd, &uid, &gid) == 0 && uid == getuid());
+#elif defined(SO_PEERCRED)
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	return (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 &&
+			cred.uid == getuid());
+#else
+	/* Permissions of the directory are all we can rely on. */
+	return 1;
+#endif
+}
+
+/* Creates directory for sockets and the registry if it doesn't exist yet and
+ * makes sure that nobody else can access it.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+prepare_ipc_dir(void)
+{
+	struct stat st;
+	const char *const dir = get_ipc_dir();
+
+	if(mkdir(dir, 0700) != 0 && errno != EEXIST)
+	{
+		LOG_SERROR_MSG(errno, "Failed to create %s", dir);
+		return 1;
+	}
+
+	if(lstat(dir, &st) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to query %s", dir);
+		return 1;
+	}
+
+	if(!S_ISDIR(st.st_mode) || st.st_uid != getuid() ||
+			(st.st_mode & 0077) != 0)
+	{
+		LOG_ERROR_MSG("Not using %s as it's not a private directory", dir);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Opens and locks registry of running instances.  Returns descriptor or -1 on
+ * error. */
+static int
+registry_open(int exclusive)
+{
+	char path[PATH_MAX + 1];
+	struct flock lock = { .l_type = (exclusive ? F_WRLCK : F_RDLCK),
+	                      .l_whence = SEEK_SET };
+	struct stat st;
+	int waited = 0;
+	int fd;
+
+	if(prepare_ipc_dir() != 0)
+	{
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/" REGISTRY_PREFIX "%lu", get_ipc_dir(),
+			(unsigned long)getuid());
+
+	fd = open(path, (exclusive ? O_RDWR | O_CREAT : O_RDONLY) | O_NOFOLLOW,
+			0600);
+	if(fd == -1)
+	{
+		return -1;
+	}
+
+	(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid())
+	{
+		LOG_ERROR_MSG("Not using registry not owned by the user: %s", path);
+		close(fd);
+		return -1;
+	}
+
+	/* Registry is locked only for a short time, so failing to lock it for long
+	 * means that something is wrong and waiting indefinitely would hang. */
+	while(fcntl(fd, F_SETLK, &lock) != 0)
+	{
+		if((errno != EACCES && errno != EAGAIN && errno != EINTR) ||
+				waited >= IO_TIMEOUT)
+		{
+			LOG_SERROR_MSG(errno, "Failed to lock %s", path);
+			close(fd);
+			return -1;
+		}
+
+		usleep(LOCK_RETRY_INTERVAL*1000);
+		waited += LOCK_RETRY_INTERVAL;
+	}
+
+	return fd;
+}
+
+/* Closes registry releasing the lock.  fd can be -1. */
+static void
+registry_close(int fd)
+{
+	if(fd != -1)
+	{
+		close(fd);
+	}
+}
+
+/* Reads contents of the registry.  Returns newly allocated string or NULL on
+ * error. */
+static char *
+registry_read(int fd)
+{
+	char *contents = NULL;
+	size_t len = 0U;
+
+	if(fd == -1 || lseek(fd, 0, SEEK_SET) != 0)
+	{
+		return NULL;
+	}
+
+	while(1)
+	{
+		ssize_t nread;
+		char *const new_contents = realloc(contents, len + 4096U + 1U);
+		if(new_contents == NULL)
+		{
+			free(contents);
+			return NULL;
+		}
+		contents = new_contents;
+
+		nread = read(fd, contents + len, 4096U);
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread < 0)
+		{
+			free(contents);
+			return NULL;
+		}
+		if(nread == 0)
+		{
+			break;
+		}
+		len += nread;
+	}
+
+	contents[len] = '\0';
+	return contents;
+}
+
+/* Checks whether registry contains name of a running instance.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+registry_has(const char registry[], const char name[])
+{
+	const size_t name_len = strlen(name);
+	const char *pos = registry;
+	const char *record;
+	pid_t pid;
+	size_t len;
+
+	while((record = next_record(&pos, &pid, &len)) != NULL)
+	{
+		if(len == name_len && strncmp(record, name, len) == 0 &&
+				process_is_alive(pid))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Rewrites the registry leaving out records of instances that are gone as well
+ * as record for the name and then adds the name if add is non-zero. */
+static void
+registry_update(int fd, const char registry[], const char name[], int add)
+{
+	const size_t name_len = strlen(name);
+	char *new_contents = NULL;
+	size_t new_len = 0U;
+	const char *pos = (registry == NULL ? "" : registry);
+	const char *record;
+	pid_t pid;
+	size_t len;
+	int error = 0;
+
+	if(fd == -1)
+	{
+		return;
+	}
+
+	while((record = next_record(&pos, &pid, &len)) != NULL)
+	{
+		char *line;
+
+		if((len == name_len && strncmp(record, name, len) == 0) ||
+				!process_is_alive(pid))
+		{
+			continue;
+		}
+
+		line = format_str("%ld %.*s\n", (long)pid, (int)len, record);
+		error |= (line == NULL || strappend(&new_contents, &new_len, line) != 0);
+		free(line);
+	}
+
+	if(add)
+	{
+		char *const line = format_str("%ld %s\n", (long)getpid(), name);
+		error |= (line == NULL || strappend(&new_contents, &new_len, line) != 0);
+		free(line);
+	}
+
+	if(!error && ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0)
+	{
+		const char *p = (new_contents == NULL ? "" : new_contents);
+		while(new_len != 0U)
+		{
+			const ssize_t nwritten = write(fd, p, new_len);
+			if(nwritten <= 0)
+			{
+				if(nwritten < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				LOG_SERROR_MSG(errno, "Failed to update registry of instances");
+				break;
+			}
+			p += nwritten;
+			new_len -= nwritten;
+		}
+	}
+
+	free(new_contents);
+}
+
+/* Advances *pos to the next record in the registry.  Returns pointer to name of
+ * the record, which is not null-terminated and is *len characters long, or NULL
+ * at the end. */
+static const char *
+next_record(const char **pos, pid_t *pid, size_t *len)
+{
+	while(**pos != '\0')
+	{
+		char *name;
+		const char *const line = *pos;
+		const char *const end = until_first(line, '\n');
+		const long value = strtol(line, &name, 10);
+
+		*pos = (*end == '\0' ? end : end + 1);
+
+		if(name != line && *name == ' ' && name + 1 < end && value > 0)
+		{
+			*pid = value;
+			*len = end - (name + 1);
+			return name + 1;
+		}
+	}
+	return NULL;
+}
+
+/* Checks whether process is still running.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+process_is_alive(pid_t pid)
+{
+	return (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+#endif
+
+/* Parses pkg, which is modified in place and should outlive *parsed.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+parse_pkg(char pkg[], const char *end, pkg_t *parsed)
+{
+	int in_body = 0;
+
+	parsed->type = NULL;
+	parsed->from = NULL;
+	parsed->id = 0U;
+	parsed->array = NULL;
+	parsed->len = 0;
+
+	while(pkg != end)
+	{
+		if(in_body)
+		{
+			parsed->len = add_to_string_array(&parsed->array, parsed->len, 1, pkg);
+		}
+		else if(starts_with_lit(pkg, "version:"))
+		{
+			if(strcmp(pkg, IPC_VERSION) != 0)
+			{
+				break;
+			}
+		}
+		else if(starts_with_lit(pkg, "from:"))
+		{
+			parsed->from = after_first(pkg, ':');
+		}
+		else if(starts_with_lit(pkg, "id:"))
+		{
+			parsed->id = strtoul(after_first(pkg, ':'), NULL, 10);
+		}
+		else if(starts_with_lit(pkg, "body:"))
+		{
+			parsed->type = after_first(pkg, ':');
+			in_body = 1;
+		}
+		else
+		{
+			break;
+		}
+		pkg += strlen(pkg) + 1;
+	}
+
+	if(pkg != end)
+	{
+		LOG_ERROR_MSG("Discarded remote package due to field: `%s`", pkg);
+	}
+	else if(parsed->from == NULL)
+	{
+		LOG_ERROR_MSG("Discarded remote package due to missing from field");
+	}
+	else if(parsed->type == NULL)
+	{
 		LOG_ERROR_MSG("Discarded remote package due to missing body field");
 	}
-	else if(strcmp(type, ARGS_TYPE) == 0)
+	else
 	{
-		handle_args(ipc, &array, len);
+		return 0;
 	}
-	else if(strcmp(type, EVAL_TYPE) == 0)
+
+	free_string_array(parsed->array, parsed->len);
+	parsed->array = NULL;
+	parsed->len = 0;
+	return 1;
+}
+
+/* Parses pkg into array of strings and invokes callback.  conn specifies where
+ * replies should be sent to and is NULL if they should be sent to the
+ * sender. */
+static void
+handle_pkg(ipc_t *ipc, void *conn, char pkg[], const char *end)
+{
+	pkg_t parsed;
+	if(parse_pkg(pkg, end, &parsed) != 0)
+	{
+		return;
+	}
+
+	if(strcmp(parsed.type, ARGS_TYPE) == 0)
+	{
+		handle_args(ipc, &parsed.array, parsed.len);
+	}
+	else if(strcmp(parsed.type, EVAL_TYPE) == 0)
 	{
-		handle_expr(ipc, from, array, len);
+		handle_expr(ipc, conn, &parsed);
 	}
-	else if(strcmp(type, EVAL_RESULT_TYPE) == 0)
+#ifdef WIN32_PIPE_READ
+	else if(strcmp(parsed.type, EVAL_RESULT_TYPE) == 0)
 	{
-		handle_eval_result(ipc, array, len);
+		if(parsed.len == 1)
+		{
+			ipc->eval_result = parsed.array[0];
+			parsed.array[0] = NULL;
+		}
 	}
-	else if(strcmp(type, EVAL_ERROR_TYPE) == 0)
+	else if(strcmp(parsed.type, EVAL_ERROR_TYPE) == 0)
 	{
 		ipc->eval_result = NULL;
 	}
+#endif
 	else
 	{
-		LOG_ERROR_MSG("Discarded remote package due to unknown type: `%s`", type);
+		LOG_ERROR_MSG("Discarded remote package due to unknown type: `%s`",
+				parsed.type);
+	}
+
+	free_string_array(parsed.array, parsed.len);
+}
+
+/* Handles received message with arguments. */
+static void
+handle_args(ipc_t *ipc, char ***array, int len)
+{
+	if(len == 0U)
+	{
+		return;
+	}
+
+	if(put_into_string_array(array, len, NULL) == len + 1)
+	{
+		ipc->locked = 1;
+		ipc->args_cb(*array);
+		ipc->locked = 0;
+	}
+}
+
+/* Handles received message with expression to evaluate. */
+static void
+handle_expr(ipc_t *ipc, void *conn, const pkg_t *pkg)
+{
+	char *result;
+	char *data[] = { NULL, NULL };
+	const char *type;
+
+	if(pkg->len != 1U)
+	{
+		LOG_ERROR_MSG("Incorrect number of lines in expr packet: %d", pkg->len);
+		return;
+	}
+
+	ipc->locked = 1;
+	result = ipc->eval_cb(pkg->array[0]);
+	ipc->locked = 0;
+
+	data[0] = result;
+	type = (result == NULL ? EVAL_ERROR_TYPE : EVAL_RESULT_TYPE);
+
+#ifndef WIN32_PIPE_READ
+	if(send_reply(ipc, conn, pkg->id, type, data) != 0)
+#else
+	if(format_and_send(ipc, pkg->from, data, type) != 0)
+#endif
+	{
+		LOG_ERROR_MSG("Failed to report evaluation %s",
+				(result == NULL ? "failure" : "result"));
+	}
+
+	free(result);
+}
+
+int
+ipc_send(ipc_t *ipc, const char whom[], char *data[])
+{
+	return format_and_send(ipc, whom, data, ARGS_TYPE);
+}
+
+char *
+ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
+{
+	char *result = NULL;
+	char *exprs[] = { (char *)expr };
+	(void)ipc_eval_many(ipc, whom, exprs, 1, &result);
+	return result;
+}
+
+int
+ipc_eval_many(ipc_t *ipc, const char whom[], char *exprs[], int n,
+		char *results[])
+{
+	int i;
+	int error;
+	char *name = NULL;
+
+	for(i = 0; i < n; ++i)
+	{
+		results[i] = NULL;
+	}
+
+	if(whom == NULL)
+	{
+		name = get_the_only_target(ipc);
+		if(name == NULL)
+		{
+			return 1;
+		}
+		whom = name;
+	}
+
+#ifndef WIN32_PIPE_READ
+	error = eval_many(ipc, whom, exprs, n, results);
+#else
+	error = 0;
+	for(i = 0; i < n; ++i)
+	{
+		results[i] = eval_one(ipc, whom, exprs[i]);
+	}
+#endif
+
+	/* Answer to a request might be an error, which is a failure as well. */
+	for(i = 0; i < n; ++i)
+	{
+		error |= (results[i] == NULL);
+	}
+
+	free(name);
+	return error;
+}
+
+/* Formats and sends a message of specified type.  The data array should be NULL
+ * terminated.  Returns zero on successful send and non-zero otherwise. */
+static int
+format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
+{
+	/* FIXME: this shouldn't have fixed size.  Or maybe it should be PIPE_BUF to
+	 * guarantee atomic operation. */
+	char pkg[8192];
+	size_t len;
+	char *name = NULL;
+	int ret;
+
+	len = format_pkg(ipc, type, 0U, data, pkg, sizeof(pkg));
+	if(len == 0U)
+	{
+		return 1;
+	}
+
+	if(whom == NULL)
+	{
+		name = get_the_only_target(ipc);
+		if(name == NULL)
+		{
+			return 1;
+		}
+		whom = name;
+	}
+
+#ifndef WIN32_PIPE_READ
+	{
+		char *buf = NULL;
+		size_t buf_len = 0U;
+		ret = append_pkg(&buf, &buf_len, pkg, len)
+		   || send_to_peer(ipc, whom, buf, buf_len);
+		free(buf);
 	}
+#else
+	ret = send_pkg(whom, pkg, len);
+#endif
 
-	free_string_array(array, len);
+	free(name);
+	return ret;
 }
 
-/* Handles received message with arguments. */
-static void
-handle_args(ipc_t *ipc, char ***array, int len)
+/* Formats packet of specified type into the pkg buffer.  Zero id means no
+ * identifier.  The data array should be NULL terminated.  Returns length of the
+ * packet or zero on error. */
+static size_t
+format_pkg(ipc_t *ipc, const char type[], unsigned int id, char *data[],
+		char pkg[], size_t size)
 {
-	if(len == 0U)
+	size_t len;
+
+	/* Compose "header". */
+	len = copy_str(pkg, size, IPC_VERSION);
+	len += MIN(snprintf(pkg + len, size - len, "from:%s", ipc_get_name(ipc)) + 1,
+			(int)(size - len));
+	if(id != 0U)
 	{
-		return;
+		len += MIN(snprintf(pkg + len, size - len, "id:%u", id) + 1,
+				(int)(size - len));
 	}
+	len += MIN(snprintf(pkg + len, size - len, "body:%s", type) + 1,
+			(int)(size - len));
 
-	if(put_into_string_array(array, len, NULL) == len + 1)
+	if(strcmp(type, ARGS_TYPE) == 0)
 	{
-		ipc->locked = 1;
-		ipc->args_cb(*array);
-		ipc->locked = 0;
+		if(get_cwd(pkg + len, size - len) == NULL)
+		{
+			LOG_ERROR_MSG("Can't get working directory");
+			return 0U;
+		}
+		len += strlen(pkg + len) + 1;
+	}
+
+	while(*data != NULL)
+	{
+		len += copy_str(pkg + len, size - len, *data);
+		++data;
 	}
+
+	return len;
 }
 
-/* Handles received message with expression to evaluate. */
-static void
-handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
+#ifdef WIN32_PIPE_READ
+
+/* Receives message addressed to this instance.  Returns NULL if there was no
+ * message or on failure to read it, otherwise newly allocated string is
+ * returned. */
+static char *
+receive_pkg(ipc_t *ipc, int *len)
 {
-	char *result;
+	uint32_t size;
+	char *pkg;
+	char *p;
+	DWORD nread;
 
-	if(len != 1U)
+	if(ReadFile(ipc->pipe_file, &size, sizeof(size), &nread, NULL) == FALSE ||
+			size >= 4294967294U)
 	{
-		LOG_ERROR_MSG("Incorrect number of lines in expr packet: %d", len);
-		return;
+		return NULL;
 	}
 
-	ipc->locked = 1;
-	result = ipc->eval_cb(array[0]);
-	ipc->locked = 0;
-	if(result == NULL)
+	pkg = malloc(size + 1U);
+	if(pkg == NULL)
 	{
-		char *data[] = { NULL };
-		if(format_and_send(ipc, from, data, EVAL_ERROR_TYPE) != 0)
-		{
-			LOG_ERROR_MSG("Failed to report evaluation failure");
-		}
+		return NULL;
 	}
-	else
+
+	p = pkg;
+	while(size != 0U)
 	{
-		char *data[] = { result, NULL };
-		if(format_and_send(ipc, from, data, EVAL_RESULT_TYPE) != 0)
+		/* TODO: maybe use OVERLAPPED I/O on Windows instead, it's just so
+		 *       inconvenient... */
+		usleep(10000);
+
+		if(ReadFile(ipc->pipe_file, p, size, &nread, NULL) == FALSE || nread == 0U)
 		{
-			LOG_ERROR_MSG("Failed to report evaluation result");
+			break;
 		}
-		free(result);
+
+		size -= nread;
+		p += nread;
+	}
+
+	/* Weird requirement for named pipes, need to break and set connection every
+	 * time. */
+	DisconnectNamedPipe(ipc->pipe_file);
+	ConnectNamedPipe(ipc->pipe_file, NULL);
+
+	if(size != 0U)
+	{
+		free(pkg);
+		return NULL;
 	}
+
+	/* Make sure we have a trailing zero. */
+	*p = '\0';
+	*len = p - pkg;
+
+	return pkg;
 }
 
-/* Handles answer about successful evaluation of expression. */
-static void
-handle_eval_result(ipc_t *ipc, char *array[], int len)
+/* Tries to open a pipe for communication.  Returns NULL_READ_PIPE on error or
+ * opened file descriptor otherwise. */
+static read_pipe_t
+create_pipe(const char name[], char path_buf[], size_t len)
 {
-	if(len == 1U)
+	unsigned int id = 0U;
+	read_pipe_t rp;
+	int fatal;
+
+	/* Try to use name as is at first. */
+	snprintf(path_buf, len, "%s/" PREFIX "%s", get_ipc_dir(), name);
+	rp = try_use_pipe(path_buf, &fatal);
+	while(rp == NULL_READ_PIPE && !fatal)
 	{
-		ipc->eval_result = array[0];
-		array[0] = NULL;
+		snprintf(path_buf, len, "%s/" PREFIX "%s%u", get_ipc_dir(), name, ++id);
+
+		if(id == 0)
+		{
+			return NULL_READ_PIPE;
+		}
+
+		rp = try_use_pipe(path_buf, &fatal);
 	}
+
+	return rp;
 }
 
-int
-ipc_send(ipc_t *ipc, const char whom[], char *data[])
+/* Creates a pipe.  Returns NULL_READ_PIPE on failure (with *fatal set to
+ * non-zero if further tries don't make any sense) or valid handle otherwise. */
+static read_pipe_t
+try_use_pipe(const char path[], int *fatal)
 {
-	return format_and_send(ipc, whom, data, ARGS_TYPE);
+	*fatal = 0;
+	return CreateNamedPipeA(path,
+			PIPE_ACCESS_INBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE,
+			PIPE_TYPE_BYTE | PIPE_NOWAIT | PIPE_REJECT_REMOTE_CLIENTS,
+			PIPE_UNLIMITED_INSTANCES, 4096, 4096, 10, NULL);
 }
 
-char *
-ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
+/* Evaluates single expression in a remote instance.  Returns newly allocated
+ * result or NULL on error. */
+static char *
+eval_one(ipc_t *ipc, const char whom[], const char expr[])
 {
 	enum { MAX_USEC = 1000000, MAX_REPEATS = 20 };
 	int repeats;
@@ -621,101 +1752,11 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 	return ipc->eval_result;
 }
 
-/* Formats and sends a message of specified type.  The data array should be NULL
- * terminated.  Returns zero on successful send and non-zero otherwise. */
-static int
-format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
-{
-	/* FIXME: this shouldn't have fixed size.  Or maybe it should be PIPE_BUF to
-	 * guarantee atomic operation. */
-	char pkg[8192];
-	size_t len;
-	char *name = NULL;
-	int ret;
-
-	/* Compose "header". */
-	len = copy_str(pkg, sizeof(pkg), IPC_VERSION);
-	len += MIN(snprintf(pkg + len, sizeof(pkg) - len, "from:%s",
-				ipc_get_name(ipc)) + 1,
-			(int)(sizeof(pkg) - len));
-	len += MIN(snprintf(pkg + len, sizeof(pkg) - len, "body:%s", type) + 1,
-			(int)(sizeof(pkg) - len));
-
-	if(strcmp(type, ARGS_TYPE) == 0)
-	{
-		if(get_cwd(pkg + len, sizeof(pkg) - len) == NULL)
-		{
-			LOG_ERROR_MSG("Can't get working directory");
-			return 1;
-		}
-		len += strlen(pkg + len) + 1;
-	}
-
-	while(*data != NULL)
-	{
-		len += copy_str(pkg + len, sizeof(pkg) - len, *data);
-		++data;
-	}
-
-	if(whom == NULL)
-	{
-		name = get_the_only_target(ipc);
-		if(name == NULL)
-		{
-			return 1;
-		}
-		whom = name;
-	}
-
-	ret = send_pkg(whom, pkg, len);
-
-	free(name);
-	return ret;
-}
-
 /* Performs actual sending of package to another instance.  Returns zero on
  * success and non-zero otherwise. */
 static int
 send_pkg(const char whom[], const char what[], size_t len)
 {
-#ifndef WIN32_PIPE_READ
-	char path[PATH_MAX + 1];
-	int fd;
-	FILE *dst;
-	uint32_t size;
-
-	snprintf(path, sizeof(path), "%s/" PREFIX "%s", get_ipc_dir(), whom);
-
-	fd = open(path, O_WRONLY);
-	if(fd == -1)
-	{
-		LOG_SERROR_MSG(errno, "Failed to open destination pipe");
-		return 1;
-	}
-
-	dst = fdopen(fd, "w");
-	if(dst == NULL)
-	{
-		LOG_SERROR_MSG(errno, "Failed to turn file descriptor into a FILE");
-		close(fd);
-		return 1;
-	}
-
-	size = len;
-	if(fwrite(&size, sizeof(size), 1U, dst) != 1U ||
-			fwrite(what, len, 1U, dst) != 1U)
-	{
-		LOG_SERROR_MSG(errno, "Failed to write into a pipe");
-		(void)fclose(dst);
-		return 1;
-	}
-
-	if(fclose(dst) != 0)
-	{
-		LOG_SERROR_MSG(errno, "Failure on close a pipe");
-	}
-	return 0;
-#else
 	char path[PATH_MAX + 1];
 	HANDLE h;
 	uint32_t size;
@@ -741,9 +1782,10 @@ send_pkg(const char whom[], const char what[], size_t len)
 
 	CloseHandle(h);
 	return 0;
-#endif
 }
 
+#endif
+
 /* Automatically picks target instance to send data to.  Returns newly allocated
  * string or NULL on error (no other instances or memory allocation failure). */
 static char *
@@ -777,47 +1819,78 @@ ipc_list(int *len)
 static char **
 list_servers(const ipc_t *ipc, int *len)
 {
-	list_data_t data = { .ipc_dir = get_ipc_dir(), .ipc = ipc };
-
 #ifndef WIN32_PIPE_READ
-	if(enum_dir_content(data.ipc_dir, &add_to_list, &data) != 0)
-	{
-		*len = 0;
-		return NULL;
-	}
-#else
+	char **list = NULL;
+	int nitems = 0;
+	const char *pos;
+	const char *record;
+	pid_t pid;
+	size_t name_len;
+
+	const int registry = registry_open(0);
+	char *const contents = registry_read(registry);
+	registry_close(registry);
+
+	pos = (contents == NULL ? "" : contents);
+	while((record = next_record(&pos, &pid, &name_len)) != NULL)
 	{
-		char find_pat[PATH_MAX + 1];
-		HANDLE hfind;
-		WIN32_FIND_DATAA ffd;
+		char *name;
 
-		snprintf(find_pat, sizeof(find_pat), "%s/*", data.ipc_dir);
-		hfind = FindFirstFileA(find_pat, &ffd);
+		if(!process_is_alive(pid))
+		{
+			continue;
+		}
 
-		if(hfind == INVALID_HANDLE_VALUE)
+		name = format_str("%.*s", (int)name_len, record);
+		/* Skip ourself. */
+		if(name == NULL || (ipc != NULL && strcmp(name, ipc_get_name(ipc)) == 0))
 		{
-			*len = 0;
-			return NULL;
+			free(name);
+			continue;
 		}
 
-		do
+		nitems = put_into_string_array(&list, nitems, name);
+	}
+	free(contents);
+
+	safe_qsort(list, nitems, sizeof(*list), &sorter);
+
+	*len = nitems;
+	return list;
+#else
+	list_data_t data = { .ipc_dir = get_ipc_dir(), .ipc = ipc };
+	char find_pat[PATH_MAX + 1];
+	HANDLE hfind;
+	WIN32_FIND_DATAA ffd;
+
+	snprintf(find_pat, sizeof(find_pat), "%s/*", data.ipc_dir);
+	hfind = FindFirstFileA(find_pat, &ffd);
+
+	if(hfind == INVALID_HANDLE_VALUE)
+	{
+		*len = 0;
+		return NULL;
+	}
+
+	do
+	{
+		if(add_to_list(ffd.cFileName, &ffd, &data) != 0)
 		{
-			if(add_to_list(ffd.cFileName, &ffd, &data) != 0)
-			{
-				break;
-			}
+			break;
 		}
-		while(FindNextFileA(hfind, &ffd));
-		FindClose(hfind);
 	}
-#endif
+	while(FindNextFileA(hfind, &ffd));
+	FindClose(hfind);
 
 	safe_qsort(data.lst, data.len, sizeof(*data.lst), &sorter);
 
 	*len = data.len;
 	return data.lst;
+#endif
 }
 
+#ifdef WIN32_PIPE_READ
+
 /* Analyzes pipe and adds it to the list of pipes.  Returns zero on success or
  * non-zero on error. */
 static int
@@ -839,30 +1912,22 @@ add_to_list(const char name[], const void *data, void *param)
 	}
 
 	/* On Windows it's guaranteed to be a valid pipe. */
-#ifndef WIN32_PIPE_READ
-	{
-		char path[PATH_MAX + 1];
-		struct stat statbuf;
-		snprintf(path, sizeof(path), "%s/%s", list_data->ipc_dir, name);
-		if(stat(path, &statbuf) != 0 || !S_ISFIFO(statbuf.st_mode) ||
-				!pipe_is_in_use(path))
-		{
-			return 0;
-		}
-	}
-#endif
-
 	list_data->len = add_to_string_array(&list_data->lst, list_data->len, 1,
 			name + strlen(PREFIX));
 	return 0;
 }
 
-/* Retrieves directory where FIFO objects are created.  Returns the path. */
+#endif
+
+/* Retrieves directory where IPC objects are created.  Returns the path. */
 static const char *
 get_ipc_dir(void)
 {
 #ifndef WIN32_PIPE_READ
-	return get_tmpdir();
+	static char dir[PATH_MAX + 1];
+	snprintf(dir, sizeof(dir), "%s/" DIR_PREFIX "%lu", get_tmpdir(),
+			(unsigned long)getuid());
+	return dir;
 #else
 	return "//./pipe";
 #endif
@@ -877,28 +1942,6 @@ sorter(const void *first, const void *second)
 	return strcmp(*a, *b);
 }
 
-#ifndef WIN32_PIPE_READ
-
-/* Tries to open a pipe to check whether it has any readers or it's
- * abandoned.  Returns non-zero if somebody is reading from the pipe and zero
- * otherwise. */
-static int
-pipe_is_in_use(const char path[])
-{
-	const int fd = open(path, O_WRONLY | O_NONBLOCK);
-	if(fd != -1 || errno != ENXIO)
-	{
-		if(fd != -1)
-		{
-			close(fd);
-		}
-		return 1;
-	}
-	return 0;
-}
-
-#endif
-
 #else
 
 #include <stddef.h> /* NULL */
@@ -939,6 +1982,12 @@ ipc_check(ipc_t *ipc)
 	return 0;
 }
 
+int
+ipc_get_fds(const ipc_t *ipc, int fds[IPC_MAX_FDS])
+{
+	return -1;
+}
+
 int
 ipc_send(ipc_t *ipc, const char whom[], char *data[])
 {
@@ -951,6 +2000,18 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 	return NULL;
 }
 
+int
+ipc_eval_many(ipc_t *ipc, const char whom[], char *exprs[], int n,
+		char *results[])
+{
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		results[i] = NULL;
+	}
+	return 1;
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
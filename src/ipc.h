@@ -19,6 +19,9 @@
 #ifndef VIFM__IPC_H__
 #define VIFM__IPC_H__
 
+/* Maximum number of descriptors returned by ipc_get_fds(). */
+#define IPC_MAX_FDS 9
+
 /* Opaque handle type for this unit that represents an IPC instance. */
 typedef struct ipc_t ipc_t;
 
@@ -55,15 +58,29 @@ const char * ipc_get_name(const ipc_t *ipc);
  * non-zero if something was received, otherwise zero is returned. */
 int ipc_check(ipc_t *ipc);
 
+/* Retrieves file descriptors any of which becomes readable when there is an
+ * incoming message for ipc_check().  Returns number of descriptors or -1 if
+ * messages can only be checked for periodically. */
+int ipc_get_fds(const ipc_t *ipc, int fds[IPC_MAX_FDS]);
+
 /* Sends data to server.  If whom argument is NULL, target instance is
  * automatically determined.  The data array should end with NULL.  Returns zero
  * on successful send and non-zero otherwise. */
 int ipc_send(ipc_t *ipc, const char whom[], char *data[]);
 
 /* Evaluates expression in a remote instance.  Rules for arguments match those
- * of ipc_send().  Returns result converted to a string or NULL on error. */
+ * of ipc_send().  Returns newly allocated result converted to a string or NULL
+ * on error. */
 char * ipc_eval(ipc_t *ipc, const char whom[], const char expr[]);
 
+/* Evaluates n expressions in a remote instance sending all of them at once.
+ * Rules for arguments match those of ipc_send().  Each element of results is
+ * set to newly allocated result of corresponding expression or NULL on error.
+ * Returns zero if all expressions were evaluated, otherwise non-zero is
+ * returned. */
+int ipc_eval_many(ipc_t *ipc, const char whom[], char *exprs[], int n,
+		char *results[]);
+
 #endif /* VIFM__IPC_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,139 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "perf_menu.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strdup() strlen() */
+
+#include "../ui/ui.h"
+#include "../utils/macros.h"
+#include "../utils/perf.h"
+#include "../utils/string_array.h"
+#include "menus.h"
+
+static void format_item(PerfKind kind, char buf[], size_t buf_len);
+static void format_duration(uint64_t ns, char buf[], size_t buf_len);
+static void format_histogram(const perf_stats_t *stats, char buf[]);
+
+int
+show_perf_menu(view_t *view)
+{
+	static menu_data_t m;
+	int i;
+
+	menus_init_data(&m, view, strdup(perf_enabled()
+			? "Kind --- Count/Total/Avg/Max/Histogram (recording)"
+			: "Kind --- Count/Total/Avg/Max/Histogram (not recording)"), NULL);
+
+	for(i = 0; i < PK_COUNT; ++i)
+	{
+		char item[256];
+		format_item(i, item, sizeof(item));
+		m.len = add_to_string_array(&m.items, m.len, 1, item);
+	}
+
+	return menus_enter(m.state, view);
+}
+
+/* Formats line of the menu for the kind of events. */
+static void
+format_item(PerfKind kind, char buf[], size_t buf_len)
+{
+	perf_stats_t stats;
+	char total[16], avg[16], max[16];
+	char histogram[PERF_BUCKETS + 1];
+	size_t len;
+
+	perf_get_stats(kind, &stats);
+
+	format_duration(stats.total, total, sizeof(total));
+	format_duration(stats.count == 0U ? 0U : stats.total/stats.count, avg,
+			sizeof(avg));
+	format_duration(stats.max, max, sizeof(max));
+	format_histogram(&stats, histogram);
+
+	snprintf(buf, buf_len, "%-10s  %8llu  %9s  %9s  %9s  [%s]",
+			perf_kind_name(kind), (unsigned long long)stats.count, total, avg, max,
+			histogram);
+
+	/* Transfer rate makes sense only for kinds that have amounts. */
+	len = strlen(buf);
+	if(stats.amount != 0U && stats.total != 0U && len < buf_len)
+	{
+		snprintf(buf + len, buf_len - len, "  %.1f MiB/s",
+				(stats.amount/(1024.0*1024.0))/(stats.total/1e9));
+	}
+}
+
+/* Formats duration in human-friendly units. */
+static void
+format_duration(uint64_t ns, char buf[], size_t buf_len)
+{
+	if(ns < 1000U)
+	{
+		snprintf(buf, buf_len, "%dns", (int)ns);
+	}
+	else if(ns < 1000U*1000U)
+	{
+		snprintf(buf, buf_len, "%.1fus", ns/1e3);
+	}
+	else if(ns < 1000U*1000U*1000U)
+	{
+		snprintf(buf, buf_len, "%.1fms", ns/1e6);
+	}
+	else
+	{
+		snprintf(buf, buf_len, "%.2fs", ns/1e9);
+	}
+}
+
+/* Draws histogram of durations with one character per bucket, where the
+ * character represents size of the bucket relative to the largest one.  buf
+ * must be at least PERF_BUCKETS + 1 characters long. */
+static void
+format_histogram(const perf_stats_t *stats, char buf[])
+{
+	static const char levels[] = " .:-=+*#%@";
+
+	int i;
+	uint64_t largest = 0U;
+
+	for(i = 0; i < PERF_BUCKETS; ++i)
+	{
+		largest = MAX(largest, stats->buckets[i]);
+	}
+
+	for(i = 0; i < PERF_BUCKETS; ++i)
+	{
+		const uint64_t n = stats->buckets[i];
+		int level = 0;
+		if(n != 0U)
+		{
+			/* Non-empty buckets are always visible. */
+			level = 1 + (int)((n*(sizeof(levels) - 3U))/largest);
+		}
+		buf[i] = levels[level];
+	}
+	buf[PERF_BUCKETS] = '\0';
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -141,6 +141,12 @@ modes_periodic(void)
 	view_check_for_updates();
 }
 
+int
+modes_need_periodic(void)
+{
+	return view_needs_updates_check();
+}
+
 void
 modes_post(void)
 {
@@ -45,6 +45,10 @@ void modes_pre(void);
 /* Executes poll-based requests for any of the active modes. */
 void modes_periodic(void);
 
+/* Checks whether modes_periodic() needs to be called periodically for some of
+ * the active modes.  Returns non-zero if so, otherwise zero is returned. */
+int modes_need_periodic(void);
+
 void modes_post(void);
 
 void modes_redraw(void);
@@ -643,6 +643,7 @@ draw(void)
 		if(vi->kind == VK_PASS_THROUGH)
 		{
 			strlist_t list = { .nitems = vi->nlines, .items = vi->lines };
+			fview_damage(vi->view);
 			ui_pass_through(&list, vi->view->win, ui_qv_left(vi->view),
 					ui_qv_top(vi->view));
 			return;
@@ -1622,6 +1623,15 @@ view_check_for_updates(void)
 	}
 }
 
+int
+view_needs_updates_check(void)
+{
+	return (curr_stats.preview.explore != NULL &&
+			curr_stats.preview.explore->auto_forward)
+	    || (lwin.vi != NULL && lwin.vi->auto_forward)
+	    || (rwin.vi != NULL && rwin.vi->auto_forward);
+}
+
 /* Forwards the view if underlying file changed.  Returns non-zero if reload
  * occurred, otherwise zero is returned. */
 static int
@@ -66,6 +66,10 @@ void view_panes_swapped(void);
 /* Checks whether contents of either view should be updated. */
 void view_check_for_updates(void);
 
+/* Checks whether view_check_for_updates() has anything to check.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int view_needs_updates_check(void);
+
 /* Detached views.  These are the views which were either created in detached
  * state or were detached from, but their state (position, etc.) is still
  * maintained. */
@@ -109,6 +109,7 @@ static void add_options(void);
 static void load_sort_option_inner(view_t *view, signed char sort_keys[]);
 static void aproposprg_handler(OPT_OP op, optval_t val);
 static void autochpos_handler(OPT_OP op, optval_t val);
+static void bgthreads_handler(OPT_OP op, optval_t val);
 static void caseoptions_handler(OPT_OP op, optval_t val);
 static void cdpath_handler(OPT_OP op, optval_t val);
 static void chaselinks_handler(OPT_OP op, optval_t val);
@@ -147,6 +148,9 @@ static void locateprg_handler(OPT_OP op, optval_t val);
 static void mediaprg_handler(OPT_OP op, optval_t val);
 #endif
 static void mintimeoutlen_handler(OPT_OP op, optval_t val);
+#ifndef _WIN32
+static void pollslowfs_handler(OPT_OP op, optval_t val);
+#endif
 static void scroll_line_down(view_t *view);
 static void quickview_handler(OPT_OP op, optval_t val);
 static void rulerformat_handler(OPT_OP op, optval_t val);
@@ -566,6 +570,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &autochpos_handler, NULL,
 	  { .ref.bool_val = &cfg.auto_ch_pos },
 	},
+	{ "bgthreads", "", "max number of background task threads",
+	  OPT_INT, 0, NULL, &bgthreads_handler, NULL,
+	  { .ref.int_val = &cfg.bg_threads },
+	},
 	{ "caseoptions", "", "case sensitivity overrides",
 	  OPT_CHARSET, ARRAY_LEN(caseoptions_vals), caseoptions_vals,
 		&caseoptions_handler, NULL,
@@ -694,6 +702,12 @@ options[] = {
 	  OPT_INT, 0, NULL, &mintimeoutlen_handler, NULL,
 	  { .ref.int_val = &cfg.min_timeout_len },
 	},
+#ifndef _WIN32
+	{ "pollslowfs", "", "detect changes on slow file systems",
+	  OPT_BOOL, 0, NULL, &pollslowfs_handler, NULL,
+	  { .ref.bool_val = &cfg.poll_slow_fs },
+	},
+#endif
 	{ "quickview", "", "whether quick view is active",
 	  OPT_BOOL, 0, NULL, &quickview_handler, NULL,
 	  { .init = &init_quickview },
@@ -1587,6 +1601,22 @@ autochpos_handler(OPT_OP op, optval_t val)
 	}
 }
 
+/* Limits number of threads that run background tasks. */
+static void
+bgthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = cfg.bg_threads;
+		vle_opts_assign("bgthreads", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.bg_threads = val.int_val;
+}
+
 /* Handles changes of 'caseoptions' option.  Updates configuration and
  * normalizes option value. */
 static void
@@ -2086,6 +2116,7 @@ static void
 iec_handler(OPT_OP op, optval_t val)
 {
 	cfg.sizefmt.ieci_prefixes = val.bool_val;
+	fview_formats_updated();
 
 	redraw_lists();
 }
@@ -2194,6 +2225,15 @@ mintimeoutlen_handler(OPT_OP op, optval_t val)
 	cfg.min_timeout_len = val.int_val;
 }
 
+#ifndef _WIN32
+/* Handles changes of 'pollslowfs'.  Takes effect on the next reload. */
+static void
+pollslowfs_handler(OPT_OP op, optval_t val)
+{
+	cfg.poll_slow_fs = val.bool_val;
+}
+#endif
+
 static void
 scroll_line_down(view_t *view)
 {
@@ -2365,6 +2405,7 @@ sizefmt_handler(OPT_OP op, optval_t val)
 		cfg.sizefmt.base = base;
 		cfg.sizefmt.precision = precision;
 		cfg.sizefmt.space = space;
+		fview_formats_updated();
 
 		stats_redraw_later();
 	}
@@ -3262,6 +3303,7 @@ static void
 timefmt_handler(OPT_OP op, optval_t val)
 {
 	replace_string(&cfg.time_format, val.str_val);
+	fview_formats_updated();
 	redraw_lists();
 }
 
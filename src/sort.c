@@ -23,8 +23,9 @@
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* abs() free() */
+#include <string.h> /* memcpy() strcmp() strdup() strlen() strrchr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
@@ -40,9 +41,20 @@
 #include "utils/utils.h"
 #include "filelist.h"
 #include "filtering.h"
+#include "flist_pos.h"
 #include "status.h"
 #include "types.h"
 
+/* Name of an entry prepared for comparison. */
+typedef struct
+{
+	char *name;        /* Name or short path in a custom view. */
+	char *folded;      /* Lower case version of the name or NULL. */
+	size_t folded_len; /* Length of folded or of name if folded is NULL. */
+	int owns_name;     /* Whether name field should be freed. */
+}
+sort_name_t;
+
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		size_t nchildren, int root);
 static void sort_sequence(dir_entry_t *entries, size_t nentries);
@@ -50,8 +62,14 @@ static void sort_by_groups(dir_entry_t *entries, signed char key,
 		size_t nentries);
 static void sort_by_key(dir_entry_t *entries, size_t nentries, signed char key,
 		void *data);
+static sort_name_t * prepare_names(const dir_entry_t *entries,
+		size_t nentries, int ignore_case);
+static void free_names(sort_name_t *names, size_t nentries);
 static int sort_dir_list(const void *one, const void *two);
 TSTATIC int strnumcmp(const char s[], const char t[]);
+TSTATIC int strnumcmp_len(const char s[], size_t s_len, const char t[],
+		size_t t_len);
+static size_t common_prefix_len(const char s[], const char t[], size_t max);
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int vercmp(const char s[], const char t[]);
 #else
@@ -59,6 +77,7 @@ static char * skip_leading_zeros(const char str[]);
 #endif
 static int compare_entry_names(const dir_entry_t *a, const dir_entry_t *b,
 		int ignore_case);
+static int compare_prepared_names(const sort_name_t *s, const sort_name_t *t);
 static int compare_full_file_names(const char s[], const char t[],
 		int ignore_case);
 static int compare_file_names(const char s[], const char t[], int ignore_case);
@@ -82,6 +101,8 @@ static int sort_descending;
 static SortingKey sort_type;
 /* Sorting key specific data. */
 static void *sort_data;
+/* Names of entries indexed by their tags for sorting by name or NULL. */
+static const sort_name_t *sort_names;
 
 void
 sort_view(view_t *v)
@@ -99,6 +120,9 @@ sort_view(view_t *v)
 	view_sort_groups = v->sort_groups;
 	custom_view = flist_custom_active(v);
 
+	/* Positions of entries are about to change. */
+	fpos_index_reordered(v);
+
 	if(!custom_view || !cv_tree(v->custom.type))
 	{
 		/* Tree sorting works fine for flat list, but requires a bit more
@@ -268,7 +292,97 @@ sort_by_key(dir_entry_t *entries, size_t nentries, signed char key, void *data)
 		entries[i].tag = i;
 	}
 
+	/* Names are compared many times, do the costly part of it once per entry.
+	 * On failure the slower way is used. */
+	sort_name_t *names = NULL;
+	if(sort_type == SK_BY_NAME || sort_type == SK_BY_INAME)
+	{
+		names = prepare_names(entries, nentries, sort_type == SK_BY_INAME);
+	}
+
+	sort_names = names;
 	safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+	sort_names = NULL;
+
+	free_names(names, nentries);
+}
+
+/* Prepares names of entries for comparison in the order of their tags, which
+ * must match their indexes.  Returns newly allocated array or NULL on error. */
+static sort_name_t *
+prepare_names(const dir_entry_t *entries, size_t nentries, int ignore_case)
+{
+	size_t i;
+	sort_name_t *const names = calloc(nentries, sizeof(*names));
+	if(names == NULL)
+	{
+		return NULL;
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		sort_name_t *const name = &names[i];
+
+		if(custom_view)
+		{
+			char short_path[PATH_MAX + 1];
+			get_short_path_of(view, &entries[i], NF_NONE, 0, sizeof(short_path),
+					short_path);
+			name->name = strdup(short_path);
+			name->owns_name = 1;
+		}
+		else
+		{
+			name->name = entries[i].name;
+		}
+
+		if(name->name == NULL)
+		{
+			free_names(names, nentries);
+			return NULL;
+		}
+
+		if(ignore_case)
+		{
+			/* Ignore too small buffer errors by not caring about part that didn't
+			 * fit. */
+			char folded[NAME_MAX + 1];
+			(void)str_to_lower(name->name, folded, sizeof(folded));
+			name->folded = strdup(folded);
+			if(name->folded == NULL)
+			{
+				free_names(names, nentries);
+				return NULL;
+			}
+		}
+
+		name->folded_len = strlen(name->folded == NULL ? name->name
+		                                                : name->folded);
+	}
+
+	return names;
+}
+
+/* Frees array of names prepared for comparison.  The array can be NULL. */
+static void
+free_names(sort_name_t *names, size_t nentries)
+{
+	size_t i;
+
+	if(names == NULL)
+	{
+		return;
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		if(names[i].owns_name)
+		{
+			free(names[i].name);
+		}
+		free(names[i].folded);
+	}
+	free(names);
 }
 
 /* Compares file names containing numbers correctly. */
@@ -284,6 +398,62 @@ strnumcmp(const char s[], const char t[])
 #endif
 }
 
+/* Same as strnumcmp(), but skips common prefix of the strings several bytes at
+ * a time.  Returns positive value if s is greater than t, zero if they are
+ * equal, otherwise negative value is returned. */
+TSTATIC int
+strnumcmp_len(const char s[], size_t s_len, const char t[], size_t t_len)
+{
+	/* Numbers are compared as a whole, hence comparison is resumed at the start
+	 * of a number (if common prefix ends in one).  State of comparison doesn't
+	 * depend on characters that precede non-digit character, so result is the
+	 * same as if strings were compared from the start.  This also holds for
+	 * leading zeros, because they must be the same in both strings. */
+	size_t prefix_len = common_prefix_len(s, t, MIN(s_len, t_len));
+	while(prefix_len != 0U && isdigit((unsigned char)s[prefix_len - 1U]))
+	{
+		--prefix_len;
+	}
+
+	if(prefix_len == 0U)
+	{
+		return strnumcmp(s, t);
+	}
+
+#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
+	return vercmp(s + prefix_len, t + prefix_len);
+#else
+	return strverscmp(s + prefix_len, t + prefix_len);
+#endif
+}
+
+/* Finds length of common prefix of two strings, which are at least max bytes
+ * long.  Returns the length. */
+static size_t
+common_prefix_len(const char s[], const char t[], size_t max)
+{
+	size_t len = 0U;
+
+	while(max - len >= sizeof(size_t))
+	{
+		size_t s_word, t_word;
+		memcpy(&s_word, &s[len], sizeof(s_word));
+		memcpy(&t_word, &t[len], sizeof(t_word));
+		if(s_word != t_word)
+		{
+			break;
+		}
+		len += sizeof(s_word);
+	}
+
+	while(len < max && s[len] == t[len])
+	{
+		++len;
+	}
+
+	return len;
+}
+
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int
 vercmp(const char s[], const char t[])
@@ -360,7 +530,12 @@ sort_dir_list(const void *one, const void *two)
 
 		case SK_BY_NAME:
 		case SK_BY_INAME:
-			if(custom_view)
+			if(sort_names != NULL)
+			{
+				retval = compare_prepared_names(&sort_names[first->tag],
+						&sort_names[second->tag]);
+			}
+			else if(custom_view)
 			{
 				retval = compare_entry_names(first, second, sort_type == SK_BY_INAME);
 			}
@@ -579,6 +754,37 @@ compare_entry_names(const dir_entry_t *a, const dir_entry_t *b, int ignore_case)
 	return compare_full_file_names(a_short_path, b_short_path, ignore_case);
 }
 
+/* Does the same as compare_full_file_names() for names prepared for
+ * comparison.  Returns positive value if s is greater than t, zero if they are
+ * equal, otherwise negative value is returned. */
+static int
+compare_prepared_names(const sort_name_t *s, const sort_name_t *t)
+{
+	const char *const s_val = (s->folded == NULL) ? s->name : s->folded;
+	const char *const t_val = (t->folded == NULL) ? t->name : t->folded;
+	int result;
+
+	if(s->name[0] == '.' && t->name[0] != '.')
+	{
+		return -1;
+	}
+	if(s->name[0] != '.' && t->name[0] == '.')
+	{
+		return 1;
+	}
+
+	result = cfg.sort_numbers
+	       ? strnumcmp_len(s_val, s->folded_len, t_val, t->folded_len)
+	       : strcmp(s_val, t_val);
+	if(result == 0 && s->folded != NULL)
+	{
+		/* Resort to comparing original names when their normalized versions match
+		 * to always solve ties in deterministic way. */
+		result = strcmp(s->name, t->name);
+	}
+	return result;
+}
+
 /* Compares two full filenames and assumes that dot character is smaller than
  * any other character.  Returns positive value if s is greater than t, zero if
  * they are equal, otherwise negative value is returned. */
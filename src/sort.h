@@ -35,6 +35,8 @@ SortingKey get_secondary_key(SortingKey primary_key);
 
 TSTATIC_DEFS(
 	int strnumcmp(const char s[], const char t[]);
+	int strnumcmp_len(const char s[], size_t s_len, const char t[],
+			size_t t_len);
 )
 
 #endif /* VIFM__SORT_H__ */
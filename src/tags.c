@@ -35,6 +35,7 @@ const char *tags[] = {
 	"vifm-'",
 	"vifm-'aproposprg'",
 	"vifm-'autochpos'",
+	"vifm-'bgthreads'",
 	"vifm-'caseoptions'",
 	"vifm-'cd'",
 	"vifm-'cdpath'",
@@ -85,6 +86,7 @@ const char *tags[] = {
 	"vifm-'number'",
 	"vifm-'numberwidth'",
 	"vifm-'nuw'",
+	"vifm-'pollslowfs'",
 	"vifm-'previewprg'",
 	"vifm-'quickview'",
 	"vifm-'relativenumber'",
@@ -303,6 +305,7 @@ const char *tags[] = {
 	"vifm-:nunmap",
 	"vifm-:on",
 	"vifm-:only",
+	"vifm-:perf",
 	"vifm-:popd",
 	"vifm-:pu",
 	"vifm-:pushd",
@@ -808,6 +811,7 @@ const char *tags[] = {
 	"vifm-zo",
 	"vifm-zr",
 	"vifm-zt",
+	"vifm-zx",
 	"vifm-zz",
 	"vifm-{",
 	"vifm-}",
@@ -39,6 +39,7 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
+#include "utils/trie.h"
 #include "utils/utils.h"
 #include "background.h"
 #include "ops.h"
@@ -102,6 +103,9 @@ static int is_trash_valid(const char trash_dir[], int allow_empty);
 static void add_trash_to_list(trashes_list *list, const char path[],
 		int can_delete);
 static void remove_from_trash(const char trash_name[]);
+static trie_t * get_paths_index(void);
+static int index_path(trie_t *trie, const char path[]);
+static void drop_paths_index(void);
 static void free_entry(const trash_entry_t *entry);
 static int pick_trash_dir_traverser(const char base_path[],
 		const char trash_dir[], int user_specific, void *arg);
@@ -123,6 +127,10 @@ static char * format_root_spec(const char spec[], const char mount_point[]);
 static char **specs;
 static int nspecs;
 
+/* Set of original paths of trash_list entries for fast lookups.  Built on first
+ * use and dropped when entries are removed. */
+static trie_t *paths_index;
+
 int
 set_trash_dir(const char new_specs[])
 {
@@ -301,8 +309,8 @@ empty_trash_dir(const char trash_dir[], int can_delete)
 	/* Yes, this isn't pretty.  It's a simple way to bundle string and bool. */
 	char *trash_dir_copy = format_str("%c%s", can_delete ? '1' : '0', trash_dir);
 
-	if(bg_execute(task_desc, op_desc, BG_UNDEFINED_TOTAL, 1, &empty_trash_in_bg,
-			trash_dir_copy) != 0)
+	if(bg_execute(task_desc, op_desc, BG_UNDEFINED_TOTAL, 1, trash_dir,
+				&empty_trash_in_bg, trash_dir_copy) != 0)
 	{
 		free(trash_dir_copy);
 	}
@@ -352,6 +360,8 @@ remove_trash_entries(const char trash_dir[])
 		free(trash_list);
 		trash_list = NULL;
 	}
+
+	drop_paths_index();
 }
 
 void
@@ -395,6 +405,11 @@ add_to_trash(const char path[], const char trash_name[])
 	}
 
 	nentries++;
+
+	if(paths_index != NULL && index_path(paths_index, path) != 0)
+	{
+		drop_paths_index();
+	}
 	return 0;
 }
 
@@ -402,6 +417,18 @@ int
 trash_includes(const char original_path[])
 {
 	int i;
+	char *key;
+	void *data;
+	int found;
+
+	trie_t *const trie = get_paths_index();
+	if(trie != NULL && (key = stroskey(original_path)) != NULL)
+	{
+		found = (trie_get(trie, key, &data) == 0);
+		free(key);
+		return found;
+	}
+
 	for(i = 0; i < nentries; ++i)
 	{
 		/* Assuming canonicalized paths for this unit. */
@@ -413,6 +440,55 @@ trash_includes(const char original_path[])
 	return 0;
 }
 
+/* Retrieves index of original paths building it if necessary.  Returns the
+ * index or NULL on error. */
+static trie_t *
+get_paths_index(void)
+{
+	int i;
+
+	if(paths_index != NULL)
+	{
+		return paths_index;
+	}
+
+	paths_index = trie_create();
+	for(i = 0; i < nentries && paths_index != NULL; ++i)
+	{
+		if(index_path(paths_index, trash_list[i].path) != 0)
+		{
+			drop_paths_index();
+		}
+	}
+	return paths_index;
+}
+
+/* Adds path to the index.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+index_path(trie_t *trie, const char path[])
+{
+	int error;
+
+	char *const key = stroskey(path);
+	if(key == NULL)
+	{
+		return 1;
+	}
+
+	error = (trie_put(trie, key) < 0);
+	free(key);
+	return error;
+}
+
+/* Frees index of original paths, so that it's rebuilt on next use. */
+static void
+drop_paths_index(void)
+{
+	trie_free(paths_index);
+	paths_index = NULL;
+}
+
 char **
 list_trashes(int *ntrashes)
 {
@@ -569,6 +645,7 @@ remove_from_trash(const char trash_name[])
 			sizeof(*trash_list)*((nentries - 1) - i));
 
 	--nentries;
+	drop_paths_index();
 }
 
 /* Frees memory allocated by given trash entry. */
@@ -919,6 +996,7 @@ trash_prune_dead_entries(void)
 		trash_list[j++] = trash_list[i];
 	}
 	nentries = j;
+	drop_paths_index();
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -30,13 +30,17 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* UINT64_C uint64_t */
 #include <stdlib.h> /* abs() */
-#include <string.h> /* memset() strcpy() strlen() */
+#include <string.h> /* memmove() memset() strcpy() strlen() */
+#include <time.h> /* localtime() strftime() time_t */
 
 #include "../cfg/config.h"
+#include "../compat/reallocarray.h"
 #include "../utils/fs.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
+#include "../utils/perf.h"
 #include "../utils/regexp.h"
 #include "../utils/str.h"
 #include "../utils/test_helpers.h"
@@ -47,15 +51,57 @@
 #include "../flist_pos.h"
 #include "../opt_handlers.h"
 #include "../sort.h"
+#include "../status.h"
 #include "color_manager.h"
 #include "color_scheme.h"
 #include "column_view.h"
+#include "listing_cache.h"
 #include "quickview.h"
 #include "statusline.h"
 
 /* Mark for a cursor position of inactive pane. */
 #define INACTIVE_CURSOR_MARK "*"
 
+/* Signature of a cell which is known to be empty. */
+#define BLANK_CELL ((uint64_t)1)
+
+/* Number of bits in index of caches of formatted values. */
+#define FORMAT_CACHE_BITS 8
+
+/* Number of slots in caches of formatted values. */
+#define FORMAT_CACHE_SIZE (1 << FORMAT_CACHE_BITS)
+
+/* How many directories above and below the cursor are listed ahead of time for
+ * the right column of miller view. */
+#define PREFETCH_DISTANCE 2
+
+/* Element of cache of formatted values.  Formatting is done per cell on every
+ * redraw, but values of adjacent files tend to repeat (e.g., times of files
+ * unpacked from an archive) and formatting times involves time zone handling,
+ * so results are cached by the value that is being formatted. */
+typedef struct
+{
+	uint64_t key; /* Formatted value. */
+	int valid;    /* Whether this slot is in use. */
+	char str[64]; /* Result of formatting. */
+}
+format_cache_t;
+
+/* Description of what is displayed in cells of a window, which allows redrawing
+ * only cells that have changed.  Signatures are hashes of everything that
+ * affects drawing of a cell, zero signature means that contents of a cell is
+ * unknown.  This is per window and not per view, because views are moved around
+ * (e.g., on switching tabs) while windows stay where they are. */
+typedef struct
+{
+	WINDOW *win;     /* Window that is described or NULL for unused slot. */
+	uint64_t layout; /* Signature of layout of cells or zero if invalid. */
+	int top;         /* Top line of the list at the moment of drawing. */
+	uint64_t *cells; /* Signatures of cells. */
+	int ncells;      /* Number of elements in cells. */
+}
+draw_cache_t;
+
 /* Packet set of parameters to pass as user data for processing columns. */
 typedef struct
 {
@@ -78,12 +124,29 @@ typedef struct
 }
 column_data_t;
 
+static draw_cache_t * get_draw_cache(const view_t *view, int create);
+static format_cache_t * get_format_slot(format_cache_t cache[], uint64_t key);
+static void reset_draw_cache(draw_cache_t *cache, uint64_t layout,
+		int ncells);
+static void scroll_draw_cache(view_t *view, draw_cache_t *cache);
+static uint64_t get_layout_signature(const view_t *view, size_t col_width,
+		int visible_cells);
+TSTATIC uint64_t get_cell_signature(const column_data_t *cdt, int cell);
+TSTATIC uint64_t get_entry_signature(const dir_entry_t *entry);
+static uint64_t hash_data(uint64_t hash, const void *data, size_t len);
+static uint64_t hash_str(uint64_t hash, const char str[]);
+static int draw_list_cell(column_data_t *cdt, int cell, size_t col_width,
+		draw_cache_t *cache);
+static void clear_list_cell(view_t *view, int cell, size_t col_width,
+		draw_cache_t *cache);
 static void draw_left_column(view_t *view);
 static void draw_right_column(view_t *view);
+static void prefetch_right_column(view_t *view);
 static void print_column(view_t *view, entries_t entries, const char current[],
 		const char path[], int width, int offset, int number_width);
 static void fill_column(view_t *view, int start_line, int top, int width,
 		int offset);
+static void fill_line(view_t *view, int line, int width, int offset);
 static void calculate_table_conf(view_t *view, size_t *count, size_t *width);
 static int calculate_number_width(const view_t *view, int list_length,
 		int width);
@@ -118,6 +181,7 @@ static void mix_in_file_name_hi(const view_t *view, dir_entry_t *entry,
 		col_attr_t *col);
 TSTATIC void format_name(int id, const void *data, size_t buf_len, char buf[]);
 static void format_size(int id, const void *data, size_t buf_len, char buf[]);
+TSTATIC void format_size_value(uint64_t size, size_t buf_len, char buf[]);
 static void format_nitems(int id, const void *data, size_t buf_len, char buf[]);
 static void format_primary_group(int id, const void *data, size_t buf_len,
 		char buf[]);
@@ -127,6 +191,7 @@ static void format_ext(int id, const void *data, size_t buf_len, char buf[]);
 static void format_fileext(int id, const void *data, size_t buf_len,
 		char buf[]);
 static void format_time(int id, const void *data, size_t buf_len, char buf[]);
+TSTATIC void format_time_value(time_t t, size_t buf_len, char buf[]);
 static void format_dir(int id, const void *data, size_t buf_len, char buf[]);
 #ifndef _WIN32
 static void format_group(int id, const void *data, size_t buf_len, char buf[]);
@@ -148,6 +213,13 @@ static void position_hardware_cursor(view_t *view);
 static int move_curr_line(view_t *view);
 static void reset_view_columns(view_t *view);
 
+/* Information about contents of windows of the views. */
+static draw_cache_t draw_caches[2];
+
+/* Caches of formatted times and sizes. */
+static format_cache_t time_cache[FORMAT_CACHE_SIZE];
+static format_cache_t size_cache[FORMAT_CACHE_SIZE];
+
 void
 fview_setup(void)
 {
@@ -254,6 +326,18 @@ fview_reset_cs(view_t *view)
 	{
 		view->dir_entry[i].hi_num = -1;
 	}
+
+	fview_damage(view);
+}
+
+void
+fview_damage(view_t *view)
+{
+	draw_cache_t *const cache = get_draw_cache(view, 0);
+	if(cache != NULL)
+	{
+		cache->layout = 0U;
+	}
 }
 
 void
@@ -273,12 +357,18 @@ draw_dir_list_only(view_t *view)
 	int x, cell;
 	size_t col_width, col_count;
 	int visible_cells;
+	int ndrawn = 0;
+	draw_cache_t *cache;
+	uint64_t layout;
+	uint64_t start;
 
 	if(curr_stats.load_stage < 2)
 	{
 		return;
 	}
 
+	start = perf_begin();
+
 	calculate_table_conf(view, &col_count, &col_width);
 
 	ui_view_title_update(view);
@@ -292,10 +382,6 @@ draw_dir_list_only(view_t *view)
 
 	view->top_line = calculate_top_position(view, view->top_line);
 
-	ui_view_erase(view);
-
-	draw_left_column(view);
-
 	visible_cells = view->window_cells;
 	if(fview_is_transposed(view) &&
 			view->column_count*(int)col_width < ui_view_available_width(view))
@@ -304,6 +390,29 @@ draw_dir_list_only(view_t *view)
 		visible_cells += view->window_rows;
 	}
 
+	/* Draw only cells that have changed if layout of the window is the same,
+	 * otherwise start from scratch. */
+	cache = get_draw_cache(view, 1);
+	layout = get_layout_signature(view, col_width, visible_cells);
+	if(cache != NULL && cache->layout == layout)
+	{
+		scroll_draw_cache(view, cache);
+	}
+	else
+	{
+		ui_view_erase(view);
+		if(cache != NULL)
+		{
+			reset_draw_cache(cache, layout, visible_cells);
+		}
+	}
+	if(cache != NULL)
+	{
+		cache->top = view->top_line;
+	}
+
+	draw_left_column(view);
+
 	for(x = view->top_line, cell = 0;
 			x < view->list_rows && cell < visible_cells;
 			++x, ++cell)
@@ -315,7 +424,13 @@ draw_dir_list_only(view_t *view)
 			.current_pos = view->list_pos,
 		};
 
-		compute_and_draw_cell(&cdt, cell, col_width);
+		ndrawn += draw_list_cell(&cdt, cell, col_width, cache);
+	}
+
+	/* Clear cells that were occupied by entries which aren't there anymore. */
+	for(; cell < visible_cells; ++cell)
+	{
+		clear_list_cell(view, cell, col_width, cache);
 	}
 
 	draw_right_column(view);
@@ -331,6 +446,306 @@ draw_dir_list_only(view_t *view)
 	ui_view_win_changed(view);
 
 	ui_view_redrawn(view);
+
+	perf_end(PK_DRAW_LIST, start, ndrawn);
+}
+
+/* Looks up information about contents of window of the view.  Returns pointer
+ * to it or NULL if there is no such information and create is zero or there is
+ * no free slot. */
+static draw_cache_t *
+get_draw_cache(const view_t *view, int create)
+{
+	size_t i;
+
+	if(view->win == NULL)
+	{
+		return NULL;
+	}
+
+	for(i = 0U; i < ARRAY_LEN(draw_caches); ++i)
+	{
+		if(draw_caches[i].win == view->win)
+		{
+			return &draw_caches[i];
+		}
+	}
+
+	if(!create)
+	{
+		return NULL;
+	}
+
+	for(i = 0U; i < ARRAY_LEN(draw_caches); ++i)
+	{
+		if(draw_caches[i].win == NULL)
+		{
+			draw_caches[i].win = view->win;
+			return &draw_caches[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Resets information about cells of a window that has just been erased. */
+static void
+reset_draw_cache(draw_cache_t *cache, uint64_t layout, int ncells)
+{
+	int i;
+
+	if(ncells != cache->ncells)
+	{
+		uint64_t *const cells = reallocarray(cache->cells, ncells, sizeof(*cells));
+		if(cells == NULL)
+		{
+			cache->layout = 0U;
+			return;
+		}
+
+		cache->cells = cells;
+		cache->ncells = ncells;
+	}
+
+	for(i = 0; i < ncells; ++i)
+	{
+		cache->cells[i] = BLANK_CELL;
+	}
+
+	cache->layout = layout;
+}
+
+/* Accounts for change of top line of the view since the last time it was
+ * drawn.  When contents moved by whole lines, scrolls the window to avoid
+ * drawing cells that are already on the screen.  Otherwise marks all cells as
+ * unknown. */
+static void
+scroll_draw_cache(view_t *view, draw_cache_t *cache)
+{
+	const int delta = view->top_line - cache->top;
+	const int lines = delta/view->column_count;
+	const int shift = lines*view->column_count;
+	int i;
+
+	if(delta == 0)
+	{
+		return;
+	}
+
+	if(fview_is_transposed(view) || delta%view->column_count != 0 ||
+			abs(lines) >= view->window_rows || cache->ncells != view->window_cells)
+	{
+		for(i = 0; i < cache->ncells; ++i)
+		{
+			cache->cells[i] = 0U;
+		}
+		return;
+	}
+
+	scrollok(view->win, TRUE);
+	wscrl(view->win, lines);
+	scrollok(view->win, FALSE);
+
+	if(shift > 0)
+	{
+		memmove(cache->cells, cache->cells + shift,
+				sizeof(*cache->cells)*(cache->ncells - shift));
+		for(i = cache->ncells - shift; i < cache->ncells; ++i)
+		{
+			cache->cells[i] = BLANK_CELL;
+		}
+	}
+	else
+	{
+		memmove(cache->cells - shift, cache->cells,
+				sizeof(*cache->cells)*(cache->ncells + shift));
+		for(i = 0; i < -shift; ++i)
+		{
+			cache->cells[i] = BLANK_CELL;
+		}
+	}
+}
+
+/* Computes signature of everything that affects all cells of the view.
+ * Returns the signature, which is never zero. */
+static uint64_t
+get_layout_signature(const view_t *view, size_t col_width, int visible_cells)
+{
+	const int fields[] = {
+		view == curr_view, (int)col_width, view->column_count, visible_cells,
+		view->window_rows, view->window_cols, view->real_num_width, view->num_type,
+		fview_is_transposed(view), ui_view_displays_columns(view),
+		ui_view_left_reserved(view), ui_view_right_reserved(view), view->matches,
+		view->custom.type, cfg.extra_padding, cfg.view_dir_size,
+	};
+	const void *const objects[] = {
+		ui_view_get_cs(view), get_view_columns(view, 0),
+	};
+
+	uint64_t hash = hash_data(UINT64_C(14695981039346656037), fields,
+			sizeof(fields));
+	hash = hash_data(hash, objects, sizeof(objects));
+	hash = hash_data(hash, &cfg.sizefmt, sizeof(cfg.sizefmt));
+	hash = hash_str(hash, cfg.time_format);
+	hash = hash_str(hash, view->view_columns);
+	return (hash == 0U ? 1U : hash);
+}
+
+/* Computes signature of a cell of the main part of the view.  Returns the
+ * signature, which is never zero and doesn't match BLANK_CELL. */
+TSTATIC uint64_t
+get_cell_signature(const column_data_t *cdt, int cell)
+{
+	const view_t *const view = cdt->view;
+	const dir_entry_t *const entry = cdt->entry;
+	const int fields[] = {
+		cdt->line_pos, cdt->line_pos == cdt->current_pos,
+		(view->num_type & NT_REL) ? cdt->current_pos : 0,
+		cell >= view->window_cells,
+	};
+
+	uint64_t hash = get_entry_signature(entry);
+	hash = hash_data(hash, fields, sizeof(fields));
+
+	if(fentry_is_dir(entry))
+	{
+		/* Size and number of items of a directory are taken from the cache, which
+		 * is updated in background (e.g., by ga and gA). */
+		dcache_result_t size, nitems;
+		dcache_get_of(entry, &size, &nitems);
+
+		const uint64_t dcache_fields[] = {
+			size.value, size.is_valid, nitems.value, nitems.is_valid,
+		};
+		hash = hash_data(hash, dcache_fields, sizeof(dcache_fields));
+	}
+
+	if(cv_tree(view->custom.type))
+	{
+		/* Tree prefix depends on parents of the entry. */
+		const dir_entry_t *child = entry;
+		const dir_entry_t *parent = child - child->child_pos;
+		while(parent != child)
+		{
+			hash = hash_data(hash, &parent->child_count, sizeof(parent->child_count));
+			child = parent;
+			parent -= parent->child_pos;
+		}
+	}
+
+	if(view->custom.type == CV_DIFF)
+	{
+		/* Highlighting of mismatches depends on the other view. */
+		const view_t *const other = (view == &lwin) ? &rwin : &lwin;
+		if(cdt->line_pos < other->list_rows)
+		{
+			const int id = other->dir_entry[cdt->line_pos].id;
+			hash = hash_data(hash, &id, sizeof(id));
+		}
+	}
+
+	return (hash <= BLANK_CELL ? hash + 2U : hash);
+}
+
+/* Computes signature of properties of the entry that affect how it's drawn.
+ * Returns the signature. */
+TSTATIC uint64_t
+get_entry_signature(const dir_entry_t *entry)
+{
+	const uint64_t wide_fields[] = {
+		entry->size, entry->mtime, entry->atime, entry->ctime,
+#ifndef _WIN32
+		entry->uid, entry->gid, entry->mode, entry->inode,
+#else
+		entry->attrs,
+#endif
+	};
+	const int fields[] = {
+		entry->nlinks, entry->id, entry->child_count, entry->child_pos,
+		entry->search_match, entry->match_left, entry->match_right, entry->type,
+		entry->selected, entry->marked, entry->dir_link, entry->folded,
+	};
+
+	uint64_t hash = hash_str(UINT64_C(14695981039346656037), entry->name);
+	hash = hash_str(hash, entry->origin);
+	hash = hash_data(hash, wide_fields, sizeof(wide_fields));
+	return hash_data(hash, fields, sizeof(fields));
+}
+
+/* Updates FNV-1a hash with a piece of data.  Returns new hash. */
+static uint64_t
+hash_data(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+	while(len-- != 0U)
+	{
+		hash ^= *bytes++;
+		hash *= UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+/* Updates FNV-1a hash with a string including its terminator.  Returns new
+ * hash. */
+static uint64_t
+hash_str(uint64_t hash, const char str[])
+{
+	/* Options might be NULL in tests. */
+	return (str == NULL ? hash : hash_data(hash, str, strlen(str) + 1U));
+}
+
+/* Draws a cell of the main part of the view unless it's already on the screen.
+ * Returns non-zero if the cell was drawn. */
+static int
+draw_list_cell(column_data_t *cdt, int cell, size_t col_width,
+		draw_cache_t *cache)
+{
+	uint64_t signature;
+
+	if(cache == NULL || cache->layout == 0U || cell >= cache->ncells)
+	{
+		compute_and_draw_cell(cdt, cell, col_width);
+		return 1;
+	}
+
+	signature = get_cell_signature(cdt, cell);
+	if(cache->cells[cell] == signature)
+	{
+		return 0;
+	}
+
+	if(!ui_view_displays_columns(cdt->view) &&
+			cdt->line_pos == cdt->current_pos && cache->cells[cell] != BLANK_CELL)
+	{
+		/* Inactive cell in ls-like view usually takes less space than an active
+		 * one.  Need to clear the cell before drawing over it. */
+		column_data_t inactive = *cdt;
+		inactive.current_pos = -1;
+		compute_and_draw_cell(&inactive, cell, col_width);
+	}
+
+	compute_and_draw_cell(cdt, cell, col_width);
+	cache->cells[cell] = signature;
+	return 1;
+}
+
+/* Clears a cell of the main part of the view unless it's already empty. */
+static void
+clear_list_cell(view_t *view, int cell, size_t col_width, draw_cache_t *cache)
+{
+	if(cache == NULL || cache->layout == 0U || cell >= cache->ncells ||
+			cache->cells[cell] == BLANK_CELL)
+	{
+		return;
+	}
+
+	const int width = ui_view_displays_columns(view)
+	                ? ui_view_available_width(view)
+	                : (int)col_width;
+	fill_line(view, fpos_get_line(view, cell), width,
+			ui_view_left_reserved(view) + fpos_get_col(view, cell)*col_width);
+
+	cache->cells[cell] = BLANK_CELL;
 }
 
 /* Draws a column to the left of the main part of the view. */
@@ -362,6 +777,12 @@ draw_left_column(view_t *view)
 		print_column(view, view->left_column.entries, dir, path, lcol_width, 0,
 				number_width);
 	}
+	else
+	{
+		/* The column isn't necessarily empty when only part of the view is
+		 * redrawn. */
+		fill_column(view, 0, 0, number_width + lcol_width, 0);
+	}
 }
 
 /* Draws a column to the right of the main part of the view. */
@@ -399,6 +820,7 @@ draw_right_column(view_t *view)
 			.h = view->window_rows,
 		};
 		qv_draw_on(entry, &parea);
+		prefetch_right_column(view);
 		return;
 	}
 
@@ -411,6 +833,47 @@ draw_right_column(view_t *view)
 		print_column(view, view->right_column.entries, NULL, path, rcol_width,
 				offset, 0);
 	}
+	else
+	{
+		/* The column isn't necessarily empty when only part of the view is
+		 * redrawn. */
+		fill_column(view, 0, 0, rcol_width, offset);
+	}
+
+	prefetch_right_column(view);
+}
+
+/* Queues listing of directories next to the cursor, which are likely to be
+ * displayed in the right column soon, nearest ones first. */
+static void
+prefetch_right_column(view_t *view)
+{
+	char paths[2*PREFETCH_DISTANCE][PATH_MAX + 1];
+	char *ptrs[2*PREFETCH_DISTANCE];
+	int count = 0;
+	int i;
+
+	for(i = 0; i < 2*PREFETCH_DISTANCE; ++i)
+	{
+		const int distance = i/2 + 1;
+		const int pos = view->list_pos + (i%2 == 0 ? distance : -distance);
+		if(pos < 0 || pos >= view->list_rows)
+		{
+			continue;
+		}
+
+		const dir_entry_t *const entry = &view->dir_entry[pos];
+		if(!fentry_is_dir(entry) || is_parent_dir(entry->name))
+		{
+			continue;
+		}
+
+		get_full_path_of(entry, sizeof(paths[count]), paths[count]);
+		ptrs[count] = paths[count];
+		++count;
+	}
+
+	lcache_prefetch(ptrs, count);
 }
 
 /* Prints column full of entry names.  Current is a hint that tells which column
@@ -491,6 +954,17 @@ print_column(view_t *view, entries_t entries, const char current[],
 /* Fills column to the bottom to clear it from previous content. */
 static void
 fill_column(view_t *view, int start_line, int top, int width, int offset)
+{
+	int i;
+	for(i = start_line; i - top < view->window_rows; ++i)
+	{
+		fill_line(view, i - top, width, offset);
+	}
+}
+
+/* Clears part of a line of the view from previous content. */
+static void
+fill_line(view_t *view, int line, int width, int offset)
 {
 	char filler[width + (cfg.extra_padding ? 1 : 0) + 1];
 	memset(filler, ' ', sizeof(filler) - 1U);
@@ -503,24 +977,20 @@ fill_column(view_t *view, int start_line, int top, int width, int offset)
 		.type = FT_UNK,
 	};
 
-	int i;
-	for(i = start_line; i - top < view->window_rows; ++i)
-	{
-		size_t prefix_len = 0U;
-		const column_data_t cdt = {
-			.view = view,
-			.entry = &non_entry,
-			.line_pos = -1,
-			.total_width = width,
-			.current_pos = -1,
-			.current_line = i - top,
-			.column_offset = offset,
-			.prefix_len = &prefix_len,
-		};
+	size_t prefix_len = 0U;
+	const column_data_t cdt = {
+		.view = view,
+		.entry = &non_entry,
+		.line_pos = -1,
+		.total_width = width,
+		.current_pos = -1,
+		.current_line = line,
+		.column_offset = offset,
+		.prefix_len = &prefix_len,
+	};
 
-		column_line_print(&cdt, FILL_COLUMN_ID, filler, cfg.extra_padding ? -1 : 0,
-				AT_LEFT, filler);
-	}
+	column_line_print(&cdt, FILL_COLUMN_ID, filler, cfg.extra_padding ? -1 : 0,
+			AT_LEFT, filler);
 }
 
 /* Calculates number of columns and maximum width of column in a view. */
@@ -671,13 +1141,16 @@ draw_cell(columns_t *columns, const column_data_t *cdt, size_t col_width,
 	                  ? ui_view_available_width(cdt->view) - (cdt->column_offset -
 	                    ui_view_left_reserved(cdt->view))
 	                  : col_width + 1U;
+	uint64_t start;
 
 	if(cfg.extra_padding)
 	{
 		column_line_print(cdt, FILL_COLUMN_ID, " ", -1, AT_LEFT, " ");
 	}
 
+	start = perf_begin();
 	columns_format_line(columns, cdt, MIN(col_width, width_left));
+	perf_end(PK_DRAW_LINE, start, 0U);
 
 	if(cfg.extra_padding && width_left >= col_width)
 	{
@@ -884,6 +1357,13 @@ fview_draw_inactive_cursor(view_t *view)
 
 	wprinta(view->win, INACTIVE_CURSOR_MARK, &line_attrs, 0);
 	ui_view_win_changed(view);
+
+	/* The mark isn't accounted for by signature of the cell. */
+	draw_cache_t *const cache = get_draw_cache(view, 0);
+	if(cache != NULL && view->curr_line < cache->ncells)
+	{
+		cache->cells[view->curr_line] = 0U;
+	}
 }
 
 /* Calculate color attributes for cursor line of inactive pane.  Returns
@@ -931,6 +1411,20 @@ redraw_cell(view_t *view, int top, int cursor, int is_current)
 		.current_pos = is_current ? view->list_pos : -1,
 	};
 	compute_and_draw_cell(&cdt, cursor, col_width);
+
+	/* Keep track of what's on the screen. */
+	draw_cache_t *const cache = get_draw_cache(view, 0);
+	if(cache != NULL && cache->layout != 0U)
+	{
+		if(top != cache->top)
+		{
+			cache->layout = 0U;
+		}
+		else if(cursor < cache->ncells)
+		{
+			cache->cells[cursor] = get_cell_signature(&cdt, cursor);
+		}
+	}
 }
 
 /* Fills in fields of cdt based on passed in arguments and
@@ -1359,7 +1853,9 @@ mix_in_file_name_hi(const view_t *view, dir_entry_t *entry, col_attr_t *col)
 {
 	const col_scheme_t *const cs = ui_view_get_cs(view);
 	char *const typed_fname = get_typed_entry_fpath(entry);
+	const uint64_t start = perf_begin();
 	const col_attr_t *color = cs_get_file_hi(cs, typed_fname, &entry->hi_num);
+	perf_end(PK_HIGHLIGHT, start, 0U);
 	free(typed_fname);
 	if(color != NULL)
 	{
@@ -1471,11 +1967,29 @@ format_size(int id, const void *data, size_t buf_len, char buf[])
 		size = cdt->entry->size;
 	}
 
-	str[0] = '\0';
-	friendly_size_notation(size, sizeof(str), str);
+	format_size_value(size, sizeof(str), str);
 	snprintf(buf, buf_len + 1, " %s", str);
 }
 
+/* Formats size in human readable form using a cache.  buf_len is the size of
+ * the buffer. */
+TSTATIC void
+format_size_value(uint64_t size, size_t buf_len, char buf[])
+{
+	format_cache_t *const slot = get_format_slot(size_cache, size);
+	if(slot->valid)
+	{
+		copy_str(buf, buf_len, slot->str);
+		return;
+	}
+
+	slot->str[0] = '\0';
+	friendly_size_notation(size, sizeof(slot->str), slot->str);
+	slot->key = size;
+	slot->valid = 1;
+	copy_str(buf, buf_len, slot->str);
+}
+
 /* Item number format callback for column_view unit. */
 static void
 format_nitems(int id, const void *data, size_t buf_len, char buf[])
@@ -1554,35 +2068,85 @@ format_fileext(int id, const void *data, size_t buf_len, char buf[])
 static void
 format_time(int id, const void *data, size_t buf_len, char buf[])
 {
-	struct tm *tm_ptr;
 	const column_data_t *cdt = data;
 
 	switch(id)
 	{
 		case SK_BY_TIME_MODIFIED:
-			tm_ptr = localtime(&cdt->entry->mtime);
+			format_time_value(cdt->entry->mtime, buf_len + 1, buf);
 			break;
 		case SK_BY_TIME_ACCESSED:
-			tm_ptr = localtime(&cdt->entry->atime);
+			format_time_value(cdt->entry->atime, buf_len + 1, buf);
 			break;
 		case SK_BY_TIME_CHANGED:
-			tm_ptr = localtime(&cdt->entry->ctime);
+			format_time_value(cdt->entry->ctime, buf_len + 1, buf);
 			break;
 
 		default:
 			assert(0 && "Unknown sort by time type");
-			tm_ptr = NULL;
+			buf[0] = '\0';
 			break;
 	}
+}
 
-	if(tm_ptr != NULL)
+/* Formats time according to 'timefmt' using a cache.  buf_len is the size of
+ * the buffer. */
+TSTATIC void
+format_time_value(time_t t, size_t buf_len, char buf[])
+{
+	format_cache_t *const slot = get_format_slot(time_cache, (uint64_t)t);
+	struct tm *tm_ptr;
+
+	if(slot->valid)
 	{
-		strftime(buf, buf_len + 1, cfg.time_format, tm_ptr);
+		copy_str(buf, buf_len, slot->str);
+		return;
 	}
-	else
+
+	tm_ptr = localtime(&t);
+	if(tm_ptr == NULL)
 	{
 		buf[0] = '\0';
+		return;
 	}
+
+	/* strftime() returns zero if result doesn't fit, such results aren't cached
+	 * and are formatted directly into the buffer. */
+	if(strftime(slot->str, sizeof(slot->str), cfg.time_format, tm_ptr) == 0U)
+	{
+		if(strftime(buf, buf_len, cfg.time_format, tm_ptr) == 0U)
+		{
+			buf[0] = '\0';
+		}
+		return;
+	}
+
+	slot->key = (uint64_t)t;
+	slot->valid = 1;
+	copy_str(buf, buf_len, slot->str);
+}
+
+/* Finds slot of a cache of formatted values that corresponds to the key.
+ * Returns pointer to the slot, which might be occupied by a different key in
+ * which case it's marked as invalid. */
+static format_cache_t *
+get_format_slot(format_cache_t cache[], uint64_t key)
+{
+	/* Fibonacci hashing spreads sequential values over the whole cache. */
+	const uint64_t hash = key*UINT64_C(11400714819323198485);
+	format_cache_t *const slot = &cache[hash >> (64 - FORMAT_CACHE_BITS)];
+	if(slot->valid && slot->key != key)
+	{
+		slot->valid = 0;
+	}
+	return slot;
+}
+
+void
+fview_formats_updated(void)
+{
+	memset(time_cache, 0, sizeof(time_cache));
+	memset(size_cache, 0, sizeof(size_cache));
 }
 
 /* Directory vs. file type format callback for column_view unit. */
@@ -1704,12 +2268,14 @@ fview_update_geometry(view_t *view)
 	view->run_size = fview_is_transposed(view) ? view->window_rows
 	                                           : view->column_count;
 	view->window_cells = view->column_count*view->window_rows;
+	fview_damage(view);
 }
 
 void
 fview_dir_updated(view_t *view)
 {
 	view->local_cs = cs_load_local(view == &lwin, view->curr_dir);
+	fview_damage(view);
 }
 
 void
@@ -1719,6 +2285,7 @@ fview_list_updated(view_t *view)
 	view->max_filename_width = 0;
 	/* Even if position will remain the same, we might need to redraw it. */
 	invalidate_cursor_pos_cache(view);
+	fview_damage(view);
 }
 
 /* Evaluates number of columns in the view.  Returns the number. */
@@ -1752,12 +2319,19 @@ get_max_filename_width(const view_t *view)
 }
 
 /* Gets filename width (length in character positions on the screen) of ith
- * entry of the view.  Returns the width. */
+ * entry of the view.  The width is cached in the entry, so that only new and
+ * renamed files are measured after a reload.  Returns the width. */
 static size_t
 get_filename_width(const view_t *view, int i)
 {
-	const dir_entry_t *const entry = &view->dir_entry[i];
+	dir_entry_t *const entry = &view->dir_entry[i];
 	size_t name_len;
+
+	if(entry->name_width != 0)
+	{
+		return entry->name_width - 1;
+	}
+
 	if(flist_custom_active(view))
 	{
 		char name[NAME_MAX + 1];
@@ -1769,7 +2343,10 @@ get_filename_width(const view_t *view, int i)
 	{
 		name_len = utf8_strsw(entry->name);
 	}
-	return name_len + get_filetype_decoration_width(entry);
+
+	name_len += get_filetype_decoration_width(entry);
+	entry->name_width = name_len + 1;
+	return name_len;
 }
 
 /* Retrieves additional number of characters which are needed to display names
@@ -1977,6 +2554,7 @@ void
 fview_sorting_updated(view_t *view)
 {
 	reset_view_columns(view);
+	fview_damage(view);
 }
 
 /* Reinitializes view columns. */
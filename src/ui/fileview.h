@@ -38,6 +38,16 @@ void fview_reset(struct view_t *view);
 /* Resets view state with regard to color schemes. */
 void fview_reset_cs(struct view_t *view);
 
+/* Marks contents of window of the view as unknown, so the next redraw of the
+ * file list draws every cell instead of only those that have changed.  Should
+ * be called after drawing something else in the window or changing appearance
+ * in a way that doesn't affect entries of the list. */
+void fview_damage(struct view_t *view);
+
+/* Discards cached results of formatting times and sizes.  Should be called
+ * after changing formatting options. */
+void fview_formats_updated(void);
+
 /* Appearance related functions. */
 
 /* Redraws directory list and puts inactive mark for the other view. */
@@ -132,6 +142,8 @@ void fview_sorting_updated(struct view_t *view);
 
 #ifdef TEST
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <time.h> /* time_t */
 
 #include "ui.h"
 #endif
@@ -160,6 +172,10 @@ TSTATIC_DEFS(
 	column_data_t;
 
 	void format_name(int id, const void *data, size_t buf_len, char buf[]);
+	uint64_t get_cell_signature(const column_data_t *cdt, int cell);
+	uint64_t get_entry_signature(const dir_entry_t *entry);
+	void format_time_value(time_t t, size_t buf_len, char buf[]);
+	void format_size_value(uint64_t size, size_t buf_len, char buf[]);
 )
 
 #endif /* VIFM__UI__FILEVIEW_H__ */
@@ -0,0 +1,535 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "listing_cache.h"
+
+#ifndef _WIN32
+#include <fcntl.h> /* FD_CLOEXEC F_GETFL F_SETFD F_SETFL O_NONBLOCK fcntl() */
+#include <unistd.h> /* pipe() read() write() */
+#endif
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strdup() */
+#include <time.h> /* time() time_t */
+
+#include "../compat/pthread.h"
+#include "../utils/dir_lister.h"
+#include "../utils/str.h"
+#include "../utils/utils.h"
+#include "../utils/watch_set.h"
+
+/* Maximum number of cached listings. */
+#define CACHE_SIZE 16
+
+/* Number of seconds after which listing of a directory that isn't watched is
+ * considered to be outdated. */
+#define UNWATCHED_TTL 1
+
+/* State of a cache entry. */
+typedef enum
+{
+	ES_FREE,    /* Unused entry. */
+	ES_QUEUED,  /* Waiting to be listed. */
+	ES_RUNNING, /* Being listed by the worker. */
+	ES_LISTED,  /* Listed, but the result wasn't taken by the main thread. */
+	ES_READY,   /* Contains up to date listing. */
+}
+EntryState;
+
+/* Single cached directory. */
+typedef struct
+{
+	char *path;                  /* Path to the directory. */
+	EntryState state;            /* State of the entry. */
+	dir_listing_t listing;       /* Listing, which is outdated if not ready. */
+	unsigned long long id;       /* Identifier of the listing or zero. */
+	dir_listing_t fresh;         /* Result of listing by the worker. */
+	int watch;                   /* Identifier of watch of the directory or -1. */
+	int watch_lost;              /* Whether the watch doesn't work anymore. */
+	int changed;                 /* Whether directory changed since listing. */
+	time_t listed_at;            /* When the listing was taken. */
+	int demanded;                /* Whether listing is needed for display. */
+	int priority;                /* Position among prefetches, lower is first. */
+	unsigned long long last_use; /* When the entry was requested last. */
+}
+entry_t;
+
+static void take_listings(void);
+static void start_worker(void);
+static entry_t * find_entry(const char path[]);
+static entry_t * add_entry(const char path[]);
+static entry_t * pick_free_entry(void);
+static void clear_entry(entry_t *entry);
+static void on_dir_changed(int id, int gone, void *arg);
+static entry_t * pick_queued_entry(void);
+static void * worker_thread(void *arg);
+static void notify(void);
+static void make_pipe(void);
+
+/* Cached listings.  Listings and watches are modified only by the main thread
+ * except for watches of running entries. */
+static entry_t cache[CACHE_SIZE];
+/* Watches of cached directories, which share a single inotify instance. */
+static watch_set_t *watches;
+/* Protects the cache and the variables below. */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Whether worker thread exists. */
+static int worker_running;
+/* Whether some entries were listed since the last check. */
+static int updated;
+/* Source of timestamps for least recently used eviction. */
+static unsigned long long use_counter;
+/* Source of identifiers of listings. */
+static unsigned long long id_counter;
+/* Notification pipe, which is created on the first request. */
+static int notify_fds[2] = { -1, -1 };
+
+const dir_listing_t *
+lcache_get(const char path[], unsigned long long *id)
+{
+	pthread_mutex_lock(&cache_lock);
+
+	take_listings();
+
+	entry_t *entry = find_entry(path);
+	if(entry == NULL)
+	{
+		entry = add_entry(path);
+	}
+	else if(entry->state == ES_READY)
+	{
+		if(watches != NULL)
+		{
+			watch_set_check(watches, &on_dir_changed, NULL);
+		}
+
+		if(entry->watch == -1)
+		{
+			if(time(NULL) - entry->listed_at >= UNWATCHED_TTL)
+			{
+				entry->state = ES_QUEUED;
+			}
+		}
+		else if(entry->changed)
+		{
+			/* Lost watch is added anew on listing the directory. */
+			entry->state = ES_QUEUED;
+		}
+	}
+
+	const dir_listing_t *listing = NULL;
+	*id = 0;
+	if(entry != NULL)
+	{
+		entry->demanded = 1;
+		entry->last_use = ++use_counter;
+
+		*id = entry->id;
+		listing = (entry->id == 0 ? NULL : &entry->listing);
+	}
+
+	start_worker();
+
+	pthread_mutex_unlock(&cache_lock);
+	return listing;
+}
+
+void
+lcache_prefetch(char *paths[], int count)
+{
+	int i;
+
+	pthread_mutex_lock(&cache_lock);
+
+	take_listings();
+
+	/* Drop prefetches that weren't started yet, needed ones are added back
+	 * below.  Outdated listings stay queued to be refreshed. */
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		if(cache[i].state == ES_QUEUED && !cache[i].demanded && cache[i].id == 0)
+		{
+			clear_entry(&cache[i]);
+		}
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		entry_t *entry = find_entry(paths[i]);
+		if(entry == NULL)
+		{
+			entry = add_entry(paths[i]);
+			if(entry == NULL)
+			{
+				break;
+			}
+		}
+
+		entry->priority = i;
+		entry->last_use = ++use_counter;
+	}
+
+	start_worker();
+
+	pthread_mutex_unlock(&cache_lock);
+}
+
+int
+lcache_check_updates(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	take_listings();
+	const int result = updated;
+	updated = 0;
+#ifndef _WIN32
+	if(result && notify_fds[0] != -1)
+	{
+		char buf[64];
+		while(read(notify_fds[0], buf, sizeof(buf)) > 0)
+		{
+			/* Do nothing. */
+		}
+	}
+#endif
+	pthread_mutex_unlock(&cache_lock);
+	return result;
+}
+
+int
+lcache_is_busy(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int result = worker_running;
+	pthread_mutex_unlock(&cache_lock);
+	return result;
+}
+
+int
+lcache_get_fd(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int fd = notify_fds[0];
+	pthread_mutex_unlock(&cache_lock);
+	return fd;
+}
+
+int
+lcache_get_watch_fd(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int fd = (watches == NULL ? -1 : watch_set_get_fd(watches));
+	pthread_mutex_unlock(&cache_lock);
+	return fd;
+}
+
+/* Replaces listings of entries with results produced by the worker.  Should be
+ * called with the lock held. */
+static void
+take_listings(void)
+{
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state == ES_LISTED)
+		{
+			dir_listing_free(&entry->listing);
+			entry->listing = entry->fresh;
+			entry->id = ++id_counter;
+			entry->listed_at = time(NULL);
+			entry->fresh.names = NULL;
+			entry->fresh.count = -1;
+			entry->fresh.stats = NULL;
+			entry->demanded = 0;
+			entry->state = ES_READY;
+		}
+	}
+}
+
+/* Starts worker thread if there is something to list and it's not running.
+ * Should be called with the lock held. */
+static void
+start_worker(void)
+{
+	int i;
+
+	if(notify_fds[0] == -1)
+	{
+		make_pipe();
+	}
+
+	if(watches == NULL)
+	{
+		watches = watch_set_create(0);
+	}
+
+	if(worker_running || pick_queued_entry() == NULL)
+	{
+		return;
+	}
+
+	pthread_t id;
+	worker_running = (pthread_create(&id, NULL, &worker_thread, NULL) == 0);
+	if(worker_running)
+	{
+		return;
+	}
+
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		if(cache[i].state == ES_QUEUED)
+		{
+			clear_entry(&cache[i]);
+		}
+	}
+}
+
+/* Looks up an entry of the directory.  Returns the entry or NULL. */
+static entry_t *
+find_entry(const char path[])
+{
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state != ES_FREE && stroscmp(entry->path, path) == 0)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/* Queues listing of a directory that's not in the cache.  Returns the entry or
+ * NULL on error. */
+static entry_t *
+add_entry(const char path[])
+{
+	entry_t *const entry = pick_free_entry();
+	if(entry == NULL)
+	{
+		return NULL;
+	}
+
+	entry->path = strdup(path);
+	if(entry->path == NULL)
+	{
+		return NULL;
+	}
+
+	entry->listing.count = -1;
+	entry->fresh.count = -1;
+	entry->watch = -1;
+	entry->state = ES_QUEUED;
+	return entry;
+}
+
+/* Picks an entry to be filled evicting least recently used entry that's not
+ * being listed if necessary.  Returns the entry or NULL. */
+static entry_t *
+pick_free_entry(void)
+{
+	entry_t *lru = NULL;
+
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state == ES_FREE)
+		{
+			return entry;
+		}
+		if(entry->state != ES_RUNNING &&
+				(lru == NULL || entry->last_use < lru->last_use))
+		{
+			lru = entry;
+		}
+	}
+
+	if(lru != NULL)
+	{
+		clear_entry(lru);
+	}
+	return lru;
+}
+
+/* Frees resources of an entry and marks it as unused. */
+static void
+clear_entry(entry_t *entry)
+{
+	free(entry->path);
+	dir_listing_free(&entry->listing);
+	dir_listing_free(&entry->fresh);
+	if(entry->watch != -1)
+	{
+		watch_set_remove(watches, entry->watch);
+	}
+	memset(entry, 0, sizeof(*entry));
+	entry->watch = -1;
+}
+
+/* Marks entries of a changed directory as such.  Should be called with the
+ * lock held. */
+static void
+on_dir_changed(int id, int gone, void *arg)
+{
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state != ES_FREE && entry->watch == id)
+		{
+			entry->changed = 1;
+			entry->watch_lost |= gone;
+		}
+	}
+}
+
+/* Picks queued entry that should be listed next: the most recently demanded
+ * one or, if there are none, prefetched entry with the highest priority.
+ * Returns the entry or NULL. */
+static entry_t *
+pick_queued_entry(void)
+{
+	entry_t *next = NULL;
+
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state != ES_QUEUED)
+		{
+			continue;
+		}
+
+		if(next == NULL || entry->demanded > next->demanded)
+		{
+			next = entry;
+		}
+		else if(entry->demanded == next->demanded)
+		{
+			if(entry->demanded ? entry->last_use > next->last_use
+			                   : entry->priority < next->priority)
+			{
+				next = entry;
+			}
+		}
+	}
+
+	return next;
+}
+
+/* Entry point of a thread that lists queued directories until there are none
+ * left.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	entry_t *entry;
+
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	pthread_mutex_lock(&cache_lock);
+	while((entry = pick_queued_entry()) != NULL)
+	{
+		dir_listing_t listing;
+		const int lost_watch = (entry->watch_lost ? entry->watch : -1);
+		const int need_watch = (entry->watch == -1 || entry->watch_lost);
+		int watch = entry->watch;
+
+		entry->state = ES_RUNNING;
+		entry->changed = 0;
+		pthread_mutex_unlock(&cache_lock);
+
+		/* Watch is added first to not miss changes made during listing. */
+		if(need_watch && watches != NULL)
+		{
+			if(lost_watch != -1)
+			{
+				watch_set_remove(watches, lost_watch);
+			}
+			watch = watch_set_add(watches, entry->path);
+		}
+		dir_lister_list(entry->path, &listing);
+
+		pthread_mutex_lock(&cache_lock);
+
+		if(need_watch)
+		{
+			entry->watch = watch;
+			entry->watch_lost = 0;
+		}
+		if(listing.count < 0 && entry->watch != -1)
+		{
+			/* Watch of a directory that's gone is of no use even if the directory
+			 * is recreated. */
+			watch_set_remove(watches, entry->watch);
+			entry->watch = -1;
+		}
+
+		entry->fresh = listing;
+		entry->state = ES_LISTED;
+		notify();
+	}
+	worker_running = 0;
+	pthread_mutex_unlock(&cache_lock);
+
+	return NULL;
+}
+
+/* Informs the main thread about an update.  Should be called with the lock
+ * held. */
+static void
+notify(void)
+{
+	updated = 1;
+#ifndef _WIN32
+	if(notify_fds[1] != -1)
+	{
+		(void)write(notify_fds[1], "x", 1);
+	}
+#endif
+}
+
+/* Creates non-blocking notification pipe.  Leaves descriptors at -1 on failure
+ * or if it's not supported.  Should be called with the lock held. */
+static void
+make_pipe(void)
+{
+#ifndef _WIN32
+	int i;
+
+	if(pipe(notify_fds) != 0)
+	{
+		notify_fds[0] = -1;
+		notify_fds[1] = -1;
+		return;
+	}
+
+	for(i = 0; i < 2; ++i)
+	{
+		(void)fcntl(notify_fds[i], F_SETFL,
+				fcntl(notify_fds[i], F_GETFL) | O_NONBLOCK);
+		(void)fcntl(notify_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
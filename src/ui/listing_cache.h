@@ -0,0 +1,66 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UI__LISTING_CACHE_H__
+#define VIFM__UI__LISTING_CACHE_H__
+
+#include "../utils/dir_lister.h"
+
+/* Lists directories displayed in miller columns (and those that are likely to
+ * be displayed next) in a background thread and keeps the listings.
+ *
+ * Cached directories are watched through a single inotify instance, listings of
+ * directories that can't be watched are considered outdated after a second.
+ * An outdated listing keeps being returned until the directory is listed anew.
+ * Directories requested for display are listed before prefetched ones, most
+ * recently requested first.  Least recently used listings are evicted when the
+ * cache is full.  Pointers to listings stay valid until the next call of any of
+ * the functions below. */
+
+/* Looks up listing of a directory, which is queued for listing if it's missing
+ * or is outdated.  *id is set to identifier of the listing, which changes
+ * whenever the directory is listed anew and is zero if there is no listing.
+ * Returns the listing or NULL if it's not available yet. */
+const dir_listing_t * lcache_get(const char path[], unsigned long long *id);
+
+/* Queues listing of directories that are likely to be needed soon in the order
+ * of their priority.  Prefetches queued by previous calls that weren't started
+ * yet are dropped. */
+void lcache_prefetch(char *paths[], int count);
+
+/* Checks whether some directories were listed since the last call.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int lcache_check_updates(void);
+
+/* Checks whether directories are being listed.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int lcache_is_busy(void);
+
+/* Retrieves file descriptor that becomes readable when some directories are
+ * listed.  Returns the descriptor or -1 if it's not available (yet). */
+int lcache_get_fd(void);
+
+/* Retrieves file descriptor that becomes readable on changes of watched cached
+ * directories.  Returns the descriptor or -1 if changes are detected only on
+ * querying them. */
+int lcache_get_watch_fd(void);
+
+#endif /* VIFM__UI__LISTING_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
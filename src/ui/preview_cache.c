@@ -0,0 +1,594 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "preview_cache.h"
+
+#ifndef _WIN32
+#include <fcntl.h> /* FD_CLOEXEC F_GETFL F_SETFD F_SETFL O_NONBLOCK fcntl() */
+#include <unistd.h> /* pipe() read() write() */
+#endif
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcmp() strdup() strncmp() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "../compat/pthread.h"
+#include "../utils/cancellation.h"
+#include "../utils/filemon.h"
+#include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../utils/utils.h"
+
+/* Maximum number of cached previews. */
+#define CACHE_SIZE 64
+
+/* Minimal interval between reports of partial previews in milliseconds. */
+#define REPORT_PERIOD 100
+
+/* State of a cache entry. */
+typedef enum
+{
+	ES_FREE,    /* Unused entry. */
+	ES_QUEUED,  /* Waiting to be produced. */
+	ES_RUNNING, /* Being produced by the worker. */
+	ES_READY,   /* Contains preview. */
+}
+EntryState;
+
+/* Single cached preview. */
+typedef struct
+{
+	char *cmd;                  /* Expanded viewer command or NULL. */
+	pcache_producer_f producer; /* Producer of the preview if cmd is NULL. */
+	char *dir;                  /* Directory in which the command is run. */
+	char *path;                 /* Path to the previewed file. */
+	filemon_t filemon;          /* Timestamp of the file. */
+	int w;                      /* Width of preview area. */
+	int h;                      /* Height of preview area. */
+
+	EntryState state;            /* State of the entry. */
+	strlist_t lines;             /* Preview, can be partial for running entry. */
+	int max_lines;               /* Limit on number of lines. */
+	int priority;                /* Position in the queue, lower is first. */
+	int cancelled;               /* Running entry isn't needed anymore. */
+	unsigned long long last_use; /* When the entry was requested last. */
+}
+entry_t;
+
+/* State of reporting of a running producer. */
+typedef struct
+{
+	entry_t *entry;       /* Entry being produced. */
+	struct timespec last; /* When partial lines were taken last. */
+}
+report_state_t;
+
+static void load_filemon(const char path[], filemon_t *filemon);
+static entry_t * find_entry(const pcache_key_t *key, const filemon_t *filemon);
+static int same_filemon(const filemon_t *a, const filemon_t *b);
+static entry_t * pick_free_entry(void);
+static void clear_entry(entry_t *entry);
+static entry_t * pick_queued_entry(void);
+static void * worker_thread(void *arg);
+static int produce(entry_t *entry, strlist_t *lines);
+static int report_progress(void *arg, const strlist_t *lines);
+static void notify(void);
+static void make_pipe(void);
+static int same_str(const char a[], const char b[]);
+static int is_cancelled(void *arg);
+static strlist_t split_into_lines(char text[], size_t len, int max_lines);
+
+/* Cached previews.  Entries that are being produced are never reused, ready
+ * entries are modified only by the main thread. */
+static entry_t cache[CACHE_SIZE];
+/* Protects the cache and the variables below. */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Whether worker thread exists. */
+static int worker_running;
+/* Whether some entries became ready since the last check. */
+static int updated;
+/* Source of timestamps for least recently used eviction. */
+static unsigned long long use_counter;
+/* Notification pipe, which is created on the first request. */
+static int notify_fds[2] = { -1, -1 };
+
+void
+pcache_request(const pcache_key_t keys[], int count, int max_lines)
+{
+#ifndef _WIN32
+	filemon_t filemons[count];
+	int i;
+	int queued = 0;
+
+	for(i = 0; i < count; ++i)
+	{
+		load_filemon(keys[i].path, &filemons[i]);
+	}
+
+	pthread_mutex_lock(&cache_lock);
+
+	if(notify_fds[0] == -1)
+	{
+		make_pipe();
+	}
+
+	/* Drop whatever wasn't produced yet, needed entries are added back below. */
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		if(cache[i].state == ES_QUEUED)
+		{
+			clear_entry(&cache[i]);
+		}
+		else if(cache[i].state == ES_RUNNING)
+		{
+			cache[i].cancelled = 1;
+		}
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		entry_t *entry = find_entry(&keys[i], &filemons[i]);
+		if(entry != NULL)
+		{
+			entry->last_use = ++use_counter;
+			entry->cancelled = 0;
+			continue;
+		}
+
+		entry = pick_free_entry();
+		if(entry == NULL)
+		{
+			break;
+		}
+
+		entry->cmd = (keys[i].cmd == NULL ? NULL : strdup(keys[i].cmd));
+		entry->producer = keys[i].producer;
+		entry->dir = strdup(keys[i].dir);
+		entry->path = strdup(keys[i].path);
+		if((entry->cmd == NULL && keys[i].cmd != NULL) || entry->dir == NULL ||
+				entry->path == NULL)
+		{
+			clear_entry(entry);
+			break;
+		}
+
+		filemon_assign(&entry->filemon, &filemons[i]);
+		entry->w = keys[i].w;
+		entry->h = keys[i].h;
+		entry->state = ES_QUEUED;
+		entry->max_lines = max_lines;
+		entry->priority = i;
+		entry->last_use = ++use_counter;
+		++queued;
+	}
+
+	if(queued != 0 && !worker_running)
+	{
+		pthread_t id;
+		worker_running = (pthread_create(&id, NULL, &worker_thread, NULL) == 0);
+		if(!worker_running)
+		{
+			for(i = 0; i < CACHE_SIZE; ++i)
+			{
+				if(cache[i].state == ES_QUEUED)
+				{
+					clear_entry(&cache[i]);
+				}
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+#endif
+}
+
+PcacheState
+pcache_lookup(const pcache_key_t *key, strlist_t *lines)
+{
+	PcacheState state = PCS_MISSING;
+	filemon_t filemon;
+	load_filemon(key->path, &filemon);
+
+	lines->items = NULL;
+	lines->nitems = 0;
+
+	pthread_mutex_lock(&cache_lock);
+	const entry_t *const entry = find_entry(key, &filemon);
+	if(entry != NULL && (entry->state == ES_READY || entry->lines.nitems != 0))
+	{
+		lines->items = copy_string_array(entry->lines.items, entry->lines.nitems);
+		if(lines->items != NULL)
+		{
+			lines->nitems = entry->lines.nitems;
+			state = (entry->state == ES_READY ? PCS_READY : PCS_PARTIAL);
+		}
+		else if(entry->lines.nitems == 0)
+		{
+			state = PCS_READY;
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return state;
+}
+
+int
+pcache_check_updates(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int result = updated;
+	updated = 0;
+#ifndef _WIN32
+	if(result && notify_fds[0] != -1)
+	{
+		char buf[64];
+		while(read(notify_fds[0], buf, sizeof(buf)) > 0)
+		{
+			/* Do nothing. */
+		}
+	}
+#endif
+	pthread_mutex_unlock(&cache_lock);
+	return result;
+}
+
+int
+pcache_is_busy(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int result = worker_running;
+	pthread_mutex_unlock(&cache_lock);
+	return result;
+}
+
+int
+pcache_get_fd(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	const int fd = notify_fds[0];
+	pthread_mutex_unlock(&cache_lock);
+	return fd;
+}
+
+/* Queries timestamp of a file.  Files that can't be examined get uninitialized
+ * timestamp, which is matched by same_filemon(). */
+static void
+load_filemon(const char path[], filemon_t *filemon)
+{
+	if(filemon_from_file(path, FMT_MODIFIED, filemon) != 0)
+	{
+		memset(filemon, 0, sizeof(*filemon));
+	}
+}
+
+/* Looks up an entry that matches the key.  Returns the entry or NULL. */
+static entry_t *
+find_entry(const pcache_key_t *key, const filemon_t *filemon)
+{
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state != ES_FREE &&
+				entry->w == key->w &&
+				entry->h == key->h &&
+				entry->producer == key->producer &&
+				same_str(entry->cmd, key->cmd) &&
+				strcmp(entry->path, key->path) == 0 &&
+				strcmp(entry->dir, key->dir) == 0 &&
+				same_filemon(&entry->filemon, filemon))
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/* Compares timestamps treating two uninitialized ones as equal.  Returns
+ * non-zero if they are equal, otherwise zero is returned. */
+static int
+same_filemon(const filemon_t *a, const filemon_t *b)
+{
+	if(a->type == FMT_UNINITIALIZED || b->type == FMT_UNINITIALIZED)
+	{
+		return (a->type == b->type);
+	}
+	return filemon_equal(a, b);
+}
+
+/* Picks an entry to be filled evicting least recently used ready entry if
+ * necessary.  Returns the entry or NULL. */
+static entry_t *
+pick_free_entry(void)
+{
+	entry_t *lru = NULL;
+
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state == ES_FREE)
+		{
+			return entry;
+		}
+		if(entry->state == ES_READY &&
+				(lru == NULL || entry->last_use < lru->last_use))
+		{
+			lru = entry;
+		}
+	}
+
+	if(lru != NULL)
+	{
+		clear_entry(lru);
+	}
+	return lru;
+}
+
+/* Frees resources of an entry and marks it as unused. */
+static void
+clear_entry(entry_t *entry)
+{
+	free(entry->cmd);
+	free(entry->dir);
+	free(entry->path);
+	free_string_array(entry->lines.items, entry->lines.nitems);
+	memset(entry, 0, sizeof(*entry));
+}
+
+/* Picks queued entry with the highest priority.  Returns the entry or
+ * NULL. */
+static entry_t *
+pick_queued_entry(void)
+{
+	entry_t *next = NULL;
+
+	int i;
+	for(i = 0; i < CACHE_SIZE; ++i)
+	{
+		entry_t *const entry = &cache[i];
+		if(entry->state == ES_QUEUED &&
+				(next == NULL || entry->priority < next->priority))
+		{
+			next = entry;
+		}
+	}
+
+	return next;
+}
+
+/* Entry point of a thread that produces queued previews until there are none
+ * left.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+#ifndef _WIN32
+	entry_t *entry;
+
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	pthread_mutex_lock(&cache_lock);
+	while((entry = pick_queued_entry()) != NULL)
+	{
+		strlist_t lines = {};
+
+		entry->state = ES_RUNNING;
+		pthread_mutex_unlock(&cache_lock);
+
+		const int failed = produce(entry, &lines);
+
+		pthread_mutex_lock(&cache_lock);
+
+		free_string_array(entry->lines.items, entry->lines.nitems);
+		entry->lines.items = NULL;
+		entry->lines.nitems = 0;
+
+		if(entry->cancelled || failed)
+		{
+			free_string_array(lines.items, lines.nitems);
+			clear_entry(entry);
+		}
+		else
+		{
+			entry->lines = lines;
+			entry->state = ES_READY;
+			notify();
+		}
+	}
+	worker_running = 0;
+	pthread_mutex_unlock(&cache_lock);
+#endif
+
+	return NULL;
+}
+
+/* Produces preview of a running entry.  Entries aren't modified by the main
+ * thread while they run, except for the cancellation flag.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+produce(entry_t *entry, strlist_t *lines)
+{
+	if(entry->cmd == NULL)
+	{
+		report_state_t state = { .entry = entry };
+		(void)clock_gettime(CLOCK_MONOTONIC, &state.last);
+		entry->producer(entry->path, entry->max_lines, lines, &report_progress,
+				&state);
+		return 0;
+	}
+
+	const cancellation_t cancellation = {
+		.hook = &is_cancelled,
+		.arg = entry,
+	};
+
+	size_t len;
+	char *const output = read_cmd_output_cancellable(entry->cmd, entry->dir,
+			entry->max_lines, &cancellation, &len);
+	if(output == NULL)
+	{
+		return 1;
+	}
+
+	*lines = split_into_lines(output, len, entry->max_lines);
+	free(output);
+	return 0;
+}
+
+/* Makes partial preview available to the main thread once in a while.
+ * Returns non-zero if the preview isn't needed anymore. */
+static int
+report_progress(void *arg, const strlist_t *lines)
+{
+	report_state_t *const state = arg;
+	entry_t *const entry = state->entry;
+	struct timespec now;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+	const long long elapsed = (now.tv_sec - state->last.tv_sec)*1000LL
+	                        + (now.tv_nsec - state->last.tv_nsec)/1000000LL;
+
+	pthread_mutex_lock(&cache_lock);
+	if(elapsed >= REPORT_PERIOD && !entry->cancelled)
+	{
+		char **const copy = copy_string_array(lines->items, lines->nitems);
+		if(copy != NULL)
+		{
+			free_string_array(entry->lines.items, entry->lines.nitems);
+			entry->lines.items = copy;
+			entry->lines.nitems = lines->nitems;
+			notify();
+		}
+		state->last = now;
+	}
+	const int cancelled = entry->cancelled;
+	pthread_mutex_unlock(&cache_lock);
+
+	return cancelled;
+}
+
+/* Informs the main thread about an update.  Should be called with the lock
+ * held. */
+static void
+notify(void)
+{
+	updated = 1;
+#ifndef _WIN32
+	if(notify_fds[1] != -1)
+	{
+		(void)write(notify_fds[1], "x", 1);
+	}
+#endif
+}
+
+/* Creates non-blocking notification pipe.  Leaves descriptors at -1 on failure
+ * or if it's not supported.  Should be called with the lock held. */
+static void
+make_pipe(void)
+{
+#ifndef _WIN32
+	int i;
+
+	if(pipe(notify_fds) != 0)
+	{
+		notify_fds[0] = -1;
+		notify_fds[1] = -1;
+		return;
+	}
+
+	for(i = 0; i < 2; ++i)
+	{
+		(void)fcntl(notify_fds[i], F_SETFL,
+				fcntl(notify_fds[i], F_GETFL) | O_NONBLOCK);
+		(void)fcntl(notify_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+}
+
+/* Compares two strings either of which can be NULL.  Returns non-zero if they
+ * are equal, otherwise zero is returned. */
+static int
+same_str(const char a[], const char b[])
+{
+	if(a == NULL || b == NULL)
+	{
+		return (a == b);
+	}
+	return (strcmp(a, b) == 0);
+}
+
+/* Cancellation hook of the worker.  Returns non-zero if entry pointed to by
+ * arg isn't needed anymore. */
+static int
+is_cancelled(void *arg)
+{
+	const entry_t *const entry = arg;
+
+	pthread_mutex_lock(&cache_lock);
+	const int cancelled = entry->cancelled;
+	pthread_mutex_unlock(&cache_lock);
+
+	return cancelled;
+}
+
+/* Breaks output of a viewer into at most max_lines lines ignoring BOM.  Returns
+ * the lines. */
+static strlist_t
+split_into_lines(char text[], size_t len, int max_lines)
+{
+	strlist_t lines = {};
+	const char *const end = text + len;
+
+	if(len >= 3 && strncmp(text, "\xef\xbb\xbf", 3) == 0)
+	{
+		text += 3;
+	}
+
+	while(text < end && lines.nitems < max_lines)
+	{
+		char *eol = text;
+		while(eol < end && *eol != '\n' && *eol != '\r')
+		{
+			++eol;
+		}
+
+		/* Both DOS and old Mac line endings are recognized. */
+		char *next = eol + 1;
+		if(eol[0] == '\r' && next < end && next[0] == '\n')
+		{
+			++next;
+		}
+		*eol = '\0';
+
+		const int old_len = lines.nitems;
+		lines.nitems = add_to_string_array(&lines.items, lines.nitems, 1, text);
+		if(lines.nitems == old_len)
+		{
+			break;
+		}
+
+		text = next;
+	}
+
+	return lines;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,88 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UI__PREVIEW_CACHE_H__
+#define VIFM__UI__PREVIEW_CACHE_H__
+
+/* Runs viewers of files (or other producers of previews) in a background
+ * thread and keeps their output.
+ *
+ * Previews are identified by command or producer, directory in which it's run,
+ * previewed file (along with its timestamp) and size of preview area.  Each
+ * request replaces the queue of previews that are yet to be produced, a preview
+ * that's being produced is cancelled if it's not requested anymore.  Least
+ * recently used previews are evicted when the cache is full. */
+
+struct strlist_t;
+
+/* State of a preview. */
+typedef enum
+{
+	PCS_MISSING, /* Preview isn't available. */
+	PCS_PARTIAL, /* Preview is being produced and only some lines are known. */
+	PCS_READY,   /* Preview is complete. */
+}
+PcacheState;
+
+/* Reports lines of a preview produced so far, which are copied.  Returns
+ * non-zero if producing should stop as the preview isn't needed anymore. */
+typedef int (*pcache_report_f)(void *arg, const struct strlist_t *lines);
+
+/* Produces at most max_lines lines of preview of the path in background
+ * reporting progress via report(arg, lines) periodically. */
+typedef void (*pcache_producer_f)(const char path[], int max_lines,
+		struct strlist_t *lines, pcache_report_f report, void *arg);
+
+/* Identification of a preview. */
+typedef struct
+{
+	const char *cmd;            /* Expanded viewer command or NULL. */
+	pcache_producer_f producer; /* Used instead of a command if cmd is NULL. */
+	const char *dir;            /* Directory in which the command is run. */
+	const char *path;           /* Path to the previewed file. */
+	int w;                      /* Width of preview area. */
+	int h;                      /* Height of preview area. */
+}
+pcache_key_t;
+
+/* Requests previews in the order of their priority, usually the first one is
+ * displayed and the rest are prefetched.  At most max_lines lines of output
+ * are kept. */
+void pcache_request(const pcache_key_t keys[], int count, int max_lines);
+
+/* Looks up a preview and copies its lines, if any, to *lines, which should be
+ * freed by the caller.  Returns state of the preview. */
+PcacheState pcache_lookup(const pcache_key_t *key, struct strlist_t *lines);
+
+/* Checks whether some previews became ready since the last call.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int pcache_check_updates(void);
+
+/* Checks whether previews are being produced.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int pcache_is_busy(void);
+
+/* Retrieves file descriptor that becomes readable when some previews become
+ * ready or are extended.  Returns the descriptor or -1 if it's not available
+ * (yet). */
+int pcache_get_fd(void);
+
+#endif /* VIFM__UI__PREVIEW_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -24,10 +24,11 @@
 
 #include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE SEEK_SET fclose() fdopen() feof() fseek()
-                      tmpfile() */
+#include <stdio.h> /* FILE SEEK_SET fclose() fdopen() feof() fprintf()
+                      fseek() snprintf() tmpfile() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strcat() strlen() strncat() */
+#include <string.h> /* strcat() strdup() strlen() strncat() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
@@ -56,12 +57,17 @@
 #include "colors.h"
 #include "escape.h"
 #include "fileview.h"
+#include "preview_cache.h"
 #include "statusbar.h"
 #include "ui.h"
 
 /* Maximum number of lines used for preview. */
 enum { MAX_PREVIEW_LINES = 256 };
 
+/* Number of files after the current one in the direction of cursor movement
+ * whose previews are produced in advance. */
+enum { PREFETCH_COUNT = 3 };
+
 /* Cached information about a single file's preview. */
 typedef struct
 {
@@ -77,15 +83,27 @@ typedef struct
 }
 quickview_cache_t;
 
+/* Time budget of building directory tree in background in milliseconds,
+ * subdirectories aren't entered after it's exhausted. */
+enum { TREE_TIME_BUDGET = 1000 };
+
 /* State of directory tree print functions. */
 typedef struct
 {
-	FILE *fp;          /* Output preview stream. */
+	strlist_t lines;   /* Output preview lines. */
+	char *line;        /* Line that's being printed or NULL. */
+	size_t line_len;   /* Length of the line. */
 	int n;             /* Current line number (zero based). */
 	int ndirs;         /* Number of seen directories. */
 	int nfiles;        /* Number of seen files. */
 	int max;           /* Maximum line number. */
 	char prefix[4096]; /* Prefix character for each tree level. */
+
+	pcache_report_f report; /* Reports progress in background or NULL. */
+	void *report_arg;       /* Argument of the report function. */
+	struct timespec start;  /* When printing started in background. */
+	int cancelled;          /* Whether printing was cancelled. */
+	int out_of_time;        /* Whether time budget is exhausted. */
 }
 tree_print_state_t;
 
@@ -93,13 +111,30 @@ static void view_entry(const dir_entry_t *entry, const preview_area_t *parea,
 		quickview_cache_t *cache);
 static void view_file(const char path[], const preview_area_t *parea,
 		quickview_cache_t *cache);
+static int is_async_viewer(const char viewer[]);
+static int can_preview_async(void);
+static void view_file_async(const char path[], const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache);
+static void show_async_preview(const pcache_key_t *key, const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache);
+static int prefetch_previews(const preview_area_t *parea, pcache_key_t keys[],
+		int max_keys);
+static char * expand_for_preview(const char viewer[],
+		const preview_area_t *parea);
 static int is_cache_valid(const quickview_cache_t *cache, const char path[],
 		const char viewer[], const preview_area_t *parea);
-static void fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
-		const char viewer[], ViewerKind kind, const preview_area_t *parea);
+static void fill_cache(quickview_cache_t *cache, strlist_t lines,
+		const char path[], const char viewer[], ViewerKind kind,
+		const preview_area_t *parea);
 TSTATIC strlist_t read_lines(FILE *fp, int max_lines);
-static FILE * view_dir(const char path[], int max_lines);
+static void view_dir_async(const char path[], const preview_area_t *parea,
+		quickview_cache_t *cache);
+static void produce_dir_tree(const char path[], int max_lines,
+		strlist_t *lines, pcache_report_f report, void *arg);
+static int view_dir(const char path[], int max_lines, strlist_t *lines,
+		pcache_report_f report, void *arg);
 static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
+static int should_stop_tree(tree_print_state_t *s);
 static int enter_dir(tree_print_state_t *s, const char path[], int last);
 static int visit_file(tree_print_state_t *s, const char path[], int last);
 static int visit_link(tree_print_state_t *s, const char path[], int last,
@@ -111,6 +146,8 @@ static void set_prefix_char(tree_print_state_t *s, char c);
 static void print_tree_entry(tree_print_state_t *s, const char path[],
 		int end_line);
 static void print_entry_prefix(tree_print_state_t *s);
+static void print_str(tree_print_state_t *s, const char str[]);
+static void end_tree_line(tree_print_state_t *s);
 static void draw_lines(const strlist_t *lines, int wrapped,
 		const preview_area_t *parea, ViewerKind kind);
 static void write_message(const char msg[], const preview_area_t *parea);
@@ -309,17 +346,31 @@ view_file(const char path[], const preview_area_t *parea,
 		return;
 	}
 
+	if(is_async_viewer(viewer))
+	{
+		view_file_async(path, viewer, parea, cache);
+		return;
+	}
+
 	ViewerKind kind = VK_TEXTUAL;
 
-	FILE *fp;
+	strlist_t lines = {};
+	FILE *fp = NULL;
 	if(viewer == NULL && is_dir(path))
 	{
+		if(can_preview_async())
+		{
+			view_dir_async(path, parea, cache);
+			return;
+		}
+
 		ui_cancellation_reset();
 		ui_cancellation_enable();
-		fp = view_dir(path, ui_qv_height(other_view));
+		const int failed = view_dir(path, ui_qv_height(other_view), &lines, NULL,
+				NULL);
 		ui_cancellation_disable();
 
-		if(fp == NULL)
+		if(failed)
 		{
 			write_message("Failed to view directory", parea);
 			return;
@@ -346,12 +397,9 @@ view_file(const char path[], const preview_area_t *parea,
 			usleep(50000);
 		}
 
-		view_t *const curr = curr_view;
-		curr_view = parea->source;
-		curr_stats.preview_hint = parea;
-		fp = qv_execute_viewer(viewer);
-		curr_stats.preview_hint = NULL;
-		curr_view = curr;
+		char *const cmd = expand_for_preview(viewer, parea);
+		fp = read_cmd_output(cmd, 0);
+		free(cmd);
 
 		if(fp == NULL)
 		{
@@ -374,15 +422,182 @@ view_file(const char path[], const preview_area_t *parea,
 	const char *clear_cmd = (viewer != NULL) ? ma_get_clear_cmd(viewer) : NULL;
 	update_string(&curr_stats.preview.cleanup_cmd, clear_cmd);
 
-	fill_cache(cache, fp, path, viewer, kind, parea);
+	if(fp != NULL)
+	{
+		lines = read_lines(fp, MAX_PREVIEW_LINES);
+		fclose(fp);
+	}
 
-	fclose(fp);
+	fill_cache(cache, lines, path, viewer, kind, parea);
 
 	ui_cancellation_disable();
 
 	draw_lines(&cache->lines, cfg.wrap_quick_view, &cache->pa, cache->kind);
 }
 
+/* Checks whether output of the viewer should be produced in background.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_async_viewer(const char viewer[])
+{
+	/* Graphical previews need to be drawn right away and they aren't cached in
+	 * the same way. */
+	return can_preview_async()
+	    && !is_null_or_empty(viewer)
+	    && ft_viewer_kind(viewer) == VK_TEXTUAL;
+}
+
+/* Checks whether previews can be produced in background.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+can_preview_async(void)
+{
+#ifndef _WIN32
+	return 1;
+#else
+	/* Standard streams are redirected to run commands, which isn't possible to do
+	 * in background. */
+	return 0;
+#endif
+}
+
+/* Displays output of the viewer if it's ready, otherwise requests it and
+ * leaves the area empty until it's produced.  Previews of next files are
+ * requested as well. */
+static void
+view_file_async(const char path[], const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache)
+{
+	pcache_key_t keys[1 + PREFETCH_COUNT];
+	char *const cmd = expand_for_preview(viewer, parea);
+	const char *const dir = flist_get_dir(parea->source);
+
+	keys[0] = (pcache_key_t){ cmd, NULL, dir, path, parea->w, parea->h };
+	const int nkeys = 1 + prefetch_previews(parea, &keys[1], PREFETCH_COUNT);
+	pcache_request(keys, nkeys, MAX_PREVIEW_LINES);
+
+	show_async_preview(&keys[0], viewer, parea, cache);
+
+	int i;
+	for(i = 0; i < nkeys; ++i)
+	{
+		free((char *)keys[i].cmd);
+		if(i != 0)
+		{
+			free((char *)keys[i].path);
+		}
+	}
+}
+
+/* Displays tree of the directory if it's ready, otherwise requests it and
+ * displays its part that's ready. */
+static void
+view_dir_async(const char path[], const preview_area_t *parea,
+		quickview_cache_t *cache)
+{
+	const pcache_key_t key = {
+		NULL, &produce_dir_tree, path, path, parea->w, parea->h
+	};
+	pcache_request(&key, 1, parea->h);
+	show_async_preview(&key, NULL, parea, cache);
+}
+
+/* Draws a preview produced in background or its part. */
+static void
+show_async_preview(const pcache_key_t *key, const char viewer[],
+		const preview_area_t *parea, quickview_cache_t *cache)
+{
+	strlist_t lines;
+	const PcacheState state = pcache_lookup(key, &lines);
+
+	cleanup_for_text(parea);
+
+	if(state != PCS_READY)
+	{
+		/* Make sure the cache isn't used until the preview is ready. */
+		update_string(&cache->path, NULL);
+
+		draw_lines(&lines, cfg.wrap_quick_view, parea, VK_TEXTUAL);
+		free_string_array(lines.items, lines.nitems);
+		return;
+	}
+
+	if(viewer != NULL)
+	{
+		update_string(&curr_stats.preview.cleanup_cmd, ma_get_clear_cmd(viewer));
+	}
+
+	fill_cache(cache, lines, key->path, viewer, VK_TEXTUAL, parea);
+	draw_lines(&cache->lines, cfg.wrap_quick_view, &cache->pa, cache->kind);
+}
+
+/* Fills keys for previews of files that follow the current one in the
+ * direction in which the cursor moved last.  Returns number of filled keys. */
+static int
+prefetch_previews(const preview_area_t *parea, pcache_key_t keys[],
+		int max_keys)
+{
+	static const view_t *last_view;
+	static int last_pos;
+
+	view_t *const view = parea->source;
+	const int pos = view->list_pos;
+	const int step = (view == last_view && pos < last_pos) ? -1 : 1;
+	last_view = view;
+	last_pos = pos;
+
+	int nkeys = 0;
+	int i;
+	for(i = pos + step; i >= 0 && i < view->list_rows && nkeys < max_keys;
+			i += step)
+	{
+		const dir_entry_t *const entry = &view->dir_entry[i];
+		if(entry->type != FT_REG || fentry_is_fake(entry))
+		{
+			continue;
+		}
+
+		char path[PATH_MAX + 1];
+		get_full_path_of(entry, sizeof(path), path);
+
+		/* Detecting mime type of every prefetched file would slow down moving
+		 * cursor, so such files are skipped. */
+		int mime;
+		const char *const viewer = is_null_or_empty(curr_view->preview_prg)
+		                         ? ft_get_viewer_no_mime(path, &mime)
+		                         : curr_view->preview_prg;
+		if(!is_async_viewer(viewer))
+		{
+			continue;
+		}
+
+		/* Macros are expanded for the current file. */
+		view->list_pos = i;
+		char *const cmd = expand_for_preview(viewer, parea);
+		view->list_pos = pos;
+
+		keys[nkeys++] = (pcache_key_t){
+			cmd, NULL, flist_get_dir(view), strdup(path), parea->w, parea->h
+		};
+	}
+
+	return nkeys;
+}
+
+/* Expands viewer command for the file under cursor in the source view of the
+ * area.  Returns newly allocated string. */
+static char *
+expand_for_preview(const char viewer[], const preview_area_t *parea)
+{
+	view_t *const curr = curr_view;
+	curr_view = parea->source;
+	curr_stats.preview_hint = parea;
+	char *const cmd = expand_viewer_command(viewer);
+	curr_stats.preview_hint = NULL;
+	curr_view = curr;
+	return cmd;
+}
+
 /* Checks whether data in the cache is up to date with the file on disk.
  * Returns non-zero if so, otherwise zero is returned. */
 static int
@@ -415,9 +630,10 @@ is_cache_valid(const quickview_cache_t *cache, const char path[],
 	return 0;
 }
 
-/* Fills the cache data with file's contents. */
+/* Fills the cache data with file's contents.  Takes ownership of the
+ * lines. */
 static void
-fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
+fill_cache(quickview_cache_t *cache, strlist_t lines, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea)
 {
 	/* File monitor must always be initialized, because it's used below. */
@@ -429,7 +645,7 @@ fill_cache(quickview_cache_t *cache, FILE *fp, const char path[],
 	update_string(&cache->viewer, viewer);
 
 	free_string_array(cache->lines.items, cache->lines.nitems);
-	cache->lines = read_lines(fp, MAX_PREVIEW_LINES);
+	cache->lines = lines;
 
 	cache->pa = *parea;
 	cache->beg_x = getbegx(parea->view->win);
@@ -464,47 +680,87 @@ read_lines(FILE *fp, int max_lines)
 FILE *
 qv_view_dir(const char path[])
 {
-	return view_dir(path, INT_MAX);
-}
+	strlist_t lines;
+	if(view_dir(path, INT_MAX, &lines, NULL, NULL) != 0)
+	{
+		return NULL;
+	}
 
-/* Previews directory, actual preview is to be read from returned stream.
- * Returns the stream or NULL on error. */
-static FILE *
-view_dir(const char path[], int max_lines)
-{
 	FILE *fp = os_tmpfile();
-
 	if(fp != NULL)
 	{
-		tree_print_state_t s = {
-			.fp = fp,
-			.max = max_lines,
-		};
-
-		if(print_dir_tree(&s, path, 0) == 0 && s.n != 0)
-		{
-			/* Print summary only if we visited the whole subtree. */
-			fprintf(fp, "%s\n%d director%s, %d file%s",
-					ui_cancellation_requested() ? "(cancelled)\n" : "",
-					s.ndirs, (s.ndirs == 1) ? "y" : "ies",
-					s.nfiles, (s.nfiles == 1) ? "" : "s");
-		}
-		else if(ui_cancellation_requested())
+		int i;
+		for(i = 0; i < lines.nitems; ++i)
 		{
-			fputs("(cancelled)", fp);
+			fprintf(fp, "%s\n", lines.items[i]);
 		}
+		fseek(fp, 0, SEEK_SET);
+	}
 
-		if(s.n == 0)
-		{
-			fclose(fp);
-			fp = NULL;
-		}
-		else
+	free_string_array(lines.items, lines.nitems);
+	return fp;
+}
+
+/* Produces tree of the directory in background.  Matches pcache_producer_f
+ * type. */
+static void
+produce_dir_tree(const char path[], int max_lines, strlist_t *lines,
+		pcache_report_f report, void *arg)
+{
+	if(view_dir(path, max_lines, lines, report, arg) != 0)
+	{
+		char *items[] = { "Failed to view directory" };
+		lines->items = copy_string_array(items, 1);
+		lines->nitems = (lines->items == NULL ? 0 : 1);
+	}
+}
+
+/* Previews directory into *lines.  Without report function, UI cancellation is
+ * checked and there is no time limit, otherwise report function is called on
+ * every line.  Returns zero on success, otherwise non-zero is returned. */
+static int
+view_dir(const char path[], int max_lines, strlist_t *lines,
+		pcache_report_f report, void *arg)
+{
+	tree_print_state_t s = {
+		.max = max_lines,
+		.report = report,
+		.report_arg = arg,
+	};
+	(void)clock_gettime(CLOCK_MONOTONIC, &s.start);
+
+	if(print_dir_tree(&s, path, 0) == 0 && s.n != 0)
+	{
+		/* Print summary only if we visited the whole subtree. */
+		if(s.cancelled || s.out_of_time)
 		{
-			fseek(fp, 0, SEEK_SET);
+			print_str(&s, s.cancelled ? "(cancelled)" : "(incomplete)");
+			end_tree_line(&s);
 		}
+		end_tree_line(&s);
+
+		char summary[64];
+		snprintf(summary, sizeof(summary), "%d director%s, %d file%s", s.ndirs,
+				(s.ndirs == 1) ? "y" : "ies", s.nfiles, (s.nfiles == 1) ? "" : "s");
+		print_str(&s, summary);
+		end_tree_line(&s);
 	}
-	return fp;
+	else if(s.cancelled)
+	{
+		print_str(&s, "(cancelled)");
+		end_tree_line(&s);
+	}
+
+	free(s.line);
+
+	if(s.n == 0)
+	{
+		free_string_array(s.lines.items, s.lines.nitems);
+		return 1;
+	}
+
+	*lines = s.lines;
+	return 0;
 }
 
 /* Produces tree preview of the path.  Returns non-zero to request stopping of
@@ -531,7 +787,7 @@ print_dir_tree(tree_print_state_t *s, const char path[], int last)
 	}
 
 	reached_limit = 0;
-	for(i = 0; i < len && !reached_limit && !ui_cancellation_requested(); ++i)
+	for(i = 0; i < len && !reached_limit && !should_stop_tree(s); ++i)
 	{
 		char link_target[PATH_MAX + 1];
 		const int last_entry = (i == len - 1);
@@ -554,8 +810,9 @@ print_dir_tree(tree_print_state_t *s, const char path[], int last)
 			}
 		}
 		/* If is_dir_empty() returns non-zero than we know that it's directory and
-		 * no additional checks are needed. */
-		else if(!is_dir_empty(full_path))
+		 * no additional checks are needed.  Once out of time, only entries of
+		 * directories that are already listed are printed. */
+		else if(!s->out_of_time && !is_dir_empty(full_path))
 		{
 			if(last_entry)
 			{
@@ -580,6 +837,31 @@ print_dir_tree(tree_print_state_t *s, const char path[], int last)
 	return reached_limit;
 }
 
+/* Checks whether printing of the tree should stop and whether time budget has
+ * been exhausted.  Returns non-zero if printing should stop, otherwise zero is
+ * returned. */
+static int
+should_stop_tree(tree_print_state_t *s)
+{
+	if(s->report == NULL)
+	{
+		s->cancelled = ui_cancellation_requested();
+		return s->cancelled;
+	}
+
+	if(!s->out_of_time)
+	{
+		struct timespec now;
+		(void)clock_gettime(CLOCK_MONOTONIC, &now);
+		s->out_of_time = (now.tv_sec - s->start.tv_sec)*1000LL
+		               + (now.tv_nsec - s->start.tv_nsec)/1000000LL
+		               >= TREE_TIME_BUDGET;
+	}
+
+	s->cancelled = s->report(s->report_arg, &s->lines);
+	return s->cancelled;
+}
+
 /* Handles entering directory on directory tree traversal.  Returns non-zero to
  * request stopping of the traversal, otherwise zero is returned. */
 static int
@@ -617,9 +899,9 @@ visit_link(tree_print_state_t *s, const char path[], int last,
 {
 	set_prefix_char(s, last ? '`' : '|');
 	print_tree_entry(s, path, 0);
-	fputs(" -> ", s->fp);
-	fputs(target, s->fp);
-	fputc('\n', s->fp);
+	print_str(s, " -> ");
+	print_str(s, target);
+	end_tree_line(s);
 
 	return ++s->n >= s->max;
 }
@@ -664,14 +946,14 @@ static void
 print_tree_entry(tree_print_state_t *s, const char path[], int end_line)
 {
 	print_entry_prefix(s);
-	fputs(get_last_path_component(path), s->fp);
+	print_str(s, get_last_path_component(path));
 	if(is_dir(path) && !ends_with_slash(path))
 	{
-		fputc('/', s->fp);
+		print_str(s, "/");
 	}
 	if(end_line)
 	{
-		fputc('\n', s->fp);
+		end_tree_line(s);
 	}
 }
 
@@ -684,12 +966,39 @@ print_entry_prefix(tree_print_state_t *s)
 	/* Expand " |`" into "    |   `-- ". */
 	while(p[0] != '\0')
 	{
-		fputc(p[0], s->fp);
-		fputs(p[1] == '\0' ? "-- " : "   ", s->fp);
+		const char c[] = { p[0], '\0' };
+		print_str(s, c);
+		print_str(s, p[1] == '\0' ? "-- " : "   ");
 		++p;
 	}
 }
 
+/* Appends string to the current line of the tree. */
+static void
+print_str(tree_print_state_t *s, const char str[])
+{
+	if(s->line == NULL)
+	{
+		s->line_len = 0U;
+	}
+	(void)strappend(&s->line, &s->line_len, str);
+}
+
+/* Finishes current line of the tree. */
+static void
+end_tree_line(tree_print_state_t *s)
+{
+	char *const line = (s->line == NULL ? strdup("") : s->line);
+	const int old_len = s->lines.nitems;
+	s->lines.nitems = put_into_string_array(&s->lines.items, s->lines.nitems,
+			line);
+	if(s->lines.nitems == old_len)
+	{
+		free(line);
+	}
+	s->line = NULL;
+}
+
 /* Displays lines in the other pane.  The wrapped parameter determines whether
  * lines should be wrapped. */
 static void
@@ -916,6 +1225,37 @@ qv_get_path_to_explore(const dir_entry_t *entry, char buf[], size_t buf_len)
 	get_full_path_of(entry, buf_len, buf);
 }
 
+void
+qv_process_async(void)
+{
+	if(!pcache_check_updates())
+	{
+		return;
+	}
+
+	if(curr_stats.preview.on &&
+			(vle_mode_is(NORMAL_MODE) || vle_mode_is(VISUAL_MODE)))
+	{
+		qv_draw(curr_view);
+	}
+	else
+	{
+		stats_redraw_later();
+	}
+}
+
+int
+qv_async_pending(void)
+{
+	return pcache_is_busy();
+}
+
+int
+qv_async_fd(void)
+{
+	return pcache_get_fd();
+}
+
 void
 qv_ui_updated(void)
 {
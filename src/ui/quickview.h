@@ -86,6 +86,17 @@ FILE * qv_view_dir(const char path[]);
 void qv_get_path_to_explore(const struct dir_entry_t *entry, char buf[],
 		size_t buf_len);
 
+/* Draws previews that were produced in background since the last call. */
+void qv_process_async(void);
+
+/* Checks whether some previews are being produced in background.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int qv_async_pending(void);
+
+/* Retrieves file descriptor that becomes readable when previews produced in
+ * background are updated.  Returns the descriptor or -1. */
+int qv_async_fd(void);
+
 /* Informs this unit that it's data was probably erased from the screen. */
 void qv_ui_updated(void);
 
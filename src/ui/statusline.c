@@ -24,8 +24,8 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* RAND_MAX free() rand() */
-#include <string.h> /* strcat() strdup() strlen() */
+#include <stdlib.h> /* RAND_MAX free() malloc() rand() */
+#include <string.h> /* memcpy() strcat() strchr() strdup() strlen() */
 #include <time.h> /* time() */
 #include <unistd.h>
 
@@ -480,7 +480,8 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 					 * TODO: implement the way to escape it, so that the expr may contain
 					 * closing brackets */
 					const char *e = strchr(*format, '}');
-					char *expr = NULL, *resstr = NULL;
+					const size_t expr_len = (e == NULL ? 0 : e - *format);
+					char *expr, *expr_copy = NULL, *resstr = NULL;
 					var_t res = var_false();
 					ParsingErrors parsing_error;
 
@@ -492,13 +493,28 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 						break;
 					}
 
-					/* Create a NULL-terminated copy of the given expr.
-					 * TODO: we could temporarily use buf for that, to avoid extra
-					 * allocation, but explicitly named variable reads better. */
-					expr = calloc(e - (*format) + 1 /* NUL-term */, 1);
-					memcpy(expr, *format, e - (*format));
+					/* Create a NUL-terminated copy of the given expr.  buf is used for
+					 * that to avoid allocations on every redraw, its contents isn't
+					 * needed after parsing. */
+					if(expr_len < sizeof(buf))
+					{
+						expr = buf;
+					}
+					else
+					{
+						expr = expr_copy = malloc(expr_len + 1 /* NUL-term */);
+					}
+					if(expr == NULL)
+					{
+						ok = 0;
+						break;
+					}
+					memcpy(expr, *format, expr_len);
+					expr[expr_len] = '\0';
 
-					/* Try to parse expr, and convert the res to string if succeed. */
+					/* Try to parse expr, and convert the res to string if succeed.
+					 * Parsed expressions are cached by the parser, so this is cheap for
+					 * expressions that were already seen. */
 					parsing_error = parse(expr, 0, &res);
 					if(parsing_error == PE_NO_ERROR)
 					{
@@ -516,7 +532,7 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 
 					var_free(res);
 					free(resstr);
-					free(expr);
+					free(expr_copy);
 
 					*format = e + 1 /* closing bracket */;
 				}
@@ -638,6 +638,10 @@ update_screen(UpdateType update_kind)
 
 	update_attributes();
 
+	/* Appearance might have changed in a way that isn't tracked by file views. */
+	fview_damage(&lwin);
+	fview_damage(&rwin);
+
 	if(cfg.side_borders_visible)
 	{
 		clear_border(lborder);
@@ -1100,6 +1104,10 @@ show_progress(const char msg[], int period)
 void
 redraw_lists(void)
 {
+	/* This is used on changing options that affect appearance of file lists. */
+	fview_damage(curr_view);
+	fview_damage(other_view);
+
 	redraw_current_view();
 	if(curr_stats.number_of_windows == 2)
 	{
@@ -1655,16 +1663,19 @@ ui_view_reset_decor_cache(const view_t *view)
 	for(i = 0; i < view->list_rows; ++i)
 	{
 		view->dir_entry[i].name_dec_num = -1;
+		view->dir_entry[i].name_width = 0;
 	}
 
 	for(i = 0; i < view->left_column.entries.nentries; ++i)
 	{
 		view->left_column.entries.entries[i].name_dec_num = -1;
+		view->left_column.entries.entries[i].name_width = 0;
 	}
 
 	for(i = 0; i < view->right_column.entries.nentries; ++i)
 	{
 		view->right_column.entries.entries[i].name_dec_num = -1;
+		view->right_column.entries.entries[i].name_width = 0;
 	}
 }
 
@@ -2273,6 +2284,7 @@ ui_view_erase(view_t *view)
 	col_attr_t col = ui_get_win_color(view, cs);
 	ui_set_bg(view->win, &col, -1);
 	werase(view->win);
+	fview_damage(view);
 }
 
 col_attr_t
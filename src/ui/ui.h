@@ -33,6 +33,7 @@
 
 #include "../compat/fs_limits.h"
 #include "../compat/pthread.h"
+#include "../utils/change_poller.h"
 #include "../utils/filter.h"
 #include "../utils/fswatch.h"
 #include "../status.h"
@@ -222,6 +223,8 @@ struct dir_entry_t
 	                     INT_MAX signifies absence of a match. */
 	int name_dec_num; /* File decoration parameters cache (initially -1).  The
 	                     value is shifted by one, 0 means type decoration. */
+	int name_width;   /* Screen width of name along with its decorations cache.
+	                     The value is shifted by one, 0 means it's unknown. */
 
 	int child_count; /* Number of child entries (all, not just direct). */
 	int child_pos;   /* Position of this entry in among children of its parent.
@@ -238,6 +241,8 @@ struct dir_entry_t
 	unsigned int marked : 1;       /* Whether file should be processed. */
 	unsigned int temporary : 1;    /* Whether this is temporary node. */
 	unsigned int dir_link : 1;     /* Whether this is symlink to a directory. */
+	unsigned int folded : 1;       /* Whether this is a collapsed directory of a
+	                                  tree, whose children weren't loaded. */
 };
 
 /* List of entries bundled with its size. */
@@ -278,6 +283,15 @@ struct cv_data_t
 	/* List of paths that should be ignored (including all nested paths).  Used
 	 * by tree-view. */
 	struct trie_t *excluded_paths;
+	/* Paths of tree-view directories whose folding state was set explicitly.
+	 * Associated data is non-NULL for folded directories. */
+	struct trie_t *folded_paths;
+	/* Maximum depth of tree-view, directories at this level are folded by
+	 * default. */
+	int tree_depth;
+	/* Listings of directories of tree-view which are reused on reloads for
+	 * directories that didn't change. */
+	struct dir_cache_t *tree_cache;
 
 	/* Names of files in custom view while it's being composed.  Used for
 	 * duplicate elimination during construction of custom list. */
@@ -313,12 +327,12 @@ struct local_filter_t
 	size_t poshist_len;
 };
 
-/* Cached file list coupled with a watcher. */
+/* File list built from cached listing of a directory. */
 typedef struct
 {
-	fswatch_t *watch;  /* Watcher for the path. */
-	char *dir;         /* Path to watched directory. */
-	entries_t entries; /* Cached list of entries. */
+	char *dir;             /* Path to the directory. */
+	unsigned long long id; /* Identifier of the listing or zero. */
+	entries_t entries;     /* Cached list of entries. */
 }
 cached_entries_t;
 
@@ -352,6 +366,11 @@ struct view_t
 	/* Monitor that checks for directory changes. */
 	fswatch_t *watch;
 	char watched_dir[PATH_MAX + 1];
+	/* Poller of timestamps for views that aren't watched (slow file systems and
+	 * custom views).  NULL if not started yet. */
+	change_poller_t *poller;
+	/* Whether poller needs to be given new set of paths. */
+	int poller_outdated;
 
 	char last_dir[PATH_MAX + 1];
 
@@ -373,6 +392,13 @@ struct view_t
 	int selected_files; /* Number of currently selected files. */
 	dir_entry_t *dir_entry; /* Must be handled via dynarray unit. */
 
+	/* Hash table of positions in dir_entry by names of entries, which is built
+	 * on demand (see flist_pos.c).  Empty slots contain -1. */
+	int *name_index;
+	int name_index_size;                    /* Number of slots, power of two. */
+	const dir_entry_t *name_index_entries; /* dir_entry of the index. */
+	int name_index_rows;                   /* list_rows of the index. */
+
 	/* Last position that was displayed on the screen. */
 	char *last_curr_file; /* To account for file replacement. */
 	int last_seen_pos;    /* To account for movement. */
@@ -615,7 +641,8 @@ void format_entry_name(const dir_entry_t *entry, NameFormat fmt, size_t buf_len,
 void ui_get_decors(const dir_entry_t *entry, const char **prefix,
 		const char **suffix);
 
-/* Resets cached indexes for name-dependent type_decs. */
+/* Resets cached indexes for name-dependent type_decs along with widths of
+ * decorated names. */
 void ui_view_reset_decor_cache(const view_t *view);
 
 /* Moves cursor to position specified by coordinates checking result of the
@@ -0,0 +1,596 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "change_poller.h"
+
+#ifndef _WIN32
+#include <fcntl.h> /* FD_CLOEXEC F_GETFL F_SETFD F_SETFL O_NONBLOCK fcntl() */
+#include <unistd.h> /* close() pipe() read() write() */
+#endif
+
+#include <errno.h> /* ETIMEDOUT */
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() qsort() */
+#include <string.h> /* strcmp() strdup() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
+
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "filemon.h"
+#include "macros.h"
+#include "utils.h"
+
+/* Maximum number of pollers that can exist at the same time.  This bounds
+ * number of threads that can be stuck on unresponsive file systems. */
+#define MAX_POLLERS 8
+
+/* Maximum number of paths examined at once. */
+#define BATCH_SIZE 64
+
+/* Minimal delay between batches in milliseconds to not flood file system with
+ * requests when there are many of them. */
+#define MIN_BATCH_DELAY 50
+
+/* State of a single path. */
+typedef struct
+{
+	char *path;    /* Path to examine. */
+	filemon_t mon; /* Last known timestamp. */
+}
+entry_t;
+
+/* Poller state.  Fields above the mutex are owned by the thread. */
+struct change_poller_t
+{
+	entry_t *entries;   /* Unique paths. */
+	int count;          /* Number of entries. */
+	int min_interval;   /* Minimal interval between passes in milliseconds. */
+	int max_interval;   /* Maximal interval between passes in milliseconds. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t cond;  /* Signals stop request or update of paths. */
+	int stopped;          /* Whether the thread should exit. */
+	int changed;          /* Whether change wasn't yet reported. */
+	int fds[2];           /* Notification pipe or pair of -1. */
+	int updated;          /* Whether new_* fields hold paths to switch to. */
+	entry_t *new_entries; /* New set of unique paths. */
+	int new_count;        /* Number of new entries. */
+	char *new_slowfs;     /* Specification of paths to skip or NULL. */
+};
+
+static int make_entries(char *paths[], int npaths, entry_t **entries,
+		int *count);
+static int sort_predicate(const void *a, const void *b);
+static void * poller_thread(void *arg);
+static void take_new_paths(change_poller_t *poller, char **slowfs);
+static void remember_paths(change_poller_t *poller, const char slowfs[]);
+static int wait_for(change_poller_t *poller, int ms);
+static int check_batch(change_poller_t *poller, int *next);
+static int update_entry(entry_t *entry);
+static void report_change(change_poller_t *poller);
+static void drain_pipe(change_poller_t *poller);
+static void free_poller(change_poller_t *poller);
+static void free_entries(entry_t *entries, int count);
+static int acquire_slot(void);
+static void release_slot(void);
+static void make_pipe(int fds[2]);
+static void close_pipe(int fds[2]);
+
+/* Protects npollers. */
+static pthread_mutex_t pollers_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Number of existing pollers including those that are being stopped. */
+static int npollers;
+
+change_poller_t *
+change_poller_create(int min_interval, int max_interval)
+{
+	pthread_t id;
+	pthread_attr_t attr;
+	change_poller_t *poller;
+
+	if(acquire_slot() != 0)
+	{
+		return NULL;
+	}
+
+	poller = calloc(1, sizeof(*poller));
+	if(poller == NULL)
+	{
+		release_slot();
+		return NULL;
+	}
+
+	poller->min_interval = MAX(min_interval, 1);
+	poller->max_interval = MAX(max_interval, poller->min_interval);
+	poller->fds[0] = -1;
+	poller->fds[1] = -1;
+	pthread_mutex_init(&poller->lock, NULL);
+	pthread_cond_init(&poller->cond, NULL);
+
+	make_pipe(poller->fds);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(pthread_create(&id, &attr, &poller_thread, poller) != 0)
+	{
+		pthread_attr_destroy(&attr);
+		free_poller(poller);
+		return NULL;
+	}
+	pthread_attr_destroy(&attr);
+
+	return poller;
+}
+
+void
+change_poller_free(change_poller_t *poller)
+{
+	if(poller == NULL)
+	{
+		return;
+	}
+
+	/* The thread might be blocked on a slow file system, so instead of waiting
+	 * for it let it free the poller on its own. */
+	pthread_mutex_lock(&poller->lock);
+	poller->stopped = 1;
+	close_pipe(poller->fds);
+	pthread_cond_signal(&poller->cond);
+	pthread_mutex_unlock(&poller->lock);
+}
+
+int
+change_poller_set_paths(change_poller_t *poller, char *paths[], int npaths,
+		const char slowfs[])
+{
+	entry_t *entries;
+	int count;
+	char *slowfs_copy = NULL;
+	int error = make_entries(paths, npaths, &entries, &count);
+
+	if(error == 0 && slowfs != NULL)
+	{
+		slowfs_copy = strdup(slowfs);
+		error = (slowfs_copy == NULL);
+	}
+
+	if(error)
+	{
+		free_entries(entries, count);
+		entries = NULL;
+		count = 0;
+	}
+
+	pthread_mutex_lock(&poller->lock);
+	if(poller->updated)
+	{
+		free_entries(poller->new_entries, poller->new_count);
+		free(poller->new_slowfs);
+	}
+	poller->updated = 1;
+	poller->new_entries = entries;
+	poller->new_count = count;
+	poller->new_slowfs = slowfs_copy;
+	poller->changed = 0;
+	drain_pipe(poller);
+	pthread_cond_signal(&poller->cond);
+	pthread_mutex_unlock(&poller->lock);
+
+	return error;
+}
+
+int
+change_poller_changed(change_poller_t *poller)
+{
+	int changed;
+
+	pthread_mutex_lock(&poller->lock);
+	changed = poller->changed;
+	poller->changed = 0;
+	if(changed)
+	{
+		drain_pipe(poller);
+	}
+	pthread_mutex_unlock(&poller->lock);
+
+	return changed;
+}
+
+int
+change_poller_get_fd(const change_poller_t *poller)
+{
+	/* The descriptor is changed only on freeing the poller, so no locking. */
+	return poller->fds[0];
+}
+
+/* Makes sorted array of unique paths.  Always sets *entries and *count.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+make_entries(char *paths[], int npaths, entry_t **entries, int *count)
+{
+	int i;
+	char **const sorted = reallocarray(NULL, npaths, sizeof(*sorted));
+
+	*count = 0;
+	*entries = reallocarray(NULL, npaths, sizeof(**entries));
+	if(npaths != 0 && (sorted == NULL || *entries == NULL))
+	{
+		free(sorted);
+		return 1;
+	}
+
+	/* Sorting groups duplicates together, which makes removing them trivial. */
+	for(i = 0; i < npaths; ++i)
+	{
+		sorted[i] = paths[i];
+	}
+	qsort(sorted, npaths, sizeof(*sorted), &sort_predicate);
+
+	for(i = 0; i < npaths; ++i)
+	{
+		entry_t *entry;
+
+		if(i != 0 && strcmp(sorted[i], sorted[i - 1]) == 0)
+		{
+			continue;
+		}
+
+		entry = &(*entries)[*count];
+		entry->path = strdup(sorted[i]);
+		if(entry->path == NULL)
+		{
+			free(sorted);
+			return 1;
+		}
+		entry->mon.type = FMT_UNINITIALIZED;
+		++*count;
+	}
+
+	free(sorted);
+	return 0;
+}
+
+/* Sorting function for qsort() that orders strings. */
+static int
+sort_predicate(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Entry point of the background thread.  Returns NULL. */
+static void *
+poller_thread(void *arg)
+{
+	change_poller_t *const poller = arg;
+	int interval = poller->min_interval;
+	int pass_changed = 0;
+	int next = 0;
+
+	pthread_mutex_lock(&poller->lock);
+	while(!poller->stopped)
+	{
+		int nbatches;
+		int changed;
+
+		if(poller->updated)
+		{
+			char *slowfs;
+			take_new_paths(poller, &slowfs);
+
+			pthread_mutex_unlock(&poller->lock);
+			remember_paths(poller, slowfs);
+			free(slowfs);
+			pthread_mutex_lock(&poller->lock);
+
+			interval = poller->min_interval;
+			pass_changed = 0;
+			next = 0;
+			continue;
+		}
+
+		nbatches = MAX(DIV_ROUND_UP(poller->count, BATCH_SIZE), 1);
+		if(wait_for(poller, MAX(interval/nbatches,
+						MIN(interval, MIN_BATCH_DELAY))) != 0)
+		{
+			continue;
+		}
+
+		pthread_mutex_unlock(&poller->lock);
+		changed = check_batch(poller, &next);
+		pthread_mutex_lock(&poller->lock);
+
+		/* Changes of paths that were replaced in the meantime are of no
+		 * interest. */
+		if(changed && !poller->updated)
+		{
+			report_change(poller);
+			interval = poller->min_interval;
+			pass_changed = 1;
+		}
+
+		/* Nothing happens, so make checks less frequent. */
+		if(next == 0)
+		{
+			if(!pass_changed)
+			{
+				interval = MIN(interval*2, poller->max_interval);
+			}
+			pass_changed = 0;
+		}
+	}
+	pthread_mutex_unlock(&poller->lock);
+
+	free_poller(poller);
+	return NULL;
+}
+
+/* Replaces current set of paths with the new one.  Must be called with the lock
+ * held.  Sets *slowfs to specification of paths to skip, which should be
+ * freed by the caller. */
+static void
+take_new_paths(change_poller_t *poller, char **slowfs)
+{
+	free_entries(poller->entries, poller->count);
+	poller->entries = poller->new_entries;
+	poller->count = poller->new_count;
+	*slowfs = poller->new_slowfs;
+
+	poller->updated = 0;
+	poller->new_entries = NULL;
+	poller->new_count = 0;
+	poller->new_slowfs = NULL;
+}
+
+/* Drops paths that are on slow file systems and collects timestamps of the
+ * rest.  This is done without waiting to not miss changes that happen shortly
+ * after paths are set. */
+static void
+remember_paths(change_poller_t *poller, const char slowfs[])
+{
+	int i;
+	int count = 0;
+
+	for(i = 0; i < poller->count; ++i)
+	{
+		entry_t *const entry = &poller->entries[i];
+		if(slowfs != NULL && is_on_slow_fs(entry->path, slowfs))
+		{
+			free(entry->path);
+			continue;
+		}
+
+		(void)update_entry(entry);
+		poller->entries[count++] = *entry;
+	}
+	poller->count = count;
+}
+
+/* Waits for the specified number of milliseconds.  Must be called with the
+ * lock held.  Returns non-zero if the thread should stop or switch to new set
+ * of paths, otherwise zero is returned. */
+static int
+wait_for(change_poller_t *poller, int ms)
+{
+	struct timespec deadline;
+
+	(void)clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ms/1000;
+	deadline.tv_nsec += (ms%1000)*1000000L;
+	if(deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	while(!poller->stopped && !poller->updated)
+	{
+		if(pthread_cond_timedwait(&poller->cond, &poller->lock,
+					&deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+
+	return poller->stopped || poller->updated;
+}
+
+/* Examines next batch of paths starting at *next and advances it wrapping
+ * around at the end.  Returns non-zero if a change was detected, otherwise zero
+ * is returned. */
+static int
+check_batch(change_poller_t *poller, int *next)
+{
+	int changed = 0;
+	const int end = MIN(*next + BATCH_SIZE, poller->count);
+
+	for(; *next < end; ++*next)
+	{
+		changed |= update_entry(&poller->entries[*next]);
+	}
+
+	if(*next >= poller->count)
+	{
+		*next = 0;
+	}
+	return changed;
+}
+
+/* Updates timestamp of the entry.  Returns non-zero if it has changed,
+ * otherwise zero is returned. */
+static int
+update_entry(entry_t *entry)
+{
+	/* Change time is updated along with modification time, but also reacts on
+	 * changes of attributes.  On Windows it's creation time though. */
+#ifndef _WIN32
+	const FileMonType type = FMT_CHANGED;
+#else
+	const FileMonType type = FMT_MODIFIED;
+#endif
+
+	filemon_t mon;
+	int changed;
+
+	if(filemon_from_file(entry->path, type, &mon) != 0)
+	{
+		/* Disappearance of a path is a change, but its continued absence isn't. */
+		changed = (entry->mon.type != FMT_UNINITIALIZED);
+		entry->mon.type = FMT_UNINITIALIZED;
+		return changed;
+	}
+
+	/* Appearance of a path is also a change. */
+	changed = !filemon_equal(&entry->mon, &mon);
+	filemon_assign(&entry->mon, &mon);
+	return changed;
+}
+
+/* Records that a change has happened and notifies about it.  Must be called
+ * with the lock held. */
+static void
+report_change(change_poller_t *poller)
+{
+	if(poller->changed)
+	{
+		return;
+	}
+
+	poller->changed = 1;
+#ifndef _WIN32
+	if(poller->fds[1] != -1)
+	{
+		(void)write(poller->fds[1], "x", 1);
+	}
+#endif
+}
+
+/* Empties notification pipe.  Must be called with the lock held. */
+static void
+drain_pipe(change_poller_t *poller)
+{
+#ifndef _WIN32
+	char buf[64];
+	if(poller->fds[0] == -1)
+	{
+		return;
+	}
+
+	while(read(poller->fds[0], buf, sizeof(buf)) > 0)
+	{
+		/* Do nothing. */
+	}
+#endif
+}
+
+/* Frees all resources of the poller. */
+static void
+free_poller(change_poller_t *poller)
+{
+	free_entries(poller->entries, poller->count);
+	free_entries(poller->new_entries, poller->new_count);
+	free(poller->new_slowfs);
+
+	close_pipe(poller->fds);
+	pthread_cond_destroy(&poller->cond);
+	pthread_mutex_destroy(&poller->lock);
+	free(poller);
+
+	release_slot();
+}
+
+/* Frees array of entries.  entries can be NULL. */
+static void
+free_entries(entry_t *entries, int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		free(entries[i].path);
+	}
+	free(entries);
+}
+
+/* Accounts for a new poller.  Returns zero on success and non-zero if there are
+ * too many of them. */
+static int
+acquire_slot(void)
+{
+	int error = 1;
+
+	pthread_mutex_lock(&pollers_lock);
+	if(npollers < MAX_POLLERS)
+	{
+		++npollers;
+		error = 0;
+	}
+	pthread_mutex_unlock(&pollers_lock);
+
+	return error;
+}
+
+/* Accounts for destruction of a poller. */
+static void
+release_slot(void)
+{
+	pthread_mutex_lock(&pollers_lock);
+	--npollers;
+	pthread_mutex_unlock(&pollers_lock);
+}
+
+/* Creates non-blocking pipe for notifications.  Leaves descriptors at -1 on
+ * failure or if it's not supported. */
+static void
+make_pipe(int fds[2])
+{
+#ifndef _WIN32
+	int i;
+
+	if(pipe(fds) != 0)
+	{
+		fds[0] = -1;
+		fds[1] = -1;
+		return;
+	}
+
+	for(i = 0; i < 2; ++i)
+	{
+		(void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		(void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+}
+
+/* Closes descriptors of the pipe that are open and resets them to -1. */
+static void
+close_pipe(int fds[2])
+{
+#ifndef _WIN32
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		if(fds[i] != -1)
+		{
+			close(fds[i]);
+			fds[i] = -1;
+		}
+	}
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,65 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__CHANGE_POLLER_H__
+#define VIFM__UTILS__CHANGE_POLLER_H__
+
+/* Detects changes of a set of directories by periodically examining their
+ * timestamps in a background thread.  Meant for cases when notifications
+ * aren't available or are too expensive (e.g., network file systems).
+ *
+ * Each poller has a thread of its own that lives until the poller is freed and
+ * the set of paths can be replaced without restarting it.  Number of pollers is
+ * limited, because threads can get stuck on unresponsive file systems.
+ *
+ * Large sets are processed in batches spread over the interval, which starts
+ * at its minimum and is doubled after every full pass over the set that
+ * detected nothing up to its maximum.  Any change resets the interval. */
+
+/* Declaration of opaque poller type. */
+typedef struct change_poller_t change_poller_t;
+
+/* Creates poller with an empty set of paths and starts it.  Intervals are in
+ * milliseconds.  Returns NULL on error or if there are too many pollers. */
+change_poller_t * change_poller_create(int min_interval, int max_interval);
+
+/* Stops the poller and frees it.  Doesn't wait for checks in progress to
+ * finish.  poller can be NULL. */
+void change_poller_free(change_poller_t *poller);
+
+/* Replaces set of paths of the poller (duplicates are allowed).  Paths on file
+ * systems matched by slowfs (in the format of 'slowfs' option) are skipped,
+ * slowfs can be NULL.  Changes that weren't reported yet are dropped and
+ * timestamps are remembered anew.  Returns zero on success, otherwise non-zero
+ * is returned and the poller examines no paths. */
+int change_poller_set_paths(change_poller_t *poller, char *paths[], int npaths,
+		const char slowfs[]);
+
+/* Checks whether any of the paths has changed since they were set or since the
+ * last call of this function.  Returns non-zero if so, otherwise zero is
+ * returned. */
+int change_poller_changed(change_poller_t *poller);
+
+/* Retrieves descriptor that becomes readable on detecting a change.  Returns
+ * the descriptor or -1 if there is none. */
+int change_poller_get_fd(const change_poller_t *poller);
+
+#endif /* VIFM__UTILS__CHANGE_POLLER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,345 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dir_cache.h"
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memset() strdup() */
+
+#include "dir_lister.h"
+#include "trie.h"
+#include "watch_set.h"
+
+/* Cached information about a single directory. */
+typedef struct entry_t
+{
+	char *path;            /* Path to the directory. */
+	int watch;             /* Identifier of the watch or -1. */
+	int watch_lost;        /* Whether the watch doesn't work anymore. */
+	int dirty;             /* Whether directory has changed since last request. */
+	int pass;              /* Last pass during which directory was requested. */
+	int has_listing;       /* Whether listing field is set. */
+	dir_listing_t listing; /* Listing of the directory. */
+	struct entry_t *next;  /* Next entry in the list. */
+}
+entry_t;
+
+/* Cache state. */
+struct dir_cache_t
+{
+	trie_t *entries;      /* Maps paths to entries. */
+	entry_t *list;        /* List of all entries. */
+	int pass;             /* Number of the current pass. */
+	watch_set_t *watches; /* Watches of directories. */
+	entry_t **by_watch;   /* Maps identifiers of watches to entries. */
+	int by_watch_size;    /* Number of elements in by_watch. */
+	int nwatches;         /* Number of watched directories. */
+	int max_watches;      /* Limit on number of watched directories. */
+};
+
+static entry_t * add_entry(dir_cache_t *cache, const char path[]);
+static void free_entry(entry_t *entry);
+static void drop_listing(entry_t *entry);
+static void on_dir_changed(int id, int gone, void *arg);
+static void watch_dir(dir_cache_t *cache, entry_t *entry);
+static void unwatch_dir(dir_cache_t *cache, entry_t *entry);
+
+dir_cache_t *
+dir_cache_create(int max_watches)
+{
+	dir_cache_t *const cache = calloc(1, sizeof(*cache));
+	if(cache == NULL)
+	{
+		return NULL;
+	}
+
+	cache->entries = trie_create();
+	if(cache->entries == NULL)
+	{
+		free(cache);
+		return NULL;
+	}
+
+	/* Sizes of files are part of listings, so writes must invalidate them. */
+	cache->watches = watch_set_create(1);
+	if(cache->watches == NULL)
+	{
+		trie_free(cache->entries);
+		free(cache);
+		return NULL;
+	}
+
+	cache->max_watches = (max_watches < 0 ? 0 : max_watches);
+	return cache;
+}
+
+void
+dir_cache_free(dir_cache_t *cache)
+{
+	if(cache == NULL)
+	{
+		return;
+	}
+
+	while(cache->list != NULL)
+	{
+		entry_t *const next = cache->list->next;
+		free_entry(cache->list);
+		cache->list = next;
+	}
+
+	watch_set_free(cache->watches);
+	trie_free(cache->entries);
+	free(cache->by_watch);
+	free(cache);
+}
+
+void
+dir_cache_start_pass(dir_cache_t *cache)
+{
+	++cache->pass;
+	watch_set_check(cache->watches, &on_dir_changed, cache);
+}
+
+void
+dir_cache_finish_pass(dir_cache_t *cache)
+{
+	entry_t **link = &cache->list;
+	while(*link != NULL)
+	{
+		entry_t *const entry = *link;
+
+		if(entry->pass != cache->pass)
+		{
+			*link = entry->next;
+			(void)trie_set(cache->entries, entry->path, NULL);
+			unwatch_dir(cache, entry);
+			free_entry(entry);
+			continue;
+		}
+
+		/* Listings that can't be reused only waste memory. */
+		if(entry->dirty || entry->watch == -1)
+		{
+			drop_listing(entry);
+		}
+
+		link = &entry->next;
+	}
+}
+
+const dir_listing_t *
+dir_cache_get(dir_cache_t *cache, const char path[])
+{
+	void *data;
+	entry_t *entry;
+
+	if(trie_get(cache->entries, path, &data) == 0 && data != NULL)
+	{
+		entry = data;
+
+		/* Don't invalidate listing that was already handed out. */
+		if(entry->pass == cache->pass)
+		{
+			return (entry->has_listing ? &entry->listing : NULL);
+		}
+
+		entry->pass = cache->pass;
+		if(!entry->dirty && entry->watch != -1 && entry->has_listing)
+		{
+			return &entry->listing;
+		}
+
+		drop_listing(entry);
+	}
+	else
+	{
+		entry = add_entry(cache, path);
+		if(entry == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	/* Watch of removed directory can't be reused even if there is a new
+	 * directory at the same path. */
+	if(entry->watch_lost)
+	{
+		unwatch_dir(cache, entry);
+	}
+
+	/* Changes that happen after this point will invalidate the listing. */
+	entry->dirty = 0;
+	if(entry->watch == -1)
+	{
+		watch_dir(cache, entry);
+	}
+	return NULL;
+}
+
+const dir_listing_t *
+dir_cache_put(dir_cache_t *cache, const char path[], dir_listing_t *listing)
+{
+	void *data;
+	entry_t *entry;
+
+	if(trie_get(cache->entries, path, &data) != 0 || data == NULL)
+	{
+		dir_listing_free(listing);
+		return NULL;
+	}
+
+	entry = data;
+	if(entry->has_listing)
+	{
+		dir_listing_free(listing);
+		return &entry->listing;
+	}
+
+	entry->listing = *listing;
+	entry->has_listing = 1;
+	return &entry->listing;
+}
+
+/* Creates new entry for the path and registers it in the cache.  Returns the
+ * entry or NULL on error. */
+static entry_t *
+add_entry(dir_cache_t *cache, const char path[])
+{
+	entry_t *const entry = calloc(1, sizeof(*entry));
+	if(entry == NULL)
+	{
+		return NULL;
+	}
+
+	entry->path = strdup(path);
+	if(entry->path == NULL || trie_set(cache->entries, path, entry) < 0)
+	{
+		free(entry->path);
+		free(entry);
+		return NULL;
+	}
+
+	entry->watch = -1;
+	entry->pass = cache->pass;
+	entry->next = cache->list;
+	cache->list = entry;
+	return entry;
+}
+
+/* Frees entry and all resources associated with it. */
+static void
+free_entry(entry_t *entry)
+{
+	drop_listing(entry);
+	free(entry->path);
+	free(entry);
+}
+
+/* Frees listing of the entry if it has one. */
+static void
+drop_listing(entry_t *entry)
+{
+	if(entry->has_listing)
+	{
+		dir_listing_free(&entry->listing);
+		entry->has_listing = 0;
+	}
+}
+
+/* Marks directory of the watch as dirty. */
+static void
+on_dir_changed(int id, int gone, void *arg)
+{
+	dir_cache_t *const cache = arg;
+	entry_t *const entry = cache->by_watch[id];
+	if(entry != NULL)
+	{
+		entry->dirty = 1;
+		entry->watch_lost |= gone;
+	}
+}
+
+/* Starts watching directory of the entry.  Entry remains unwatched on error or
+ * when limit on number of watches is reached, in which case the directory is
+ * listed anew on every request. */
+static void
+watch_dir(dir_cache_t *cache, entry_t *entry)
+{
+	int id;
+
+	/* Without inotify changes of files inside directories aren't noticed. */
+	if(watch_set_get_fd(cache->watches) == -1 ||
+			cache->nwatches >= cache->max_watches)
+	{
+		return;
+	}
+
+	id = watch_set_add(cache->watches, entry->path);
+	if(id == -1)
+	{
+		return;
+	}
+
+	if(id >= cache->by_watch_size)
+	{
+		const int new_size = id + 1;
+		entry_t **const by_watch = realloc(cache->by_watch,
+				sizeof(*by_watch)*new_size);
+		if(by_watch == NULL)
+		{
+			watch_set_remove(cache->watches, id);
+			return;
+		}
+
+		memset(&by_watch[cache->by_watch_size], 0,
+				sizeof(*by_watch)*(new_size - cache->by_watch_size));
+		cache->by_watch = by_watch;
+		cache->by_watch_size = new_size;
+	}
+
+	/* The same directory is already watched under a different path. */
+	if(cache->by_watch[id] != NULL)
+	{
+		watch_set_remove(cache->watches, id);
+		return;
+	}
+
+	cache->by_watch[id] = entry;
+	++cache->nwatches;
+
+	entry->watch = id;
+}
+
+/* Stops watching directory of the entry. */
+static void
+unwatch_dir(dir_cache_t *cache, entry_t *entry)
+{
+	if(entry->watch != -1)
+	{
+		watch_set_remove(cache->watches, entry->watch);
+		cache->by_watch[entry->watch] = NULL;
+		--cache->nwatches;
+		entry->watch = -1;
+	}
+	entry->watch_lost = 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
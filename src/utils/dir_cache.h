@@ -0,0 +1,65 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DIR_CACHE_H__
+#define VIFM__UTILS__DIR_CACHE_H__
+
+#include "dir_lister.h"
+
+/* Cache of directory listings which are dropped on any change of a directory
+ * or of any of its files.  Changes are tracked via inotify, without it nothing
+ * is ever reused.
+ *
+ * The cache is used in passes.  Each pass starts by processing accumulated
+ * notifications and ends by forgetting directories which weren't requested
+ * during the pass. */
+
+/* Declaration of opaque cache type. */
+typedef struct dir_cache_t dir_cache_t;
+
+/* Creates empty cache, which watches at most max_watches directories for
+ * changes.  Listings of directories above the limit are never reused.  Returns
+ * NULL on error. */
+dir_cache_t * dir_cache_create(int max_watches);
+
+/* Frees the cache along with all listings.  cache can be NULL. */
+void dir_cache_free(dir_cache_t *cache);
+
+/* Starts new pass over the cache by processing pending notifications about
+ * changes. */
+void dir_cache_start_pass(dir_cache_t *cache);
+
+/* Finishes a pass by dropping directories that weren't requested during it as
+ * well as listings that can't be reused. */
+void dir_cache_finish_pass(dir_cache_t *cache);
+
+/* Looks up up to date listing of a directory.  On failure, starts tracking
+ * changes of the directory, so it needs to be listed after this call.  Returns
+ * the listing, which stays valid until the end of the pass, or NULL. */
+const dir_listing_t * dir_cache_get(dir_cache_t *cache, const char path[]);
+
+/* Stores listing of a directory for which dir_cache_get() failed.  Takes
+ * ownership of the listing.  Returns pointer to stored listing, which stays
+ * valid until the end of the pass, or NULL on error. */
+const dir_listing_t * dir_cache_put(dir_cache_t *cache, const char path[],
+		dir_listing_t *listing);
+
+#endif /* VIFM__UTILS__DIR_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
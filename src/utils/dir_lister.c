@@ -0,0 +1,344 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dir_lister.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memset() */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "fs.h"
+#include "str.h"
+#include "string_array.h"
+
+/* State of a request. */
+typedef enum
+{
+	RS_QUEUED,  /* Waiting for a worker. */
+	RS_RUNNING, /* Being processed. */
+	RS_DONE,    /* Result is available. */
+}
+ReqState;
+
+/* Single listing request. */
+struct dir_lister_req_t
+{
+	char *path;              /* Path to the directory. */
+	ReqState state;          /* Current state of the request. */
+	dir_listing_t listing;   /* Result of listing. */
+	dir_lister_req_t *prev;  /* Previous request in the queue. */
+	dir_lister_req_t *next;  /* Next request in the queue. */
+};
+
+/* Lister state. */
+struct dir_lister_t
+{
+	pthread_mutex_t lock;    /* Protects all fields below and request states. */
+	pthread_cond_t queued;   /* Signaled on new requests and on stopping. */
+	pthread_cond_t finished; /* Signaled when a request is processed. */
+
+	dir_lister_req_t *queue; /* Top of the stack of queued requests. */
+	int stop;                /* Whether workers should quit. */
+
+	pthread_t *workers;      /* Worker threads. */
+	int nworkers;            /* Number of started worker threads. */
+};
+
+static void * worker_thread(void *arg);
+static void unlink_req(dir_lister_t *lister, dir_lister_req_t *req);
+
+dir_lister_t *
+dir_lister_create(int nworkers)
+{
+	int i;
+	dir_lister_t *const lister = malloc(sizeof(*lister));
+	if(lister == NULL)
+	{
+		return NULL;
+	}
+
+	lister->queue = NULL;
+	lister->stop = 0;
+	lister->nworkers = 0;
+	lister->workers = reallocarray(NULL, nworkers, sizeof(*lister->workers));
+	if(lister->workers == NULL && nworkers != 0)
+	{
+		free(lister);
+		return NULL;
+	}
+
+	pthread_mutex_init(&lister->lock, NULL);
+	pthread_cond_init(&lister->queued, NULL);
+	pthread_cond_init(&lister->finished, NULL);
+
+	/* Failing to start some of the workers isn't fatal, requests are processed
+	 * by the calling thread when necessary. */
+	for(i = 0; i < nworkers; ++i)
+	{
+		if(pthread_create(&lister->workers[lister->nworkers], NULL,
+					&worker_thread, lister) == 0)
+		{
+			++lister->nworkers;
+		}
+	}
+
+	return lister;
+}
+
+void
+dir_lister_free(dir_lister_t *lister)
+{
+	int i;
+
+	if(lister == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&lister->lock);
+	lister->stop = 1;
+	pthread_cond_broadcast(&lister->queued);
+	pthread_mutex_unlock(&lister->lock);
+
+	for(i = 0; i < lister->nworkers; ++i)
+	{
+		pthread_join(lister->workers[i], NULL);
+	}
+
+	pthread_cond_destroy(&lister->finished);
+	pthread_cond_destroy(&lister->queued);
+	pthread_mutex_destroy(&lister->lock);
+
+	free(lister->workers);
+	free(lister);
+}
+
+dir_lister_req_t *
+dir_lister_queue(dir_lister_t *lister, const char path[])
+{
+	dir_lister_req_t *const req = calloc(1, sizeof(*req));
+	if(req == NULL)
+	{
+		return NULL;
+	}
+
+	req->path = strdup(path);
+	if(req->path == NULL)
+	{
+		free(req);
+		return NULL;
+	}
+
+	req->state = RS_QUEUED;
+	req->listing.count = -1;
+
+	pthread_mutex_lock(&lister->lock);
+	req->next = lister->queue;
+	if(lister->queue != NULL)
+	{
+		lister->queue->prev = req;
+	}
+	lister->queue = req;
+	pthread_cond_signal(&lister->queued);
+	pthread_mutex_unlock(&lister->lock);
+
+	return req;
+}
+
+const dir_listing_t *
+dir_lister_get(dir_lister_t *lister, dir_lister_req_t *req)
+{
+	pthread_mutex_lock(&lister->lock);
+
+	if(req->state == RS_QUEUED)
+	{
+		/* Don't wait for workers to get to this request. */
+		unlink_req(lister, req);
+		req->state = RS_RUNNING;
+		pthread_mutex_unlock(&lister->lock);
+
+		dir_lister_list(req->path, &req->listing);
+
+		pthread_mutex_lock(&lister->lock);
+		req->state = RS_DONE;
+	}
+
+	while(req->state != RS_DONE)
+	{
+		pthread_cond_wait(&lister->finished, &lister->lock);
+	}
+
+	pthread_mutex_unlock(&lister->lock);
+
+	return &req->listing;
+}
+
+void
+dir_lister_take(dir_lister_t *lister, dir_lister_req_t *req,
+		dir_listing_t *listing)
+{
+	*listing = *dir_lister_get(lister, req);
+
+	req->listing.names = NULL;
+	req->listing.count = -1;
+	req->listing.stats = NULL;
+}
+
+void
+dir_lister_release(dir_lister_t *lister, dir_lister_req_t *req)
+{
+	if(req == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&lister->lock);
+	if(req->state == RS_QUEUED)
+	{
+		unlink_req(lister, req);
+	}
+	else
+	{
+		while(req->state != RS_DONE)
+		{
+			pthread_cond_wait(&lister->finished, &lister->lock);
+		}
+	}
+	pthread_mutex_unlock(&lister->lock);
+
+	dir_listing_free(&req->listing);
+	free(req->path);
+	free(req);
+}
+
+void
+dir_lister_list(const char path[], dir_listing_t *listing)
+{
+	int i;
+
+	listing->stats = NULL;
+	listing->names = list_all_files(path, &listing->count);
+	if(listing->count <= 0)
+	{
+		return;
+	}
+
+	listing->stats = reallocarray(NULL, listing->count,
+			sizeof(*listing->stats));
+	if(listing->stats == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < listing->count; ++i)
+	{
+		char *const full_path = format_str("%s/%s", path, listing->names[i]);
+		if(full_path == NULL || os_lstat(full_path, &listing->stats[i]) != 0)
+		{
+			memset(&listing->stats[i], 0, sizeof(listing->stats[i]));
+		}
+		free(full_path);
+	}
+}
+
+void
+dir_listing_free(dir_listing_t *listing)
+{
+	if(listing == NULL)
+	{
+		return;
+	}
+
+	if(listing->count > 0)
+	{
+		free_string_array(listing->names, listing->count);
+	}
+	free(listing->stats);
+
+	listing->names = NULL;
+	listing->count = -1;
+	listing->stats = NULL;
+}
+
+/* Entry point of worker threads.  Processes requests until stopped.  Returns
+ * NULL. */
+static void *
+worker_thread(void *arg)
+{
+	dir_lister_t *const lister = arg;
+
+	pthread_mutex_lock(&lister->lock);
+	while(1)
+	{
+		dir_lister_req_t *req;
+
+		while(!lister->stop && lister->queue == NULL)
+		{
+			pthread_cond_wait(&lister->queued, &lister->lock);
+		}
+
+		if(lister->stop)
+		{
+			break;
+		}
+
+		req = lister->queue;
+		unlink_req(lister, req);
+		req->state = RS_RUNNING;
+		pthread_mutex_unlock(&lister->lock);
+
+		dir_lister_list(req->path, &req->listing);
+
+		pthread_mutex_lock(&lister->lock);
+		req->state = RS_DONE;
+		pthread_cond_broadcast(&lister->finished);
+	}
+	pthread_mutex_unlock(&lister->lock);
+
+	return NULL;
+}
+
+/* Removes request from the queue.  Should be called with the lock held. */
+static void
+unlink_req(dir_lister_t *lister, dir_lister_req_t *req)
+{
+	if(req->prev == NULL)
+	{
+		lister->queue = req->next;
+	}
+	else
+	{
+		req->prev->next = req->next;
+	}
+
+	if(req->next != NULL)
+	{
+		req->next->prev = req->prev;
+	}
+
+	req->prev = NULL;
+	req->next = NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
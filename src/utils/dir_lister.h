@@ -0,0 +1,84 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DIR_LISTER_H__
+#define VIFM__UTILS__DIR_LISTER_H__
+
+#include <sys/stat.h> /* stat */
+
+/* Pool of threads that list directories and lstat() their entries ahead of
+ * time.  Requests are served in LIFO order, so that the most recently queued
+ * directories (which are usually deeper in a tree) get listed first.  A request
+ * that wasn't picked up by any of the workers by the time its result is
+ * needed is processed by the calling thread. */
+
+/* Declaration of opaque lister type. */
+typedef struct dir_lister_t dir_lister_t;
+
+/* Declaration of opaque type of a single listing request. */
+typedef struct dir_lister_req_t dir_lister_req_t;
+
+/* Result of listing a directory. */
+typedef struct
+{
+	char **names;       /* Names of files in the directory. */
+	int count;          /* Number of files or negative value on error. */
+	struct stat *stats; /* lstat() information for each file.  Information of
+	                       files that couldn't be queried is zeroed. */
+}
+dir_listing_t;
+
+/* Creates lister that uses specified number of worker threads (zero is allowed
+ * and makes all listing synchronous).  Returns NULL on error. */
+dir_lister_t * dir_lister_create(int nworkers);
+
+/* Stops workers and frees the lister.  All requests must be released before
+ * calling this function.  Freeing NULL lister is OK. */
+void dir_lister_free(dir_lister_t *lister);
+
+/* Schedules listing of a directory.  Returns request handle, which must be
+ * released via dir_lister_release(), or NULL on error. */
+dir_lister_req_t * dir_lister_queue(dir_lister_t *lister, const char path[]);
+
+/* Waits for the request to be processed doing the work in calling thread if
+ * it wasn't started yet.  Returns pointer to the result, which is owned by the
+ * request. */
+const dir_listing_t * dir_lister_get(dir_lister_t *lister,
+		dir_lister_req_t *req);
+
+/* Same as dir_lister_get(), but moves result out of the request into
+ * *listing.  The result should be freed with dir_listing_free() afterwards and
+ * the request still needs to be released. */
+void dir_lister_take(dir_lister_t *lister, dir_lister_req_t *req,
+		dir_listing_t *listing);
+
+/* Frees request along with its result.  Requests that weren't started yet are
+ * dropped.  Releasing NULL request is OK. */
+void dir_lister_release(dir_lister_t *lister, dir_lister_req_t *req);
+
+/* Lists directory and queries information about its files in calling thread.
+ * The result should be freed with dir_listing_free(). */
+void dir_lister_list(const char path[], dir_listing_t *listing);
+
+/* Frees resources of the listing and resets it.  listing can be NULL. */
+void dir_listing_free(dir_listing_t *listing);
+
+#endif /* VIFM__UTILS__DIR_LISTER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -20,7 +20,7 @@
 
 #include <stddef.h> /* NULL size_t */
 #include <stdlib.h> /* calloc() free() */
-#include <string.h> /* memmove() */
+#include <string.h> /* memmove() strcmp() strdup() */
 
 #include "macros.h"
 #include "string_array.h"
@@ -29,12 +29,20 @@
 
 static int move_to_first_position(hist_t *hist, const char item[]);
 static int insert_at_first_position(hist_t *hist, size_t size, const char item[]);
+static int ensure_index(hist_t *hist, size_t count);
+static int index_find(const hist_t *hist, const char item[]);
+static void index_add(hist_t *hist, char *item);
+static void index_remove(hist_t *hist, const char *item);
+static void drop_index(hist_t *hist);
+static unsigned int hash_item(const char item[]);
 
 int
 hist_init(hist_t *hist, size_t size)
 {
 	hist->pos = NO_POS;
 	hist->items = calloc(size, sizeof(char *));
+	hist->index = NULL;
+	hist->index_size = 0;
 	return hist->items == NULL;
 }
 
@@ -44,6 +52,7 @@ hist_reset(hist_t *hist, size_t size)
 	free_string_array(hist->items, size);
 	hist->items = NULL;
 	hist->pos = NO_POS;
+	drop_index(hist);
 }
 
 int
@@ -55,6 +64,9 @@ hist_is_empty(const hist_t *hist)
 void
 hist_trunc(hist_t *hist, size_t new_size, size_t removed_count)
 {
+	/* This is rare, so just let the index be rebuilt later. */
+	drop_index(hist);
+
 	free_strings(hist->items + new_size, removed_count);
 	hist->pos = MIN(hist->pos, (int)new_size - 1);
 }
@@ -66,6 +78,10 @@ hist_contains(const hist_t *hist, const char item[])
 	{
 		return 0;
 	}
+	if(hist->index != NULL)
+	{
+		return index_find(hist, item) != -1;
+	}
 	return is_in_string_array(hist->items, hist->pos + 1, item);
 }
 
@@ -74,6 +90,9 @@ hist_add(hist_t *hist, const char item[], size_t size)
 {
 	if(size > 0 && item[0] != '\0')
 	{
+		/* Failure to build the index isn't fatal, lookups just get slower. */
+		(void)ensure_index(hist, MIN(size, (size_t)(hist->pos + 2)));
+
 		if(move_to_first_position(hist, item) != 0)
 		{
 			return insert_at_first_position(hist, size, item);
@@ -87,7 +106,27 @@ hist_add(hist_t *hist, const char item[], size_t size)
 static int
 move_to_first_position(hist_t *hist, const char item[])
 {
-	const int pos = string_array_pos(hist->items, hist->pos + 1, item);
+	int pos;
+
+	if(hist->index != NULL && !hist_is_empty(hist))
+	{
+		const int slot = index_find(hist, item);
+		if(slot == -1)
+		{
+			return 1;
+		}
+
+		/* Comparing pointers is much cheaper than comparing strings. */
+		for(pos = 0; hist->items[pos] != hist->index[slot]; ++pos)
+		{
+			/* Do nothing. */
+		}
+	}
+	else
+	{
+		pos = string_array_pos(hist->items, hist->pos + 1, item);
+	}
+
 	if(pos == 0)
 	{
 		return 0;
@@ -116,14 +155,160 @@ insert_at_first_position(hist_t *hist, size_t size, const char item[])
 	hist->pos = MIN(hist->pos + 1, (int)size - 1);
 	if(hist->pos > 0)
 	{
-		free(hist->items[hist->pos]);
+		if(hist->items[hist->pos] != NULL)
+		{
+			index_remove(hist, hist->items[hist->pos]);
+			free(hist->items[hist->pos]);
+		}
 		memmove(hist->items + 1, hist->items, sizeof(char *)*hist->pos);
 		hist->items[0] = NULL;
 	}
+	else if(hist->items[0] != NULL)
+	{
+		/* History of size one, the only item is replaced. */
+		index_remove(hist, hist->items[0]);
+		free(hist->items[0]);
+	}
 
 	hist->items[0] = item_copy;
+	index_add(hist, item_copy);
+	return 0;
+}
+
+/* Makes sure that the index exists and can hold count items keeping at least
+ * half of slots free.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+ensure_index(hist_t *hist, size_t count)
+{
+	int i;
+	int index_size = 16;
+
+	if(hist->index != NULL && (size_t)hist->index_size >= count*2U)
+	{
+		return 0;
+	}
+
+	drop_index(hist);
+
+	while((size_t)index_size < count*2U)
+	{
+		index_size *= 2;
+	}
+
+	hist->index = calloc(index_size, sizeof(*hist->index));
+	if(hist->index == NULL)
+	{
+		return 1;
+	}
+	hist->index_size = index_size;
+
+	for(i = 0; i <= hist->pos; ++i)
+	{
+		index_add(hist, hist->items[i]);
+	}
 	return 0;
 }
 
+/* Looks up item in the index.  Returns slot of the item or -1. */
+static int
+index_find(const hist_t *hist, const char item[])
+{
+	const unsigned int mask = hist->index_size - 1;
+	unsigned int slot;
+	for(slot = hash_item(item) & mask; hist->index[slot] != NULL;
+			slot = (slot + 1) & mask)
+	{
+		if(strcmp(hist->index[slot], item) == 0)
+		{
+			return slot;
+		}
+	}
+	return -1;
+}
+
+/* Adds item to the index if it exists. */
+static void
+index_add(hist_t *hist, char *item)
+{
+	unsigned int mask;
+	unsigned int slot;
+
+	if(hist->index == NULL)
+	{
+		return;
+	}
+
+	mask = hist->index_size - 1;
+	slot = hash_item(item) & mask;
+	while(hist->index[slot] != NULL)
+	{
+		slot = (slot + 1) & mask;
+	}
+	hist->index[slot] = item;
+}
+
+/* Removes item from the index if it exists.  The item must be one of the
+ * pointers stored in the index. */
+static void
+index_remove(hist_t *hist, const char *item)
+{
+	unsigned int mask;
+	unsigned int slot, next;
+
+	if(hist->index == NULL)
+	{
+		return;
+	}
+
+	mask = hist->index_size - 1;
+	for(slot = hash_item(item) & mask; hist->index[slot] != item;
+			slot = (slot + 1) & mask)
+	{
+		if(hist->index[slot] == NULL)
+		{
+			return;
+		}
+	}
+
+	/* Shift following elements of the cluster back to not break their probe
+	 * sequences instead of leaving a tombstone. */
+	for(next = (slot + 1) & mask; hist->index[next] != NULL;
+			next = (next + 1) & mask)
+	{
+		const unsigned int home = hash_item(hist->index[next]) & mask;
+		/* Element can be moved if its home slot isn't in (slot; next]. */
+		if(((next - home) & mask) >= ((next - slot) & mask))
+		{
+			hist->index[slot] = hist->index[next];
+			slot = next;
+		}
+	}
+	hist->index[slot] = NULL;
+}
+
+/* Frees the index. */
+static void
+drop_index(hist_t *hist)
+{
+	free(hist->index);
+	hist->index = NULL;
+	hist->index_size = 0;
+}
+
+/* Computes hash of a history item.  Returns the hash. */
+static unsigned int
+hash_item(const char item[])
+{
+	/* FNV-1a. */
+	unsigned int hash = 2166136261U;
+	while(*item != '\0')
+	{
+		hash ^= (unsigned char)*item++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -31,6 +31,12 @@ typedef struct
 	/* Position of the last item in the items list.  Undefined (likely to be
 	 * negative) for empty lists. */
 	int pos;
+
+	/* Hash set of pointers to items for fast lookups.  Built by hist_add() and
+	 * dropped on truncation.  Can be NULL. */
+	char **index;
+	/* Number of slots in the index, which is a power of two. */
+	int index_size;
 }
 hist_t;
 
@@ -445,5 +445,11 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+int
+matcher_is_mime(const matcher_t *matcher)
+{
+	return (matcher->type == MT_MIME);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
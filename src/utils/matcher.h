@@ -64,6 +64,10 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Checks whether given matcher matches mime types, which are slow to detect.
+ * Returns non-zero if so, otherwise zero is returned. */
+int matcher_is_mime(const matcher_t *matcher);
+
 #endif /* VIFM__UTILS__MATCHER_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
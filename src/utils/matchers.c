@@ -183,6 +183,26 @@ matchers_match(const matchers_t *matchers, const char path[])
 	return 1;
 }
 
+int
+matchers_match_no_mime(const matchers_t *matchers, const char path[],
+		int *mime)
+{
+	int i;
+	*mime = 0;
+	for(i = 0; i < matchers->count; ++i)
+	{
+		if(matcher_is_mime(matchers->list[i]))
+		{
+			*mime = 1;
+		}
+		else if(!matcher_matches(matchers->list[i], path))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
 int
 matchers_match_dir(const matchers_t *matchers, const char path[])
 {
@@ -43,6 +43,12 @@ int matchers_match(const matchers_t *matchers, const char path[]);
  * directories.  Returns non-zero if so, otherwise zero is returned. */
 int matchers_match_dir(const matchers_t *matchers, const char path[]);
 
+/* Checks whether given path/name matches skipping matchers of mime types.
+ * *mime is set to non-zero if some matchers were skipped.  Returns non-zero if
+ * so, otherwise zero is returned. */
+int matchers_match_no_mime(const matchers_t *matchers, const char path[],
+		int *mime);
+
 /* Retrieves original matcher expression.  Returns the expression. */
 const char * matchers_get_expr(const matchers_t *matchers);
 
@@ -0,0 +1,447 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "perf.h"
+
+#include <errno.h> /* errno */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() ferror() fprintf() fputs() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "macros.h"
+#include "utils.h"
+
+/* Number of recent events that are kept per thread. */
+#define RING_SIZE 8192
+
+/* Single recorded event. */
+typedef struct
+{
+	uint64_t start;    /* Start time in nanoseconds. */
+	uint64_t duration; /* Duration in nanoseconds. */
+	uint64_t amount;   /* Kind-specific quantity. */
+	PerfKind kind;     /* Kind of the event. */
+}
+record_t;
+
+/* Recording state of a thread.  Everything except for the in_use field is
+ * written only by the thread that owns the state, other threads only read it.
+ * States are never freed, but are reused after their threads exit. */
+typedef struct state_t
+{
+	struct state_t *next;         /* Next state in the list of all states. */
+	int tid;                      /* Identifier of the thread in traces. */
+	int in_use;                   /* Whether the state is owned by a thread. */
+	unsigned int epoch;           /* Value of the epoch at the last reset. */
+	uint64_t head;                /* Number of records written to the ring. */
+	perf_stats_t stats[PK_COUNT]; /* Statistics by kind. */
+	record_t ring[RING_SIZE];     /* Recent events. */
+}
+state_t;
+
+static state_t * get_state(void);
+static void make_key(void);
+static void release_state(void *arg);
+static void reset_state(state_t *state, unsigned int new_epoch);
+static uint64_t now(void);
+static int get_bucket(uint64_t duration);
+static void store(uint64_t *field, uint64_t value);
+static uint64_t load(const uint64_t *field);
+static int is_current(const state_t *state);
+static void export_state(FILE *fp, const state_t *state, record_t buf[],
+		int *first);
+
+/* Names of kinds of events. */
+static const char *const kind_names[] = {
+	[PK_DIR_READ]   = "dir-read",
+	[PK_DIR_SORT]   = "dir-sort",
+	[PK_DIR_FILTER] = "dir-filter",
+	[PK_DRAW_LIST]  = "draw-list",
+	[PK_DRAW_LINE]  = "draw-line",
+	[PK_HIGHLIGHT]  = "highlight",
+	[PK_MIME]       = "mime",
+	[PK_FSWATCH]    = "fswatch",
+	[PK_COPY]       = "copy",
+	[PK_BG_TASK]    = "bg-task",
+};
+ARRAY_GUARD(kind_names, PK_COUNT);
+
+/* Whether recording is enabled. */
+static int enabled;
+/* Incremented on each reset, states of older epochs are considered empty. */
+static unsigned int epoch;
+
+/* Key of thread-specific state and guard of its initialization. */
+static pthread_key_t key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+/* Protects the list of states and their in_use fields. */
+static pthread_mutex_t states_lock = PTHREAD_MUTEX_INITIALIZER;
+/* List of all states. */
+static state_t *states;
+/* Identifier for the next new state. */
+static int next_tid = 1;
+
+void
+perf_enable(int enable)
+{
+	__atomic_store_n(&enabled, enable != 0, __ATOMIC_RELAXED);
+}
+
+int
+perf_enabled(void)
+{
+	return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+void
+perf_reset(void)
+{
+	/* Threads reset their own data on the next event, which avoids writing to
+	 * data owned by another thread. */
+	(void)__atomic_add_fetch(&epoch, 1U, __ATOMIC_RELEASE);
+}
+
+uint64_t
+perf_begin(void)
+{
+	return perf_enabled() ? now() : 0U;
+}
+
+void
+perf_end(PerfKind kind, uint64_t start, uint64_t amount)
+{
+	uint64_t duration;
+	state_t *state;
+	perf_stats_t *stats;
+	record_t *record;
+	unsigned int cur_epoch;
+	int bucket;
+	int saved_errno;
+
+	if(start == 0U)
+	{
+		return;
+	}
+
+	duration = now() - start;
+
+	/* Callers might examine errno after this call. */
+	saved_errno = errno;
+	state = get_state();
+	errno = saved_errno;
+	if(state == NULL)
+	{
+		return;
+	}
+
+	cur_epoch = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+	if(state->epoch != cur_epoch)
+	{
+		reset_state(state, cur_epoch);
+	}
+
+	/* The state has single writer, so plain reads of own data are fine, while
+	 * writes are atomic to not tear values for readers. */
+	stats = &state->stats[kind];
+	bucket = get_bucket(duration);
+	store(&stats->count, stats->count + 1U);
+	store(&stats->total, stats->total + duration);
+	store(&stats->amount, stats->amount + amount);
+	store(&stats->buckets[bucket], stats->buckets[bucket] + 1U);
+	if(duration > stats->max)
+	{
+		store(&stats->max, duration);
+	}
+
+	record = &state->ring[state->head%RING_SIZE];
+	record->start = start;
+	record->duration = duration;
+	record->amount = amount;
+	record->kind = kind;
+	__atomic_store_n(&state->head, state->head + 1U, __ATOMIC_RELEASE);
+}
+
+/* Retrieves state of the current thread creating it if necessary.  Returns the
+ * state or NULL on error. */
+static state_t *
+get_state(void)
+{
+	state_t *state;
+
+	(void)pthread_once(&key_once, &make_key);
+
+	state = pthread_getspecific(key);
+	if(state != NULL)
+	{
+		return state;
+	}
+
+	pthread_mutex_lock(&states_lock);
+
+	for(state = states; state != NULL; state = state->next)
+	{
+		if(!state->in_use)
+		{
+			break;
+		}
+	}
+
+	if(state == NULL)
+	{
+		state = calloc(1, sizeof(*state));
+		if(state != NULL)
+		{
+			state->tid = next_tid++;
+			state->epoch = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+			state->next = states;
+			states = state;
+		}
+	}
+
+	if(state != NULL)
+	{
+		state->in_use = 1;
+	}
+
+	pthread_mutex_unlock(&states_lock);
+
+	if(state != NULL && pthread_setspecific(key, state) != 0)
+	{
+		release_state(state);
+		return NULL;
+	}
+	return state;
+}
+
+/* Creates key of thread-specific states. */
+static void
+make_key(void)
+{
+	(void)pthread_key_create(&key, &release_state);
+}
+
+/* Makes state of an exited thread available for reuse.  Data of the state is
+ * kept intact. */
+static void
+release_state(void *arg)
+{
+	state_t *const state = arg;
+	pthread_mutex_lock(&states_lock);
+	state->in_use = 0;
+	pthread_mutex_unlock(&states_lock);
+}
+
+/* Discards data of the state and marks it as belonging to the epoch. */
+static void
+reset_state(state_t *state, unsigned int new_epoch)
+{
+	int i, j;
+
+	for(i = 0; i < PK_COUNT; ++i)
+	{
+		perf_stats_t *const stats = &state->stats[i];
+		store(&stats->count, 0U);
+		store(&stats->total, 0U);
+		store(&stats->max, 0U);
+		store(&stats->amount, 0U);
+		for(j = 0; j < PERF_BUCKETS; ++j)
+		{
+			store(&stats->buckets[j], 0U);
+		}
+	}
+
+	__atomic_store_n(&state->head, 0U, __ATOMIC_RELEASE);
+	__atomic_store_n(&state->epoch, new_epoch, __ATOMIC_RELEASE);
+}
+
+/* Retrieves current value of a monotonic clock.  Returns time in nanoseconds,
+ * which is never zero. */
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+	uint64_t ns;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	ns = (uint64_t)ts.tv_sec*1000000000U + ts.tv_nsec;
+	return (ns == 0U ? 1U : ns);
+}
+
+/* Computes index of histogram bucket for the duration.  Returns the index. */
+static int
+get_bucket(uint64_t duration)
+{
+	uint64_t us = duration/1000U;
+	int bucket = 0;
+
+	while(us != 0U && bucket < PERF_BUCKETS - 1)
+	{
+		us >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+/* Atomically stores the value to a field of a state. */
+static void
+store(uint64_t *field, uint64_t value)
+{
+	__atomic_store_n(field, value, __ATOMIC_RELAXED);
+}
+
+/* Atomically loads value of a field of a state.  Returns the value. */
+static uint64_t
+load(const uint64_t *field)
+{
+	return __atomic_load_n(field, __ATOMIC_RELAXED);
+}
+
+const char *
+perf_kind_name(PerfKind kind)
+{
+	return kind_names[kind];
+}
+
+void
+perf_get_stats(PerfKind kind, perf_stats_t *stats)
+{
+	const state_t *state;
+	int i;
+
+	*stats = (perf_stats_t){};
+
+	pthread_mutex_lock(&states_lock);
+	for(state = states; state != NULL; state = state->next)
+	{
+		const perf_stats_t *const s = &state->stats[kind];
+		uint64_t max;
+
+		if(!is_current(state))
+		{
+			continue;
+		}
+
+		stats->count += load(&s->count);
+		stats->total += load(&s->total);
+		stats->amount += load(&s->amount);
+		for(i = 0; i < PERF_BUCKETS; ++i)
+		{
+			stats->buckets[i] += load(&s->buckets[i]);
+		}
+
+		max = load(&s->max);
+		stats->max = MAX(stats->max, max);
+	}
+	pthread_mutex_unlock(&states_lock);
+}
+
+/* Checks whether data of the state wasn't discarded by a reset.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_current(const state_t *state)
+{
+	return __atomic_load_n(&state->epoch, __ATOMIC_ACQUIRE)
+	    == __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+}
+
+int
+perf_export_trace(const char path[])
+{
+	const state_t *state;
+	int first = 1;
+	int error;
+	FILE *fp;
+
+	record_t *const buf = malloc(sizeof(*buf)*RING_SIZE);
+	if(buf == NULL)
+	{
+		return 1;
+	}
+
+	fp = os_fopen(path, "w");
+	if(fp == NULL)
+	{
+		free(buf);
+		return 1;
+	}
+
+	fputs("{\"traceEvents\":[", fp);
+
+	pthread_mutex_lock(&states_lock);
+	for(state = states; state != NULL; state = state->next)
+	{
+		if(is_current(state))
+		{
+			export_state(fp, state, buf, &first);
+		}
+	}
+	pthread_mutex_unlock(&states_lock);
+
+	fputs("\n]}\n", fp);
+
+	free(buf);
+	error = ferror(fp);
+	return (fclose(fp) != 0 || error);
+}
+
+/* Prints events of the state to the file.  buf is a temporary storage of
+ * RING_SIZE elements.  *first specifies whether an event wasn't printed yet. */
+static void
+export_state(FILE *fp, const state_t *state, record_t buf[], int *first)
+{
+	uint64_t i;
+	uint64_t new_head, valid_from;
+
+	/* The owner might be writing new events while they are being copied, so copy
+	 * first and then drop records that could have been overwritten. */
+	const uint64_t head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+	const uint64_t from = (head > RING_SIZE ? head - RING_SIZE : 0U);
+	for(i = from; i < head; ++i)
+	{
+		buf[i%RING_SIZE] = state->ring[i%RING_SIZE];
+	}
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	new_head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+	if(new_head < head)
+	{
+		/* The state was reset in the meantime. */
+		return;
+	}
+	valid_from = (new_head >= RING_SIZE ? new_head - RING_SIZE + 1U : 0U);
+
+	for(i = MAX(from, valid_from); i < head; ++i)
+	{
+		const record_t *const record = &buf[i%RING_SIZE];
+		fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"vifm\",\"ph\":\"X\","
+				"\"pid\":%u,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+				"\"args\":{\"amount\":%llu}}", *first ? "" : ",",
+				kind_names[record->kind], get_pid(), state->tid,
+				record->start/1000.0, record->duration/1000.0,
+				(unsigned long long)record->amount);
+		*first = 0;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,100 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__PERF_H__
+#define VIFM__UTILS__PERF_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Lightweight instrumentation of hot paths, which is disabled by default and
+ * costs a check of a flag in that state.  When enabled, each thread records
+ * durations of events into its own ring buffer and statistics without taking
+ * any locks.  Usage:
+ *
+ *   const uint64_t start = perf_begin();
+ *   ...
+ *   perf_end(PK_SOMETHING, start, 0U);
+ */
+
+/* Number of buckets in histograms of durations.  Bucket i holds events that
+ * took [2^(i-1); 2^i) microseconds, bucket 0 is for less than a microsecond and
+ * the last one is for everything that didn't fit into preceding buckets. */
+#define PERF_BUCKETS 24
+
+/* Kinds of recorded events. */
+typedef enum
+{
+	PK_DIR_READ,   /* Reading directory into a view (includes stat()). */
+	PK_DIR_SORT,   /* Sorting entries of a view. */
+	PK_DIR_FILTER, /* Applying local filter to entries of a view. */
+	PK_DRAW_LIST,  /* Drawing list of files of a view. */
+	PK_DRAW_LINE,  /* Formatting and printing single line of a view. */
+	PK_HIGHLIGHT,  /* Matching file name against highlight rules. */
+	PK_MIME,       /* Detecting MIME-type of a file. */
+	PK_FSWATCH,    /* Checking file system watcher for changes. */
+	PK_COPY,       /* Copying a file, amount is number of bytes. */
+	PK_BG_TASK,    /* Executing a background task. */
+	PK_COUNT       /* Number of kinds. */
+}
+PerfKind;
+
+/* Aggregated statistics about events of a kind. */
+typedef struct
+{
+	uint64_t count;                  /* Number of events. */
+	uint64_t total;                  /* Total duration in nanoseconds. */
+	uint64_t max;                    /* Maximal duration in nanoseconds. */
+	uint64_t amount;                 /* Sum of amounts (e.g., bytes). */
+	uint64_t buckets[PERF_BUCKETS];  /* Histogram of durations. */
+}
+perf_stats_t;
+
+/* Enables or disables recording. */
+void perf_enable(int enable);
+
+/* Checks whether recording is enabled.  Returns non-zero if so, otherwise zero
+ * is returned. */
+int perf_enabled(void);
+
+/* Discards everything that was recorded so far. */
+void perf_reset(void);
+
+/* Marks start of an event.  Returns opaque value for perf_end(), which is zero
+ * when recording is disabled. */
+uint64_t perf_begin(void);
+
+/* Marks end of an event that was started by perf_begin().  amount is an
+ * optional kind-specific quantity (e.g., number of processed bytes).  Doesn't
+ * change errno. */
+void perf_end(PerfKind kind, uint64_t start, uint64_t amount);
+
+/* Retrieves name of a kind.  Returns the name. */
+const char * perf_kind_name(PerfKind kind);
+
+/* Sums statistics about events of the kind over all threads. */
+void perf_get_stats(PerfKind kind, perf_stats_t *stats);
+
+/* Writes recent events in Chrome trace event format (JSON), which can be
+ * loaded in chrome://tracing or similar tools.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int perf_export_trace(const char path[]);
+
+#endif /* VIFM__UTILS__PERF_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,52 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__POLLER_H__
+#define VIFM__UTILS__POLLER_H__
+
+/* Waiting for readability of a set of file descriptors, which doesn't depend
+ * on the size of the set on Linux (epoll is used there, poll() elsewhere). */
+
+/* Opaque poller type. */
+typedef struct poller_t poller_t;
+
+/* Creates empty poller.  Returns NULL on error. */
+poller_t * poller_create(void);
+
+/* Frees the poller, but not the descriptors.  poller can be NULL. */
+void poller_free(poller_t *poller);
+
+/* Starts waiting for readability (EOF and errors included) of the descriptor
+ * associating data with it.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int poller_add(poller_t *poller, int fd, void *data);
+
+/* Stops waiting for the descriptor. */
+void poller_remove(poller_t *poller, int fd);
+
+/* Waits for at most timeout milliseconds (negative value means infinitely) for
+ * any of the descriptors to become readable.  Stores data associated with up
+ * to max of such descriptors in the ready array, others are reported by
+ * subsequent calls.  Returns number of stored items, which is zero on timeout
+ * or interruption by a signal, or negative value on error. */
+int poller_wait(poller_t *poller, int timeout, void *ready[], int max);
+
+#endif /* VIFM__UTILS__POLLER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,218 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "poller.h"
+
+#ifdef __linux__
+#include <sys/epoll.h> /* EPOLL* epoll_* */
+#else
+#include <poll.h> /* POLL* poll() pollfd */
+#endif
+#include <unistd.h> /* close() */
+
+#include <errno.h> /* EINTR errno */
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() */
+
+#include "../compat/reallocarray.h"
+#include "macros.h"
+
+#ifdef __linux__
+
+/* Poller state. */
+struct poller_t
+{
+	int fd; /* epoll descriptor. */
+};
+
+poller_t *
+poller_create(void)
+{
+	poller_t *const poller = calloc(1, sizeof(*poller));
+	if(poller == NULL)
+	{
+		return NULL;
+	}
+
+	poller->fd = epoll_create1(EPOLL_CLOEXEC);
+	if(poller->fd == -1)
+	{
+		free(poller);
+		return NULL;
+	}
+
+	return poller;
+}
+
+void
+poller_free(poller_t *poller)
+{
+	if(poller != NULL)
+	{
+		close(poller->fd);
+		free(poller);
+	}
+}
+
+int
+poller_add(poller_t *poller, int fd, void *data)
+{
+	struct epoll_event e = { .events = EPOLLIN, .data.ptr = data };
+	return (epoll_ctl(poller->fd, EPOLL_CTL_ADD, fd, &e) != 0);
+}
+
+void
+poller_remove(poller_t *poller, int fd)
+{
+	/* Non-NULL event is for compatibility with kernels older than 2.6.9. */
+	struct epoll_event e = { .events = 0 };
+	(void)epoll_ctl(poller->fd, EPOLL_CTL_DEL, fd, &e);
+}
+
+int
+poller_wait(poller_t *poller, int timeout, void *ready[], int max)
+{
+	enum { MAX_EVENTS = 64 };
+
+	struct epoll_event events[MAX_EVENTS];
+	int i;
+
+	const int n = epoll_wait(poller->fd, events, MIN(max, MAX_EVENTS),
+			timeout < 0 ? -1 : timeout);
+	if(n < 0)
+	{
+		return (errno == EINTR ? 0 : -1);
+	}
+
+	for(i = 0; i < n; ++i)
+	{
+		ready[i] = events[i].data.ptr;
+	}
+	return n;
+}
+
+#else
+
+/* Poller state. */
+struct poller_t
+{
+	struct pollfd *fds; /* Descriptors. */
+	void **data;        /* Data associated with descriptors. */
+	int count;          /* Number of descriptors. */
+	int capacity;       /* Number of allocated elements. */
+	int next;           /* Where to start next scan to be fair to all. */
+};
+
+poller_t *
+poller_create(void)
+{
+	return calloc(1, sizeof(poller_t));
+}
+
+void
+poller_free(poller_t *poller)
+{
+	if(poller != NULL)
+	{
+		free(poller->fds);
+		free(poller->data);
+		free(poller);
+	}
+}
+
+int
+poller_add(poller_t *poller, int fd, void *data)
+{
+	if(poller->count == poller->capacity)
+	{
+		const int capacity = poller->capacity*2 + 8;
+		struct pollfd *fds;
+		void **datas;
+
+		fds = reallocarray(poller->fds, capacity, sizeof(*fds));
+		if(fds == NULL)
+		{
+			return 1;
+		}
+		poller->fds = fds;
+
+		datas = reallocarray(poller->data, capacity, sizeof(*datas));
+		if(datas == NULL)
+		{
+			return 1;
+		}
+		poller->data = datas;
+
+		poller->capacity = capacity;
+	}
+
+	poller->fds[poller->count].fd = fd;
+	poller->fds[poller->count].events = POLLIN;
+	poller->fds[poller->count].revents = 0;
+	poller->data[poller->count] = data;
+	++poller->count;
+	return 0;
+}
+
+void
+poller_remove(poller_t *poller, int fd)
+{
+	int i;
+	for(i = 0; i < poller->count; ++i)
+	{
+		if(poller->fds[i].fd == fd)
+		{
+			--poller->count;
+			poller->fds[i] = poller->fds[poller->count];
+			poller->data[i] = poller->data[poller->count];
+			break;
+		}
+	}
+}
+
+int
+poller_wait(poller_t *poller, int timeout, void *ready[], int max)
+{
+	int i;
+	int n = 0;
+
+	if(poll(poller->fds, poller->count, timeout < 0 ? -1 : timeout) < 0)
+	{
+		return (errno == EINTR ? 0 : -1);
+	}
+
+	for(i = 0; i < poller->count && n < max; ++i)
+	{
+		const int idx = (poller->next + i)%poller->count;
+		if(poller->fds[idx].revents & (POLLIN | POLLHUP | POLLERR))
+		{
+			ready[n++] = poller->data[idx];
+		}
+	}
+
+	if(poller->count != 0)
+	{
+		poller->next = (poller->next + 1)%poller->count;
+	}
+	return n;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
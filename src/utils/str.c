@@ -221,7 +221,7 @@ to_multibyte(const wchar_t s[])
 int
 str_to_lower(const char str[], char buf[], size_t buf_len)
 {
-	if(utf8_stro(str) == 0U)
+	if(utf8_is_ascii(str) || utf8_stro(str) == 0U)
 	{
 		return transform_ascii_str(str, &tolower, buf, buf_len);
 	}
@@ -234,7 +234,7 @@ str_to_lower(const char str[], char buf[], size_t buf_len)
 int
 str_to_upper(const char str[], char buf[], size_t buf_len)
 {
-	if(utf8_stro(str) == 0U)
+	if(utf8_is_ascii(str) || utf8_stro(str) == 0U)
 	{
 		return transform_ascii_str(str, &toupper, buf, buf_len);
 	}
@@ -377,6 +377,23 @@ strossorter(const void *s, const void *t)
 	return stroscmp(*(const char **)s, *(const char **)t);
 }
 
+char *
+stroskey(const char s[])
+{
+	char *const key = strdup(s);
+#ifdef _WIN32
+	if(key != NULL)
+	{
+		char *p;
+		for(p = key; *p != '\0'; ++p)
+		{
+			*p = tolower((unsigned char)*p);
+		}
+	}
+#endif
+	return key;
+}
+
 char *
 after_last(const char *str, char c)
 {
@@ -130,6 +130,11 @@ int strnoscmp(const char *s, const char *t, size_t n);
 /* Wraps stroscmp() for use with qsort(). */
 int strossorter(const void *s, const void *t);
 
+/* Converts string into a form in which strings equal according to stroscmp()
+ * are identical, which is useful for keys of lookup tables.  Returns newly
+ * allocated string or NULL on error. */
+char * stroskey(const char s[]);
+
 /* Returns pointer to first character after last occurrence of c in str or
  * str. */
 char * after_last(const char *str, char c);
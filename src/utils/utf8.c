@@ -25,12 +25,23 @@
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t wchar_t */
 #include <stdlib.h> /* malloc() */
-#include <string.h> /* strlen() */
+#include <string.h> /* memchr() memcpy() strlen() */
 
 #include "../compat/reallocarray.h"
 #include "macros.h"
 #include "utils.h"
 
+/* Word with the lowest bit of each byte set, used to process several bytes at
+ * once. */
+#define ONES ((size_t)-1/0xff)
+/* Word with the highest bit of each byte set. */
+#define HIGHS (ONES*0x80)
+/* Checks whether any byte of the word is less than n, which must not exceed
+ * 0x80. */
+#define HAS_LESS(word, n) ((((word) - ONES*(n)) & ~(word) & HIGHS) != 0)
+
+static size_t ascii_prefix_len(const char str[], size_t len);
+static size_t printable_prefix_len(const char str[], size_t len);
 static size_t guess_char_width(char c);
 static wchar_t utf8_char_to_wchar(const char str[], size_t char_width);
 static size_t chrsw(const char str[], size_t char_width);
@@ -51,6 +62,60 @@ utf8_chrw(const char str[])
 	return 1;
 }
 
+/* Counts leading ASCII characters among the first len bytes of the string,
+ * which must not contain null character.  Returns the count. */
+static size_t
+ascii_prefix_len(const char str[], size_t len)
+{
+	size_t i = 0U;
+
+	while(len - i >= sizeof(size_t))
+	{
+		size_t word;
+		memcpy(&word, &str[i], sizeof(word));
+		if((word & HIGHS) != 0)
+		{
+			break;
+		}
+		i += sizeof(word);
+	}
+
+	while(i < len && (unsigned char)str[i] < 0x80)
+	{
+		++i;
+	}
+
+	return i;
+}
+
+/* Counts leading printable ASCII characters (each of which occupies single
+ * position on the screen) among the first len bytes of the string, which must
+ * not contain null character.  Returns the count. */
+static size_t
+printable_prefix_len(const char str[], size_t len)
+{
+	size_t i = 0U;
+
+	while(len - i >= sizeof(size_t))
+	{
+		size_t word;
+		memcpy(&word, &str[i], sizeof(word));
+		if((word & HIGHS) != 0 || HAS_LESS(word, ' ') ||
+				HAS_LESS(word ^ ONES*0x7f, 1))
+		{
+			break;
+		}
+		i += sizeof(word);
+	}
+
+	while(i < len && str[i] >= ' ' && str[i] < 0x7f)
+	{
+		++i;
+	}
+
+	return i;
+}
+
 /* Determines width of a utf-8 character by its first byte. */
 static size_t
 guess_char_width(char c)
@@ -67,7 +132,14 @@ guess_char_width(char c)
 size_t
 utf8_strsnlen(const char str[], size_t max_screen_width)
 {
-	size_t width = 0;
+	/* Length of the string isn't known and can be much bigger than the limit, so
+	 * only leading printable ASCII characters are skipped at once. */
+	const char *const nul = memchr(str, '\0', max_screen_width);
+	size_t width = printable_prefix_len(str, (nul == NULL) ? max_screen_width
+	                                                       : (size_t)(nul - str));
+	str += width;
+	max_screen_width -= width;
+
 	while(*str != '\0' && max_screen_width != 0)
 	{
 		size_t char_width = utf8_chrw(str);
@@ -111,7 +183,18 @@ utf8_nstrsnlen(const char str[], size_t max_screen_width)
 	while(length_left != 0 && max_screen_width > 0)
 	{
 		size_t char_screen_width;
-		const size_t char_width = utf8_chrw(str);
+		size_t char_width = printable_prefix_len(str,
+				MIN(length_left, max_screen_width));
+		if(char_width != 0)
+		{
+			length += char_width;
+			max_screen_width -= char_width;
+			str += char_width;
+			length_left -= char_width;
+			continue;
+		}
+
+		char_width = utf8_chrw(str);
 		if(char_width > length_left)
 		{
 			break;
@@ -155,12 +238,24 @@ utf8_char_to_wchar(const char str[], size_t char_width)
 size_t
 utf8_strsw(const char str[])
 {
+	size_t length_left = strlen(str);
 	size_t length = 0;
-	while(*str != '\0')
+	while(length_left != 0)
 	{
-		const size_t char_width = utf8_chrw(str);
-		const size_t char_screen_width = chrsw(str, char_width);
+		size_t char_screen_width;
+		size_t char_width = printable_prefix_len(str, length_left);
+		if(char_width != 0)
+		{
+			str += char_width;
+			length_left -= char_width;
+			length += char_width;
+			continue;
+		}
+
+		char_width = utf8_chrw(str);
+		char_screen_width = chrsw(str, char_width);
 		str += char_width;
+		length_left -= char_width;
 		length += char_screen_width;
 	}
 	return length;
@@ -235,6 +330,13 @@ utf8_strso(const char str[])
 	return overhead;
 }
 
+int
+utf8_is_ascii(const char str[])
+{
+	const size_t len = strlen(str);
+	return (ascii_prefix_len(str, len) == len);
+}
+
 size_t
 utf8_strcpy(char dst[], const char src[], size_t dst_len)
 {
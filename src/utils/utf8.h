@@ -67,6 +67,10 @@ size_t utf8_stro(const char str[]);
  * Returns the overhead. */
 size_t utf8_strso(const char str[]);
 
+/* Checks whether string consists of ASCII characters only.  Returns non-zero
+ * if so, otherwise zero is returned. */
+int utf8_is_ascii(const char str[]);
+
 /* Copies as many full utf-8 characters from source to destination as size of
  * destination buffer permits.  Returns number of actually copied bytes
  * including terminating null character. */
@@ -175,7 +175,8 @@ char * parse_file_spec(const char spec[], int *line_num, const char cwd[]);
  * Returns non-zero on error, otherwise zero is returned. */
 int get_mount_point(const char path[], size_t buf_len, char buf[]);
 
-/* Calls client traverser for each mount point.  Returns non-zero on error,
+/* Calls client traverser for each mount point.  Can be used from multiple
+ * threads, but client must not call this function.  Returns non-zero on error,
  * otherwise zero is returned. */
 int traverse_mount_points(mptraverser client, void *arg);
 
@@ -233,12 +234,14 @@ void stop_process(void);
 void update_terminal_settings(void);
 
 /* Fills the buffer with string representation of owner user for the entry.  The
- * as_num flag forces formatting as integer. */
+ * as_num flag forces formatting as integer.  Names are cached for some time to
+ * avoid querying user database on every call. */
 void get_uid_string(const struct dir_entry_t *entry, int as_num, size_t buf_len,
 		char buf[]);
 
 /* Fills the buffer with string representation of owner group for the entry.
- * The as_num flag forces formatting as integer. */
+ * The as_num flag forces formatting as integer.  Names are cached for some time
+ * to avoid querying group database on every call. */
 void get_gid_string(const struct dir_entry_t *entry, int as_num, size_t buf_len,
 		char buf[]);
 
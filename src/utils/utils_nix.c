@@ -37,10 +37,12 @@
 #include <sys/wait.h> /* waitpid */
 #include <fcntl.h> /* open() close() */
 #include <grp.h> /* getgrnam() getgrgid_r() */
-#include <pthread.h> /* pthread_sigmask() */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_t
+                       pthread_mutex_lock() pthread_mutex_unlock()
+                       pthread_sigmask() */
 #include <pwd.h> /* getpwnam() getpwuid_r() */
 #include <unistd.h> /* X_OK chown() dup() dup2() getpid() isatty() pause()
-                       sysconf() ttyname() */
+                       setpgid() sysconf() ttyname() */
 
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
@@ -49,8 +51,10 @@
                        sigfillset() signal() sigprocmask() */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE stderr fclose() fdopen() fprintf() snprintf() */
-#include <stdlib.h> /* atoi() free() */
-#include <string.h> /* strchr() strdup() strerror() strlen() strncmp() */
+#include <stdlib.h> /* atoi() free() realloc() */
+#include <string.h> /* memcpy() strchr() strdup() strerror() strlen()
+                       strncmp() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() time() time_t timespec */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
@@ -91,6 +95,24 @@ typedef struct
 }
 get_mount_point_traverser_state;
 
+/* Number of slots in caches of names of users and groups. */
+#define ID_CACHE_SIZE 64
+
+/* Number of seconds during which names of users and groups are considered to be
+ * up to date.  Looking them up might involve network requests (e.g., for LDAP),
+ * so they aren't queried on every redraw. */
+#define ID_NAME_TTL 60
+
+/* Element of cache of names of users or groups. */
+typedef struct
+{
+	unsigned long id; /* User or group id. */
+	time_t time;      /* When the name was looked up. */
+	char name[26];    /* Name or numerical id if there is no name.  Empty string
+	                     for an unused slot. */
+}
+id_name_t;
+
 static int get_mount_info_traverser(struct mntent *entry, void *arg);
 static void free_mnt_entries(struct mntent *entries, unsigned int nentries);
 static struct mntent * read_mnt_entries(unsigned int *nentries);
@@ -102,6 +124,16 @@ static int open_tty(void);
 static void clone_timestamps(const char path[], const char from[],
 		const struct stat *st);
 static void clone_xattrs(const char path[], const char from[]);
+static const char * get_id_name(id_name_t cache[], unsigned long id,
+		int is_group);
+static void lookup_user_name(uid_t uid, char buf[], size_t buf_len);
+static void lookup_group_name(gid_t gid, char buf[], size_t buf_len);
+static int start_cmd_for_reading(const char cmd[], const char dir[],
+		pid_t *pid);
+static char * collect_output(pid_t pid, int fd,
+		const cancellation_t *cancellation, int max_lines, size_t *len);
+static void add_msecs(struct timespec *ts, int msecs);
+static int wait_for_data_until(int fd, const struct timespec *deadline);
 
 void
 pause_shell(void)
@@ -306,15 +338,11 @@ prepare_for_exec(void)
 	{
 		view_t *view = tab_info.view;
 		fswatch_free(view->watch);
-		fswatch_free(view->left_column.watch);
-		fswatch_free(view->right_column.watch);
 	}
 	for(i = 0; tabs_enum(&rwin, i, &tab_info); ++i)
 	{
 		view_t *view = tab_info.view;
 		fswatch_free(view->watch);
-		fswatch_free(view->left_column.watch);
-		fswatch_free(view->right_column.watch);
 	}
 }
 
@@ -539,7 +567,9 @@ get_mount_info_traverser(struct mntent *entry, void *arg)
 int
 traverse_mount_points(mptraverser client, void *arg)
 {
-	/* Cached mount entries, updated only when /etc/mtab changes. */
+	/* Cached mount entries, updated only when /etc/mtab changes.  The cache is
+	 * also used by background threads. */
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 	static filemon_t mtab_mon;
 	static struct mntent *entries;
 	static unsigned int nentries;
@@ -547,6 +577,8 @@ traverse_mount_points(mptraverser client, void *arg)
 	filemon_t mon;
 	unsigned int i;
 
+	pthread_mutex_lock(&lock);
+
 	/* Check for cache validity. */
 	if(filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon) != 0 ||
 			!filemon_equal(&mon, &mtab_mon))
@@ -558,6 +590,7 @@ traverse_mount_points(mptraverser client, void *arg)
 
 	if(nentries == 0U)
 	{
+		pthread_mutex_unlock(&lock);
 		return 1;
 	}
 
@@ -569,6 +602,7 @@ traverse_mount_points(mptraverser client, void *arg)
 		}
 	}
 
+	pthread_mutex_unlock(&lock);
 	return 0;
 }
 
@@ -834,79 +868,107 @@ update_terminal_settings(void)
 void
 get_uid_string(const dir_entry_t *entry, int as_num, size_t buf_len, char buf[])
 {
-	/* Cache for the last requested user id. */
-	static uid_t last_uid = (uid_t)-1;
-	static char uid_buf[26];
+	static id_name_t cache[ID_CACHE_SIZE];
 
-	if(entry->uid == last_uid)
+	if(as_num)
 	{
-		copy_str(buf, buf_len, uid_buf);
+		snprintf(buf, buf_len, "%d", (int)entry->uid);
 		return;
 	}
 
-	last_uid = entry->uid;
-	snprintf(uid_buf, sizeof(uid_buf), "%d", (int)last_uid);
+	copy_str(buf, buf_len, get_id_name(cache, entry->uid, 0));
+}
 
-	if(!as_num)
-	{
-		enum { MAX_TRIES = 4 };
-		size_t size = MAX(sysconf(_SC_GETPW_R_SIZE_MAX) + 1, PATH_MAX);
-		int i;
-		for(i = 0; i < MAX_TRIES; ++i, size *= 2)
-		{
-			char buf[size];
-			struct passwd pwd_b;
-			struct passwd *pwd_buf;
+void
+get_gid_string(const dir_entry_t *entry, int as_num, size_t buf_len, char buf[])
+{
+	static id_name_t cache[ID_CACHE_SIZE];
 
-			if(getpwuid_r(last_uid, &pwd_b, buf, sizeof(buf), &pwd_buf) == 0 &&
-					pwd_buf != NULL)
-			{
-				copy_str(uid_buf, sizeof(uid_buf), pwd_buf->pw_name);
-				break;
-			}
-		}
+	if(as_num)
+	{
+		snprintf(buf, buf_len, "%d", (int)entry->gid);
+		return;
 	}
 
-	copy_str(buf, buf_len, uid_buf);
+	copy_str(buf, buf_len, get_id_name(cache, entry->gid, 1));
 }
 
-void
-get_gid_string(const dir_entry_t *entry, int as_num, size_t buf_len, char buf[])
+/* Retrieves name of a user or a group by its id consulting the cache first.
+ * Returns pointer to the name inside the cache. */
+static const char *
+get_id_name(id_name_t cache[], unsigned long id, int is_group)
 {
-	/* Cache for the last requested group id. */
-	static gid_t last_gid = (gid_t)-1;
-	static char gid_buf[26];
+	id_name_t *const slot = &cache[id%ID_CACHE_SIZE];
+	const time_t now = time(NULL);
 
-	if(entry->gid == last_gid)
+	/* Clock going backwards also invalidates the cached name. */
+	if(slot->name[0] != '\0' && slot->id == id && slot->time <= now &&
+			now - slot->time < ID_NAME_TTL)
 	{
-		copy_str(buf, buf_len, gid_buf);
-		return;
+		return slot->name;
 	}
 
-	last_gid = entry->gid;
-	snprintf(gid_buf, sizeof(gid_buf), "%d", (int)last_gid);
+	slot->id = id;
+	slot->time = now;
+	if(is_group)
+	{
+		lookup_group_name((gid_t)id, slot->name, sizeof(slot->name));
+	}
+	else
+	{
+		lookup_user_name((uid_t)id, slot->name, sizeof(slot->name));
+	}
+	return slot->name;
+}
+
+/* Queries name of the user falling back to its numerical id. */
+static void
+lookup_user_name(uid_t uid, char buf[], size_t buf_len)
+{
+	enum { MAX_TRIES = 4 };
+	size_t size = MAX(sysconf(_SC_GETPW_R_SIZE_MAX) + 1, PATH_MAX);
+	int i;
+
+	snprintf(buf, buf_len, "%d", (int)uid);
 
-	if(!as_num)
+	for(i = 0; i < MAX_TRIES; ++i, size *= 2)
 	{
-		enum { MAX_TRIES = 4 };
-		size_t size = MAX(sysconf(_SC_GETGR_R_SIZE_MAX) + 1, PATH_MAX);
-		int i;
-		for(i = 0; i < MAX_TRIES; ++i, size *= 2)
-		{
-			char buf[size];
-			struct group group_b;
-			struct group *group_buf;
+		char pwd_data[size];
+		struct passwd pwd_b;
+		struct passwd *pwd_buf;
 
-			if(getgrgid_r(last_gid, &group_b, buf, sizeof(buf), &group_buf) == 0 &&
-					group_buf != NULL)
-			{
-				copy_str(gid_buf, sizeof(gid_buf), group_buf->gr_name);
-				break;
-			}
+		if(getpwuid_r(uid, &pwd_b, pwd_data, sizeof(pwd_data), &pwd_buf) == 0 &&
+				pwd_buf != NULL)
+		{
+			copy_str(buf, buf_len, pwd_buf->pw_name);
+			break;
 		}
 	}
+}
+
+/* Queries name of the group falling back to its numerical id. */
+static void
+lookup_group_name(gid_t gid, char buf[], size_t buf_len)
+{
+	enum { MAX_TRIES = 4 };
+	size_t size = MAX(sysconf(_SC_GETGR_R_SIZE_MAX) + 1, PATH_MAX);
+	int i;
+
+	snprintf(buf, buf_len, "%d", (int)gid);
+
+	for(i = 0; i < MAX_TRIES; ++i, size *= 2)
+	{
+		char group_data[size];
+		struct group group_b;
+		struct group *group_buf;
 
-	copy_str(buf, buf_len, gid_buf);
+		if(getgrgid_r(gid, &group_b, group_data, sizeof(group_data),
+					&group_buf) == 0 && group_buf != NULL)
+		{
+			copy_str(buf, buf_len, group_buf->gr_name);
+			break;
+		}
+	}
 }
 
 FILE *
@@ -1044,6 +1106,262 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	return fp;
 }
 
+char *
+read_cmd_output_timed(const char cmd[], int timeout, size_t *len)
+{
+	/* How long to wait for the command to exit after each signal. */
+	enum { GRACE_PERIOD = 1000 };
+
+	pid_t pid;
+	struct timespec deadline;
+	char *output = NULL;
+	size_t output_len = 0U;
+	int nsignals = 0;
+
+	const int fd = start_cmd_for_reading(cmd, NULL, &pid);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+	add_msecs(&deadline, timeout);
+
+	while(1)
+	{
+		char buf[4096];
+		ssize_t nread;
+		char *new_output;
+
+		/* The command is interrupted once deadline is reached and killed along
+		 * with its children if that doesn't help.  The pipe might still be kept
+		 * open by processes that left the group, so give up after that. */
+		if(!wait_for_data_until(fd, &deadline))
+		{
+			if(nsignals == 2)
+			{
+				break;
+			}
+
+			(void)kill(-pid, nsignals == 0 ? SIGINT : SIGKILL);
+			++nsignals;
+			add_msecs(&deadline, GRACE_PERIOD);
+			continue;
+		}
+
+		nread = read(fd, buf, sizeof(buf));
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread <= 0)
+		{
+			break;
+		}
+
+		new_output = realloc(output, output_len + nread + 1U);
+		if(new_output == NULL)
+		{
+			break;
+		}
+		output = new_output;
+
+		memcpy(output + output_len, buf, nread);
+		output_len += nread;
+		output[output_len] = '\0';
+	}
+
+	close(fd);
+
+	if(output == NULL)
+	{
+		output = strdup("");
+	}
+	*len = output_len;
+	return output;
+}
+
+char *
+read_cmd_output_cancellable(const char cmd[], const char dir[], int max_lines,
+		const cancellation_t *cancellation, size_t *len)
+{
+	pid_t pid;
+	char *output;
+
+	const int fd = start_cmd_for_reading(cmd, dir, &pid);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	output = collect_output(pid, fd, cancellation, max_lines, len);
+	close(fd);
+	return output;
+}
+
+/* Starts the command in a shell with its output redirected to a pipe.  The
+ * command is run in the dir directory unless it's NULL.  Stores id of the
+ * process in *pid.  Returns read end of the pipe or -1 on error. */
+static int
+start_cmd_for_reading(const char cmd[], const char dir[], pid_t *pid)
+{
+	int out_pipe[2];
+
+	if(pipe(out_pipe) != 0)
+	{
+		return -1;
+	}
+
+	*pid = fork();
+	if(*pid == (pid_t)-1)
+	{
+		close(out_pipe[0]);
+		close(out_pipe[1]);
+		return -1;
+	}
+
+	if(*pid == 0)
+	{
+		/* The caller might have blocked signals, which shouldn't affect the
+		 * command as it needs to react on SIGINT and SIGPIPE. */
+		sigset_t set;
+		sigemptyset(&set);
+		pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+		/* Make a process group to be able to kill the command along with all of
+		 * its children. */
+		(void)setpgid(0, 0);
+
+		if(dir != NULL && chdir(dir) != 0)
+		{
+			_Exit(EXIT_FAILURE);
+		}
+		run_from_fork(out_pipe, 0, 0, (char *)cmd, SHELL_BY_USER);
+	}
+
+	/* Avoid racing with the child to become leader of process group. */
+	(void)setpgid(*pid, *pid);
+
+	/* Close write end of pipe. */
+	close(out_pipe[1]);
+	return out_pipe[0];
+}
+
+/* Reads output of the process until end of file, max_lines complete lines or
+ * cancellation.  The process is interrupted on cancellation, but isn't waited
+ * for.  Returns newly allocated string of length *len or NULL on error or
+ * cancellation. */
+static char *
+collect_output(pid_t pid, int fd, const cancellation_t *cancellation,
+		int max_lines, size_t *len)
+{
+	char *output = NULL;
+	size_t output_len = 0U;
+	int lines = 0;
+
+	while(lines < max_lines)
+	{
+		struct timeval ts = { .tv_sec = 0, .tv_usec = 10000 };
+		fd_set read_ready;
+		char buf[4096];
+		ssize_t nread;
+		char *new_output;
+
+		if(cancellation_requested(cancellation))
+		{
+			(void)kill(pid, SIGINT);
+			free(output);
+			return NULL;
+		}
+
+		FD_ZERO(&read_ready);
+		FD_SET(fd, &read_ready);
+		const int ready = select(fd + 1, &read_ready, NULL, NULL, &ts);
+		if(ready == 0 || (ready == -1 && errno == EINTR))
+		{
+			continue;
+		}
+
+		nread = read(fd, buf, sizeof(buf));
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread <= 0)
+		{
+			break;
+		}
+
+		new_output = realloc(output, output_len + nread + 1U);
+		if(new_output == NULL)
+		{
+			break;
+		}
+		output = new_output;
+
+		memcpy(output + output_len, buf, nread);
+		output_len += nread;
+		output[output_len] = '\0';
+
+		lines += chars_in_str(output + output_len - nread, '\n');
+	}
+
+	if(output == NULL)
+	{
+		output = strdup("");
+	}
+	*len = output_len;
+	return output;
+}
+
+/* Moves time point forward by the specified number of milliseconds. */
+static void
+add_msecs(struct timespec *ts, int msecs)
+{
+	ts->tv_sec += msecs/1000;
+	ts->tv_nsec += (msecs%1000)*1000000L;
+	if(ts->tv_nsec >= 1000000000L)
+	{
+		++ts->tv_sec;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/* Waits for the descriptor to become readable or for the deadline to pass.
+ * Returns non-zero if there is something to read (or an error to report),
+ * otherwise zero is returned. */
+static int
+wait_for_data_until(int fd, const struct timespec *deadline)
+{
+	while(1)
+	{
+		struct timespec now;
+		struct timeval ts;
+		fd_set read_ready;
+		long long left;
+		int result;
+
+		(void)clock_gettime(CLOCK_MONOTONIC, &now);
+		left = (deadline->tv_sec - now.tv_sec)*1000000LL
+		     + (deadline->tv_nsec - now.tv_nsec)/1000;
+		if(left <= 0)
+		{
+			return 0;
+		}
+
+		ts.tv_sec = left/1000000;
+		ts.tv_usec = left%1000000;
+		FD_ZERO(&read_ready);
+		FD_SET(fd, &read_ready);
+
+		result = select(fd + 1, &read_ready, NULL, NULL, &ts);
+		if(result != -1 || errno != EINTR)
+		{
+			return (result != 0);
+		}
+	}
+}
+
 const char *
 get_installed_data_dir(void)
 {
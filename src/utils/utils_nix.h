@@ -46,6 +46,23 @@ int get_proc_exit_status(pid_t pid);
 void _gnuc_noreturn run_from_fork(int pipe[2], int err_only, int preserve_stdin,
 		char cmd[], ShellRequester by);
 
+/* Runs command in a shell and collects its output (joined standard output and
+ * standard error streams).  The command is interrupted if it runs for longer
+ * than timeout milliseconds, killed if it doesn't stop after that and
+ * abandoned if its output is still open a second later.  Unlike
+ * read_cmd_output(), can be used outside of the main thread.  Returns newly
+ * allocated string of length *len or NULL on error. */
+char * read_cmd_output_timed(const char cmd[], int timeout, size_t *len);
+
+/* Runs command in a shell inside the dir directory and collects its output
+ * (joined standard output and standard error streams) until it ends or
+ * max_lines lines are read.  The command is interrupted and its output is
+ * dropped on cancellation.  Can be used outside of the main thread.  Returns
+ * newly allocated string of length *len or NULL on error or cancellation. */
+char * read_cmd_output_cancellable(const char cmd[], const char dir[],
+		int max_lines,
+		const struct cancellation_t *cancellation, size_t *len);
+
 /* Frees some resources before exec(), which shouldn't be inherited and remain
  * allocated in child process or it might make those resources appear busy
  * (e.g., pipe not being closed, directory being still in use). */
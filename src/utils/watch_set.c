@@ -0,0 +1,565 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "watch_set.h"
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h> /* IN_* inotify_* */
+#include <unistd.h> /* close() read() */
+
+#include <errno.h> /* EAGAIN errno */
+#endif
+
+#include <pthread.h> /* PTHREAD_* pthread_mutex_* */
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* strcmp() strdup() */
+
+#include "../compat/fs_limits.h"
+#include "filemon.h"
+
+/* Single watched directory. */
+typedef struct
+{
+	char *path;    /* Path to the directory or NULL for unused slot. */
+	int refs;      /* Number of users of the watch. */
+	int wd;        /* Watch descriptor or -1 when timestamps are used. */
+	int gone;      /* Whether the watch doesn't work anymore. */
+	filemon_t mon; /* Timestamp of the directory when inotify isn't used. */
+}
+watch_t;
+
+/* State of a set of watches. */
+struct watch_set_t
+{
+	int fd;               /* File descriptor for inotify or -1. */
+	int track_writes;     /* Whether writes are reported before closing files. */
+	pthread_mutex_t lock; /* Protects the rest of the fields. */
+	watch_t *watches;     /* Slots of watches indexed by their identifiers. */
+	int count;            /* Number of slots (used or not). */
+
+	/* Hash table that maps watch descriptors to identifiers of watches (-1 marks
+	 * free slot).  Its size is a power of two and is at least twice as big as
+	 * the number of descriptors in it. */
+	int *wds;
+	unsigned int wds_size; /* Size of the wds table. */
+	int nwds;              /* Number of descriptors in the wds table. */
+};
+
+static int find_watch(const watch_set_t *set, int wd, const char path[]);
+static int alloc_slot(watch_set_t *set);
+#ifdef HAVE_INOTIFY
+static int lookup_wd(const watch_set_t *set, int wd);
+static int insert_wd(watch_set_t *set, int id);
+static void put_wd(watch_set_t *set, int id);
+static void remove_wd(watch_set_t *set, int id);
+static unsigned int hash_wd(int wd);
+#endif
+static void check_events(watch_set_t *set, watch_set_cb cb, void *arg);
+static void report_all(watch_set_t *set, watch_set_cb cb, void *arg);
+static void check_stamps(watch_set_t *set, watch_set_cb cb, void *arg);
+static void report_gone(watch_set_t *set, watch_set_cb cb, void *arg);
+
+watch_set_t *
+watch_set_create(int track_writes)
+{
+	watch_set_t *const set = calloc(1, sizeof(*set));
+	if(set == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&set->lock, NULL) != 0)
+	{
+		free(set);
+		return NULL;
+	}
+
+#ifdef HAVE_INOTIFY
+	set->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+	set->fd = -1;
+#endif
+	set->track_writes = track_writes;
+
+	return set;
+}
+
+void
+watch_set_free(watch_set_t *set)
+{
+	int i;
+
+	if(set == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < set->count; ++i)
+	{
+		free(set->watches[i].path);
+	}
+	free(set->watches);
+	free(set->wds);
+
+#ifdef HAVE_INOTIFY
+	if(set->fd != -1)
+	{
+		close(set->fd);
+	}
+#endif
+
+	pthread_mutex_destroy(&set->lock);
+	free(set);
+}
+
+int
+watch_set_add(watch_set_t *set, const char path[])
+{
+	int id;
+	int wd = -1;
+	filemon_t mon;
+
+	pthread_mutex_lock(&set->lock);
+
+	if(set->fd != -1)
+	{
+#ifdef HAVE_INOTIFY
+		/* By default changes of files are reported on closing them to avoid flood
+		 * of events from files that are being written to. */
+		wd = inotify_add_watch(set->fd, path, IN_ATTRIB | IN_CREATE | IN_DELETE |
+				IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+				IN_CLOSE_WRITE | IN_EXCL_UNLINK | IN_ONLYDIR |
+				(set->track_writes ? IN_MODIFY : 0));
+#endif
+		if(wd < 0)
+		{
+			pthread_mutex_unlock(&set->lock);
+			return -1;
+		}
+	}
+	else if(filemon_from_file(path, FMT_MODIFIED, &mon) != 0)
+	{
+		pthread_mutex_unlock(&set->lock);
+		return -1;
+	}
+
+	/* Adding a watch for already watched directory yields the same descriptor,
+	 * so such watches are shared. */
+	id = find_watch(set, wd, path);
+	if(id != -1)
+	{
+		++set->watches[id].refs;
+		pthread_mutex_unlock(&set->lock);
+		return id;
+	}
+
+	id = alloc_slot(set);
+	if(id != -1)
+	{
+		set->watches[id].path = strdup(path);
+		set->watches[id].wd = wd;
+		if(set->watches[id].path == NULL)
+		{
+			id = -1;
+		}
+	}
+
+#ifdef HAVE_INOTIFY
+	if(id != -1 && wd != -1 && insert_wd(set, id) != 0)
+	{
+		free(set->watches[id].path);
+		set->watches[id].path = NULL;
+		id = -1;
+	}
+#endif
+
+	if(id == -1)
+	{
+#ifdef HAVE_INOTIFY
+		if(wd != -1)
+		{
+			(void)inotify_rm_watch(set->fd, wd);
+		}
+#endif
+		pthread_mutex_unlock(&set->lock);
+		return -1;
+	}
+
+	set->watches[id].refs = 1;
+	set->watches[id].gone = 0;
+	if(wd == -1)
+	{
+		filemon_assign(&set->watches[id].mon, &mon);
+	}
+
+	pthread_mutex_unlock(&set->lock);
+	return id;
+}
+
+void
+watch_set_remove(watch_set_t *set, int id)
+{
+	pthread_mutex_lock(&set->lock);
+
+	if(id >= 0 && id < set->count && set->watches[id].path != NULL &&
+			--set->watches[id].refs == 0)
+	{
+		watch_t *const watch = &set->watches[id];
+#ifdef HAVE_INOTIFY
+		if(watch->wd != -1)
+		{
+			remove_wd(set, id);
+			(void)inotify_rm_watch(set->fd, watch->wd);
+		}
+#endif
+		free(watch->path);
+		watch->path = NULL;
+	}
+
+	pthread_mutex_unlock(&set->lock);
+}
+
+void
+watch_set_check(watch_set_t *set, watch_set_cb cb, void *arg)
+{
+	pthread_mutex_lock(&set->lock);
+
+	if(set->fd != -1)
+	{
+		check_events(set, cb, arg);
+	}
+	else
+	{
+		check_stamps(set, cb, arg);
+	}
+	report_gone(set, cb, arg);
+
+	pthread_mutex_unlock(&set->lock);
+}
+
+int
+watch_set_get_fd(const watch_set_t *set)
+{
+	return set->fd;
+}
+
+/* Looks up a working watch by its descriptor or by path if descriptor is -1.
+ * Returns identifier of the watch or -1. */
+static int
+find_watch(const watch_set_t *set, int wd, const char path[])
+{
+	int i;
+
+#ifdef HAVE_INOTIFY
+	if(wd != -1)
+	{
+		return lookup_wd(set, wd);
+	}
+#endif
+
+	for(i = 0; i < set->count; ++i)
+	{
+		const watch_t *const watch = &set->watches[i];
+		if(watch->path == NULL || watch->gone)
+		{
+			continue;
+		}
+
+		if(strcmp(watch->path, path) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Finds an unused slot or makes a new one.  Returns identifier of the slot or
+ * -1 on error. */
+static int
+alloc_slot(watch_set_t *set)
+{
+	int i;
+	watch_t *watches;
+
+	for(i = 0; i < set->count; ++i)
+	{
+		if(set->watches[i].path == NULL)
+		{
+			return i;
+		}
+	}
+
+	watches = realloc(set->watches, sizeof(*watches)*(set->count + 1));
+	if(watches == NULL)
+	{
+		return -1;
+	}
+
+	set->watches = watches;
+	set->watches[set->count].path = NULL;
+	return set->count++;
+}
+
+/* Reports watches that have received events since the last call. */
+static void
+check_events(watch_set_t *set, watch_set_cb cb, void *arg)
+{
+#ifdef HAVE_INOTIFY
+	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
+
+	char buf[BUF_LEN];
+
+	while(1)
+	{
+		char *p;
+		const struct inotify_event *e;
+
+		const ssize_t nread = read(set->fd, buf, sizeof(buf));
+		if(nread <= 0)
+		{
+			/* Don't trust anything if we failed to receive events. */
+			if(nread < 0 && errno != EAGAIN)
+			{
+				report_all(set, cb, arg);
+			}
+			break;
+		}
+
+		for(p = buf; p < buf + nread; p += sizeof(*e) + e->len)
+		{
+			int id;
+
+			e = (const struct inotify_event *)p;
+			if(e->mask & IN_Q_OVERFLOW)
+			{
+				report_all(set, cb, arg);
+				continue;
+			}
+
+			id = find_watch(set, e->wd, NULL);
+			if(id == -1)
+			{
+				continue;
+			}
+
+			/* Watch is gone (e.g., directory was removed), the descriptor is
+			 * released by the system. */
+			if(e->mask & IN_IGNORED)
+			{
+				remove_wd(set, id);
+				set->watches[id].wd = -1;
+				set->watches[id].gone = 1;
+				continue;
+			}
+
+			cb(id, 0, arg);
+		}
+	}
+#endif
+}
+
+/* Reports all working watches as changed. */
+static void
+report_all(watch_set_t *set, watch_set_cb cb, void *arg)
+{
+	int i;
+	for(i = 0; i < set->count; ++i)
+	{
+		if(set->watches[i].path != NULL && !set->watches[i].gone)
+		{
+			cb(i, 0, arg);
+		}
+	}
+}
+
+/* Reports watches whose timestamps have changed since the last call. */
+static void
+check_stamps(watch_set_t *set, watch_set_cb cb, void *arg)
+{
+	int i;
+	for(i = 0; i < set->count; ++i)
+	{
+		filemon_t mon;
+		watch_t *const watch = &set->watches[i];
+
+		if(watch->path == NULL || watch->gone)
+		{
+			continue;
+		}
+
+		if(filemon_from_file(watch->path, FMT_MODIFIED, &mon) != 0)
+		{
+			watch->gone = 1;
+			continue;
+		}
+
+		if(!filemon_equal(&watch->mon, &mon))
+		{
+			filemon_assign(&watch->mon, &mon);
+			cb(i, 0, arg);
+		}
+	}
+}
+
+/* Reports watches that don't work anymore. */
+static void
+report_gone(watch_set_t *set, watch_set_cb cb, void *arg)
+{
+	int i;
+	for(i = 0; i < set->count; ++i)
+	{
+		if(set->watches[i].path != NULL && set->watches[i].gone)
+		{
+			cb(i, 1, arg);
+		}
+	}
+}
+
+#ifdef HAVE_INOTIFY
+
+/* Looks up watch by its descriptor.  Returns identifier of the watch or -1. */
+static int
+lookup_wd(const watch_set_t *set, int wd)
+{
+	const unsigned int mask = set->wds_size - 1U;
+	unsigned int slot;
+
+	if(set->wds_size == 0U)
+	{
+		return -1;
+	}
+
+	for(slot = hash_wd(wd) & mask; set->wds[slot] != -1;
+			slot = (slot + 1U) & mask)
+	{
+		if(set->watches[set->wds[slot]].wd == wd)
+		{
+			return set->wds[slot];
+		}
+	}
+	return -1;
+}
+
+/* Adds descriptor of the watch to the table of descriptors growing the table
+ * if necessary.  Returns zero on success, otherwise non-zero is returned. */
+static int
+insert_wd(watch_set_t *set, int id)
+{
+	if(2U*(unsigned int)(set->nwds + 1) > set->wds_size)
+	{
+		unsigned int i;
+		const unsigned int new_size = (set->wds_size == 0U ? 16U
+		                                                   : 2U*set->wds_size);
+		int *const wds = malloc(sizeof(*wds)*new_size);
+		if(wds == NULL)
+		{
+			return 1;
+		}
+
+		for(i = 0U; i < new_size; ++i)
+		{
+			wds[i] = -1;
+		}
+
+		free(set->wds);
+		set->wds = wds;
+		set->wds_size = new_size;
+
+		/* Rehash all descriptors into the new table. */
+		for(i = 0U; i < (unsigned int)set->count; ++i)
+		{
+			if(set->watches[i].path != NULL && set->watches[i].wd != -1 &&
+					(int)i != id)
+			{
+				put_wd(set, i);
+			}
+		}
+	}
+
+	put_wd(set, id);
+	++set->nwds;
+	return 0;
+}
+
+/* Puts descriptor of the watch into the table, which has free slots. */
+static void
+put_wd(watch_set_t *set, int id)
+{
+	const unsigned int mask = set->wds_size - 1U;
+	unsigned int slot = hash_wd(set->watches[id].wd) & mask;
+	while(set->wds[slot] != -1)
+	{
+		slot = (slot + 1U) & mask;
+	}
+	set->wds[slot] = id;
+}
+
+/* Removes descriptor of the watch from the table.  Does nothing if it isn't
+ * there. */
+static void
+remove_wd(watch_set_t *set, int id)
+{
+	const unsigned int mask = set->wds_size - 1U;
+	unsigned int slot, next;
+
+	if(set->wds_size == 0U)
+	{
+		return;
+	}
+
+	for(slot = hash_wd(set->watches[id].wd) & mask; set->wds[slot] != id;
+			slot = (slot + 1U) & mask)
+	{
+		if(set->wds[slot] == -1)
+		{
+			return;
+		}
+	}
+
+	/* Shift following elements of the cluster back to not break their probe
+	 * sequences instead of leaving a tombstone. */
+	for(next = (slot + 1U) & mask; set->wds[next] != -1;
+			next = (next + 1U) & mask)
+	{
+		const int wd = set->watches[set->wds[next]].wd;
+		const unsigned int home = hash_wd(wd) & mask;
+		/* Element can be moved if its home slot isn't in (slot; next]. */
+		if(((next - home) & mask) >= ((next - slot) & mask))
+		{
+			set->wds[slot] = set->wds[next];
+			slot = next;
+		}
+	}
+	set->wds[slot] = -1;
+	--set->nwds;
+}
+
+/* Computes hash of a watch descriptor.  Returns the hash. */
+static unsigned int
+hash_wd(int wd)
+{
+	/* Multiplicative hashing spreads sequential descriptors. */
+	return (unsigned int)wd*2654435761U;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,67 @@
+/* vifm
+ * Copyright (C) 2020 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__WATCH_SET_H__
+#define VIFM__UTILS__WATCH_SET_H__
+
+/* Watches a set of directories for changes of their lists of files.  All
+ * directories share a single inotify instance, which is a limited resource.
+ * When inotify isn't available, timestamps of directories are compared on
+ * checking for changes.
+ *
+ * Adding and removing watches can be done from any thread, while checks should
+ * be done by a single thread at a time. */
+
+/* Declaration of opaque watch set type. */
+typedef struct watch_set_t watch_set_t;
+
+/* Callback invoked for each watch that has changed.  gone is non-zero if the
+ * watch doesn't work anymore (e.g., directory was removed), such watches are
+ * reported on every check until they are removed. */
+typedef void (*watch_set_cb)(int id, int gone, void *arg);
+
+/* Creates an empty set of watches.  Modifications of files are reported as
+ * they happen if track_writes is non-zero and only when files are closed
+ * otherwise, because writes can produce lots of events.  Returns the set or
+ * NULL on error. */
+watch_set_t * watch_set_create(int track_writes);
+
+/* Frees the set and all of its watches.  set can be NULL. */
+void watch_set_free(watch_set_t *set);
+
+/* Starts watching a directory.  Watches of the same directory share identifier
+ * and are reference counted.  Returns identifier of the watch or -1 on
+ * error. */
+int watch_set_add(watch_set_t *set, const char path[]);
+
+/* Stops watching a directory if this was the last reference to the watch. */
+void watch_set_remove(watch_set_t *set, int id);
+
+/* Invokes the callback for each watch that has changed since the last call.
+ * The callback must not call functions of this unit.  All watches are reported
+ * if some events were lost. */
+void watch_set_check(watch_set_t *set, watch_set_cb cb, void *arg);
+
+/* Retrieves descriptor that becomes readable on changes.  Returns the
+ * descriptor or -1 if changes are detected only on checking them. */
+int watch_set_get_fd(const watch_set_t *set);
+
+#endif /* VIFM__UTILS__WATCH_SET_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,165 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strcat() strcmp() */
+
+#include "../../src/engine/autocmds.h"
+
+static void handler(const char action[], void *arg);
+static void removing_handler(const char action[], void *arg);
+static void adding_handler(const char action[], void *arg);
+static void reregistering_handler(const char action[], void *arg);
+
+static char actions[128];
+static int ncalls;
+
+SETUP()
+{
+	actions[0] = '\0';
+	ncalls = 0;
+}
+
+TEST(literal_paths_ignore_case)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/Some/Path", "a", &handler));
+
+	vle_aucmd_execute("CD", "/sOME/pATH", NULL);
+	assert_string_equal("a", actions);
+}
+
+TEST(literal_names_match_last_component)
+{
+	assert_success(vle_aucmd_on_execute("cd", "name", "a", &handler));
+
+	vle_aucmd_execute("cd", "/path/name2", NULL);
+	vle_aucmd_execute("cd", "/name/path", NULL);
+	assert_string_equal("", actions);
+
+	vle_aucmd_execute("cd", "/path/name", NULL);
+	assert_string_equal("a", actions);
+}
+
+TEST(prefixes_match_subtrees)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/etc/**", "a", &handler));
+
+	vle_aucmd_execute("cd", "/etc", NULL);
+	vle_aucmd_execute("cd", "/etcetera/dir", NULL);
+	assert_string_equal("", actions);
+
+	vle_aucmd_execute("cd", "/etc/dir", NULL);
+	vle_aucmd_execute("cd", "/ETC/dir/sub", NULL);
+	assert_string_equal("aa", actions);
+}
+
+TEST(registration_order_is_preserved)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/etc/**", "1", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "*", "2", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "/etc/dir", "3", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "dir", "4", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "!/tmp", "5", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "/**", "6", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "/", "7", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "/etc/**", "8", &handler));
+
+	vle_aucmd_execute("cd", "/etc/dir", NULL);
+	assert_string_equal("1234568", actions);
+}
+
+TEST(only_matching_of_many_is_run)
+{
+	int i;
+	for(i = 0; i < 400; ++i)
+	{
+		char path[32];
+		snprintf(path, sizeof(path), "/projects/%d", i);
+		assert_success(vle_aucmd_on_execute("cd", path, i == 123 ? "a" : "b",
+					&handler));
+	}
+
+	vle_aucmd_execute("cd", "/projects/123", NULL);
+	assert_string_equal("a", actions);
+}
+
+TEST(events_do_not_mix)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/path", "a", &handler));
+	assert_success(vle_aucmd_on_execute("other", "/path", "b", &handler));
+
+	vle_aucmd_execute("cd", "/path", NULL);
+	vle_aucmd_execute("unknown", "/path", NULL);
+	assert_string_equal("a", actions);
+}
+
+TEST(handler_can_remove_autocmds)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/path", "a", &handler));
+	assert_success(vle_aucmd_on_execute("cd", "/path", "r", &removing_handler));
+	assert_success(vle_aucmd_on_execute("cd", "/path", "b", &handler));
+
+	vle_aucmd_execute("cd", "/path", NULL);
+	assert_string_equal("ar", actions);
+}
+
+TEST(autocmds_added_by_handler_are_not_run)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/path", "a", &adding_handler));
+	assert_success(vle_aucmd_on_execute("cd", "/path", "b", &handler));
+
+	vle_aucmd_execute("cd", "/path", NULL);
+	assert_string_equal("ab", actions);
+
+	actions[0] = '\0';
+	vle_aucmd_execute("cd", "/path", NULL);
+	assert_string_equal("abc", actions);
+}
+
+TEST(handler_that_reregisters_itself_runs_once)
+{
+	assert_success(vle_aucmd_on_execute("cd", "/path", "a",
+				&reregistering_handler));
+
+	vle_aucmd_execute("cd", "/path", NULL);
+	assert_int_equal(1, ncalls);
+
+	vle_aucmd_execute("cd", "/path", NULL);
+	assert_int_equal(2, ncalls);
+}
+
+static void
+handler(const char action[], void *arg)
+{
+	strcat(actions, action);
+}
+
+static void
+removing_handler(const char action[], void *arg)
+{
+	strcat(actions, action);
+	vle_aucmd_remove(NULL, NULL);
+}
+
+static void
+adding_handler(const char action[], void *arg)
+{
+	strcat(actions, action);
+	assert_success(vle_aucmd_on_execute("cd", "/path", "c", &handler));
+}
+
+static void
+reregistering_handler(const char action[], void *arg)
+{
+	/* Stop runaway recursion in case of a bug. */
+	if(++ncalls > 50)
+	{
+		return;
+	}
+
+	vle_aucmd_remove(NULL, NULL);
+	assert_success(vle_aucmd_on_execute("cd", "/path", action,
+				&reregistering_handler));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,138 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() snprintf() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/compare.h"
+#include "../../src/filelist.h"
+
+#include "utils.h"
+
+static void bench_compare(const char name[], CompareType ct);
+static void make_files(const char dir[], int count, int seed);
+static void restore_views(void *arg);
+static void compare(void *arg);
+
+static char sandbox[PATH_MAX + 1];
+static char a[PATH_MAX + 1];
+static char b[PATH_MAX + 1];
+
+/* Type of comparison. */
+static CompareType compare_type;
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		copy_str(sandbox, sizeof(sandbox), SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+	snprintf(a, sizeof(a), "%s/a", sandbox);
+	snprintf(b, sizeof(b), "%s/b", sandbox);
+}
+
+SETUP()
+{
+	bench_view_setup(&lwin, a);
+	bench_view_setup(&rwin, b);
+
+	bench_opts_setup();
+}
+
+TEARDOWN()
+{
+	bench_opts_teardown();
+
+	bench_view_teardown(&lwin);
+	bench_view_teardown(&rwin);
+}
+
+TEST(by_name)
+{
+	bench_compare("compare/name", CT_NAME);
+}
+
+TEST(by_size)
+{
+	bench_compare("compare/size", CT_SIZE);
+}
+
+TEST(by_contents)
+{
+	bench_compare("compare/contents", CT_CONTENTS);
+}
+
+/* Measures comparison of two directories of all sizes. */
+static void
+bench_compare(const char name[], CompareType ct)
+{
+	int size;
+
+	compare_type = ct;
+
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		make_files(a, size, 0);
+		make_files(b, size, size/2);
+
+		bench_measure(name, size, &restore_views, &compare, NULL);
+
+		bench_remove(a);
+		bench_remove(b);
+	}
+}
+
+/* Creates directory with count files, content of which depends on their
+ * number.  Names of the files intersect for different seeds. */
+static void
+make_files(const char dir[], int count, int seed)
+{
+	int i;
+	char path[PATH_MAX + 1];
+
+	assert_success(os_mkdir(dir, 0700));
+
+	for(i = 0; i < count; ++i)
+	{
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "%s/file%d", dir, seed + i);
+		fp = fopen(path, "w");
+		assert_non_null(fp);
+		fprintf(fp, "%d\n", (seed + i)%97);
+		fclose(fp);
+	}
+}
+
+/* Brings views back to regular state. */
+static void
+restore_views(void *arg)
+{
+	bench_view_teardown(&lwin);
+	bench_view_teardown(&rwin);
+	bench_view_setup(&lwin, a);
+	bench_view_setup(&rwin, b);
+}
+
+/* Compares directories of two views. */
+static void
+compare(void *arg)
+{
+	(void)compare_two_panes(compare_type, LT_ALL, 1, 0);
+	assert_true(flist_custom_active(&lwin));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,99 @@
+#include <stic.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/str.h"
+#include "../../src/filtering.h"
+
+#include "utils.h"
+
+static void start_local_filter(void *arg);
+static void type_local_filter(void *arg);
+static void check_visibility(void *arg);
+
+SETUP()
+{
+	update_string(&cfg.slow_fs_list, "");
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.slow_fs_list, NULL);
+}
+
+TEST(local_filter)
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_view_setup(&lwin, "/bench");
+		bench_fill_view(&lwin, size, 16);
+
+		bench_measure("filter/local", size, &start_local_filter,
+				&type_local_filter, &lwin);
+		local_filter_cancel(&lwin);
+
+		bench_view_teardown(&lwin);
+	}
+}
+
+TEST(name_filters)
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		char *error;
+
+		bench_view_setup(&lwin, "/bench");
+		bench_fill_view(&lwin, size, 16);
+
+		matcher_free(lwin.manual_filter);
+		lwin.manual_filter = matcher_alloc("{*.o,*.h}", 0, 1, "", &error);
+		assert_non_null(lwin.manual_filter);
+		assert_success(filter_set(&lwin.auto_filter, "a.*1"));
+
+		bench_measure("filter/name", size, NULL, &check_visibility, &lwin);
+
+		bench_view_teardown(&lwin);
+	}
+}
+
+/* Resets local filter to an empty state, which makes all entries visible. */
+static void
+start_local_filter(void *arg)
+{
+	view_t *const view = arg;
+	local_filter_cancel(view);
+	(void)local_filter_set(view, "");
+}
+
+/* Emulates typing of local filter. */
+static void
+type_local_filter(void *arg)
+{
+	(void)local_filter_set(arg, "a");
+	(void)local_filter_set(arg, "ab");
+	(void)local_filter_set(arg, "ab1");
+}
+
+/* Checks whether each file of the view passes filters. */
+static void
+check_visibility(void *arg)
+{
+	view_t *const view = arg;
+	int i;
+	int visible = 0;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		const dir_entry_t *const entry = &view->dir_entry[i];
+		visible += filters_file_is_visible(view, entry->origin, entry->name,
+				entry->type == FT_DIR, 1);
+	}
+
+	assert_true(visible > 0);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
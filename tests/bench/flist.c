@@ -0,0 +1,157 @@
+#include <stic.h>
+
+#include <limits.h> /* INT_MAX */
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+
+#include "utils.h"
+
+static void populate(void *arg);
+static void reload(void *arg);
+static void load_tree(void *arg);
+static void bench_dir(const char name[], const char dir[], int size);
+static int not_windows(void);
+
+static char sandbox[PATH_MAX + 1];
+static char dir[PATH_MAX + 1];
+static char target[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		copy_str(sandbox, sizeof(sandbox), SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+	snprintf(dir, sizeof(dir), "%s/dir", sandbox);
+	snprintf(target, sizeof(target), "%s/target", sandbox);
+}
+
+SETUP()
+{
+	update_string(&cfg.slow_fs_list, "");
+	update_string(&cfg.fuse_home, "");
+	cfg.dot_dirs = 0;
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.slow_fs_list, NULL);
+	update_string(&cfg.fuse_home, NULL);
+}
+
+TEST(flat_directories)
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_make_flat(dir, size, 16);
+		bench_dir("populate/flat", dir, size);
+		bench_remove(dir);
+	}
+}
+
+TEST(long_names)
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_make_flat(dir, size, 200);
+		bench_dir("populate/long-names", dir, size);
+		bench_remove(dir);
+	}
+}
+
+TEST(symlink_farms, IF(not_windows))
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_make_flat(target, size, 16);
+		bench_make_symlinks(dir, target, size, 16);
+		bench_dir("populate/symlinks", dir, size);
+		bench_remove(dir);
+		bench_remove(target);
+	}
+}
+
+TEST(deep_tree)
+{
+	/* 2^10 - 1 directories with 8 files each. */
+	bench_make_tree(dir, 10, 2, 8);
+
+	bench_view_setup(&lwin, dir);
+	lwin.columns = columns_create();
+	bench_measure("tree/load", 1023*9, NULL, &load_tree, &lwin);
+	bench_view_teardown(&lwin);
+
+	bench_remove(dir);
+}
+
+/* Measures initial loading and reloading (which merges new list with the old
+ * one) of the directory. */
+static void
+bench_dir(const char name[], const char dir[], int size)
+{
+	char full_name[64];
+
+	bench_view_setup(&lwin, dir);
+
+	bench_measure(name, size, NULL, &populate, &lwin);
+	assert_int_equal(size, lwin.list_rows);
+
+	snprintf(full_name, sizeof(full_name), "%s-reload", name);
+	bench_measure(full_name, size, NULL, &reload, &lwin);
+	assert_int_equal(size, lwin.list_rows);
+
+	bench_view_teardown(&lwin);
+}
+
+/* Loads directory anew. */
+static void
+populate(void *arg)
+{
+	assert_success(populate_dir_list(arg, 0));
+}
+
+/* Reloads already loaded directory. */
+static void
+reload(void *arg)
+{
+	assert_success(populate_dir_list(arg, 1));
+}
+
+/* Loads directory as a tree.  Path isn't taken from the view, because loading
+ * of a tree updates it along the way. */
+static void
+load_tree(void *arg)
+{
+	assert_success(flist_load_tree(arg, dir, INT_MAX));
+}
+
+static int
+not_windows(void)
+{
+#ifndef _WIN32
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,68 @@
+#include <stic.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/search.h"
+
+#include "utils.h"
+
+static void search(void *arg);
+
+/* Pattern to look for. */
+static const char *search_pattern;
+
+SETUP()
+{
+	cfg.hl_search = 1;
+	cfg.wrap_scan = 1;
+}
+
+TEARDOWN()
+{
+	cfg.hl_search = 0;
+	cfg.wrap_scan = 0;
+}
+
+TEST(literal_pattern)
+{
+	int size;
+
+	search_pattern = "ab";
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_view_setup(&lwin, "/bench");
+		bench_fill_view(&lwin, size, 16);
+
+		bench_measure("search/literal", size, NULL, &search, &lwin);
+
+		bench_view_teardown(&lwin);
+	}
+}
+
+TEST(regex_pattern)
+{
+	int size;
+
+	search_pattern = "^[a-f].*[0-9]+\\.(c|h)$";
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_view_setup(&lwin, "/bench");
+		bench_fill_view(&lwin, size, 16);
+
+		bench_measure("search/regex", size, NULL, &search, &lwin);
+
+		bench_view_teardown(&lwin);
+	}
+}
+
+/* Looks for the pattern among files of the view. */
+static void
+search(void *arg)
+{
+	int found;
+	(void)find_pattern(arg, search_pattern, 0, 1, &found, 0);
+	assert_true(found);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,97 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* memset() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/sort.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+static void bench_sort(const char name[], SortingKey key);
+static void shuffle(void *arg);
+static void sort(void *arg);
+
+SETUP_ONCE()
+{
+	/* Sizes of directories are looked up in the cache. */
+	assert_success(stats_init(&cfg));
+}
+
+SETUP()
+{
+	cfg.sort_numbers = 0;
+}
+
+TEARDOWN()
+{
+	cfg.sort_numbers = 0;
+}
+
+TEST(by_name)
+{
+	bench_sort("sort/name", SK_BY_NAME);
+}
+
+TEST(by_name_ignoring_case)
+{
+	bench_sort("sort/iname", SK_BY_INAME);
+}
+
+TEST(by_name_naturally)
+{
+	cfg.sort_numbers = 1;
+	bench_sort("sort/name-natural", SK_BY_NAME);
+}
+
+TEST(by_extension)
+{
+	bench_sort("sort/ext", SK_BY_EXTENSION);
+}
+
+TEST(by_size)
+{
+	bench_sort("sort/size", SK_BY_SIZE);
+}
+
+TEST(by_modification_time)
+{
+	bench_sort("sort/mtime", SK_BY_TIME_MODIFIED);
+}
+
+/* Measures sorting of in-memory lists of all sizes by the key. */
+static void
+bench_sort(const char name[], SortingKey key)
+{
+	int size;
+	for(size = 1000; size <= bench_max_entries(); size *= 10)
+	{
+		bench_view_setup(&lwin, "/bench");
+		lwin.sort[0] = key;
+		memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+		bench_fill_view(&lwin, size, 16);
+		bench_measure(name, size, &shuffle, &sort, &lwin);
+
+		bench_view_teardown(&lwin);
+	}
+}
+
+/* Brings entries of the view into the same unsorted state. */
+static void
+shuffle(void *arg)
+{
+	bench_shuffle_view(arg);
+}
+
+/* Sorts entries of the view. */
+static void
+sort(void *arg)
+{
+	sort_view(arg);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,431 @@
+#include "utils.h"
+
+#include <unistd.h> /* symlink() */
+
+#include <stdint.h> /* uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fflush() fopen() fprintf() printf()
+                      snprintf() */
+#include <stdlib.h> /* atoi() free() getenv() qsort() */
+#include <string.h> /* memset() strcpy() strdup() strlen() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/compat/reallocarray.h"
+#include "../../src/engine/options.h"
+#include "../../src/io/ior.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/filter.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/opt_handlers.h"
+
+static int get_env_int(const char name[], int def);
+static uint64_t now(void);
+static int u64_cmp(const void *a, const void *b);
+static uint64_t percentile(const uint64_t samples[], int count, int p);
+static void format_ns(uint64_t ns, char buf[], size_t buf_len);
+static uint32_t next_rand(uint32_t *state);
+
+/* Configuration. */
+static int max_entries;
+static int runs;
+static int warmups;
+
+/* Where to write machine-readable results or NULL. */
+static FILE *output;
+
+void
+bench_init(void)
+{
+	const char *path;
+
+	max_entries = get_env_int("BENCH_MAX_ENTRIES", 100000);
+	runs = get_env_int("BENCH_RUNS", 10);
+	warmups = get_env_int("BENCH_WARMUPS", 2);
+
+	path = getenv("BENCH_OUTPUT");
+	if(path != NULL && path[0] != '\0')
+	{
+		output = fopen(path, "a");
+		assert_non_null(output);
+	}
+
+	printf("%-32s %8s %10s %10s %10s %10s %10s\n", "benchmark", "size", "min",
+			"p50", "p90", "p99", "max");
+}
+
+void
+bench_finish(void)
+{
+	if(output != NULL)
+	{
+		fclose(output);
+		output = NULL;
+	}
+}
+
+/* Retrieves value of an integer environment variable.  Returns the value or
+ * def if the variable is missing or isn't a positive number. */
+static int
+get_env_int(const char name[], int def)
+{
+	const char *const value = getenv(name);
+	const int n = (value == NULL ? 0 : atoi(value));
+	return (n > 0 ? n : def);
+}
+
+int
+bench_max_entries(void)
+{
+	return max_entries;
+}
+
+void
+bench_measure(const char name[], int size, bench_func prepare,
+		bench_func func, void *arg)
+{
+	int i;
+	uint64_t total = 0U;
+	char min[16], p50[16], p90[16], p99[16], max[16];
+
+	uint64_t *const samples = reallocarray(NULL, runs, sizeof(*samples));
+	assert_non_null(samples);
+
+	for(i = -warmups; i < runs; ++i)
+	{
+		uint64_t start;
+
+		if(prepare != NULL)
+		{
+			prepare(arg);
+		}
+
+		start = now();
+		func(arg);
+		if(i >= 0)
+		{
+			samples[i] = now() - start;
+			total += samples[i];
+		}
+	}
+
+	qsort(samples, runs, sizeof(*samples), &u64_cmp);
+
+	format_ns(samples[0], min, sizeof(min));
+	format_ns(percentile(samples, runs, 50), p50, sizeof(p50));
+	format_ns(percentile(samples, runs, 90), p90, sizeof(p90));
+	format_ns(percentile(samples, runs, 99), p99, sizeof(p99));
+	format_ns(samples[runs - 1], max, sizeof(max));
+	printf("%-32s %8d %10s %10s %10s %10s %10s\n", name, size, min, p50, p90,
+			p99, max);
+	fflush(stdout);
+
+	if(output != NULL)
+	{
+		fprintf(output, "{\"name\":\"%s\",\"size\":%d,\"runs\":%d,"
+				"\"min_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,"
+				"\"max_ns\":%llu,\"mean_ns\":%llu}\n", name, size, runs,
+				(unsigned long long)samples[0],
+				(unsigned long long)percentile(samples, runs, 50),
+				(unsigned long long)percentile(samples, runs, 90),
+				(unsigned long long)percentile(samples, runs, 99),
+				(unsigned long long)samples[runs - 1],
+				(unsigned long long)(total/runs));
+	}
+
+	free(samples);
+}
+
+/* Retrieves current value of a monotonic clock.  Returns time in
+ * nanoseconds. */
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000U + ts.tv_nsec;
+}
+
+/* qsort() comparer of 64-bit unsigned integers.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+u64_cmp(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a;
+	const uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* Picks percentile of sorted samples using nearest-rank method.  Returns the
+ * value. */
+static uint64_t
+percentile(const uint64_t samples[], int count, int p)
+{
+	const int rank = (p*count + 99)/100;
+	return samples[rank == 0 ? 0 : rank - 1];
+}
+
+/* Formats duration in human-friendly units. */
+static void
+format_ns(uint64_t ns, char buf[], size_t buf_len)
+{
+	if(ns < 1000U*1000U)
+	{
+		snprintf(buf, buf_len, "%.1fus", ns/1e3);
+	}
+	else if(ns < 1000U*1000U*1000U)
+	{
+		snprintf(buf, buf_len, "%.2fms", ns/1e6);
+	}
+	else
+	{
+		snprintf(buf, buf_len, "%.3fs", ns/1e9);
+	}
+}
+
+void
+bench_make_flat(const char dir[], int count, int name_len)
+{
+	int i;
+	char path[PATH_MAX + 1];
+	const size_t dir_len = strlen(dir);
+
+	assert_success(os_mkdir(dir, 0700));
+
+	strcpy(path, dir);
+	path[dir_len] = '/';
+	for(i = 0; i < count; ++i)
+	{
+		FILE *fp;
+
+		bench_make_name(i, name_len, path + dir_len + 1);
+		fp = fopen(path, "w");
+		assert_non_null(fp);
+		fclose(fp);
+	}
+}
+
+void
+bench_make_tree(const char dir[], int depth, int fanout, int files)
+{
+	int i;
+	char path[PATH_MAX + 1];
+
+	bench_make_flat(dir, files, 16);
+
+	if(depth <= 1)
+	{
+		return;
+	}
+
+	for(i = 0; i < fanout; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir%d", dir, i);
+		bench_make_tree(path, depth - 1, fanout, files);
+	}
+}
+
+void
+bench_make_symlinks(const char dir[], const char target[], int count,
+		int name_len)
+{
+#ifndef _WIN32
+	int i;
+	char name[NAME_MAX + 1];
+	char from[PATH_MAX + 1], to[PATH_MAX + 1];
+
+	assert_success(os_mkdir(dir, 0700));
+
+	for(i = 0; i < count; ++i)
+	{
+		bench_make_name(i, name_len, name);
+		snprintf(from, sizeof(from), "%s/%s", target, name);
+		snprintf(to, sizeof(to), "%s/%s", dir, name);
+		assert_success(symlink(from, to));
+	}
+#endif
+}
+
+void
+bench_remove(const char path[])
+{
+	io_args_t args = {
+		.arg1.path = path,
+	};
+	assert_success(ior_rm(&args));
+}
+
+void
+bench_make_name(int i, int name_len, char buf[])
+{
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_-";
+	static const char *const exts[] = { ".c", ".h", ".txt", ".o", "" };
+
+	uint32_t state = (uint32_t)i*2654435761U + 1U;
+	char suffix[32];
+	int prefix_len;
+	int j;
+
+	/* Number in the name keeps it unique, prefix makes order of names differ
+	 * from order of numbers. */
+	snprintf(suffix, sizeof(suffix), "%d%s", i, exts[i%5]);
+	prefix_len = MAX(name_len - (int)strlen(suffix), 1);
+
+	for(j = 0; j < prefix_len; ++j)
+	{
+		buf[j] = alphabet[next_rand(&state)%(sizeof(alphabet) - 1U)];
+	}
+	strcpy(buf + prefix_len, suffix);
+}
+
+/* Generates next pseudo-random number.  Returns the number. */
+static uint32_t
+next_rand(uint32_t *state)
+{
+	*state = *state*1103515245U + 12345U;
+	return *state >> 16;
+}
+
+void
+bench_opts_setup(void)
+{
+	update_string(&cfg.slow_fs_list, "");
+	update_string(&cfg.apropos_prg, "");
+	update_string(&cfg.cd_path, "");
+	update_string(&cfg.find_prg, "");
+	update_string(&cfg.fuse_home, "");
+	update_string(&cfg.time_format, "+");
+	update_string(&cfg.vi_command, "");
+	update_string(&cfg.vi_x_command, "");
+	update_string(&cfg.ruler_format, "");
+	update_string(&cfg.status_line, "");
+	update_string(&cfg.grep_prg, "");
+	update_string(&cfg.locate_prg, "");
+	update_string(&cfg.media_prg, "");
+	update_string(&cfg.border_filler, "");
+	update_string(&cfg.shell, "");
+	update_string(&cfg.shell_cmd_flag, "");
+
+	init_option_handlers();
+}
+
+void
+bench_opts_teardown(void)
+{
+	vle_opts_reset();
+
+	update_string(&cfg.slow_fs_list, NULL);
+	update_string(&cfg.apropos_prg, NULL);
+	update_string(&cfg.cd_path, NULL);
+	update_string(&cfg.find_prg, NULL);
+	update_string(&cfg.fuse_home, NULL);
+	update_string(&cfg.time_format, NULL);
+	update_string(&cfg.vi_command, NULL);
+	update_string(&cfg.vi_x_command, NULL);
+	update_string(&cfg.ruler_format, NULL);
+	update_string(&cfg.status_line, NULL);
+	update_string(&cfg.grep_prg, NULL);
+	update_string(&cfg.locate_prg, NULL);
+	update_string(&cfg.media_prg, NULL);
+	update_string(&cfg.border_filler, NULL);
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+}
+
+void
+bench_view_setup(view_t *view, const char dir[])
+{
+	char *error;
+
+	view->list_rows = 0;
+	view->filtered = 0;
+	view->list_pos = 0;
+	view->top_line = 0;
+	view->dir_entry = NULL;
+	view->hide_dot = 1;
+	view->invert = 1;
+	view->selected_files = 0;
+	view->ls_view = 0;
+	view->miller_view = 0;
+	view->window_rows = 0;
+	view->run_size = 1;
+
+	view->custom.entry_count = 0;
+	view->custom.entries = NULL;
+	view->local_filter.entry_count = 0;
+	view->local_filter.entries = NULL;
+
+	assert_success(filter_init(&view->local_filter.filter, 1));
+	assert_non_null(view->manual_filter = matcher_alloc("", 0, 0, "", &error));
+	assert_success(filter_init(&view->auto_filter, 1));
+
+	copy_str(view->curr_dir, sizeof(view->curr_dir), dir);
+
+	update_string(&view->view_columns, "");
+	update_string(&view->view_columns_g, "");
+	update_string(&view->sort_groups, "");
+	update_string(&view->sort_groups_g, "");
+	update_string(&view->preview_prg, "");
+	update_string(&view->preview_prg_g, "");
+
+	view->sort[0] = SK_BY_NAME;
+	memset(&view->sort[1], SK_NONE, sizeof(view->sort) - 1);
+}
+
+void
+bench_view_teardown(view_t *view)
+{
+	flist_free_view(view);
+}
+
+void
+bench_fill_view(view_t *view, int count, int name_len)
+{
+	int i;
+	uint32_t state = 1U;
+	char name[NAME_MAX + 1];
+
+	view->dir_entry = dynarray_cextend(NULL, count*sizeof(*view->dir_entry));
+	assert_non_null(view->dir_entry);
+	view->list_rows = count;
+
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+
+		bench_make_name(i, name_len, name);
+		entry->name = strdup(name);
+		entry->origin = &view->curr_dir[0];
+		entry->type = (i%10 == 0 ? FT_DIR : FT_REG);
+		entry->size = next_rand(&state);
+		entry->mtime = next_rand(&state);
+		entry->atime = entry->mtime;
+		entry->ctime = entry->mtime;
+		entry->nlinks = 1;
+		entry->hi_num = -1;
+		entry->id = i;
+	}
+}
+
+void
+bench_shuffle_view(view_t *view)
+{
+	int i;
+	uint32_t state = 1U;
+
+	for(i = view->list_rows - 1; i > 0; --i)
+	{
+		const int j = next_rand(&state)%(i + 1);
+		const dir_entry_t tmp = view->dir_entry[i];
+		view->dir_entry[i] = view->dir_entry[j];
+		view->dir_entry[j] = tmp;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,71 @@
+#ifndef VIFM_TESTS__BENCH__UTILS_H__
+#define VIFM_TESTS__BENCH__UTILS_H__
+
+/* Helpers for benchmarks.  Configuration is taken from environment:
+ *  - BENCH_MAX_ENTRIES -- size of the largest data set (100000 by default),
+ *                         sizes start at 1000 and grow by a factor of 10;
+ *  - BENCH_RUNS        -- number of measured runs (10 by default);
+ *  - BENCH_WARMUPS     -- number of runs before measurements (2 by default);
+ *  - BENCH_OUTPUT      -- file to append results to as JSON lines. */
+
+struct view_t;
+
+/* Benchmarked function or a preparation step for it. */
+typedef void (*bench_func)(void *arg);
+
+/* Reads configuration from environment. */
+void bench_init(void);
+
+/* Finishes writing of results. */
+void bench_finish(void);
+
+/* Retrieves size of the largest data set.  Returns the size. */
+int bench_max_entries(void);
+
+/* Runs the function several times and reports its timings.  size is the size
+ * of the data set.  prepare can be NULL, otherwise it's called before each run
+ * and isn't measured. */
+void bench_measure(const char name[], int size, bench_func prepare,
+		bench_func func, void *arg);
+
+/* Creates directory with count empty files with names of name_len
+ * characters. */
+void bench_make_flat(const char dir[], int count, int name_len);
+
+/* Creates tree of directories of specified depth where each directory has
+ * fanout subdirectories and files files. */
+void bench_make_tree(const char dir[], int depth, int fanout, int files);
+
+/* Creates directory with count symbolic links to files of the target
+ * directory, which are named as by bench_make_flat(). */
+void bench_make_symlinks(const char dir[], const char target[], int count,
+		int name_len);
+
+/* Removes file or directory recursively. */
+void bench_remove(const char path[]);
+
+/* Fills file name for bench_make_flat(). */
+void bench_make_name(int i, int name_len, char buf[]);
+
+/* Prepares configuration and option handlers for use in benchmarks. */
+void bench_opts_setup(void);
+
+/* Cleans up configuration and option handlers. */
+void bench_opts_teardown(void);
+
+/* Prepares view for use in benchmarks. */
+void bench_view_setup(struct view_t *view, const char dir[]);
+
+/* Frees resources of the view. */
+void bench_view_teardown(struct view_t *view);
+
+/* Fills view with count entries without accessing file system. */
+void bench_fill_view(struct view_t *view, int count, int name_len);
+
+/* Reorders entries of the view in a repeatable way. */
+void bench_shuffle_view(struct view_t *view);
+
+#endif /* VIFM_TESTS__BENCH__UTILS_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -2,6 +2,8 @@
 
 #include <unistd.h> /* chdir() rmdir() unlink() */
 
+#include <limits.h> /* INT_MAX */
+
 #include "../../src/compat/fs_limits.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/fs.h"
@@ -86,7 +88,7 @@ TEST(make_files_considers_tree_structure)
 
 	create_empty_dir("dir");
 
-	flist_load_tree(&lwin, lwin.curr_dir);
+	flist_load_tree(&lwin, lwin.curr_dir, INT_MAX);
 
 	/* Set at to -1. */
 	lwin.list_pos = 0;
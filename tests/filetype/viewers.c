@@ -93,6 +93,26 @@ TEST(several_patterns)
 	assert_true(ft_get_viewer("file.version.tar.bz2") != NULL);
 }
 
+TEST(viewer_is_picked_without_mime_type)
+{
+	int mime;
+
+	set_viewers("*.c", "prog1");
+	set_viewers("<text/plain>{*.h}", "prog1");
+	set_viewers("*.h", "prog2");
+	set_viewers("<text/plain>", "prog2");
+
+	ft_init(&prog1_available);
+
+	assert_string_equal("prog1", ft_get_viewer_no_mime("file.c", &mime));
+	assert_false(mime);
+	assert_null(ft_get_viewer_no_mime("file.h", &mime));
+	assert_true(mime);
+	/* Mime type is of no interest when there is no viewer to pick. */
+	assert_null(ft_get_viewer_no_mime("file.txt", &mime));
+	assert_false(mime);
+}
+
 TEST(pattern_list, IF(has_mime_type_detection))
 {
 	char cmd[1024];
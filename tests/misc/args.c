@@ -131,7 +131,20 @@ TEST(remote_expr_is_parsed, IF(with_remote_cmds))
 	char *argv[] = { "vifm", "--remote-expr", "expr", NULL };
 
 	args_parse(&args, ARRAY_LEN(argv) - 1U, argv, "/");
-	assert_string_equal("expr", args.remote_expr);
+	assert_int_equal(1, args.nremote_exprs);
+	assert_string_equal("expr", args.remote_exprs[0]);
+	args_free(&args);
+}
+
+TEST(several_remote_exprs_are_kept_in_order, IF(with_remote_cmds))
+{
+	args_t args = { };
+	char *argv[] = { "vifm", "--remote-expr", "a", "--remote-expr", "b", NULL };
+
+	args_parse(&args, ARRAY_LEN(argv) - 1U, argv, "/");
+	assert_int_equal(2, args.nremote_exprs);
+	assert_string_equal("a", args.remote_exprs[0]);
+	assert_string_equal("b", args.remote_exprs[1]);
 	args_free(&args);
 }
 
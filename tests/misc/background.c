@@ -1,6 +1,11 @@
 #include <stic.h>
 
+#include <unistd.h> /* usleep() */
+
+#include <stdint.h> /* intptr_t */
+
 #include "../../src/cfg/config.h"
+#include "../../src/compat/pthread.h"
 #include "../../src/utils/cancellation.h"
 #include "../../src/utils/str.h"
 #include "../../src/ui/ui.h"
@@ -8,6 +13,17 @@
 
 #include "utils.h"
 
+static void block_task(bg_op_t *bg_op, void *arg);
+static void record_task(bg_op_t *bg_op, void *arg);
+static void wait_for_start(void);
+static void wait_for_order(int count);
+
+static pthread_mutex_t order_lock = PTHREAD_MUTEX_INITIALIZER;
+static int order[4];
+static int norder;
+static volatile int started;
+static volatile int released;
+
 SETUP()
 {
 	/* curr_view shouldn't be NULL, because of iteration over tabs before doing
@@ -18,6 +34,10 @@ SETUP()
 TEARDOWN()
 {
 	curr_view = NULL;
+	cfg.bg_threads = 0;
+	norder = 0;
+	started = 0;
+	released = 0;
 }
 
 TEST(background_redirects_streams_properly, IF(not_windows))
@@ -29,5 +49,126 @@ TEST(background_redirects_streams_properly, IF(not_windows))
 	update_string(&cfg.shell_cmd_flag, NULL);
 }
 
+TEST(tasks_are_started_before_queued_operations)
+{
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("", "", 0, 1, NULL, &block_task, (void *)1));
+	wait_for_start();
+	assert_success(bg_execute("", "", 0, 1, NULL, &record_task, (void *)2));
+	assert_success(bg_execute("", "", 0, 0, NULL, &record_task, (void *)3));
+
+	released = 1;
+	wait_for_order(3);
+
+	assert_int_equal(1, order[0]);
+	assert_int_equal(3, order[1]);
+	assert_int_equal(2, order[2]);
+}
+
+TEST(operations_do_not_occupy_all_threads)
+{
+	cfg.bg_threads = 2;
+
+	assert_success(bg_execute("", "", 0, 1, NULL, &block_task, (void *)1));
+	wait_for_start();
+	assert_success(bg_execute("", "", 0, 1, NULL, &record_task, (void *)2));
+	assert_success(bg_execute("", "", 0, 0, NULL, &record_task, (void *)3));
+
+	wait_for_order(1);
+	assert_int_equal(3, order[0]);
+
+	released = 1;
+	wait_for_order(3);
+
+	assert_int_equal(1, order[1]);
+	assert_int_equal(2, order[2]);
+}
+
+TEST(device_limit_applies_only_to_operations)
+{
+	cfg.bg_threads = 4;
+
+	assert_success(bg_execute("", "", 0, 1, ".", &block_task, (void *)1));
+	wait_for_start();
+	started = 0;
+	assert_success(bg_execute("", "", 0, 1, ".", &block_task, (void *)2));
+	wait_for_start();
+
+	assert_success(bg_execute("", "", 0, 1, ".", &record_task, (void *)3));
+	assert_success(bg_execute("", "", 0, 0, ".", &record_task, (void *)4));
+
+	wait_for_order(1);
+	assert_int_equal(4, order[0]);
+
+	/* Third operation on the same device waits for one of the first two. */
+	usleep(50000);
+	pthread_mutex_lock(&order_lock);
+	assert_int_equal(1, norder);
+	pthread_mutex_unlock(&order_lock);
+
+	released = 1;
+	wait_for_order(4);
+}
+
+static void
+block_task(bg_op_t *bg_op, void *arg)
+{
+	started = 1;
+	while(!released)
+	{
+		usleep(1000);
+	}
+	record_task(bg_op, arg);
+}
+
+static void
+record_task(bg_op_t *bg_op, void *arg)
+{
+	pthread_mutex_lock(&order_lock);
+	order[norder++] = (intptr_t)arg;
+	pthread_mutex_unlock(&order_lock);
+}
+
+static void
+wait_for_start(void)
+{
+	int counter = 0;
+	while(!started)
+	{
+		usleep(5000);
+		if(++counter > 200)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+}
+
+static void
+wait_for_order(int count)
+{
+	int counter = 0;
+	while(1)
+	{
+		int n;
+		pthread_mutex_lock(&order_lock);
+		n = norder;
+		pthread_mutex_unlock(&order_lock);
+
+		if(n >= count)
+		{
+			break;
+		}
+
+		usleep(5000);
+		if(++counter > 200)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
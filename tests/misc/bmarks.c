@@ -138,6 +138,20 @@ TEST(tilde_is_expanded)
 	assert_false(path[strlen(path) - 1] == '~');
 }
 
+TEST(bookmark_can_be_found_after_it_is_moved)
+{
+	assert_success(bmarks_setup("/a/path", "tag", 10));
+	bmarks_file_moved("/a/path", "/b/path");
+
+	assert_true(bmark_is_older("/a/path", 20));
+	assert_false(bmark_is_older("/b/path", 5));
+	assert_true(bmark_is_older("/b/path", 20));
+
+	assert_success(bmarks_set("/b/path", "other"));
+	assert_int_equal(1, count_bmarks());
+	assert_string_equal("other", tags);
+}
+
 static int
 count_bmarks(void)
 {
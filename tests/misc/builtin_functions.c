@@ -1,11 +1,12 @@
 #include <stic.h>
 
 #include <sys/time.h> /* timeval utimes() */
-#include <unistd.h> /* symlink() */
+#include <unistd.h> /* symlink() usleep() */
 
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* free() remove() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strcmp() strdup() */
 
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
@@ -24,6 +25,8 @@
 
 #include "utils.h"
 
+static int wait_for_value(const char expr[], const char expected[]);
+
 SETUP()
 {
 	update_string(&cfg.shell, "sh");
@@ -103,6 +106,17 @@ TEST(system_catches_stdout_and_err)
 #endif
 }
 
+TEST(system_rejects_unknown_mode)
+{
+	ASSERT_FAIL("system('echo a', 'sync')", PE_INVALID_EXPRESSION);
+}
+
+TEST(system_async_returns_output_later, IF(not_windows))
+{
+	ASSERT_OK("system('echo async', 'async')", "");
+	assert_true(wait_for_value("system('echo async', 'async')", "async"));
+}
+
 TEST(term_catches_stdout)
 {
 	ASSERT_OK("term('echo a')", "a");
@@ -218,7 +232,7 @@ TEST(getpanetype_for_very_custom_view)
 
 TEST(getpanetype_for_tree_view)
 {
-	flist_load_tree(&lwin, TEST_DATA_PATH);
+	flist_load_tree(&lwin, TEST_DATA_PATH, INT_MAX);
 
 	curr_view = &lwin;
 	ASSERT_OK("getpanetype()", "tree");
@@ -423,5 +437,59 @@ TEST(extcached)
 	set_extcached_monitor_type(FMT_CHANGED);
 }
 
+TEST(extcached_async_returns_stale_value_until_update, IF(not_windows))
+{
+	curr_view = &lwin;
+	set_extcached_monitor_type(FMT_MODIFIED);
+	create_file("file");
+
+	ASSERT_OK("extcached('async', 'file', 'echo 1', 'async')", "");
+	assert_true(wait_for_value("extcached('async', 'file', 'echo 1', 'async')",
+				"1"));
+	/* Unchanged. */
+	ASSERT_OK("extcached('async', 'file', 'echo 2', 'async')", "1");
+
+	/* Changed. */
+	struct timeval tvs[2] = {};
+	assert_success(utimes("file", tvs));
+	ASSERT_OK("extcached('async', 'file', 'echo 3', 'async')", "1");
+	assert_true(wait_for_value("extcached('async', 'file', 'echo 3', 'async')",
+				"3"));
+
+	/* Synchronous call doesn't return stale value. */
+	tvs[1].tv_sec = 1;
+	assert_success(utimes("file", tvs));
+	ASSERT_OK("extcached('async', 'file', 'echo 4', 'async')", "3");
+	ASSERT_OK("extcached('async', 'file', 'echo 4')", "4");
+
+	assert_success(remove("file"));
+	set_extcached_monitor_type(FMT_CHANGED);
+}
+
+/* Evaluates expression until it produces expected value or a time limit is
+ * reached.  Returns non-zero on success. */
+static int
+wait_for_value(const char expr[], const char expected[])
+{
+	int i;
+	for(i = 0; i < 500; ++i)
+	{
+		var_t result = var_false();
+		if(parse(expr, 0, &result) == PE_NO_ERROR)
+		{
+			char *const str = var_to_str(result);
+			const int equal = (str != NULL && strcmp(str, expected) == 0);
+			free(str);
+			var_free(result);
+			if(equal)
+			{
+				return 1;
+			}
+		}
+		usleep(10000);
+	}
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
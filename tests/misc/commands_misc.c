@@ -2,6 +2,8 @@
 
 #include <unistd.h> /* F_OK access() chdir() rmdir() symlink() unlink() */
 
+#include <limits.h> /* INT_MAX */
+#include <stdio.h> /* remove() */
 #include <string.h> /* strcpy() strdup() */
 
 #include "../../src/cfg/config.h"
@@ -17,6 +19,7 @@
 #include "../../src/utils/env.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/perf.h"
 #include "../../src/utils/str.h"
 #include "../../src/builtin_functions.h"
 #include "../../src/cmd_core.h"
@@ -263,7 +266,7 @@ TEST(putting_files_works)
 	regs_init();
 
 	assert_success(os_mkdir(SANDBOX_PATH "/empty-dir", 0700));
-	assert_success(flist_load_tree(&lwin, sandbox));
+	assert_success(flist_load_tree(&lwin, sandbox, INT_MAX));
 
 	make_abs_path(path, sizeof(path), TEST_DATA_PATH, "read/binary-data", cwd);
 	assert_success(regs_append(DEFAULT_REG_NAME, path));
@@ -701,6 +704,27 @@ TEST(regular_command)
 	assert_false(flist_custom_active(&lwin));
 }
 
+TEST(perf_command)
+{
+	strcpy(lwin.curr_dir, sandbox);
+
+	assert_success(exec_commands("perf on", &lwin, CIT_COMMAND));
+	assert_true(perf_enabled());
+	assert_success(exec_commands("perf reset", &lwin, CIT_COMMAND));
+	assert_success(exec_commands("perf off", &lwin, CIT_COMMAND));
+	assert_false(perf_enabled());
+
+	ui_sb_msg("");
+	assert_failure(exec_commands("perf bad", &lwin, CIT_COMMAND));
+	assert_string_equal("Unknown action: bad", ui_sb_last());
+	assert_failure(exec_commands("perf on extra", &lwin, CIT_COMMAND));
+	assert_failure(exec_commands("perf export", &lwin, CIT_COMMAND));
+
+	/* Path is relative to the current directory of the view. */
+	(void)exec_commands("perf export trace.json", &lwin, CIT_COMMAND);
+	assert_success(remove(SANDBOX_PATH "/trace.json"));
+}
+
 static void
 silent_key(key_info_t key_info, keys_info_t *keys_info)
 {
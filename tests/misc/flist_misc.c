@@ -1,7 +1,11 @@
 #include <stic.h>
 
 #include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() usleep() */
 
+#include <poll.h> /* POLLIN poll() pollfd */
+
+#include <limits.h> /* INT_MAX */
 #include <string.h> /* memset() strcpy() */
 #include <time.h> /* time() */
 
@@ -9,6 +13,7 @@
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/ui/fileview.h"
+#include "../../src/ui/listing_cache.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/cancellation.h"
 #include "../../src/utils/dynarray.h"
@@ -18,10 +23,14 @@
 #include "../../src/filelist.h"
 #include "../../src/flist_pos.h"
 #include "../../src/fops_misc.h"
+#include "../../src/sort.h"
 #include "../../src/status.h"
 
 #include "utils.h"
 
+static int wait_for_cache_update(cached_entries_t *cache, const char path[]);
+static int using_inotify(void);
+
 static char cwd[PATH_MAX + 1];
 
 SETUP_ONCE()
@@ -143,7 +152,7 @@ TEST(find_first_and_last_siblings)
 {
 	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), TEST_DATA_PATH, "tree",
 			cwd);
-	assert_success(flist_load_tree(&lwin, lwin.curr_dir));
+	assert_success(flist_load_tree(&lwin, lwin.curr_dir, INT_MAX));
 	assert_int_equal(12, lwin.list_rows);
 
 	assert_int_equal(0, fpos_first_sibling(&lwin));
@@ -163,7 +172,7 @@ TEST(find_next_and_prev_dir_sibling)
 {
 	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), TEST_DATA_PATH, "tree",
 			cwd);
-	assert_success(flist_load_tree(&lwin, lwin.curr_dir));
+	assert_success(flist_load_tree(&lwin, lwin.curr_dir, INT_MAX));
 	assert_int_equal(12, lwin.list_rows);
 
 	assert_int_equal(0, fpos_prev_dir_sibling(&lwin));
@@ -428,6 +437,66 @@ TEST(duplicated_entries_detected)
 	assert_true(lwin.has_dups);
 }
 
+TEST(entries_are_found_by_name_among_duplicates)
+{
+	lwin.list_rows = 4;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("a");
+	lwin.dir_entry[0].origin = strdup("/x");
+	lwin.dir_entry[1].name = strdup("b");
+	lwin.dir_entry[1].origin = strdup("/x");
+	lwin.dir_entry[2].name = strdup("a");
+	lwin.dir_entry[2].origin = strdup("/y");
+	lwin.dir_entry[3].name = strdup("c");
+	lwin.dir_entry[3].origin = strdup("/y");
+
+	assert_int_equal(0, fpos_find_by_name(&lwin, "a"));
+	assert_int_equal(2, fpos_find_entry(&lwin, "a", "/y"));
+	assert_int_equal(-1, fpos_find_entry(&lwin, "b", "/y"));
+	assert_int_equal(2, fpos_find_next_by_name(&lwin, "a", 0));
+	assert_int_equal(-1, fpos_find_next_by_name(&lwin, "a", 2));
+	assert_int_equal(-1, fpos_find_by_name(&lwin, "d"));
+
+	assert_true(entry_from_path(&lwin, lwin.dir_entry, lwin.list_rows, "/y/a")
+			== &lwin.dir_entry[2]);
+	assert_null(entry_from_path(&lwin, lwin.dir_entry, lwin.list_rows, "/z/a"));
+}
+
+TEST(renamed_entries_are_found_by_new_name)
+{
+	lwin.list_rows = 2;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("a");
+	lwin.dir_entry[0].origin = &lwin.curr_dir[0];
+	lwin.dir_entry[1].name = strdup("b");
+	lwin.dir_entry[1].origin = &lwin.curr_dir[0];
+
+	assert_int_equal(1, fpos_find_by_name(&lwin, "b"));
+	fentry_rename(&lwin, &lwin.dir_entry[1], "c");
+	assert_int_equal(-1, fpos_find_by_name(&lwin, "b"));
+	assert_int_equal(1, fpos_find_by_name(&lwin, "c"));
+}
+
+TEST(cursor_position_is_found_after_sorting)
+{
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), TEST_DATA_PATH,
+			"existing-files", cwd);
+	load_dir_list(&lwin, 1);
+	assert_int_equal(3, lwin.list_rows);
+	assert_int_equal(0, fpos_find_by_name(&lwin, "a"));
+	const int *const index = lwin.name_index;
+
+	lwin.sort[0] = -SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	sort_view(&lwin);
+	assert_int_equal(2, fpos_find_by_name(&lwin, "a"));
+	assert_int_equal(0, fpos_find_by_name(&lwin, "c"));
+	/* Index is refilled instead of being allocated anew. */
+	assert_true(lwin.name_index == index);
+}
+
 TEST(cache_handles_noexec_dirs, IF(not_windows))
 {
 	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
@@ -435,7 +504,7 @@ TEST(cache_handles_noexec_dirs, IF(not_windows))
 	assert_success(chmod(SANDBOX_PATH "/dir", 0666));
 
 	cached_entries_t cache = {};
-	assert_true(flist_update_cache(&lwin, &cache, SANDBOX_PATH "/dir"));
+	assert_true(wait_for_cache_update(&cache, SANDBOX_PATH "/dir"));
 	assert_int_equal(0, cache.entries.nentries);
 	flist_free_cache(&lwin, &cache);
 
@@ -444,6 +513,115 @@ TEST(cache_handles_noexec_dirs, IF(not_windows))
 	assert_success(rmdir(SANDBOX_PATH "/dir"));
 }
 
+TEST(cache_is_filled_in_background)
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/bg", 0700));
+	create_file(SANDBOX_PATH "/bg/file");
+
+	cached_entries_t cache = {};
+	assert_true(flist_update_cache(&lwin, &cache, SANDBOX_PATH "/bg"));
+	if(cache.entries.nentries < 0)
+	{
+		assert_true(wait_for_cache_update(&cache, SANDBOX_PATH "/bg"));
+	}
+	assert_int_equal(1, cache.entries.nentries);
+	assert_string_equal("file", cache.entries.entries[0].name);
+
+	/* Nothing changed. */
+	assert_false(flist_update_cache(&lwin, &cache, SANDBOX_PATH "/bg"));
+
+	/* Outdated list is kept until the directory is listed anew. */
+	create_file(SANDBOX_PATH "/bg/file2");
+	assert_true(wait_for_cache_update(&cache, SANDBOX_PATH "/bg"));
+	assert_int_equal(2, cache.entries.nentries);
+
+	flist_free_cache(&lwin, &cache);
+
+	assert_success(remove(SANDBOX_PATH "/bg/file"));
+	assert_success(remove(SANDBOX_PATH "/bg/file2"));
+	assert_success(rmdir(SANDBOX_PATH "/bg"));
+}
+
+TEST(changes_of_cached_directories_are_signalled, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/w1", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/w2", 0700));
+
+	cached_entries_t cache1 = {}, cache2 = {};
+	assert_true(flist_update_cache(&lwin, &cache1, SANDBOX_PATH "/w1"));
+	if(cache1.entries.nentries < 0)
+	{
+		assert_true(wait_for_cache_update(&cache1, SANDBOX_PATH "/w1"));
+	}
+	assert_true(flist_update_cache(&lwin, &cache2, SANDBOX_PATH "/w2"));
+	if(cache2.entries.nentries < 0)
+	{
+		assert_true(wait_for_cache_update(&cache2, SANDBOX_PATH "/w2"));
+	}
+
+	struct pollfd pfd = { .fd = lcache_get_watch_fd(), .events = POLLIN };
+	assert_true(pfd.fd >= 0);
+
+	/* Both directories are watched through the same descriptor. */
+	create_file(SANDBOX_PATH "/w2/file");
+	assert_int_equal(1, poll(&pfd, 1, 1000));
+	assert_true(wait_for_cache_update(&cache2, SANDBOX_PATH "/w2"));
+	assert_int_equal(1, cache2.entries.nentries);
+	assert_false(flist_update_cache(&lwin, &cache1, SANDBOX_PATH "/w1"));
+
+	flist_free_cache(&lwin, &cache1);
+	flist_free_cache(&lwin, &cache2);
+
+	assert_success(remove(SANDBOX_PATH "/w2/file"));
+	assert_success(rmdir(SANDBOX_PATH "/w1"));
+	assert_success(rmdir(SANDBOX_PATH "/w2"));
+}
+
+TEST(cache_is_rebuilt_without_listing_directory_anew)
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/rebuild", 0700));
+	create_file(SANDBOX_PATH "/rebuild/.hidden");
+
+	cached_entries_t cache = {};
+	assert_true(wait_for_cache_update(&cache, SANDBOX_PATH "/rebuild"));
+	assert_int_equal(1, cache.entries.nentries);
+
+	/* This is what reloading of a view does. */
+	lwin.hide_dot = 1;
+	cache.id = 0;
+	assert_true(flist_update_cache(&lwin, &cache, SANDBOX_PATH "/rebuild"));
+	assert_int_equal(0, cache.entries.nentries);
+	lwin.hide_dot = 0;
+
+	flist_free_cache(&lwin, &cache);
+
+	assert_success(remove(SANDBOX_PATH "/rebuild/.hidden"));
+	assert_success(rmdir(SANDBOX_PATH "/rebuild"));
+}
+
+TEST(prefetched_directories_are_available_right_away)
+{
+	int i;
+	char path[] = SANDBOX_PATH "/prefetch";
+	char *paths[] = { path };
+
+	assert_success(os_mkdir(path, 0700));
+
+	lcache_prefetch(paths, 1);
+	for(i = 0; i < 500 && lcache_is_busy(); ++i)
+	{
+		usleep(10000);
+	}
+	(void)lcache_check_updates();
+
+	cached_entries_t cache = {};
+	assert_true(flist_update_cache(&lwin, &cache, path));
+	assert_int_equal(0, cache.entries.nentries);
+	flist_free_cache(&lwin, &cache);
+
+	assert_success(rmdir(path));
+}
+
 TEST(filename_is_formatted_according_to_column_and_filetype)
 {
 	char origin[] = "";
@@ -489,5 +667,34 @@ TEST(filename_is_formatted_according_to_column_and_filetype)
 	assert_string_equal("a.b", name);
 }
 
+/* Waits for cached list to be updated with new listing of a directory.
+ * Returns non-zero on success, otherwise zero is returned. */
+static int
+wait_for_cache_update(cached_entries_t *cache, const char path[])
+{
+	int i;
+	for(i = 0; i < 500; ++i)
+	{
+		if(flist_update_cache(&lwin, cache, path) && cache->entries.nentries >= 0)
+		{
+			return 1;
+		}
+		usleep(10000);
+	}
+	return 0;
+}
+
+/* Checks whether changes of directories are signalled by a descriptor.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
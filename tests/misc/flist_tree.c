@@ -816,7 +816,7 @@ load_tree(view_t *view, const char path[])
 {
 	char abs_path[PATH_MAX + 1];
 	make_abs_path(abs_path, sizeof(abs_path), path, "", cwd);
-	return flist_load_tree(view, abs_path);
+	return flist_load_tree(view, abs_path, INT_MAX);
 }
 
 static void
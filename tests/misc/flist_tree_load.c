@@ -0,0 +1,212 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() */
+
+#include <limits.h> /* INT_MAX */
+#include <stdio.h> /* remove() snprintf() */
+#include <string.h> /* strcmp() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+static int load_tree(view_t *view, const char path[], int depth);
+static void column_line_print(const void *data, int column_id, const char buf[],
+		size_t offset, AlignType align, const char full_column[]);
+static void load_view(view_t *view);
+static int find_entry(const view_t *view, const char name[]);
+
+static char cwd[PATH_MAX + 1], test_data[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(test_data, sizeof(test_data), TEST_DATA_PATH, "", cwd);
+}
+
+SETUP()
+{
+	update_string(&cfg.fuse_home, "no");
+	update_string(&cfg.slow_fs_list, "");
+
+	view_setup(&lwin);
+
+	curr_view = &lwin;
+	other_view = &lwin;
+
+	columns_set_line_print_func(&column_line_print);
+	lwin.columns = columns_create();
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.slow_fs_list, NULL);
+	update_string(&cfg.fuse_home, NULL);
+
+	view_teardown(&lwin);
+
+	columns_set_line_print_func(NULL);
+	columns_free(lwin.columns);
+	lwin.columns = NULL;
+}
+
+TEST(depth_limits_loaded_part_of_tree)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 1));
+	assert_int_equal(3, lwin.list_rows);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir1")].folded);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir5")].folded);
+
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 2));
+	assert_int_equal(7, lwin.list_rows);
+	assert_false(lwin.dir_entry[find_entry(&lwin, "dir1")].folded);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir2")].folded);
+	assert_int_equal(0, lwin.dir_entry[find_entry(&lwin, "dir2")].child_count);
+}
+
+TEST(unfolding_loads_children_of_directory)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 1));
+	assert_int_equal(3, lwin.list_rows);
+
+	lwin.list_pos = find_entry(&lwin, "dir1");
+	curr_stats.load_stage = 2;
+	assert_success(flist_toggle_fold(&lwin));
+	curr_stats.load_stage = 0;
+
+	assert_int_equal(5, lwin.list_rows);
+	assert_int_equal(2, lwin.dir_entry[find_entry(&lwin, "dir1")].child_count);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir2")].folded);
+	assert_string_equal("dir1", get_current_file_name(&lwin));
+}
+
+TEST(folding_drops_children_of_directory)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", INT_MAX));
+	assert_int_equal(12, lwin.list_rows);
+
+	lwin.list_pos = find_entry(&lwin, "dir2");
+	curr_stats.load_stage = 2;
+	assert_success(flist_toggle_fold(&lwin));
+	curr_stats.load_stage = 0;
+
+	assert_int_equal(7, lwin.list_rows);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir2")].folded);
+	assert_string_equal("dir2", get_current_file_name(&lwin));
+}
+
+TEST(folding_state_survives_reload)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 1));
+
+	lwin.list_pos = find_entry(&lwin, "dir5");
+	curr_stats.load_stage = 2;
+	assert_success(flist_toggle_fold(&lwin));
+	curr_stats.load_stage = 0;
+	assert_int_equal(5, lwin.list_rows);
+
+	load_view(&lwin);
+	assert_int_equal(5, lwin.list_rows);
+	assert_true(lwin.dir_entry[find_entry(&lwin, "dir1")].folded);
+	assert_false(lwin.dir_entry[find_entry(&lwin, "dir5")].folded);
+}
+
+TEST(folding_state_is_reset_by_loading_new_tree)
+{
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 1));
+
+	lwin.list_pos = find_entry(&lwin, "dir5");
+	curr_stats.load_stage = 2;
+	assert_success(flist_toggle_fold(&lwin));
+	curr_stats.load_stage = 0;
+
+	assert_success(load_tree(&lwin, TEST_DATA_PATH "/tree", 1));
+	assert_int_equal(3, lwin.list_rows);
+}
+
+TEST(folds_can_not_be_toggled_outside_of_tree)
+{
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), TEST_DATA_PATH, "tree",
+			cwd);
+	load_view(&lwin);
+	lwin.list_pos = find_entry(&lwin, "dir1");
+
+	assert_failure(flist_toggle_fold(&lwin));
+}
+
+TEST(reload_picks_up_changes_in_nested_directories)
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	create_file(SANDBOX_PATH "/dir/file1");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH, INT_MAX));
+	assert_int_equal(2, lwin.list_rows);
+
+	create_file(SANDBOX_PATH "/dir/file2");
+	load_view(&lwin);
+	assert_int_equal(3, lwin.list_rows);
+
+	assert_success(chmod(SANDBOX_PATH "/dir/file1", 0600));
+	load_view(&lwin);
+	assert_int_equal(0600,
+			lwin.dir_entry[find_entry(&lwin, "file1")].mode & 0777);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file1"));
+	assert_success(remove(SANDBOX_PATH "/dir/file2"));
+	load_view(&lwin);
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("..", lwin.dir_entry[1].name);
+
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+static int
+load_tree(view_t *view, const char path[], int depth)
+{
+	char abs_path[PATH_MAX + 1];
+	make_abs_path(abs_path, sizeof(abs_path), path, "", cwd);
+	return flist_load_tree(view, abs_path, depth);
+}
+
+static void
+column_line_print(const void *data, int column_id, const char buf[],
+		size_t offset, AlignType align, const char full_column[])
+{
+	/* Do nothing. */
+}
+
+static void
+load_view(view_t *view)
+{
+	curr_stats.load_stage = 2;
+	load_saving_pos(view);
+	curr_stats.load_stage = 0;
+}
+
+static int
+find_entry(const view_t *view, const char name[])
+{
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(strcmp(view->dir_entry[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+	assert_fail("Entry wasn't found");
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,116 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strlen() */
+#include <time.h> /* time_t */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/fileview.h"
+#include "../../src/utils/str.h"
+
+/* 15th of June of 2000, which is the same date in all time zones. */
+static const time_t SOME_TIME = 961070400;
+
+SETUP()
+{
+	cfg.sizefmt.base = 1024;
+	cfg.sizefmt.precision = 0;
+	cfg.sizefmt.space = 1;
+	cfg.sizefmt.ieci_prefixes = 0;
+	fview_formats_updated();
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.time_format, NULL);
+	fview_formats_updated();
+}
+
+TEST(time_is_formatted)
+{
+	char buf[64];
+
+	update_string(&cfg.time_format, "%Y-%m-%d");
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("2000-06-15", buf);
+
+	/* Result from the cache. */
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("2000-06-15", buf);
+}
+
+TEST(changing_time_format_takes_effect)
+{
+	char buf[64];
+
+	update_string(&cfg.time_format, "%Y");
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("2000", buf);
+
+	update_string(&cfg.time_format, "%m");
+	fview_formats_updated();
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("06", buf);
+}
+
+TEST(cached_time_is_truncated_to_the_buffer)
+{
+	char full[64];
+	char buf[5];
+
+	update_string(&cfg.time_format, "%Y-%m-%d");
+	format_time_value(SOME_TIME, sizeof(full), full);
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("2000", buf);
+}
+
+TEST(too_long_times_are_not_cached)
+{
+	char buf[128];
+
+	update_string(&cfg.time_format,
+			"%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y");
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_int_equal(24*4, strlen(buf));
+
+	update_string(&cfg.time_format, "%Y");
+	fview_formats_updated();
+	format_time_value(SOME_TIME, sizeof(buf), buf);
+	assert_string_equal("2000", buf);
+}
+
+TEST(different_values_in_the_same_slot_do_not_clash)
+{
+	char buf[64];
+	time_t t;
+
+	update_string(&cfg.time_format, "%s");
+	for(t = 0; t < 1000; ++t)
+	{
+		char expected[64];
+		snprintf(expected, sizeof(expected), "%d", (int)t);
+		format_time_value(t, sizeof(buf), buf);
+		assert_string_equal(expected, buf);
+	}
+}
+
+TEST(changing_size_format_takes_effect)
+{
+	char buf[64];
+
+	format_size_value(15872, sizeof(buf), buf);
+	assert_string_equal("16 K", buf);
+
+	cfg.sizefmt.precision = 1;
+	fview_formats_updated();
+	format_size_value(15872, sizeof(buf), buf);
+	assert_string_equal("15.5 K", buf);
+
+	cfg.sizefmt.space = 0;
+	fview_formats_updated();
+	format_size_value(15872, sizeof(buf), buf);
+	assert_string_equal("15.5K", buf);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
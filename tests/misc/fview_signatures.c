@@ -0,0 +1,325 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/curses.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/fileview.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/str.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+static void start_drawing(int nentries);
+static void stop_drawing(void);
+static void mark_window(void);
+static char cell_char(int row);
+
+static char name[] = "file";
+static char other_name[] = "File";
+static char origin[] = "/some/path";
+
+static dir_entry_t entry;
+static SCREEN *screen;
+static FILE *term_out;
+static FILE *term_in;
+
+SETUP()
+{
+	dir_entry_t initial = {
+		.name = name,
+		.origin = origin,
+		.size = 10,
+		.hi_num = -1,
+		.name_dec_num = -1,
+		.type = FT_REG,
+	};
+	entry = initial;
+}
+
+TEST(signature_is_stable)
+{
+	assert_true(get_entry_signature(&entry) == get_entry_signature(&entry));
+}
+
+TEST(signature_depends_on_name_and_location)
+{
+	const uint64_t before = get_entry_signature(&entry);
+
+	entry.name = other_name;
+	assert_false(get_entry_signature(&entry) == before);
+
+	entry.name = name;
+	entry.origin = other_name;
+	assert_false(get_entry_signature(&entry) == before);
+}
+
+TEST(signature_depends_on_selection_and_search)
+{
+	const uint64_t before = get_entry_signature(&entry);
+
+	entry.selected = 1;
+	assert_false(get_entry_signature(&entry) == before);
+	entry.selected = 0;
+
+	entry.search_match = 1;
+	entry.match_left = 0;
+	entry.match_right = 2;
+	assert_false(get_entry_signature(&entry) == before);
+}
+
+TEST(signature_depends_on_file_properties)
+{
+	const uint64_t before = get_entry_signature(&entry);
+
+	entry.size = 11;
+	assert_false(get_entry_signature(&entry) == before);
+	entry.size = 10;
+
+	entry.mtime = 1;
+	assert_false(get_entry_signature(&entry) == before);
+	entry.mtime = 0;
+
+	entry.type = FT_DIR;
+	assert_false(get_entry_signature(&entry) == before);
+}
+
+TEST(signature_ignores_caches_and_temporary_data)
+{
+	const uint64_t before = get_entry_signature(&entry);
+
+	entry.hi_num = 3;
+	entry.name_dec_num = 2;
+	entry.tag = 123;
+	entry.was_selected = 1;
+	assert_true(get_entry_signature(&entry) == before);
+}
+
+TEST(cell_signature_depends_on_cached_directory_info)
+{
+	char dir_name[] = "read";
+	char dir_origin[] = TEST_DATA_PATH;
+	view_t view = { .list_rows = 1 };
+	column_data_t cdt = { .view = &view, .entry = &entry };
+	uint64_t before;
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	entry.name = dir_name;
+	entry.origin = dir_origin;
+	entry.type = FT_DIR;
+	before = get_cell_signature(&cdt, 0);
+
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 10, DCACHE_UNKNOWN));
+	assert_false(get_cell_signature(&cdt, 0) == before);
+	before = get_cell_signature(&cdt, 0);
+
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", DCACHE_UNKNOWN, 3));
+	assert_false(get_cell_signature(&cdt, 0) == before);
+
+	update_string(&cfg.shell, NULL);
+}
+
+TEST(damaging_view_without_window_does_nothing)
+{
+	view_t view = { .win = NULL };
+	fview_damage(&view);
+}
+
+TEST(unchanged_cells_are_not_redrawn)
+{
+	start_drawing(3);
+
+	draw_dir_list_only(&lwin);
+	assert_int_equal('a', cell_char(0));
+	assert_int_equal('b', cell_char(1));
+	assert_int_equal('c', cell_char(2));
+
+	mark_window();
+	draw_dir_list_only(&lwin);
+	assert_int_equal('#', cell_char(0));
+	assert_int_equal('#', cell_char(1));
+	assert_int_equal('#', cell_char(2));
+
+	replace_string(&lwin.dir_entry[1].name, "x");
+	draw_dir_list_only(&lwin);
+	assert_int_equal('#', cell_char(0));
+	assert_int_equal('x', cell_char(1));
+	assert_int_equal('#', cell_char(2));
+
+	stop_drawing();
+}
+
+TEST(cells_that_became_empty_are_cleared)
+{
+	start_drawing(3);
+
+	draw_dir_list_only(&lwin);
+	mark_window();
+
+	free(lwin.dir_entry[2].name);
+	lwin.dir_entry[2].name = NULL;
+	lwin.list_rows = 2;
+
+	draw_dir_list_only(&lwin);
+	assert_int_equal('#', cell_char(0));
+	assert_int_equal('#', cell_char(1));
+	assert_int_equal(' ', cell_char(2));
+
+	/* Cleared cell isn't cleared again. */
+	mark_window();
+	draw_dir_list_only(&lwin);
+	assert_int_equal('#', cell_char(2));
+
+	stop_drawing();
+}
+
+TEST(scrolling_moves_drawn_cells)
+{
+	start_drawing(5);
+	lwin.list_pos = 2;
+
+	draw_dir_list_only(&lwin);
+	mark_window();
+
+	lwin.top_line = 1;
+	draw_dir_list_only(&lwin);
+	assert_int_equal(1, lwin.top_line);
+	assert_int_equal('#', cell_char(0));
+	assert_int_equal('#', cell_char(1));
+	assert_int_equal('d', cell_char(2));
+
+	mark_window();
+	lwin.top_line = 0;
+	draw_dir_list_only(&lwin);
+	assert_int_equal(0, lwin.top_line);
+	assert_int_equal('a', cell_char(0));
+	assert_int_equal('#', cell_char(1));
+	assert_int_equal('#', cell_char(2));
+
+	stop_drawing();
+}
+
+TEST(damaged_view_is_redrawn_completely)
+{
+	start_drawing(3);
+
+	draw_dir_list_only(&lwin);
+	mark_window();
+
+	fview_damage(&lwin);
+	draw_dir_list_only(&lwin);
+	assert_int_equal('a', cell_char(0));
+	assert_int_equal('b', cell_char(1));
+	assert_int_equal('c', cell_char(2));
+
+	stop_drawing();
+}
+
+/* Sets up lwin to be drawn into a curses window with three lines, which shows
+ * entries named "a", "b", etc. */
+static void
+start_drawing(int nentries)
+{
+	static const column_info_t name_column = {
+		.column_id = SK_BY_NAME, .full_width = 0UL,    .text_width = 0UL,
+		.align = AT_LEFT,        .sizing = ST_AUTO,    .cropping = CT_NONE,
+	};
+
+	int i;
+
+	term_out = fopen("/dev/null", "w");
+	term_in = fopen("/dev/null", "r");
+	assert_non_null(term_out);
+	assert_non_null(term_in);
+	screen = newterm("dumb", term_out, term_in);
+	assert_non_null(screen);
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	lwin.list_rows = nentries;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	for(i = 0; i < nentries; ++i)
+	{
+		const char entry_name[] = { 'a' + i, '\0' };
+		lwin.dir_entry[i].name = strdup(entry_name);
+		lwin.dir_entry[i].origin = &lwin.curr_dir[0];
+		lwin.dir_entry[i].type = FT_REG;
+		lwin.dir_entry[i].hi_num = -1;
+		lwin.dir_entry[i].name_dec_num = -1;
+	}
+
+	cfg.extra_padding = 0;
+	cfg.scroll_off = 0;
+	lwin.window_rows = 3;
+	lwin.window_cols = 10;
+	lwin.win = newwin(lwin.window_rows, lwin.window_cols, 0, 0);
+	assert_non_null(lwin.win);
+
+	fview_setup();
+	lwin.columns = columns_create();
+	columns_add_column(lwin.columns, name_column);
+
+	curr_stats.load_stage = 2;
+}
+
+/* Undoes effects of start_drawing(). */
+static void
+stop_drawing(void)
+{
+	curr_stats.load_stage = 0;
+
+	columns_free(lwin.columns);
+	lwin.columns = NULL;
+	columns_teardown();
+
+	/* Forget about contents of the window before it's gone. */
+	fview_damage(&lwin);
+	delwin(lwin.win);
+	lwin.win = NULL;
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	endwin();
+	delscreen(screen);
+	screen = NULL;
+	fclose(term_out);
+	fclose(term_in);
+}
+
+/* Fills the window with marks to be able to tell which cells get drawn. */
+static void
+mark_window(void)
+{
+	int row, col;
+	for(row = 0; row < lwin.window_rows; ++row)
+	{
+		for(col = 0; col < lwin.window_cols; ++col)
+		{
+			mvwaddch(lwin.win, row, col, '#');
+		}
+	}
+}
+
+/* Retrieves character at the start of a line of the window.  Returns the
+ * character. */
+static char
+cell_char(int row)
+{
+	return mvwinch(lwin.win, row, 0) & A_CHARTEXT;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
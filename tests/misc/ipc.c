@@ -2,12 +2,21 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/socket.h> /* AF_UNIX SOCK_STREAM bind() socket() */
+#include <sys/stat.h> /* chmod() mkdir() */
+#include <sys/un.h> /* sockaddr_un */
+#include <poll.h> /* poll() pollfd POLLIN */
+#include <unistd.h> /* F_OK access() close() getuid() unlink() */
 #endif
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strcmp() strdup() */
 
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/path.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 #include "../../src/background.h"
@@ -20,6 +29,10 @@ static void test_ipc_args2(char *args[]);
 static void recursive_ipc_args(char *args[]);
 static char * test_ipc_eval(const char expr[]);
 static char * test_ipc_eval_error(const char expr[]);
+static void serving_instance(bg_op_t *bg_op, void *arg);
+#ifndef _WIN32
+static int count_ready(ipc_t *ipc);
+#endif
 static void other_instance(bg_op_t *bg_op, void *arg);
 static int enabled_and_not_in_wine(void);
 static int enabled_and_not_windows(void);
@@ -30,11 +43,14 @@ static char *message;
 static int nmessages2;
 static char *message2;
 static ipc_t *recursive_ipc;
+static int nrecursive_calls;
+static volatile int stop_serving;
 
 TEARDOWN()
 {
 	nmessages = 0;
 	nmessages2 = 0;
+	nrecursive_calls = 0;
 	update_string(&message, NULL);
 	update_string(&message2, NULL);
 }
@@ -130,7 +146,7 @@ TEST(expr_is_evaluated, IF(enabled_and_not_in_wine))
 	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
 	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
 
-	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
 
 	result = ipc_eval(ipc1, ipc_get_name(ipc2), expr);
 	assert_false(ipc_check(ipc1));
@@ -157,7 +173,7 @@ TEST(eval_error_is_handled, IF(enabled_and_not_in_wine))
 	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
 	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval_error);
 
-	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(bg_execute("", "", 0, 1, NULL, &other_instance, ipc2));
 
 	result = ipc_eval(ipc1, ipc_get_name(ipc2), expr);
 	assert_false(ipc_check(ipc1));
@@ -186,13 +202,124 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 
 	recursive_ipc = ipc2;
 
+	/* Both messages are handled by a single check. */
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_true(ipc_check(ipc2));
+	assert_false(ipc_check(ipc2));
+	assert_int_equal(2, nrecursive_calls);
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(descriptor_is_readable_only_when_there_is_a_message,
+		IF(enabled_and_not_windows))
+{
+#ifndef _WIN32
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	assert_int_equal(0, count_ready(ipc2));
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_int_equal(1, count_ready(ipc2));
+
+	assert_true(ipc_check(ipc2));
+	assert_int_equal(0, count_ready(ipc2));
+
+	/* Connection is kept open and new data on it is noticed. */
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_int_equal(1, count_ready(ipc2));
 	assert_true(ipc_check(ipc2));
 
 	ipc_free(ipc1);
 	ipc_free(ipc2);
+
+	assert_int_equal(4, nmessages2);
+#endif
+}
+
+TEST(several_exprs_are_evaluated_in_order, IF(enabled_and_not_in_wine))
+{
+	char *exprs[] = { "good expression", "bad expression", "good expression" };
+	char *results[3];
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	stop_serving = 0;
+	assert_success(bg_execute("", "", 0, 1, NULL, &serving_instance, ipc2));
+
+	assert_failure(ipc_eval_many(ipc1, ipc_get_name(ipc2), exprs, 3, results));
+	assert_string_equal("good result", results[0]);
+	assert_string_equal(NULL, results[1]);
+	assert_string_equal("good result", results[2]);
+	free(results[0]);
+	free(results[2]);
+
+	/* The same connection is used again. */
+	assert_success(ipc_eval_many(ipc1, ipc_get_name(ipc2), exprs, 1, results));
+	assert_string_equal("good result", results[0]);
+	free(results[0]);
+
+	stop_serving = 1;
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+TEST(abandoned_socket_is_reused, IF(enabled_and_not_windows))
+{
+#ifndef _WIN32
+	char path[PATH_MAX + 1];
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	ipc_t *ipc;
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	assert_true(fd != -1);
+
+	snprintf(path, sizeof(path), "%s/vifm-%lu", get_tmpdir(),
+			(unsigned long)getuid());
+	(void)mkdir(path, 0700);
+
+	snprintf(path, sizeof(path), "%s/vifm-%lu/vifm-ipc-%s-abandoned",
+			get_tmpdir(), (unsigned long)getuid(), NAME);
+	(void)unlink(path);
+	copy_str(addr.sun_path, sizeof(addr.sun_path), path);
+	assert_success(bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+	close(fd);
+
+	ipc = ipc_init("vifm-test-abandoned", &test_ipc_args, &test_ipc_eval);
+	assert_string_equal("vifm-test-abandoned", ipc_get_name(ipc));
+	ipc_free(ipc);
+
+	assert_failure(access(path, F_OK));
+#endif
+}
+
+TEST(directory_accessible_by_others_is_not_used, IF(enabled_and_not_windows))
+{
+#ifndef _WIN32
+	char dir[PATH_MAX + 1];
+	ipc_t *ipc;
+
+	snprintf(dir, sizeof(dir), "%s/vifm-%lu", get_tmpdir(),
+			(unsigned long)getuid());
+	(void)mkdir(dir, 0700);
+
+	assert_success(chmod(dir, 0755));
+	assert_null(ipc_init(NAME, &test_ipc_args, &test_ipc_eval));
+	assert_success(chmod(dir, 0700));
+
+	ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	assert_non_null(ipc);
+	ipc_free(ipc);
+#endif
 }
 
 static void
@@ -212,6 +339,7 @@ test_ipc_args2(char *args[])
 static void
 recursive_ipc_args(char *args[])
 {
+	++nrecursive_calls;
 	assert_false(ipc_check(recursive_ipc));
 }
 
@@ -231,6 +359,40 @@ test_ipc_eval_error(const char expr[])
 	return NULL;
 }
 
+static void
+serving_instance(bg_op_t *bg_op, void *arg)
+{
+	ipc_t *const ipc = arg;
+	while(!stop_serving)
+	{
+		(void)ipc_check(ipc);
+	}
+}
+
+#ifndef _WIN32
+
+/* Counts descriptors of the IPC instance that are ready for reading.  Returns
+ * the number. */
+static int
+count_ready(ipc_t *ipc)
+{
+	int i;
+	int fds[IPC_MAX_FDS];
+	struct pollfd pfds[IPC_MAX_FDS];
+
+	const int nfds = ipc_get_fds(ipc, fds);
+	assert_true(nfds > 0);
+
+	for(i = 0; i < nfds; ++i)
+	{
+		pfds[i].fd = fds[i];
+		pfds[i].events = POLLIN;
+	}
+	return poll(pfds, nfds, 0);
+}
+
+#endif
+
 static void
 other_instance(bg_op_t *bg_op, void *arg)
 {
@@ -1,6 +1,6 @@
 #include <stic.h>
 
-#include <string.h> /* memcmp() */
+#include <string.h> /* memcmp() strdup() */
 
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
@@ -8,6 +8,7 @@
 #include "../../src/ui/column_view.h"
 #include "../../src/ui/fileview.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
 #include "../../src/utils/fs.h"
 #include "../../src/cmd_core.h"
 #include "../../src/filelist.h"
@@ -220,5 +221,40 @@ TEST(changing_classify_invalidates_decors_cache)
 	columns_teardown();
 }
 
+TEST(changing_classify_updates_widths_of_names_in_ls_view)
+{
+	lwin.list_rows = 2;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("a");
+	lwin.dir_entry[0].origin = &lwin.curr_dir[0];
+	lwin.dir_entry[0].name_dec_num = -1;
+	lwin.dir_entry[1].name = strdup("b");
+	lwin.dir_entry[1].origin = &lwin.curr_dir[0];
+	lwin.dir_entry[1].name_dec_num = -1;
+
+	cfg.extra_padding = 0;
+	lwin.ls_view = 1;
+	lwin.window_cols = 20;
+	lwin.window_rows = 1;
+
+	fview_list_updated(&lwin);
+	fview_update_geometry(&lwin);
+	assert_int_equal(10, lwin.column_count);
+
+	/* Geometry update reuses cached widths. */
+	lwin.dir_entry[1].name_width = 4;
+	fview_list_updated(&lwin);
+	fview_update_geometry(&lwin);
+	assert_int_equal(5, lwin.column_count);
+
+	assert_success(exec_commands("set classify=<<<::*::>>>", &lwin, CIT_COMMAND));
+	fview_list_updated(&lwin);
+	fview_update_geometry(&lwin);
+	assert_int_equal(2, lwin.column_count);
+
+	lwin.ls_view = 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
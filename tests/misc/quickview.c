@@ -1,13 +1,17 @@
 #include <stic.h>
 
+#include <unistd.h> /* usleep() */
+
 #include <stdio.h> /* FILE fclose() fopen() */
 #include <string.h> /* strcpy() */
 
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
+#include "../../src/ui/preview_cache.h"
 #include "../../src/ui/quickview.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/file_streams.h"
+#include "../../src/utils/macros.h"
 #include "../../src/utils/matchers.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
@@ -15,6 +19,14 @@
 
 #include "utils.h"
 
+static void slow_producer(const char path[], int max_lines, strlist_t *lines,
+		pcache_report_f report, void *arg);
+static PcacheState wait_for_preview(const pcache_key_t *key,
+		strlist_t *lines);
+
+/* Whether slow_producer() should finish. */
+static int producer_can_finish;
+
 SETUP()
 {
 	curr_view = &lwin;
@@ -200,5 +212,177 @@ TEST(can_read_only_specified_number_of_lines)
 	fclose(fp);
 }
 
+TEST(directory_tree_is_printed)
+{
+	FILE *fp = qv_view_dir(TEST_DATA_PATH "/tree/dir1");
+	assert_non_null(fp);
+
+	strlist_t lines = read_lines(fp, 100);
+	fclose(fp);
+
+	const char *expected[] = {
+		"dir1/",
+		"|-- dir2/",
+		"|   |-- dir3/",
+		"|   |   |-- file1",
+		"|   |   `-- file2",
+		"|   `-- dir4/",
+		"|       `-- file3",
+		"`-- file4",
+		"",
+		"3 directories, 4 files",
+	};
+
+	int i;
+	assert_int_equal(ARRAY_LEN(expected), lines.nitems);
+	for(i = 0; i < lines.nitems && i < (int)ARRAY_LEN(expected); ++i)
+	{
+		assert_string_equal(expected[i], lines.items[i]);
+	}
+
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(previews_are_produced_in_background, IF(not_windows))
+{
+	update_string(&cfg.shell, "sh");
+	update_string(&cfg.shell_cmd_flag, "-c");
+
+	const pcache_key_t key = {
+		"printf '\\357\\273\\277a\\r\\nb\\n'", NULL, "/",
+		TEST_DATA_PATH "/read/two-lines", 10, 10
+	};
+	pcache_request(&key, 1, 10);
+
+	strlist_t lines;
+	assert_int_equal(PCS_READY, wait_for_preview(&key, &lines));
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("a", lines.items[0]);
+	assert_string_equal("b", lines.items[1]);
+	free_string_array(lines.items, lines.nitems);
+	assert_true(pcache_check_updates());
+	assert_false(pcache_check_updates());
+
+	/* Different size of the area is a different preview. */
+	const pcache_key_t other_size = {
+		key.cmd, NULL, key.dir, key.path, key.w + 1, key.h
+	};
+	assert_int_equal(PCS_MISSING, pcache_lookup(&other_size, &lines));
+	assert_int_equal(0, lines.nitems);
+
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+}
+
+TEST(background_previews_are_limited_in_lines, IF(not_windows))
+{
+	update_string(&cfg.shell, "sh");
+	update_string(&cfg.shell_cmd_flag, "-c");
+
+	const pcache_key_t key = {
+		"while true; do echo line; done", NULL, "/",
+		TEST_DATA_PATH "/read/two-lines", 10, 10
+	};
+	pcache_request(&key, 1, 3);
+
+	strlist_t lines;
+	assert_int_equal(PCS_READY, wait_for_preview(&key, &lines));
+	assert_int_equal(3, lines.nitems);
+	free_string_array(lines.items, lines.nitems);
+
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+}
+
+TEST(superseded_previews_are_cancelled, IF(not_windows))
+{
+	update_string(&cfg.shell, "sh");
+	update_string(&cfg.shell_cmd_flag, "-c");
+
+	const pcache_key_t slow = {
+		"sleep 10; echo slow", NULL, "/", TEST_DATA_PATH "/read/two-lines", 10, 10
+	};
+	const pcache_key_t fast = {
+		"pwd", NULL, TEST_DATA_PATH "/read", TEST_DATA_PATH "/read/two-lines",
+		10, 10
+	};
+
+	pcache_request(&slow, 1, 10);
+	pcache_request(&fast, 1, 10);
+
+	strlist_t lines;
+	assert_int_equal(PCS_READY, wait_for_preview(&fast, &lines));
+	assert_int_equal(1, lines.nitems);
+	assert_true(ends_with(lines.items[0], "/read"));
+	free_string_array(lines.items, lines.nitems);
+	assert_int_equal(PCS_MISSING, pcache_lookup(&slow, &lines));
+
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+}
+
+TEST(partial_previews_are_available, IF(not_windows))
+{
+	const pcache_key_t key = {
+		NULL, &slow_producer, TEST_DATA_PATH, TEST_DATA_PATH, 10, 10
+	};
+	pcache_request(&key, 1, 10);
+
+	strlist_t lines;
+	int i;
+	PcacheState state = PCS_MISSING;
+	for(i = 0; i < 500 && state == PCS_MISSING; ++i)
+	{
+		usleep(10000);
+		state = pcache_lookup(&key, &lines);
+	}
+	assert_int_equal(PCS_PARTIAL, state);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("first", lines.items[0]);
+	free_string_array(lines.items, lines.nitems);
+
+	producer_can_finish = 1;
+	assert_int_equal(PCS_READY, wait_for_preview(&key, &lines));
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("second", lines.items[1]);
+	free_string_array(lines.items, lines.nitems);
+}
+
+/* Producer of previews that reports a line and waits for permission to finish.
+ * Matches pcache_producer_f type. */
+static void
+slow_producer(const char path[], int max_lines, strlist_t *lines,
+		pcache_report_f report, void *arg)
+{
+	lines->nitems = add_to_string_array(&lines->items, lines->nitems, 1,
+			"first");
+	while(!producer_can_finish)
+	{
+		(void)report(arg, lines);
+		usleep(10000);
+	}
+	lines->nitems = add_to_string_array(&lines->items, lines->nitems, 1,
+			"second");
+}
+
+/* Waits for at most 5 seconds for a preview to be produced.  Returns state of
+ * the preview, lines of which are stored in *lines. */
+static PcacheState
+wait_for_preview(const pcache_key_t *key, strlist_t *lines)
+{
+	int i;
+	for(i = 0; i < 500; ++i)
+	{
+		const PcacheState state = pcache_lookup(key, lines);
+		if(state == PCS_READY)
+		{
+			return state;
+		}
+		free_string_array(lines->items, lines->nitems);
+		usleep(10000);
+	}
+	return pcache_lookup(key, lines);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
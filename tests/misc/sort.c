@@ -3,9 +3,11 @@
 #include <unistd.h> /* chdir() unlink() */
 
 #include <locale.h> /* LC_ALL setlocale() */
-#include <string.h> /* memset() strcpy() */
+#include <stdlib.h> /* rand() srand() */
+#include <string.h> /* memset() strcat() strcpy() strlen() */
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/utils/str.h"
@@ -14,6 +16,9 @@
 
 #include "utils.h"
 
+static void make_random_name(char buf[]);
+static int ref_name_cmp(const char s[], const char t[], int ignore_case);
+
 #define SIGN(n) ({__typeof(n) _n = (n); (_n < 0) ? -1 : (_n > 0);})
 #define ASSERT_STRCMP_EQUAL(a, b) \
 		do { assert_int_equal(SIGN(a), SIGN(b)); } while(0)
@@ -276,6 +281,58 @@ TEST(versort_man_page_example)
 	assert_true(strnumcmp("9", "10") < 0);
 }
 
+TEST(versort_of_prefixed_strings_matches_full_comparison)
+{
+	int i;
+
+	srand(1);
+	for(i = 0; i < 20000; ++i)
+	{
+		char s[128], t[128];
+		make_random_name(s);
+		make_random_name(t);
+
+		ASSERT_STRCMP_EQUAL(strnumcmp(s, t),
+				strnumcmp_len(s, strlen(s), t, strlen(t)));
+		ASSERT_STRCMP_EQUAL(strnumcmp(t, s),
+				strnumcmp_len(t, strlen(t), s, strlen(s)));
+	}
+}
+
+TEST(name_sorting_matches_pairwise_comparison)
+{
+	int ignore_case;
+	int i;
+
+	view_teardown(&lwin);
+
+	srand(2);
+	lwin.list_rows = 500;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		char name[128];
+		make_random_name(name);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].type = FT_REG;
+	}
+
+	for(ignore_case = 0; ignore_case < 2; ++ignore_case)
+	{
+		lwin.sort[0] = ignore_case ? SK_BY_INAME : SK_BY_NAME;
+		memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+		sort_view(&lwin);
+
+		for(i = 1; i < lwin.list_rows; ++i)
+		{
+			assert_true(ref_name_cmp(lwin.dir_entry[i - 1].name,
+						lwin.dir_entry[i].name, ignore_case) <= 0);
+		}
+	}
+}
+
 TEST(ignore_case_name_sort_breaks_ties_deterministically)
 {
 	/* If normalized names are equal, byte-by-byte comparison should be used to
@@ -483,5 +540,51 @@ TEST(inode_sorting_works)
 
 #endif
 
+/* Fills the buffer with a random name made of letters, dots and numbers with
+ * and without leading zeros. */
+static void
+make_random_name(char buf[])
+{
+	static const char *const pieces[] = {
+		"0", "00", "1", "9", "10", "010", "123456789", "a", "B", "abcdefgh",
+		"ABCDEFGH", ".", "-", "_", "v", "Я", "я",
+	};
+
+	int n = 1 + rand()%12;
+
+	buf[0] = '\0';
+	while(n-- != 0)
+	{
+		strcat(buf, pieces[rand()%(sizeof(pieces)/sizeof(pieces[0]))]);
+	}
+}
+
+/* Compares file names the way sorting by name does it one pair at a time. */
+static int
+ref_name_cmp(const char s[], const char t[], int ignore_case)
+{
+	char s_buf[NAME_MAX + 1], t_buf[NAME_MAX + 1];
+	int result;
+
+	if(s[0] == '.' && t[0] != '.')
+	{
+		return -1;
+	}
+	if(s[0] != '.' && t[0] == '.')
+	{
+		return 1;
+	}
+
+	if(!ignore_case)
+	{
+		return strnumcmp(s, t);
+	}
+
+	(void)str_to_lower(s, s_buf, sizeof(s_buf));
+	(void)str_to_lower(t, t_buf, sizeof(t_buf));
+	result = strnumcmp(s_buf, t_buf);
+	return (result == 0) ? strcmp(s, t) : result;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -3,7 +3,8 @@
 #include <sys/stat.h> /* stat */
 #include <unistd.h> /* stat() */
 
-#include <stdio.h> /* fclose() fopen() fprintf() remove() */
+#include <stdio.h> /* fclose() fopen() fprintf() remove() snprintf() */
+#include <string.h> /* strlen() */
 
 #include "../../src/cfg/config.h"
 #include "../../src/cfg/info.h"
@@ -12,12 +13,19 @@
 #include "../../src/utils/matcher.h"
 #include "../../src/utils/matchers.h"
 #include "../../src/utils/str.h"
+#include "../../src/bmarks.h"
 #include "../../src/cmd_core.h"
 #include "../../src/filetype.h"
 #include "../../src/opt_handlers.h"
+#include "../../src/trash.h"
 
 #include "utils.h"
 
+static void bmarks_cb(const char p[], const char t[], time_t timestamp,
+		void *arg);
+
+static char bmarks_str[256];
+
 SETUP()
 {
 	view_setup(&lwin);
@@ -194,5 +202,68 @@ TEST(history_is_automatically_extended)
 	assert_success(remove(SANDBOX_PATH "/vifminfo"));
 }
 
+TEST(bookmarks_are_merged)
+{
+	FILE *const f = fopen(SANDBOX_PATH "/vifminfo", "w");
+	fprintf(f, "%c/a\n\told\n\t10\n", LINE_TYPE_BOOKMARK);
+	fprintf(f, "%c/b\n\tother\n\t10\n", LINE_TYPE_BOOKMARK);
+	fclose(f);
+
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.vifm_info = VINFO_BOOKMARKS;
+	init_commands();
+
+	/* Newer bookmark in memory overrules the one in the file. */
+	assert_success(bmarks_setup("/a", "new", 20));
+	write_info_file();
+	bmarks_clear();
+
+	read_info_file(1);
+	bmarks_str[0] = '\0';
+	bmarks_list(&bmarks_cb, NULL);
+	assert_string_equal("/a:new;/b:other;", bmarks_str);
+
+	bmarks_clear();
+	assert_success(remove(SANDBOX_PATH "/vifminfo"));
+	vle_cmds_reset();
+}
+
+TEST(trash_entries_are_merged)
+{
+	FILE *const f = fopen(SANDBOX_PATH "/vifminfo", "w");
+	fprintf(f, "%c/trash/000_a\n\t/a\n", LINE_TYPE_TRASH);
+	fprintf(f, "%c/trash/000_b\n\t/b\n", LINE_TYPE_TRASH);
+	fclose(f);
+
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.vifm_info = VINFO_BOOKMARKS;
+	init_commands();
+
+	/* Entry for the same path from the file is dropped. */
+	assert_success(add_to_trash("/a", "/trash/001_a"));
+	write_info_file();
+	/* Trash files don't exist, so this removes all entries. */
+	trash_prune_dead_entries();
+	assert_int_equal(0, nentries);
+
+	read_info_file(1);
+	assert_int_equal(2, nentries);
+	assert_string_equal("/trash/001_a", trash_list[0].trash_name);
+	assert_true(trash_includes("/a"));
+	assert_true(trash_includes("/b"));
+	assert_false(trash_includes("/c"));
+
+	trash_prune_dead_entries();
+	assert_success(remove(SANDBOX_PATH "/vifminfo"));
+	vle_cmds_reset();
+}
+
+static void
+bmarks_cb(const char p[], const char t[], time_t timestamp, void *arg)
+{
+	const size_t len = strlen(bmarks_str);
+	snprintf(bmarks_str + len, sizeof(bmarks_str) - len, "%s:%s;", p, t);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,161 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+
+#include "../../src/engine/functions.h"
+#include "../../src/engine/options.h"
+#include "../../src/engine/parsing.h"
+#include "../../src/engine/var.h"
+#include "../../src/engine/variables.h"
+
+#include "asserts.h"
+
+static const char * getenv_value(const char name[]);
+static var_t counter(const call_info_t *call_info);
+static var_t failer(const call_info_t *call_info);
+static void dummy_handler(OPT_OP op, optval_t val);
+
+static const char *env_value;
+static int ncalls;
+
+SETUP()
+{
+	static int option_changed;
+	static const function_t counter_func = { "counter", "descr", {0,1},
+		&counter };
+	static const function_t failer_func = { "failer", "descr", {0,0}, &failer };
+	optval_t val = { .int_val = 2 };
+
+	env_value = "first";
+	ncalls = 0;
+
+	assert_success(function_register(&counter_func));
+	assert_success(function_register(&failer_func));
+
+	vle_opts_init(&option_changed, NULL);
+	vle_opts_add("tabstop", "ts", "descr", OPT_INT, OPT_GLOBAL, 0, NULL,
+			&dummy_handler, val);
+
+	/* This also initializes parser, so override it afterwards. */
+	init_variables();
+	init_parser(&getenv_value);
+}
+
+TEARDOWN()
+{
+	function_reset_all();
+	vle_opts_reset();
+	clear_variables();
+}
+
+static const char *
+getenv_value(const char name[])
+{
+	return env_value;
+}
+
+static var_t
+counter(const call_info_t *call_info)
+{
+	return var_from_int(++ncalls);
+}
+
+static var_t
+failer(const call_info_t *call_info)
+{
+	return var_error();
+}
+
+static void
+dummy_handler(OPT_OP op, optval_t val)
+{
+}
+
+TEST(environment_variables_are_read_on_each_evaluation)
+{
+	ASSERT_OK("$VAR", "first");
+	env_value = "second";
+	ASSERT_OK("$VAR", "second");
+}
+
+TEST(options_are_read_on_each_evaluation)
+{
+	optval_t val = { .int_val = 8 };
+
+	ASSERT_INT_OK("&tabstop", 2);
+	vle_opts_assign("tabstop", val, OPT_GLOBAL);
+	ASSERT_INT_OK("&tabstop", 8);
+}
+
+TEST(removed_option_is_an_error)
+{
+	ASSERT_INT_OK("&tabstop", 2);
+	vle_opts_reset();
+	ASSERT_FAIL("&tabstop", PE_INVALID_EXPRESSION);
+	assert_string_equal("&tabstop", get_last_position());
+}
+
+TEST(builtin_variables_are_read_on_each_evaluation)
+{
+	assert_success(setvar("v:count", var_from_int(1)));
+	ASSERT_INT_OK("v:count", 1);
+	assert_success(setvar("v:count", var_from_int(5)));
+	ASSERT_INT_OK("v:count", 5);
+}
+
+TEST(functions_are_called_on_each_evaluation)
+{
+	ASSERT_INT_OK("counter()", 1);
+	ASSERT_INT_OK("counter()", 2);
+	ASSERT_INT_OK("counter(1 + 2) + 10", 13);
+	ASSERT_INT_OK("counter(1 + 2) + 10", 14);
+}
+
+TEST(lazy_evaluation_is_preserved)
+{
+	ASSERT_INT_OK("0 && counter()", 0);
+	ASSERT_INT_OK("0 && counter()", 0);
+	ASSERT_INT_OK("1 || counter()", 1);
+	ASSERT_INT_OK("1 || counter()", 1);
+	assert_int_equal(0, ncalls);
+}
+
+TEST(constant_expressions_are_evaluated_repeatedly)
+{
+	ASSERT_OK("'a' . (1 + 2) . 'b'", "a3b");
+	ASSERT_OK("'a' . (1 + 2) . 'b'", "a3b");
+	ASSERT_INT_OK("!(1 == 2) && 3 > 2", 1);
+	ASSERT_INT_OK("!(1 == 2) && 3 > 2", 1);
+}
+
+TEST(failure_of_cached_expression_is_reported)
+{
+	ASSERT_FAIL("failer() ", PE_INVALID_EXPRESSION);
+	assert_string_equal("failer() ", get_last_position());
+	assert_true(is_prev_token_whitespace());
+
+	ASSERT_FAIL("failer() ", PE_INVALID_EXPRESSION);
+	assert_string_equal("failer() ", get_last_position());
+	assert_true(is_prev_token_whitespace());
+}
+
+TEST(partial_parsing_is_not_affected_by_caching)
+{
+	var_t res = var_false();
+	char *str;
+
+	ASSERT_OK("'a'", "a");
+
+	assert_int_equal(PE_INVALID_EXPRESSION, parse("'a' 'b'", 0, &res));
+	assert_true(is_prev_token_whitespace());
+	assert_string_equal("'b'", get_last_parsed_char());
+
+	res = get_parsing_result();
+	str = var_to_str(res);
+	assert_string_equal("a", str);
+	free(str);
+	var_free(res);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
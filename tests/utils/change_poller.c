@@ -0,0 +1,239 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() usleep() */
+
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#endif
+
+#include <stdio.h> /* fclose() fopen() remove() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/change_poller.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+
+static int wait_for_change(change_poller_t *poller);
+static int not_windows(void);
+
+static char sandbox[PATH_MAX + 1];
+static char dir[PATH_MAX + 1];
+static change_poller_t *poller;
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s", SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+	snprintf(dir, sizeof(dir), "%s/dir", sandbox);
+}
+
+SETUP()
+{
+	char *paths[] = { dir, dir, sandbox };
+
+	assert_success(os_mkdir(dir, 0700));
+	poller = change_poller_create(10, 40);
+	assert_non_null(poller);
+	assert_success(change_poller_set_paths(poller, paths, 3, NULL));
+
+	/* Give the poller a chance to remember initial state. */
+	usleep(50*1000);
+}
+
+TEARDOWN()
+{
+	change_poller_free(poller);
+	(void)rmdir(dir);
+}
+
+TEST(freeing_null_poller_is_ok)
+{
+	change_poller_free(NULL);
+}
+
+TEST(poller_for_no_paths_is_ok)
+{
+	change_poller_t *const empty = change_poller_create(10, 10);
+	assert_non_null(empty);
+	assert_success(change_poller_set_paths(empty, NULL, 0, NULL));
+	assert_false(change_poller_changed(empty));
+	change_poller_free(empty);
+}
+
+TEST(nothing_is_reported_without_changes)
+{
+	usleep(100*1000);
+	assert_false(change_poller_changed(poller));
+}
+
+TEST(new_file_is_detected)
+{
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	assert_true(wait_for_change(poller));
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(change_is_reported_once)
+{
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	assert_true(wait_for_change(poller));
+	assert_false(change_poller_changed(poller));
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(changes_after_back_off_are_detected)
+{
+	/* Wait for a couple of passes to let interval reach its maximum. */
+	usleep(150*1000);
+	assert_false(change_poller_changed(poller));
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	assert_true(wait_for_change(poller));
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(attribute_change_is_detected, IF(not_windows))
+{
+	assert_success(chmod(dir, 0750));
+	assert_true(wait_for_change(poller));
+}
+
+TEST(removal_of_directory_is_detected)
+{
+	assert_success(rmdir(dir));
+	assert_true(wait_for_change(poller));
+}
+
+TEST(replaced_paths_are_not_examined)
+{
+	char *paths[] = { sandbox };
+	assert_success(change_poller_set_paths(poller, paths, 1, NULL));
+	usleep(50*1000);
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	usleep(100*1000);
+	assert_false(change_poller_changed(poller));
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+
+	fclose(fopen(SANDBOX_PATH "/file", "w"));
+	assert_true(wait_for_change(poller));
+	assert_success(remove(SANDBOX_PATH "/file"));
+}
+
+TEST(changes_are_forgotten_on_replacing_paths)
+{
+	char *paths[] = { dir };
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	usleep(100*1000);
+
+	assert_success(change_poller_set_paths(poller, paths, 1, NULL));
+	assert_false(change_poller_changed(poller));
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(paths_on_slow_file_systems_are_skipped)
+{
+	char *paths[] = { dir };
+	assert_success(change_poller_set_paths(poller, paths, 1, sandbox));
+	usleep(50*1000);
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	usleep(100*1000);
+	assert_false(change_poller_changed(poller));
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(number_of_pollers_is_limited)
+{
+	change_poller_t *pollers[64];
+	change_poller_t *extra = NULL;
+	int n = 0;
+	int i;
+
+	while(n < (int)ARRAY_LEN(pollers) &&
+			(pollers[n] = change_poller_create(10, 10)) != NULL)
+	{
+		++n;
+	}
+	assert_true(n < (int)ARRAY_LEN(pollers));
+
+	while(--n >= 0)
+	{
+		change_poller_free(pollers[n]);
+	}
+
+	/* Threads release their slots on exiting. */
+	for(i = 0; i < 200 && extra == NULL; ++i)
+	{
+		extra = change_poller_create(10, 10);
+		usleep(10*1000);
+	}
+	assert_non_null(extra);
+	change_poller_free(extra);
+
+	usleep(50*1000);
+}
+
+#ifndef _WIN32
+
+TEST(descriptor_becomes_readable_on_change)
+{
+	struct pollfd pfd = { .fd = change_poller_get_fd(poller), .events = POLLIN };
+	assert_true(pfd.fd != -1);
+
+	assert_int_equal(0, poll(&pfd, 1, 0));
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	assert_int_equal(1, poll(&pfd, 1, 2000));
+
+	assert_true(change_poller_changed(poller));
+	assert_int_equal(0, poll(&pfd, 1, 0));
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+#endif
+
+/* Waits for the poller to report a change for up to two seconds.  Returns
+ * non-zero if it did, otherwise zero is returned. */
+static int
+wait_for_change(change_poller_t *poller)
+{
+	int i;
+	for(i = 0; i < 200; ++i)
+	{
+		if(change_poller_changed(poller))
+		{
+			return 1;
+		}
+		usleep(10*1000);
+	}
+	return 0;
+}
+
+static int
+not_windows(void)
+{
+#ifndef _WIN32
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
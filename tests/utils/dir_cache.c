@@ -0,0 +1,283 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* fclose() fopen() remove() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/dir_cache.h"
+#include "../../src/utils/dir_lister.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+
+static const dir_listing_t * list(dir_cache_t *cache, const char path[]);
+static int using_inotify(void);
+
+static char sandbox[PATH_MAX + 1];
+static char dir[PATH_MAX + 1];
+static dir_cache_t *cache;
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s", SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+	snprintf(dir, sizeof(dir), "%s/dir", sandbox);
+}
+
+SETUP()
+{
+	assert_success(os_mkdir(dir, 0700));
+	cache = dir_cache_create(1);
+	assert_non_null(cache);
+}
+
+TEARDOWN()
+{
+	dir_cache_free(cache);
+	assert_success(rmdir(dir));
+}
+
+TEST(freeing_null_cache_is_ok)
+{
+	dir_cache_free(NULL);
+}
+
+TEST(first_request_misses)
+{
+	dir_cache_start_pass(cache);
+	assert_null(dir_cache_get(cache, dir));
+	dir_cache_finish_pass(cache);
+}
+
+TEST(listing_is_available_during_the_pass)
+{
+	const dir_listing_t *listing;
+
+	dir_cache_start_pass(cache);
+	listing = list(cache, dir);
+	assert_non_null(listing);
+	assert_int_equal(0, listing->count);
+	assert_true(dir_cache_get(cache, dir) == listing);
+	dir_cache_finish_pass(cache);
+}
+
+TEST(unchanged_directory_is_reused, IF(using_inotify))
+{
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	assert_non_null(dir_cache_get(cache, dir));
+	dir_cache_finish_pass(cache);
+}
+
+TEST(new_file_invalidates_listing, IF(using_inotify))
+{
+	const dir_listing_t *listing;
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+
+	dir_cache_start_pass(cache);
+	assert_null(dir_cache_get(cache, dir));
+	listing = list(cache, dir);
+	assert_int_equal(1, listing->count);
+	dir_cache_finish_pass(cache);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(file_attributes_invalidate_listing, IF(using_inotify))
+{
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	assert_success(chmod(SANDBOX_PATH "/dir/file", 0600));
+
+	dir_cache_start_pass(cache);
+	assert_null(dir_cache_get(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(unrequested_directories_are_forgotten, IF(using_inotify))
+{
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	assert_null(dir_cache_get(cache, dir));
+	dir_cache_finish_pass(cache);
+}
+
+TEST(removed_directory_is_not_reused, IF(using_inotify))
+{
+	char nested[PATH_MAX + 1];
+	snprintf(nested, sizeof(nested), "%s/nested", dir);
+	assert_success(os_mkdir(nested, 0700));
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	assert_success(rmdir(nested));
+	assert_success(os_mkdir(nested, 0700));
+
+	dir_cache_start_pass(cache);
+	assert_null(dir_cache_get(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	assert_success(rmdir(nested));
+}
+
+TEST(directories_above_watch_limit_are_listed_anew, IF(using_inotify))
+{
+	char nested[PATH_MAX + 1];
+	snprintf(nested, sizeof(nested), "%s/nested", dir);
+	assert_success(os_mkdir(nested, 0700));
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	assert_non_null(list(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	assert_non_null(dir_cache_get(cache, dir));
+	assert_null(dir_cache_get(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	assert_success(rmdir(nested));
+}
+
+TEST(watches_of_forgotten_directories_are_reused, IF(using_inotify))
+{
+	char nested[PATH_MAX + 1];
+	snprintf(nested, sizeof(nested), "%s/nested", dir);
+	assert_success(os_mkdir(nested, 0700));
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, dir));
+	dir_cache_finish_pass(cache);
+
+	/* Watch of the first directory is released at the end of this pass. */
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	assert_non_null(list(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	dir_cache_start_pass(cache);
+	assert_non_null(dir_cache_get(cache, nested));
+	dir_cache_finish_pass(cache);
+
+	assert_success(rmdir(nested));
+}
+
+TEST(many_directories_are_tracked_independently, IF(using_inotify))
+{
+	enum { N = 50 };
+	char paths[N][PATH_MAX + 1];
+	dir_cache_t *const big_cache = dir_cache_create(N);
+	int i;
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(paths[i], sizeof(paths[i]), "%s/%d", dir, i);
+		assert_success(os_mkdir(paths[i], 0700));
+	}
+
+	dir_cache_start_pass(big_cache);
+	for(i = 0; i < N; ++i)
+	{
+		assert_non_null(list(big_cache, paths[i]));
+	}
+	dir_cache_finish_pass(big_cache);
+
+	/* Forget every other directory. */
+	dir_cache_start_pass(big_cache);
+	for(i = 0; i < N; i += 2)
+	{
+		assert_non_null(dir_cache_get(big_cache, paths[i]));
+	}
+	dir_cache_finish_pass(big_cache);
+
+	assert_success(rmdir(paths[N - 2]));
+	assert_success(os_mkdir(paths[N - 2], 0700));
+
+	dir_cache_start_pass(big_cache);
+	for(i = 0; i < N; ++i)
+	{
+		const int reused = (i%2 == 0 && i != N - 2);
+		assert_int_equal(reused, dir_cache_get(big_cache, paths[i]) != NULL);
+	}
+	dir_cache_finish_pass(big_cache);
+
+	dir_cache_free(big_cache);
+
+	for(i = 0; i < N; ++i)
+	{
+		assert_success(rmdir(paths[i]));
+	}
+}
+
+/* Lists directory through the cache.  Returns the listing. */
+static const dir_listing_t *
+list(dir_cache_t *cache, const char path[])
+{
+	dir_listing_t listing;
+	const dir_listing_t *cached;
+	dir_lister_t *const lister = dir_lister_create(0);
+	dir_lister_req_t *req;
+
+	cached = dir_cache_get(cache, path);
+	if(cached != NULL)
+	{
+		dir_lister_free(lister);
+		return cached;
+	}
+
+	req = dir_lister_queue(lister, path);
+	dir_lister_take(lister, req, &listing);
+	dir_lister_release(lister, req);
+	dir_lister_free(lister);
+
+	return dir_cache_put(cache, path, &listing);
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
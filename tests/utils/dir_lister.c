@@ -0,0 +1,97 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* S_ISDIR() S_ISREG() */
+
+#include <stddef.h> /* NULL */
+#include <string.h> /* strcmp() */
+
+#include "../../src/utils/dir_lister.h"
+
+static int find_name(const dir_listing_t *listing, const char name[]);
+
+TEST(freeing_null_lister_is_ok)
+{
+	dir_lister_free(NULL);
+}
+
+TEST(releasing_null_request_is_ok)
+{
+	dir_lister_t *const lister = dir_lister_create(0);
+	assert_non_null(lister);
+	dir_lister_release(lister, NULL);
+	dir_lister_free(lister);
+}
+
+TEST(synchronous_listing_works)
+{
+	dir_lister_t *const lister = dir_lister_create(0);
+	dir_lister_req_t *const req = dir_lister_queue(lister,
+			TEST_DATA_PATH "/tree/dir1");
+	const dir_listing_t *const listing = dir_lister_get(lister, req);
+
+	assert_int_equal(2, listing->count);
+	assert_true(S_ISDIR(listing->stats[find_name(listing, "dir2")].st_mode));
+	assert_true(S_ISREG(listing->stats[find_name(listing, "file4")].st_mode));
+
+	dir_lister_release(lister, req);
+	dir_lister_free(lister);
+}
+
+TEST(parallel_listing_works)
+{
+	int i;
+	dir_lister_req_t *reqs[3];
+	dir_lister_t *const lister = dir_lister_create(2);
+
+	reqs[0] = dir_lister_queue(lister, TEST_DATA_PATH "/tree");
+	reqs[1] = dir_lister_queue(lister, TEST_DATA_PATH "/tree/dir1/dir2");
+	reqs[2] = dir_lister_queue(lister, TEST_DATA_PATH "/tree/dir1/dir2/dir3");
+
+	assert_int_equal(2, dir_lister_get(lister, reqs[2])->count);
+	assert_int_equal(2, dir_lister_get(lister, reqs[1])->count);
+	assert_int_equal(3, dir_lister_get(lister, reqs[0])->count);
+
+	for(i = 0; i < 3; ++i)
+	{
+		dir_lister_release(lister, reqs[i]);
+	}
+	dir_lister_free(lister);
+}
+
+TEST(requests_can_be_released_without_being_processed)
+{
+	dir_lister_t *const lister = dir_lister_create(1);
+	dir_lister_req_t *const req1 = dir_lister_queue(lister, TEST_DATA_PATH);
+	dir_lister_req_t *const req2 = dir_lister_queue(lister, TEST_DATA_PATH);
+	dir_lister_release(lister, req1);
+	dir_lister_release(lister, req2);
+	dir_lister_free(lister);
+}
+
+TEST(listing_missing_directory_fails)
+{
+	dir_lister_t *const lister = dir_lister_create(1);
+	dir_lister_req_t *const req = dir_lister_queue(lister,
+			SANDBOX_PATH "/no-such-dir");
+	assert_true(dir_lister_get(lister, req)->count < 0);
+	dir_lister_release(lister, req);
+	dir_lister_free(lister);
+}
+
+static int
+find_name(const dir_listing_t *listing, const char name[])
+{
+	int i;
+	for(i = 0; i < listing->count; ++i)
+	{
+		if(strcmp(listing->names[i], name) == 0)
+		{
+			return i;
+		}
+	}
+	assert_fail("Name wasn't found");
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,73 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/ui/ui.h"
+#include "../../src/utils/utils.h"
+
+static int not_windows(void);
+
+TEST(ids_can_be_formatted_as_numbers, IF(not_windows))
+{
+	char buf[32];
+	dir_entry_t entry = { .uid = 12345, .gid = 54321 };
+
+	get_uid_string(&entry, 1, sizeof(buf), buf);
+	assert_string_equal("12345", buf);
+	get_gid_string(&entry, 1, sizeof(buf), buf);
+	assert_string_equal("54321", buf);
+}
+
+TEST(cached_name_does_not_affect_numeric_form, IF(not_windows))
+{
+	char buf[32];
+	dir_entry_t entry = { .uid = 0, .gid = 0 };
+
+	get_uid_string(&entry, 0, sizeof(buf), buf);
+	assert_string_equal("root", buf);
+	get_uid_string(&entry, 1, sizeof(buf), buf);
+	assert_string_equal("0", buf);
+	get_uid_string(&entry, 0, sizeof(buf), buf);
+	assert_string_equal("root", buf);
+}
+
+TEST(unknown_ids_fall_back_to_numbers, IF(not_windows))
+{
+	char expected[32];
+	char buf[32];
+	dir_entry_t entry = { .uid = 2000000123, .gid = 2000000123 };
+
+	snprintf(expected, sizeof(expected), "%d", (int)entry.uid);
+
+	get_uid_string(&entry, 0, sizeof(buf), buf);
+	assert_string_equal(expected, buf);
+	get_gid_string(&entry, 0, sizeof(buf), buf);
+	assert_string_equal(expected, buf);
+}
+
+TEST(ids_in_the_same_slot_do_not_clash, IF(not_windows))
+{
+	char buf[32];
+	dir_entry_t root = { .uid = 0 };
+	dir_entry_t other = { .uid = 2000000000 };
+
+	get_uid_string(&root, 0, sizeof(buf), buf);
+	assert_string_equal("root", buf);
+	get_uid_string(&other, 0, sizeof(buf), buf);
+	assert_string_equal("2000000000", buf);
+	get_uid_string(&root, 0, sizeof(buf), buf);
+	assert_string_equal("root", buf);
+}
+
+static int
+not_windows(void)
+{
+#ifndef _WIN32
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,149 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/hist.h"
+
+static hist_t hist;
+
+SETUP()
+{
+	assert_success(hist_init(&hist, 10U));
+}
+
+TEARDOWN()
+{
+	hist_reset(&hist, 10U);
+}
+
+TEST(empty_history_contains_nothing)
+{
+	assert_true(hist_is_empty(&hist));
+	assert_false(hist_contains(&hist, "item"));
+}
+
+TEST(empty_items_are_not_added)
+{
+	assert_success(hist_add(&hist, "", 10U));
+	assert_true(hist_is_empty(&hist));
+}
+
+TEST(items_are_added_to_the_front)
+{
+	assert_success(hist_add(&hist, "first", 10U));
+	assert_success(hist_add(&hist, "second", 10U));
+
+	assert_int_equal(1, hist.pos);
+	assert_string_equal("second", hist.items[0]);
+	assert_string_equal("first", hist.items[1]);
+	assert_true(hist_contains(&hist, "first"));
+	assert_true(hist_contains(&hist, "second"));
+	assert_false(hist_contains(&hist, "third"));
+}
+
+TEST(existing_item_is_moved_to_the_front)
+{
+	assert_success(hist_add(&hist, "first", 10U));
+	assert_success(hist_add(&hist, "second", 10U));
+	assert_success(hist_add(&hist, "third", 10U));
+	assert_success(hist_add(&hist, "first", 10U));
+
+	assert_int_equal(2, hist.pos);
+	assert_string_equal("first", hist.items[0]);
+	assert_string_equal("third", hist.items[1]);
+	assert_string_equal("second", hist.items[2]);
+}
+
+TEST(oldest_item_is_dropped_on_overflow)
+{
+	int i;
+	char item[16];
+
+	for(i = 0; i < 15; ++i)
+	{
+		snprintf(item, sizeof(item), "item%d", i);
+		assert_success(hist_add(&hist, item, 10U));
+	}
+
+	assert_int_equal(9, hist.pos);
+	assert_string_equal("item14", hist.items[0]);
+	assert_string_equal("item5", hist.items[9]);
+	assert_false(hist_contains(&hist, "item4"));
+	assert_true(hist_contains(&hist, "item5"));
+
+	/* Dropped item is added anew. */
+	assert_success(hist_add(&hist, "item0", 10U));
+	assert_string_equal("item0", hist.items[0]);
+	assert_string_equal("item6", hist.items[9]);
+	assert_false(hist_contains(&hist, "item5"));
+}
+
+TEST(history_of_size_one_keeps_last_item)
+{
+	hist_t small;
+	assert_success(hist_init(&small, 1U));
+
+	assert_success(hist_add(&small, "first", 1U));
+	assert_success(hist_add(&small, "second", 1U));
+
+	assert_int_equal(0, small.pos);
+	assert_string_equal("second", small.items[0]);
+	assert_false(hist_contains(&small, "first"));
+	assert_true(hist_contains(&small, "second"));
+
+	hist_reset(&small, 1U);
+}
+
+TEST(truncation_is_taken_into_account)
+{
+	assert_success(hist_add(&hist, "first", 10U));
+	assert_success(hist_add(&hist, "second", 10U));
+	assert_success(hist_add(&hist, "third", 10U));
+
+	hist_trunc(&hist, 2U, 8U);
+	assert_int_equal(1, hist.pos);
+	assert_false(hist_contains(&hist, "first"));
+	assert_true(hist_contains(&hist, "second"));
+
+	assert_success(hist_add(&hist, "second", 2U));
+	assert_string_equal("second", hist.items[0]);
+	assert_string_equal("third", hist.items[1]);
+
+	assert_success(hist_add(&hist, "fourth", 2U));
+	assert_string_equal("fourth", hist.items[0]);
+	assert_string_equal("second", hist.items[1]);
+	assert_false(hist_contains(&hist, "third"));
+
+	hist_reset(&hist, 2U);
+	assert_success(hist_init(&hist, 10U));
+}
+
+TEST(large_history_is_consistent)
+{
+	int i;
+	char item[16];
+	hist_t large;
+
+	assert_success(hist_init(&large, 1000U));
+
+	/* Each item is added twice to exercise moving as well. */
+	for(i = 0; i < 3000; ++i)
+	{
+		snprintf(item, sizeof(item), "%d", i%1500);
+		assert_success(hist_add(&large, item, 1000U));
+	}
+
+	assert_int_equal(999, large.pos);
+	for(i = 0; i < 1500; ++i)
+	{
+		snprintf(item, sizeof(item), "%d", i);
+		assert_int_equal(i >= 500, hist_contains(&large, item));
+	}
+	assert_string_equal("1499", large.items[0]);
+	assert_string_equal("500", large.items[999]);
+
+	hist_reset(&large, 1000U);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
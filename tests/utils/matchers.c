@@ -64,6 +64,20 @@ TEST(both_matchers_match)
 	matchers_free(ms);
 }
 
+TEST(mime_matchers_can_be_skipped)
+{
+	int mime;
+	char *error = NULL;
+	matchers_t *const ms = matchers_alloc("<text/plain>{*.c}", 0, 1, "", &error);
+	assert_string_equal(NULL, error);
+
+	assert_true(matchers_match_no_mime(ms, "a.c", &mime));
+	assert_true(mime);
+	assert_false(matchers_match_no_mime(ms, "a.h", &mime));
+
+	matchers_free(ms);
+}
+
 TEST(get_expr_returns_original_expr)
 {
 	char *error = NULL;
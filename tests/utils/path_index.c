@@ -0,0 +1,144 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* fclose() fopen() remove() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/int/path_env.h"
+#include "../../src/utils/env.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+
+static void create_file(const char name[], int mode);
+static int using_inotify(void);
+
+static char sandbox[PATH_MAX + 1];
+static char *original_path_env;
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s", SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+}
+
+SETUP()
+{
+	original_path_env = strdup(env_get_def("PATH", ""));
+	env_set("PATH", sandbox);
+	update_path_env(1);
+}
+
+TEARDOWN()
+{
+	env_set("PATH", original_path_env);
+	update_path_env(1);
+	free(original_path_env);
+}
+
+TEST(new_executables_are_found, IF(using_inotify))
+{
+	char path[PATH_MAX + 1];
+
+	assert_failure(find_cmd_in_path("prog", sizeof(path), path));
+
+	create_file("prog", 0700);
+	assert_success(find_cmd_in_path("prog", sizeof(path), path));
+	assert_true(paths_are_same(path, SANDBOX_PATH "/prog"));
+
+	assert_success(remove(SANDBOX_PATH "/prog"));
+	assert_failure(find_cmd_in_path("prog", sizeof(path), path));
+}
+
+TEST(non_executables_are_not_found, IF(using_inotify))
+{
+	create_file("prog", 0600);
+	assert_failure(find_cmd_in_path("prog", 0U, NULL));
+	assert_success(remove(SANDBOX_PATH "/prog"));
+
+	assert_success(os_mkdir(SANDBOX_PATH "/prog", 0700));
+	assert_failure(find_cmd_in_path("prog", 0U, NULL));
+	assert_success(rmdir(SANDBOX_PATH "/prog"));
+}
+
+TEST(names_are_listed_by_prefix, IF(using_inotify))
+{
+	size_t count;
+	char **names;
+
+	create_file("a", 0600);
+	create_file("ab", 0600);
+	create_file("abc", 0600);
+	create_file("b", 0600);
+
+	names = get_path_dir_names(0, "ab", &count);
+	assert_non_null(names);
+	assert_int_equal(2, count);
+	assert_string_equal("ab", names[0]);
+	assert_string_equal("abc", names[1]);
+
+	assert_true(path_dir_may_contain(0, "b"));
+	assert_false(path_dir_may_contain(0, "c"));
+
+	assert_success(remove(SANDBOX_PATH "/abc"));
+	names = get_path_dir_names(0, "ab", &count);
+	assert_non_null(names);
+	assert_int_equal(1, count);
+	assert_string_equal("ab", names[0]);
+
+	assert_success(remove(SANDBOX_PATH "/a"));
+	assert_success(remove(SANDBOX_PATH "/ab"));
+	assert_success(remove(SANDBOX_PATH "/b"));
+}
+
+TEST(relative_paths_are_not_indexed)
+{
+	size_t count;
+
+	env_set("PATH", ".");
+	update_path_env(1);
+
+	assert_null(get_path_dir_names(0, "", &count));
+	assert_true(path_dir_may_contain(0, "anything"));
+}
+
+/* Creates file in the sandbox with specified permissions. */
+static void
+create_file(const char name[], int mode)
+{
+	char path[PATH_MAX + 1];
+	snprintf(path, sizeof(path), "%s/%s", sandbox, name);
+
+	FILE *const f = fopen(path, "w");
+	assert_non_null(f);
+	fclose(f);
+
+	assert_success(chmod(path, mode));
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,199 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fread() remove() */
+#include <string.h> /* strncmp() strstr() */
+
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/perf.h"
+
+static void * record_in_thread(void *arg);
+static uint64_t sum_buckets(const perf_stats_t *stats);
+
+SETUP()
+{
+	perf_enable(0);
+	perf_reset();
+}
+
+TEARDOWN()
+{
+	perf_enable(0);
+	perf_reset();
+}
+
+TEST(nothing_is_recorded_when_disabled)
+{
+	perf_stats_t stats;
+
+	const uint64_t start = perf_begin();
+	assert_true(start == 0U);
+	perf_end(PK_DIR_READ, start, 10U);
+
+	perf_get_stats(PK_DIR_READ, &stats);
+	assert_true(stats.count == 0U);
+	assert_true(stats.amount == 0U);
+}
+
+TEST(events_are_recorded_when_enabled)
+{
+	perf_stats_t stats;
+	uint64_t start;
+
+	perf_enable(1);
+	assert_true(perf_enabled());
+
+	start = perf_begin();
+	assert_true(start != 0U);
+	perf_end(PK_COPY, start, 100U);
+	perf_end(PK_COPY, perf_begin(), 28U);
+
+	perf_get_stats(PK_COPY, &stats);
+	assert_true(stats.count == 2U);
+	assert_true(stats.amount == 128U);
+	assert_true(stats.max <= stats.total);
+	assert_true(sum_buckets(&stats) == 2U);
+
+	perf_get_stats(PK_MIME, &stats);
+	assert_true(stats.count == 0U);
+}
+
+TEST(event_started_before_disabling_is_recorded)
+{
+	perf_stats_t stats;
+	uint64_t start;
+
+	perf_enable(1);
+	start = perf_begin();
+	perf_enable(0);
+	perf_end(PK_MIME, start, 0U);
+
+	perf_get_stats(PK_MIME, &stats);
+	assert_true(stats.count == 1U);
+}
+
+TEST(reset_discards_statistics)
+{
+	perf_stats_t stats;
+
+	perf_enable(1);
+	perf_end(PK_DIR_SORT, perf_begin(), 0U);
+	perf_reset();
+
+	perf_get_stats(PK_DIR_SORT, &stats);
+	assert_true(stats.count == 0U);
+
+	perf_end(PK_DIR_SORT, perf_begin(), 0U);
+	perf_get_stats(PK_DIR_SORT, &stats);
+	assert_true(stats.count == 1U);
+}
+
+TEST(statistics_of_threads_are_summed)
+{
+	perf_stats_t stats;
+	pthread_t id;
+
+	perf_enable(1);
+	perf_end(PK_BG_TASK, perf_begin(), 1U);
+
+	assert_success(pthread_create(&id, NULL, &record_in_thread, NULL));
+	assert_success(pthread_join(id, NULL));
+
+	perf_get_stats(PK_BG_TASK, &stats);
+	assert_true(stats.count == 2U);
+	assert_true(stats.amount == 3U);
+
+	/* State of the finished thread is reused without losing its data. */
+	assert_success(pthread_create(&id, NULL, &record_in_thread, NULL));
+	assert_success(pthread_join(id, NULL));
+
+	perf_get_stats(PK_BG_TASK, &stats);
+	assert_true(stats.count == 3U);
+	assert_true(stats.amount == 5U);
+}
+
+TEST(trace_is_exported)
+{
+	char buf[4096];
+	size_t len;
+	FILE *fp;
+
+	perf_enable(1);
+	perf_end(PK_DRAW_LIST, perf_begin(), 5U);
+	perf_end(PK_HIGHLIGHT, perf_begin(), 0U);
+
+	assert_success(perf_export_trace(SANDBOX_PATH "/trace.json"));
+
+	fp = fopen(SANDBOX_PATH "/trace.json", "r");
+	assert_non_null(fp);
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	buf[len] = '\0';
+	fclose(fp);
+
+	assert_success(strncmp(buf, "{\"traceEvents\":[", 16));
+	assert_non_null(strstr(buf, "\"name\":\"draw-list\""));
+	assert_non_null(strstr(buf, "\"name\":\"highlight\""));
+	assert_non_null(strstr(buf, "\"amount\":5}"));
+	assert_non_null(strstr(buf, "\n]}\n"));
+
+	assert_success(remove(SANDBOX_PATH "/trace.json"));
+}
+
+TEST(reset_events_are_not_exported)
+{
+	char buf[4096];
+	size_t len;
+	FILE *fp;
+
+	perf_enable(1);
+	perf_end(PK_DRAW_LINE, perf_begin(), 0U);
+	perf_reset();
+
+	assert_success(perf_export_trace(SANDBOX_PATH "/trace.json"));
+
+	fp = fopen(SANDBOX_PATH "/trace.json", "r");
+	assert_non_null(fp);
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	buf[len] = '\0';
+	fclose(fp);
+
+	assert_string_equal("{\"traceEvents\":[\n]}\n", buf);
+
+	assert_success(remove(SANDBOX_PATH "/trace.json"));
+}
+
+TEST(export_to_bad_path_fails)
+{
+	assert_failure(perf_export_trace(SANDBOX_PATH "/no/such/dir/trace.json"));
+}
+
+TEST(kinds_have_names)
+{
+	assert_string_equal("dir-read", perf_kind_name(PK_DIR_READ));
+	assert_string_equal("copy", perf_kind_name(PK_COPY));
+	assert_string_equal("bg-task", perf_kind_name(PK_BG_TASK));
+}
+
+/* Entry point of a thread that records a single event. */
+static void *
+record_in_thread(void *arg)
+{
+	perf_end(PK_BG_TASK, perf_begin(), 2U);
+	return NULL;
+}
+
+/* Computes number of events in the histogram.  Returns the number. */
+static uint64_t
+sum_buckets(const perf_stats_t *stats)
+{
+	int i;
+	uint64_t sum = 0U;
+	for(i = 0; i < PERF_BUCKETS; ++i)
+	{
+		sum += stats->buckets[i];
+	}
+	return sum;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,90 @@
+#include <stic.h>
+
+#ifndef _WIN32
+
+#include <unistd.h> /* close() pipe() write() */
+
+#include "../../src/utils/poller.h"
+
+static poller_t *poller;
+static int fds[2];
+
+SETUP()
+{
+	poller = poller_create();
+	assert_non_null(poller);
+	assert_success(pipe(fds));
+}
+
+TEARDOWN()
+{
+	close(fds[0]);
+	close(fds[1]);
+	poller_free(poller);
+}
+
+TEST(freeing_null_poller_is_ok)
+{
+	poller_free(NULL);
+}
+
+TEST(timeout_is_reported_as_no_events)
+{
+	void *ready[4];
+	assert_success(poller_add(poller, fds[0], &fds[0]));
+	assert_int_equal(0, poller_wait(poller, 0, ready, 4));
+}
+
+TEST(readable_descriptor_is_reported_with_its_data)
+{
+	void *ready[4];
+	assert_success(poller_add(poller, fds[0], &fds[0]));
+	assert_int_equal(1, write(fds[1], "x", 1));
+
+	assert_int_equal(1, poller_wait(poller, -1, ready, 4));
+	assert_true(ready[0] == &fds[0]);
+}
+
+TEST(closed_write_end_is_reported)
+{
+	void *ready[4];
+	assert_success(poller_add(poller, fds[0], NULL));
+	close(fds[1]);
+	fds[1] = -1;
+
+	assert_int_equal(1, poller_wait(poller, 0, ready, 4));
+	assert_null(ready[0]);
+}
+
+TEST(removed_descriptor_is_not_reported)
+{
+	void *ready[4];
+	assert_success(poller_add(poller, fds[0], &fds[0]));
+	poller_remove(poller, fds[0]);
+	assert_int_equal(1, write(fds[1], "x", 1));
+
+	assert_int_equal(0, poller_wait(poller, 0, ready, 4));
+}
+
+TEST(number_of_events_is_limited)
+{
+	int other[2];
+	void *ready[4];
+
+	assert_success(pipe(other));
+	assert_success(poller_add(poller, fds[0], &fds[0]));
+	assert_success(poller_add(poller, other[0], &other[0]));
+	assert_int_equal(1, write(fds[1], "x", 1));
+	assert_int_equal(1, write(other[1], "x", 1));
+
+	assert_int_equal(1, poller_wait(poller, 0, ready, 1));
+	assert_int_equal(2, poller_wait(poller, 0, ready, 4));
+
+	close(other[0]);
+	close(other[1]);
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,87 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+#include <time.h> /* time() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/utils.h"
+#include "../../src/status.h"
+
+#ifndef _WIN32
+#include "../../src/utils/utils_nix.h"
+#endif
+
+static int not_windows(void);
+static int has_setsid(void);
+
+SETUP()
+{
+	replace_string(&cfg.shell, "/bin/sh");
+	update_string(&cfg.shell_cmd_flag, "-c");
+	stats_update_shell_type(cfg.shell);
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.shell_cmd_flag, NULL);
+	stats_update_shell_type("/bin/sh");
+}
+
+TEST(output_is_collected, IF(not_windows))
+{
+#ifndef _WIN32
+	size_t len;
+	char *const output = read_cmd_output_timed("echo out; echo err 1>&2", 10000,
+			&len);
+	assert_string_equal("out\nerr\n", output);
+	assert_int_equal(8, len);
+	free(output);
+#endif
+}
+
+TEST(command_that_ignores_interruption_is_killed, IF(not_windows))
+{
+#ifndef _WIN32
+	size_t len;
+	const time_t start = time(NULL);
+	char *const output = read_cmd_output_timed("trap '' INT; echo x; sleep 10",
+			100, &len);
+	assert_true(time(NULL) - start < 5);
+	assert_string_equal("x\n", output);
+	free(output);
+#endif
+}
+
+TEST(output_held_by_process_out_of_group_is_abandoned, IF(has_setsid))
+{
+#ifndef _WIN32
+	size_t len;
+	const time_t start = time(NULL);
+	char *const output = read_cmd_output_timed("setsid sleep 10 &", 100, &len);
+	assert_true(time(NULL) - start < 5);
+	assert_string_equal("", output);
+	free(output);
+#endif
+}
+
+static int
+not_windows(void)
+{
+#ifndef _WIN32
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static int
+has_setsid(void)
+{
+	return not_windows() && find_cmd_in_path("setsid", 0UL, NULL) == 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -117,5 +117,16 @@ TEST(str_to_upper_too_short_mixed, IF(utf8_locale))
 	assert_string_equal("АAБBВCГ", buf);
 }
 
+TEST(stray_bytes_are_not_treated_as_wide_characters)
+{
+	char str[] = "aBcDeFgHiJkLmNoP\xff";
+	char buf[sizeof(str)*4];
+
+	assert_success(str_to_lower(str, buf, sizeof(buf)));
+	assert_string_equal("abcdefghijklmnop\xff", buf);
+	assert_success(str_to_upper(str, buf, sizeof(buf)));
+	assert_string_equal("ABCDEFGHIJKLMNOP\xff", buf);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
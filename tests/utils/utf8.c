@@ -1,8 +1,8 @@
 #include <stic.h>
 
 #include <stddef.h> /* size_t */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <stdlib.h> /* free() rand() srand() */
+#include <string.h> /* strcat() strlen() */
 #include <wchar.h>
 
 #include "../../src/utils/str.h"
@@ -10,6 +10,11 @@
 
 #include "utils.h"
 
+static void make_random_str(char buf[], size_t max_pieces);
+static size_t ref_strsw(const char str[]);
+static size_t ref_strsnlen(const char str[], size_t max_screen_width);
+static size_t ref_nstrsnlen(const char str[], size_t max_screen_width);
+
 SETUP_ONCE()
 {
 	try_enable_utf8_locale();
@@ -67,6 +72,41 @@ TEST(length_is_less_or_equal_to_string_length, IF(utf8_locale))
 	}
 }
 
+TEST(fast_paths_match_per_character_processing)
+{
+	int i;
+
+	srand(1);
+	for(i = 0; i < 2000; ++i)
+	{
+		char str[256];
+		size_t len;
+		size_t max_width;
+
+		make_random_str(str, 40);
+		len = strlen(str);
+
+		assert_int_equal(ref_strsw(str), utf8_strsw(str));
+		for(max_width = 0; max_width <= len + 1; ++max_width)
+		{
+			assert_int_equal(ref_strsnlen(str, max_width),
+					utf8_strsnlen(str, max_width));
+			assert_int_equal(ref_nstrsnlen(str, max_width),
+					utf8_nstrsnlen(str, max_width));
+		}
+	}
+}
+
+TEST(ascii_strings_are_detected)
+{
+	assert_true(utf8_is_ascii(""));
+	assert_true(utf8_is_ascii("a"));
+	assert_true(utf8_is_ascii("\x01\t\x7f long enough to span several words"));
+	assert_false(utf8_is_ascii("long enough to span several words\x80"));
+	assert_false(utf8_is_ascii("\xff"));
+	assert_false(utf8_is_ascii("\xd0\xb2"));
+}
+
 #ifdef _WIN32
 
 TEST(utf16_roundtrip, IF(utf8_locale))
@@ -90,5 +130,76 @@ TEST(first_char, IF(utf8_locale))
 
 #endif
 
+/* Fills the buffer with a random mix of ASCII, control, multibyte and broken
+ * characters. */
+static void
+make_random_str(char buf[], size_t max_pieces)
+{
+	static const char *const pieces[] = {
+		"a", "Z", " ", "~", "0", "abcdefgh", "\x7f", "\t", "\x01", "\x1f", "в",
+		"师", "\xf0\x9f\x98\x80", "\xff", "\x80", "\xc3", "\xe4\xb8",
+	};
+
+	size_t n = rand()%(max_pieces + 1);
+
+	buf[0] = '\0';
+	while(n-- != 0)
+	{
+		strcat(buf, pieces[rand()%(sizeof(pieces)/sizeof(pieces[0]))]);
+	}
+}
+
+/* Computes screen width of the string one character at a time. */
+static size_t
+ref_strsw(const char str[])
+{
+	size_t width = 0;
+	while(*str != '\0')
+	{
+		width += utf8_chrsw(str);
+		str += utf8_chrw(str);
+	}
+	return width;
+}
+
+/* Computes utf8_strsnlen() one character at a time. */
+static size_t
+ref_strsnlen(const char str[], size_t max_screen_width)
+{
+	size_t len = 0;
+	while(str[len] != '\0' && max_screen_width != 0)
+	{
+		const size_t char_screen_width = utf8_chrsw(&str[len]);
+		if(char_screen_width > max_screen_width)
+		{
+			break;
+		}
+		max_screen_width -= char_screen_width;
+		len += utf8_chrw(&str[len]);
+	}
+	return len;
+}
+
+/* Computes utf8_nstrsnlen() one character at a time. */
+static size_t
+ref_nstrsnlen(const char str[], size_t max_screen_width)
+{
+	size_t length_left = strlen(str);
+	size_t len = 0;
+	while(length_left != 0 && max_screen_width != 0)
+	{
+		const size_t char_width = utf8_chrw(&str[len]);
+		const size_t char_screen_width = utf8_chrsw(&str[len]);
+		if(char_width > length_left || char_screen_width > max_screen_width)
+		{
+			break;
+		}
+		max_screen_width -= char_screen_width;
+		len += char_width;
+		length_left -= char_width;
+	}
+	return len;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
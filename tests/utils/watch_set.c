@@ -0,0 +1,263 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <stdio.h> /* fclose() fopen() remove() snprintf() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/watch_set.h"
+
+static void reset_changes(void);
+static void on_change(int id, int gone, void *arg);
+static int using_inotify(void);
+
+static char sandbox[PATH_MAX + 1];
+static char subdir[PATH_MAX + 1];
+static watch_set_t *set;
+static int changed[64];
+static int gone[64];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+
+	if(is_path_absolute(SANDBOX_PATH))
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s", SANDBOX_PATH);
+	}
+	else
+	{
+		snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+	}
+	snprintf(subdir, sizeof(subdir), "%s/dir", sandbox);
+}
+
+SETUP()
+{
+	reset_changes();
+
+	assert_success(os_mkdir(subdir, 0700));
+	assert_non_null(set = watch_set_create(0));
+}
+
+TEARDOWN()
+{
+	watch_set_free(set);
+	(void)rmdir(subdir);
+}
+
+TEST(watch_is_not_added_for_missing_directory)
+{
+	assert_int_equal(-1, watch_set_add(set, SANDBOX_PATH "/no-such-dir"));
+}
+
+TEST(watches_start_as_not_changed)
+{
+	assert_true(watch_set_add(set, sandbox) >= 0);
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[0] + changed[1]);
+}
+
+TEST(same_directory_shares_watch)
+{
+	const int id = watch_set_add(set, sandbox);
+	assert_true(id >= 0);
+	assert_int_equal(id, watch_set_add(set, sandbox));
+	assert_true(watch_set_add(set, subdir) != id);
+}
+
+TEST(change_is_reported_for_its_directory_only, IF(using_inotify))
+{
+	const int id1 = watch_set_add(set, sandbox);
+	const int id2 = watch_set_add(set, subdir);
+	assert_true(id1 >= 0 && id1 < 4);
+	assert_true(id2 >= 0 && id2 < 4);
+
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[id1]);
+	assert_true(changed[id2] > 0);
+
+	changed[id2] = 0;
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[id2]);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[id1]);
+	assert_true(changed[id2] > 0);
+}
+
+TEST(watch_is_kept_until_last_reference_is_removed, IF(using_inotify))
+{
+	const int id = watch_set_add(set, subdir);
+	assert_true(id >= 0 && id < 4);
+	assert_int_equal(id, watch_set_add(set, subdir));
+
+	watch_set_remove(set, id);
+	fclose(fopen(SANDBOX_PATH "/dir/file", "w"));
+	watch_set_check(set, &on_change, NULL);
+	assert_true(changed[id] > 0);
+
+	changed[id] = 0;
+	watch_set_remove(set, id);
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[id]);
+}
+
+TEST(lost_watch_is_reported_until_removed)
+{
+	const int id = watch_set_add(set, subdir);
+	assert_true(id >= 0 && id < 4);
+
+	assert_success(rmdir(subdir));
+	watch_set_check(set, &on_change, NULL);
+	assert_true(gone[id]);
+
+	gone[id] = 0;
+	watch_set_check(set, &on_change, NULL);
+	assert_true(gone[id]);
+
+	/* Slot is reused only after removal. */
+	assert_success(os_mkdir(subdir, 0700));
+	assert_true(watch_set_add(set, subdir) != id);
+	watch_set_remove(set, id);
+	gone[id] = 0;
+	watch_set_check(set, &on_change, NULL);
+	assert_false(gone[id]);
+	assert_int_equal(id, watch_set_add(set, sandbox));
+}
+
+TEST(writes_are_reported_before_closing_if_tracked, IF(using_inotify))
+{
+	FILE *fp;
+	int id;
+
+	watch_set_free(set);
+	assert_non_null(set = watch_set_create(1));
+
+	fp = fopen(SANDBOX_PATH "/dir/file", "w");
+	assert_non_null(fp);
+
+	id = watch_set_add(set, subdir);
+	assert_true(id >= 0 && id < 4);
+
+	assert_true(fputs("text", fp) >= 0);
+	assert_success(fflush(fp));
+	watch_set_check(set, &on_change, NULL);
+	assert_true(changed[id] > 0);
+
+	fclose(fp);
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(writes_are_reported_on_closing_if_not_tracked, IF(using_inotify))
+{
+	FILE *fp = fopen(SANDBOX_PATH "/dir/file", "w");
+	const int id = watch_set_add(set, subdir);
+	assert_non_null(fp);
+	assert_true(id >= 0 && id < 4);
+
+	assert_true(fputs("text", fp) >= 0);
+	assert_success(fflush(fp));
+	watch_set_check(set, &on_change, NULL);
+	assert_int_equal(0, changed[id]);
+
+	fclose(fp);
+	watch_set_check(set, &on_change, NULL);
+	assert_true(changed[id] > 0);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+}
+
+TEST(many_watches_are_tracked_independently, IF(using_inotify))
+{
+	enum { N = 40 };
+
+	char paths[N][PATH_MAX + 1];
+	int ids[N];
+	int i;
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(paths[i], sizeof(paths[i]), "%s/%d", subdir, i);
+		assert_success(os_mkdir(paths[i], 0700));
+		ids[i] = watch_set_add(set, paths[i]);
+		assert_true(ids[i] >= 0);
+	}
+
+	/* Remove every other watch to exercise removal from the middle of
+	 * clusters. */
+	for(i = 0; i < N; i += 2)
+	{
+		watch_set_remove(set, ids[i]);
+	}
+
+	for(i = 1; i < N; i += 2)
+	{
+		int j;
+		char file[PATH_MAX + 1];
+		snprintf(file, sizeof(file), "%s/file", paths[i]);
+		fclose(fopen(file, "w"));
+
+		watch_set_check(set, &on_change, NULL);
+		for(j = 1; j < N; j += 2)
+		{
+			assert_int_equal(j == i, changed[ids[j]] > 0);
+		}
+
+		assert_success(remove(file));
+		watch_set_check(set, &on_change, NULL);
+		reset_changes();
+	}
+
+	for(i = 0; i < N; ++i)
+	{
+		assert_success(rmdir(paths[i]));
+	}
+}
+
+TEST(descriptor_is_available_with_inotify, IF(using_inotify))
+{
+	assert_true(watch_set_get_fd(set) >= 0);
+}
+
+static void
+reset_changes(void)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(changed); ++i)
+	{
+		changed[i] = 0;
+		gone[i] = 0;
+	}
+}
+
+static void
+on_change(int id, int is_gone, void *arg)
+{
+	if(id >= 0 && id < (int)ARRAY_LEN(changed))
+	{
+		++changed[id];
+		gone[id] |= is_gone;
+	}
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */